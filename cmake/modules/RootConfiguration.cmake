@@ -445,6 +445,11 @@ if(vc)
 else()
   set(hasvc undef)
 endif()
+if(zstd)
+  set(haszstd define)
+else()
+  set(haszstd undef)
+endif()
 if(cxx11)
   set(cxxversion cxx11)
   set(usec++11 define)
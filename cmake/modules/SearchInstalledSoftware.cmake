@@ -179,6 +179,19 @@ if(builtin_lzma)
   endif()
 endif()
 
+#---Check for ZSTD-------------------------------------------------------------------
+if(zstd)
+  message(STATUS "Looking for ZSTD")
+  find_package(ZSTD)
+  if(NOT ZSTD_FOUND)
+    if(fail-on-missing)
+      message(FATAL_ERROR "ZSTD library not found and is required (zstd option enabled)")
+    else()
+      message(STATUS "ZSTD not found. Switching off zstd option")
+      set(zstd OFF CACHE BOOL "" FORCE)
+    endif()
+  endif()
+endif()
 
 #---Check for X11 which is mandatory lib on Unix--------------------------------------
 if(x11)
@@ -16,12 +16,15 @@
 //                                                                      //
 // Initial version: Apr 22, 2000                                        //
 //                                                                      //
-// A set of inline byte swapping routines for arrays.                   //
+// A set of byte swapping routines for arrays.                          //
 //                                                                      //
-// The bswapcpy16() and bswapcpy32() routines are used for packing      //
-// arrays of basic types into a buffer in a byte swapped order. Use     //
-// of asm and the `bswap' opcode (available on i486 and up) reduces     //
-// byte swapping overhead on linux.                                     //
+// The R__bswapcpy16(), R__bswapcpy32() and R__bswapcpy64() routines    //
+// are used for packing arrays of basic types into a buffer in a byte   //
+// swapped order (and for unpacking them). On x86-64 they use SSSE3 or  //
+// AVX2 byte shuffles, selected at run time from the capabilities of    //
+// the processor; elsewhere they use a scalar loop. The source and the  //
+// destination do not have to be aligned and may be identical (in      //
+// place swapping), but must not partially overlap.                     //
 //                                                                      //
 // Use of routines is similar to that of memcpy.                        //
 //                                                                      //
@@ -30,9 +33,12 @@
 //    n - is a number of array elements to be copied and byteswapped.   //
 //        (It is not the number of bytes!)                              //
 //                                                                      //
-// For arrays of short type (2 bytes in size) use bswapcpy16().         //
-// For arrays of of 4-byte types (int, float) use bswapcpy32().         //
+// For arrays of short type (2 bytes in size) use R__bswapcpy16().      //
+// For arrays of of 4-byte types (int, float) use R__bswapcpy32().      //
+// For arrays of of 8-byte types (long long, double) use R__bswapcpy64()//
 //                                                                      //
+// The inline bswapcpy16() and bswapcpy32() are the original i386       //
+// assembler versions.                                                  //
 //                                                                      //
 // Author: Alexandre V. Vaniachine <AVVaniachine@lbl.gov>               //
 //                                                                      //
@@ -42,6 +48,12 @@
 #include <sys/types.h>
 #endif
 
+void R__bswapcpy16(void *to, const void *from, size_t n);
+void R__bswapcpy32(void *to, const void *from, size_t n);
+void R__bswapcpy64(void *to, const void *from, size_t n);
+
+#if defined(__i386__) && defined(__GNUC__) && !defined(__CINT__)
+
 extern inline void * bswapcpy16(void * to, const void * from, size_t n)
 {
 int d0, d1, d2, d3;
@@ -78,4 +90,6 @@ __asm__ __volatile__(
         :"memory");
 return (to);
 }
+#endif // __i386__
+
 #endif
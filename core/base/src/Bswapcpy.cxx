@@ -0,0 +1,193 @@
+// @(#)root/base:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/**
+\file Bswapcpy.cxx
+Byte swapping copy of arrays of 2, 4 and 8 byte elements.
+
+The kernels are selected once, at the first call, from the capabilities
+of the processor: AVX2 (32 bytes per shuffle), SSSE3 (16 bytes per
+shuffle) or a scalar loop. The vector kernels are compiled with function
+level target attributes, so the library itself does not require a
+processor supporting these instructions.
+*/
+
+#include "Bswapcpy.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) && !defined(__CINT__) && \
+    (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))))
+#define R__BSWAPCPY_X86
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*BswapcpyFunc_t)(unsigned char *to, const unsigned char *from, size_t n, size_t size);
+
+////////////////////////////////////////////////////////////////////////////////
+/// Scalar kernel, also used for the tail of the vector kernels.
+/// Each element is loaded completely before being stored, which makes the
+/// in place swapping (to == from) safe.
+
+void BswapcpyScalar(unsigned char *to, const unsigned char *from, size_t n, size_t size)
+{
+   switch (size) {
+      case 2:
+         for (size_t i = 0; i < n; ++i, to += 2, from += 2) {
+            unsigned char b0 = from[0], b1 = from[1];
+            to[0] = b1; to[1] = b0;
+         }
+         break;
+      case 4:
+         for (size_t i = 0; i < n; ++i, to += 4, from += 4) {
+            unsigned int v;
+            memcpy(&v, from, 4);
+            v = ((v & 0x000000ffU) << 24) | ((v & 0x0000ff00U) << 8) |
+                ((v & 0x00ff0000U) >> 8) | ((v & 0xff000000U) >> 24);
+            memcpy(to, &v, 4);
+         }
+         break;
+      case 8:
+         for (size_t i = 0; i < n; ++i, to += 8, from += 8) {
+            unsigned char b[8];
+            memcpy(b, from, 8);
+            for (int j = 0; j < 8; ++j) to[j] = b[7 - j];
+         }
+         break;
+   }
+}
+
+#ifdef R__BSWAPCPY_X86
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fill the pshufb control of 32 bytes reversing the bytes of each element
+/// of the given size. Elements never straddle the 16 bytes lanes.
+
+void BswapcpyMask(unsigned char *mask, size_t size)
+{
+   for (size_t k = 0; k < 32; ++k)
+      mask[k] = (unsigned char)(((k % 16) / size) * size + (size - 1 - k % size));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// SSSE3 kernel.
+
+__attribute__((target("ssse3")))
+void BswapcpySSSE3(unsigned char *to, const unsigned char *from, size_t n, size_t size)
+{
+   unsigned char m[32];
+   BswapcpyMask(m, size);
+   const __m128i mask = _mm_loadu_si128((const __m128i *)m);
+   const size_t nbytes = n * size;
+   size_t i = 0;
+   for (; i + 32 <= nbytes; i += 32) {
+      __m128i v0 = _mm_loadu_si128((const __m128i *)(from + i));
+      __m128i v1 = _mm_loadu_si128((const __m128i *)(from + i + 16));
+      _mm_storeu_si128((__m128i *)(to + i), _mm_shuffle_epi8(v0, mask));
+      _mm_storeu_si128((__m128i *)(to + i + 16), _mm_shuffle_epi8(v1, mask));
+   }
+   for (; i + 16 <= nbytes; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + i));
+      _mm_storeu_si128((__m128i *)(to + i), _mm_shuffle_epi8(v, mask));
+   }
+   BswapcpyScalar(to + i, from + i, (nbytes - i) / size, size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// AVX2 kernel.
+
+__attribute__((target("avx2")))
+void BswapcpyAVX2(unsigned char *to, const unsigned char *from, size_t n, size_t size)
+{
+   unsigned char m[32];
+   BswapcpyMask(m, size);
+   const __m256i mask = _mm256_loadu_si256((const __m256i *)m);
+   const size_t nbytes = n * size;
+   size_t i = 0;
+   for (; i + 64 <= nbytes; i += 64) {
+      __m256i v0 = _mm256_loadu_si256((const __m256i *)(from + i));
+      __m256i v1 = _mm256_loadu_si256((const __m256i *)(from + i + 32));
+      _mm256_storeu_si256((__m256i *)(to + i), _mm256_shuffle_epi8(v0, mask));
+      _mm256_storeu_si256((__m256i *)(to + i + 32), _mm256_shuffle_epi8(v1, mask));
+   }
+   for (; i + 32 <= nbytes; i += 32) {
+      __m256i v = _mm256_loadu_si256((const __m256i *)(from + i));
+      _mm256_storeu_si256((__m256i *)(to + i), _mm256_shuffle_epi8(v, mask));
+   }
+   if (i + 16 <= nbytes) {
+      const __m128i mask128 = _mm256_castsi256_si128(mask);
+      __m128i v = _mm_loadu_si128((const __m128i *)(from + i));
+      _mm_storeu_si128((__m128i *)(to + i), _mm_shuffle_epi8(v, mask128));
+      i += 16;
+   }
+   BswapcpyScalar(to + i, from + i, (nbytes - i) / size, size);
+}
+
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+/// Select the best kernel supported by the processor.
+
+BswapcpyFunc_t BswapcpySelect()
+{
+#ifdef R__BSWAPCPY_X86
+   __builtin_cpu_init();
+   if (__builtin_cpu_supports("avx2"))
+      return BswapcpyAVX2;
+   if (__builtin_cpu_supports("ssse3"))
+      return BswapcpySSSE3;
+#endif
+   return BswapcpyScalar;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Dispatch to the selected kernel. Short arrays, the most frequent case
+/// when streaming objects member by member, do not pay for the indirect
+/// call.
+
+inline void Bswapcpy(void *to, const void *from, size_t n, size_t size)
+{
+   unsigned char *t = (unsigned char *)to;
+   const unsigned char *f = (const unsigned char *)from;
+   if (n * size < 16) {
+      BswapcpyScalar(t, f, n, size);
+      return;
+   }
+   static const BswapcpyFunc_t kernel = BswapcpySelect();
+   kernel(t, f, n, size);
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/// Copy n 2-byte elements from `from` to `to` swapping their bytes.
+
+void R__bswapcpy16(void *to, const void *from, size_t n)
+{
+   Bswapcpy(to, from, n, 2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Copy n 4-byte elements from `from` to `to` swapping their bytes.
+
+void R__bswapcpy32(void *to, const void *from, size_t n)
+{
+   Bswapcpy(to, from, n, 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Copy n 8-byte elements from `from` to `to` swapping their bytes.
+
+void R__bswapcpy64(void *to, const void *from, size_t n)
+{
+   Bswapcpy(to, from, n, 8);
+}
@@ -102,6 +102,9 @@ namespace ROOT {
          T operator-(int v) {
             return fCounter - v;
          }
+         difference_type operator-(const iterator &other) const {
+            return (fCounter - other.fCounter) / fStep;
+         }
          iterator &operator--() {
             fCounter -= fStep;
             return *this;
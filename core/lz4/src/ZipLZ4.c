@@ -0,0 +1,295 @@
+// @(#)root/lz4:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/* Self-contained implementation of the LZ4 block format.
+   A compressed block is a sequence of (token, literals, offset, match)
+   records.  The token holds the literal length in its high nibble and
+   the match length minus 4 in its low nibble; a nibble value of 15 is
+   followed by extension bytes (255 means "add and continue").  The
+   offset is a 16 bit little endian backward distance.  The last record
+   only carries literals.  LZ4 favours decompression speed over ratio:
+   it is typically several times faster to inflate than zlib for
+   slightly bigger output.
+
+   The compression level selects how hard the compressor searches for
+   matches: level 1 uses a single hash probe and skips faster over
+   incompressible data, higher levels follow a hash chain of up to
+   2^(level-1) candidates.  The decompressor does not depend on the
+   level. */
+
+#include "ZipLZ4.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const int kHeaderSize = 9;
+static const int kLZ4Version = 1;
+
+#define LZ4_MINMATCH      4
+#define LZ4_LASTLITERALS  5   /* the last 5 bytes are always literals */
+#define LZ4_MFLIMIT       12  /* the last match starts 12 bytes before the end */
+#define LZ4_MAXDISTANCE   65535
+#define LZ4_HASHLOG       16
+#define LZ4_HASHSIZE      (1 << LZ4_HASHLOG)
+#define LZ4_CHAINSIZE     65536 /* must be larger than LZ4_MAXDISTANCE */
+
+static unsigned R__lz4_read32(const unsigned char *p)
+{
+   unsigned v;
+   memcpy(&v, p, 4);
+   return v;
+}
+
+static unsigned R__lz4_hash(unsigned v)
+{
+   return ((v * 2654435761U) & 0xffffffffU) >> (32 - LZ4_HASHLOG);
+}
+
+static void R__lz4_insert(const unsigned char *in, int *head, int *chain, int pos)
+{
+   unsigned h = R__lz4_hash(R__lz4_read32(in + pos));
+   if (chain) chain[pos & (LZ4_CHAINSIZE - 1)] = head[h];
+   head[h] = pos;
+}
+
+static unsigned char *R__lz4_put_length(unsigned char *op, int len)
+{
+   while (len >= 255) {
+      *op++ = 255;
+      len -= 255;
+   }
+   *op++ = (unsigned char)len;
+   return op;
+}
+
+void R__zipLZ4(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep)
+{
+   const unsigned char *in = (const unsigned char *)src;
+   int in_size = *srcsize;
+   unsigned char *op, *oend, *token;
+   int *head, *chain;
+   int ip, anchor, mflimit, matchlimit, maxAttempts, i, lit;
+   unsigned out_size;
+
+   *irep = 0;
+
+   if (*tgtsize <= kHeaderSize) {
+      return;
+   }
+
+   if (in_size > 0xffffff || in_size < 0) {
+      return;
+   }
+
+   if (cxlevel > 9) cxlevel = 9;
+   maxAttempts = (cxlevel <= 1) ? 1 : (1 << (cxlevel - 1));
+
+   head = (int *)malloc(LZ4_HASHSIZE * sizeof(int));
+   chain = (cxlevel > 1) ? (int *)malloc(LZ4_CHAINSIZE * sizeof(int)) : 0;
+   if (!head || (cxlevel > 1 && !chain)) {
+      free(head);
+      free(chain);
+      return;
+   }
+   for (i = 0; i < LZ4_HASHSIZE; ++i) head[i] = -1;
+
+   op   = (unsigned char *)(&tgt[kHeaderSize]);
+   oend = (unsigned char *)tgt + *tgtsize;
+
+   ip = 0;
+   anchor = 0;
+   mflimit = in_size - LZ4_MFLIMIT;
+   matchlimit = in_size - LZ4_LASTLITERALS;
+
+   while (ip <= mflimit) {
+      unsigned seq = R__lz4_read32(in + ip);
+      int cand = head[R__lz4_hash(seq)];
+      int attempts = maxAttempts;
+      int bestLen = 0, bestRef = -1;
+
+      while (cand >= 0 && ip - cand <= LZ4_MAXDISTANCE && attempts-- > 0) {
+         if (R__lz4_read32(in + cand) == seq) {
+            int len = LZ4_MINMATCH;
+            while (ip + len < matchlimit && in[cand + len] == in[ip + len]) ++len;
+            if (len > bestLen) {
+               bestLen = len;
+               bestRef = cand;
+            }
+         }
+         if (!chain) break;
+         {
+            int next = chain[cand & (LZ4_CHAINSIZE - 1)];
+            if (next >= cand) break;
+            cand = next;
+         }
+      }
+      R__lz4_insert(in, head, chain, ip);
+
+      if (bestLen < LZ4_MINMATCH) {
+         /* Level 1 accelerates over incompressible data */
+         ip += (cxlevel <= 1) ? 1 + ((ip - anchor) >> 6) : 1;
+         continue;
+      }
+
+      /* Encode the literals followed by the match */
+      lit = ip - anchor;
+      if (op + 1 + lit / 255 + 1 + lit + 2 + (bestLen - LZ4_MINMATCH) / 255 + 1 > oend) {
+         /* The compressed buffer would be larger than the target buffer */
+         free(head);
+         free(chain);
+         return;
+      }
+      token = op++;
+      if (lit >= 15) {
+         *token = (unsigned char)(15 << 4);
+         op = R__lz4_put_length(op, lit - 15);
+      } else {
+         *token = (unsigned char)(lit << 4);
+      }
+      memcpy(op, in + anchor, lit);
+      op += lit;
+
+      *op++ = (unsigned char)((ip - bestRef) & 0xff);
+      *op++ = (unsigned char)(((ip - bestRef) >> 8) & 0xff);
+
+      if (bestLen - LZ4_MINMATCH >= 15) {
+         *token |= 15;
+         op = R__lz4_put_length(op, bestLen - LZ4_MINMATCH - 15);
+      } else {
+         *token |= (unsigned char)(bestLen - LZ4_MINMATCH);
+      }
+
+      for (i = ip + 1; i < ip + bestLen && i <= mflimit; ++i)
+         R__lz4_insert(in, head, chain, i);
+      ip += bestLen;
+      anchor = ip;
+   }
+
+   free(head);
+   free(chain);
+
+   /* Last literals */
+   lit = in_size - anchor;
+   if (op + 1 + lit / 255 + 1 + lit > oend) {
+      return;
+   }
+   token = op++;
+   if (lit >= 15) {
+      *token = (unsigned char)(15 << 4);
+      op = R__lz4_put_length(op, lit - 15);
+   } else {
+      *token = (unsigned char)(lit << 4);
+   }
+   memcpy(op, in + anchor, lit);
+   op += lit;
+
+   out_size = (unsigned)(op - (unsigned char *)(&tgt[kHeaderSize]));
+   if (out_size > 0xffffff) {
+      return;
+   }
+
+   tgt[0] = 'L';  /* Signature of LZ4 */
+   tgt[1] = '4';
+   tgt[2] = (char)kLZ4Version;
+
+   tgt[3] = (char)(out_size & 0xff);
+   tgt[4] = (char)((out_size >> 8) & 0xff);
+   tgt[5] = (char)((out_size >> 16) & 0xff);
+
+   tgt[6] = (char)(in_size & 0xff);         /* decompressed size */
+   tgt[7] = (char)((in_size >> 8) & 0xff);
+   tgt[8] = (char)((in_size >> 16) & 0xff);
+
+   *irep = (int)out_size + kHeaderSize;
+}
+
+void R__unzipLZ4(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep)
+{
+   const unsigned char *ip, *iend;
+   unsigned char *op, *oend;
+   long ibufcnt;
+
+   *irep = 0;
+
+   if (*srcsize < kHeaderSize || src[0] != 'L' || src[1] != '4') {
+      fprintf(stderr, "R__unzipLZ4: error in header\n");
+      return;
+   }
+   if (src[2] != kLZ4Version) {
+      fprintf(stderr, "R__unzipLZ4: unsupported LZ4 format version %d\n", (int)src[2]);
+      return;
+   }
+
+   ibufcnt = (long)src[3] | ((long)src[4] << 8) | ((long)src[5] << 16);
+   if (ibufcnt + kHeaderSize > *srcsize) {
+      fprintf(stderr, "R__unzipLZ4: discrepancy in source length\n");
+      return;
+   }
+
+   ip   = src + kHeaderSize;
+   iend = ip + ibufcnt;
+   op   = tgt;
+   oend = tgt + *tgtsize;
+
+   while (ip < iend) {
+      unsigned token = *ip++;
+      size_t lit = token >> 4;
+      size_t ml;
+      size_t offset;
+      unsigned s;
+      const unsigned char *match;
+
+      if (lit == 15) {
+         do {
+            if (ip >= iend) goto corrupted;
+            s = *ip++;
+            lit += s;
+         } while (s == 255);
+      }
+      if ((size_t)(iend - ip) < lit || (size_t)(oend - op) < lit) goto corrupted;
+      memcpy(op, ip, lit);
+      op += lit;
+      ip += lit;
+
+      /* The last sequence only carries literals */
+      if (ip >= iend) break;
+
+      if (iend - ip < 2) goto corrupted;
+      offset = (size_t)ip[0] | ((size_t)ip[1] << 8);
+      ip += 2;
+      if (offset == 0 || offset > (size_t)(op - tgt)) goto corrupted;
+
+      ml = token & 15;
+      if (ml == 15) {
+         do {
+            if (ip >= iend) goto corrupted;
+            s = *ip++;
+            ml += s;
+         } while (s == 255);
+      }
+      ml += LZ4_MINMATCH;
+      if ((size_t)(oend - op) < ml) goto corrupted;
+
+      match = op - offset;
+      if (offset >= ml) {
+         memcpy(op, match, ml);
+         op += ml;
+      } else {
+         /* Overlapping copy, the match repeats the last offset bytes */
+         while (ml--) *op++ = *match++;
+      }
+   }
+
+   *irep = (int)(op - tgt);
+   return;
+
+corrupted:
+   fprintf(stderr, "R__unzipLZ4: corrupted input at byte %ld\n", (long)(ip - src));
+}
@@ -21,11 +21,15 @@ MULTIPROCDH     := $(MULTIPROCDS:.cxx=.h)
 MULTIPROCH      := $(MODDIRI)/TMPClient.h $(MODDIRI)/TProcPool.h \
                 $(MODDIRI)/TMPWorker.h $(MODDIRI)/MPSendRecv.h \
                 $(MODDIRI)/TPoolWorker.h $(MODDIRI)/TPoolProcessor.h \
+                $(MODDIRI)/TPoolPacketizer.h $(MODDIRI)/TMPSharedMem.h \
+                $(MODDIRI)/TPersistentProcPool.h $(MODDIRI)/TPersistentPoolWorker.h \
                 $(MODDIRI)/MPCode.h $(MODDIRI)/PoolUtils.h
 
 MULTIPROCS      := $(MODDIRS)/TMPClient.cxx $(MODDIRS)/TProcPool.cxx \
                 $(MODDIRS)/TMPWorker.cxx $(MODDIRS)/MPSendRecv.cxx \
                 $(MODDIRS)/TPoolWorker.cxx $(MODDIRS)/TPoolProcessor.cxx \
+                $(MODDIRS)/TPoolPacketizer.cxx $(MODDIRS)/TMPSharedMem.cxx \
+                $(MODDIRS)/TPersistentProcPool.cxx \
                 $(MODDIRS)/PoolUtils.cxx
 
 MULTIPROCO      := $(call stripsrc,$(MULTIPROCS:.cxx=.o))
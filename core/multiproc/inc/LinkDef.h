@@ -19,5 +19,6 @@
 #pragma link C++ class TMPWorker+;
 #pragma link C++ class TMPInterruptHandler+;
 #pragma link C++ class TProcPool+;
+#pragma link C++ struct PoolUtils::TEntryPacket+;
 
 #endif
@@ -10,6 +10,8 @@
 #include <type_traits> //enable_if
 #include <iostream>
 
+class TMPSharedMem;
+
 //////////////////////////////////////////////////////////////////////////
 /// An std::pair that wraps the code and optional object contained in a message.
 /// \param first message code
@@ -41,6 +43,24 @@ int MPSend(TSocket *s, unsigned code, T obj);
 
 MPCodeBufPair MPRecv(TSocket *s);
 
+// These functions let a client and its workers exchange large objects
+// through a region of memory shared between them (see TMPSharedMem)
+void MPAttachSharedMem(TSocket *s, TMPSharedMem *mem, unsigned regionN, bool isWorker);
+void MPDetachSharedMem(TSocket *s);
+void MPDetachSharedMem(TMPSharedMem *mem);
+int MPSendObjBuf(TSocket *s, unsigned code, const TBufferFile &objBuf);
+bool MPStashBuf(TSocket *s, const TBufferFile &objBuf);
+std::unique_ptr<TBufferFile> MPUnstash(TSocket *s, unsigned regionN);
+
+template<class T, typename std::enable_if<std::is_class<T>::value>::type * = nullptr>
+bool MPStash(TSocket *s, T obj);
+
+template < class T, typename std::enable_if < std::is_pointer<T>::value  &&std::is_constructible<TObject *, T>::value >::type * = nullptr >
+bool MPStash(TSocket *s, T obj);
+
+template < class T, typename std::enable_if < !std::is_class<T>::value && !(std::is_pointer<T>::value && std::is_constructible<TObject *, T>::value) >::type * = nullptr >
+bool MPStash(TSocket *s, T obj);
+
 
 //this version reads classes from the message
 template<class T, typename std::enable_if<std::is_class<T>::value>::type * = nullptr>
@@ -86,11 +106,7 @@ int MPSend(TSocket *s, unsigned code, T obj)
    }
    TBufferFile objBuf(TBuffer::kWrite);
    objBuf.WriteObjectAny(&obj, c);
-   TBufferFile wBuf(TBuffer::kWrite);
-   wBuf.WriteUInt(code);
-   wBuf.WriteULong(objBuf.Length());
-   wBuf.WriteBuf(objBuf.Buffer(), objBuf.Length());
-   return s->SendRaw(wBuf.Buffer(), wBuf.Length());
+   return MPSendObjBuf(s, code, objBuf);
 }
 
 /// \cond
@@ -126,17 +142,50 @@ int MPSend(TSocket *s, unsigned code, T obj)
    if(obj != nullptr)
       objBuf.WriteObjectAny(obj, obj->IsA());
 
-   //write everything together in a buffer
-   TBufferFile wBuf(TBuffer::kWrite);
-   wBuf.WriteUInt(code);
-   wBuf.WriteULong(objBuf.Length());
-   if(objBuf.Length())
-      wBuf.WriteBuf(objBuf.Buffer(), objBuf.Length());
-   return s->SendRaw(wBuf.Buffer(), wBuf.Length());
+   //write everything together in a buffer, or in shared memory
+   return MPSendObjBuf(s, code, objBuf);
 }
 
 /// \endcond
 
+//////////////////////////////////////////////////////////////////////////
+/// Leave an object in the shared memory region of this worker, where
+/// another worker can retrieve it with MPUnstash() and ReadBuffer().
+/// Only classes and pointers to TObject can be stashed: the other versions
+/// of this function always return false.
+/// \param s the socket of the worker, which must be attached to a shared memory region
+/// \param obj the object to be stashed
+/// \return true if the object was stashed, false if it must be sent with MPSend()
+template<class T, typename std::enable_if<std::is_class<T>::value>::type *>
+bool MPStash(TSocket *s, T obj)
+{
+   TClass *c = TClass::GetClass(typeid(T));
+   if (!c)
+      return false;
+   TBufferFile objBuf(TBuffer::kWrite);
+   objBuf.WriteObjectAny(&obj, c);
+   return MPStashBuf(s, objBuf);
+}
+
+/// \cond
+template < class T, typename std::enable_if < std::is_pointer<T>::value  &&std::is_constructible<TObject *, T>::value >::type * >
+bool MPStash(TSocket *s, T obj)
+{
+   if (obj == nullptr)
+      return false;
+   TBufferFile objBuf(TBuffer::kWrite);
+   objBuf.WriteObjectAny(obj, obj->IsA());
+   return MPStashBuf(s, objBuf);
+}
+
+// built-in types are small: they are always sent through the socket
+template < class T, typename std::enable_if < !std::is_class<T>::value && !(std::is_pointer<T>::value && std::is_constructible<TObject *, T>::value) >::type * >
+bool MPStash(TSocket *, T)
+{
+   return false;
+}
+/// \endcond
+
 //////////////////////////////////////////////////////////////////////////
 /// One of the template functions used to read objects from messages.
 /// Different implementations are provided for different types of objects:
@@ -13,8 +13,12 @@
 #define ROOT_PoolUtils
 
 #include "TObject.h"
+#include <string>
 #include <vector>
 
+class TFile;
+class TTree;
+
 namespace PoolCode {
 
    //////////////////////////////////////////////////////////////////////////
@@ -32,10 +36,14 @@ namespace PoolCode {
       /* TPool::MapReduce */
       kIdling,          ///< We are ready for the next task
       kSendResult,      ///< Ask for a kFuncResult/kProcResult
+      kStashResult,     ///< Ask a worker to leave its result in shared memory for another worker, or to send a kFuncResult/kProcResult if it cannot
+      kResultStashed,   ///< The result was left in shared memory. The object sent is the number of the worker
+      kReduceWith,      ///< Tell a worker to reduce the result stashed by another worker with its own. The object sent is the number of that worker
       /* TPool::Process */
       kProcFile,        ///< Tell a TPoolProcessor which tree to process. The object sent is a TreeInfo
       kProcRange,       ///< Tell a TPoolProcessor which tree and entries range to process. The object sent is a TreeRangeInfo
       kProcTree,        ///< Tell a TPoolProcessor to process the tree that was passed to it at construction time
+      kProcEntries,     ///< Tell a TPoolProcessor which file and entries range to process. The object sent is a PoolUtils::TEntryPacket
       kProcResult,      ///< The message contains the result of the processing of a TTree
       kProcEnded,       ///< Tell the client we are done processing (i.e. we have reached the target number of entries to process)
       kProcError,       ///< Tell the client there was an error while processing
@@ -51,6 +59,19 @@ namespace PoolCode {
 //////////////////////////////////////////////////////////////////////////
 namespace PoolUtils {
    TObject* ReduceObjects(const std::vector<TObject *>& objs);
+   TTree* GetTree(TFile *fp, const std::string &treeName);
+
+   //////////////////////////////////////////////////////////////////////////
+   ///
+   /// A range of entries of one of the files processed by TProcPool::ProcTree,
+   /// made of whole clusters. See TPoolPacketizer.
+   ///
+   //////////////////////////////////////////////////////////////////////////
+   struct TEntryPacket {
+      unsigned fFileN; ///< index of the file in the list of files to process
+      Long64_t fStart; ///< first entry of the range
+      Long64_t fEnd;   ///< entry following the last entry of the range
+   };
 }
 
 #endif
@@ -15,6 +15,7 @@
 #include "TMonitor.h"
 #include "TMPWorker.h"
 #include "MPSendRecv.h"
+#include "TMPSharedMem.h"
 #include <vector>
 #include <unistd.h> //pid_t
 #include <memory> //unique_ptr
@@ -38,9 +39,14 @@ public:
    /// Set the number of workers that will be spawned by the next call to Fork()
    void SetNWorkers(unsigned n) { fNWorkers = n; }
    unsigned GetNWorkers() const { return fNWorkers; }
+   /// Set the size, in bytes, of the shared memory region of each worker spawned by the next call to Fork(). 0 disables it.
+   void SetSharedMemSize(ULong_t size) { fSharedMemSize = size; }
+   ULong_t GetSharedMemSize() const { return fSharedMemSize; }
+   bool HasSharedMem() const { return fSharedMem != nullptr; }
    void DeActivate(TSocket *s);
    void Remove(TSocket *s);
    void ReapWorkers();
+   void ReapDeadWorkers();
    void HandleMPCode(MPCodeBufPair &msg, TSocket *sender);
 
 private:
@@ -48,6 +54,8 @@ private:
    std::vector<pid_t> fWorkerPids; ///< A vector containing the PIDs of children processes/workers
    TMonitor fMon; ///< This object manages the sockets and detect socket events via TMonitor::Select
    unsigned fNWorkers; ///< The number of workers that should be spawned upon forking
+   std::unique_ptr<TMPSharedMem> fSharedMem; ///< The memory regions shared with the workers, if any
+   ULong_t fSharedMemSize; ///< The size of the shared memory region of each worker, 0 to disable it
 };
 
 
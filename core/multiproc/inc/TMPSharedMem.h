@@ -0,0 +1,42 @@
+/* @(#)root/multiproc:$Id$ */
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TMPSharedMem
+#define ROOT_TMPSharedMem
+
+#include "TBufferFile.h"
+#include "RtypesCore.h"
+#include <memory> //unique_ptr
+
+class TMPSharedMem {
+public:
+   TMPSharedMem(unsigned nRegions, ULong_t regionSize);
+   ~TMPSharedMem();
+   //it doesn't make sense to copy a TMPSharedMem (it owns the mapping)
+   TMPSharedMem(const TMPSharedMem &) = delete;
+   TMPSharedMem &operator=(const TMPSharedMem &) = delete;
+
+   bool IsValid() const { return fBase != nullptr; }
+   unsigned GetNRegions() const { return fNRegions; }
+   ULong_t GetRegionSize() const { return fRegionSize; }
+
+   bool Put(unsigned regionN, const char *buf, ULong_t len);
+   std::unique_ptr<TBufferFile> Take(unsigned regionN);
+
+private:
+   char *GetRegion(unsigned regionN) const;
+
+   char *fBase;          ///< start of the mapping shared by the client and all the workers
+   unsigned fNRegions;   ///< the number of regions, one per worker
+   ULong_t fRegionSize;  ///< the size of the data part of each region, in bytes
+   ULong_t fStride;      ///< the distance between the beginning of two consecutive regions, in bytes
+};
+
+#endif
@@ -0,0 +1,65 @@
+/* @(#)root/multiproc:$Id$ */
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TPersistentPoolWorker
+#define ROOT_TPersistentPoolWorker
+
+#include "TMPWorker.h"
+#include "PoolUtils.h"
+#include "MPCode.h"
+#include "MPSendRecv.h"
+#include <memory> //unique_ptr
+#include <string>
+#include <type_traits> //std::decay
+#include <utility> //std::declval
+
+//////////////////////////////////////////////////////////////////////////
+///
+/// The worker of a TPersistentProcPool. It calls initFunc once, right
+/// after forking, and keeps the state it returns for the whole life of
+/// the process. Each argument of type T received from the client is then
+/// passed to func together with the state, and the result is sent back.
+///
+//////////////////////////////////////////////////////////////////////////
+template<class F, class I, class T>
+class TPersistentPoolWorker : public TMPWorker {
+public:
+   using State_t = typename std::decay<decltype(std::declval<I&>()())>::type;
+
+   TPersistentPoolWorker(F func, I initFunc) : TMPWorker(), fFunc(func), fInitFunc(initFunc), fState() {}
+   ~TPersistentPoolWorker() {}
+
+   void Init(int fd, unsigned workerN) ///< Build the state of this worker
+   {
+      TMPWorker::Init(fd, workerN);
+      fState.reset(new State_t(fInitFunc()));
+   }
+
+   void HandleInput(MPCodeBufPair &msg) ///< Execute instructions received from a TPersistentProcPool client
+   {
+      unsigned code = msg.first;
+      TSocket *s = GetSocket();
+      if (code == PoolCode::kExecFuncWithArg) {
+         T arg = ReadBuffer<T>(msg.second.get());
+         MPSend(s, PoolCode::kFuncResult, fFunc(*fState, arg));
+      } else {
+         std::string reply = "S" + std::to_string(GetNWorker());
+         reply += ": unknown code received: " + std::to_string(code);
+         MPSend(s, MPCode::kError, reply.data());
+      }
+   }
+
+private:
+   F fFunc; ///< the function to be executed on each argument
+   I fInitFunc; ///< the function building the state of the worker
+   std::unique_ptr<State_t> fState; ///< the state of the worker, built after forking and kept between tasks
+};
+
+#endif
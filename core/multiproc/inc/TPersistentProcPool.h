@@ -0,0 +1,208 @@
+/* @(#)root/multiproc:$Id$ */
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TPersistentProcPool
+#define ROOT_TPersistentProcPool
+
+#include "TMPClient.h"
+#include "MPSendRecv.h"
+#include "MPCode.h"
+#include "PoolUtils.h"
+#include "TPersistentPoolWorker.h"
+#include "TList.h"
+#include <algorithm> //std::remove
+#include <deque>
+#include <map>
+#include <memory> //std::unique_ptr
+#include <type_traits> //std::decay
+#include <utility> //std::declval
+#include <vector>
+#include <iostream>
+
+template<class F, class I, class T>
+class TPersistentProcPool : private TMPClient {
+public:
+   using State_t = typename TPersistentPoolWorker<F, I, T>::State_t;
+   using Result_t = typename std::decay<decltype(std::declval<F&>()(std::declval<State_t&>(), std::declval<T&>()))>::type;
+
+   TPersistentProcPool(F func, I initFunc, unsigned nWorkers = 0);
+   ~TPersistentProcPool() {}
+   //it doesn't make sense for a TPersistentProcPool to be copied
+   TPersistentProcPool(const TPersistentProcPool &) = delete;
+   TPersistentProcPool &operator=(const TPersistentProcPool &) = delete;
+
+   std::vector<Result_t> Map(const std::vector<T> &args);
+   template<class R> Result_t MapReduce(const std::vector<T> &args, R redfunc);
+
+   bool IsStarted() const { return fStarted; }
+   void SetNWorkers(unsigned n) { if (!fStarted) TMPClient::SetNWorkers(n); }
+   unsigned GetNWorkers() const { return TMPClient::GetNWorkers(); }
+   void SetSharedMemSize(ULong_t size) { if (!fStarted) TMPClient::SetSharedMemSize(size); }
+
+private:
+   bool Start();
+   unsigned GetNConnected() { return GetMonitor().GetActive() + GetMonitor().GetDeActive(); }
+
+   F fFunc; ///< the function executed by the workers on each argument
+   I fInitFunc; ///< the function building the state of each worker
+   bool fStarted; ///< true once the workers have been forked
+};
+
+
+/************ TEMPLATE METHODS IMPLEMENTATION ******************/
+
+//////////////////////////////////////////////////////////////////////////
+/// Class constructor.
+/// The workers are not forked until the first call to Map or MapReduce.
+/// func is called as `func(state, arg)`, where state is the object
+/// returned by initFunc in the worker and arg is one of the arguments.
+/// nWorkers is the number of workers, 0 meaning the number of cores.
+template<class F, class I, class T>
+TPersistentProcPool<F, I, T>::TPersistentProcPool(F func, I initFunc, unsigned nWorkers) :
+   TMPClient(nWorkers), fFunc(func), fInitFunc(initFunc), fStarted(false)
+{}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Fork the workers, which build their state and wait for arguments.
+template<class F, class I, class T>
+bool TPersistentProcPool<F, I, T>::Start()
+{
+   TPersistentPoolWorker<F, I, T> worker(fFunc, fInitFunc);
+   //only the client returns from Fork
+   fStarted = Fork(worker) && GetNConnected() > 0;
+   return fStarted;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Execute func on each element of args in the workers, and return the
+/// results in the same order as the arguments.
+/// The workers are forked at the first call, and are reused by the
+/// following ones: their state is preserved and only the arguments and
+/// the results are exchanged. The arguments of the workers that are lost
+/// are given to the others. If no worker is left, new ones are forked
+/// once, building their state again with initFunc; if they are lost too,
+/// or cannot be forked, an error is printed and an empty vector is returned.
+template<class F, class I, class T>
+auto TPersistentProcPool<F, I, T>::Map(const std::vector<T> &args) -> std::vector<Result_t>
+{
+   std::vector<Result_t> reslist(args.size());
+   if (args.empty())
+      return reslist;
+
+   ReapDeadWorkers();
+   if (!fStarted || GetNConnected() == 0) {
+      if (!Start()) {
+         std::cerr << "[E][C] Could not fork. Aborting operation\n";
+         return std::vector<Result_t>();
+      }
+   }
+
+   //the indices of the arguments that have not been handed out yet
+   std::deque<unsigned> pending;
+   for (unsigned i = 0; i < args.size(); ++i)
+      pending.push_back(i);
+   //the argument each worker is processing
+   std::map<TSocket *, unsigned> busy;
+   std::vector<TSocket *> idle;
+
+   auto giveTask = [&](TSocket *s) {
+      if (pending.empty()) {
+         idle.push_back(s);
+         return;
+      }
+      unsigned n = pending.front();
+      pending.pop_front();
+      MPSend(s, PoolCode::kExecFuncWithArg, args[n]);
+      busy[s] = n;
+   };
+
+   //give workers their first task
+   TMonitor &mon = GetMonitor();
+   auto giveFirstTasks = [&]() {
+      mon.ActivateAll();
+      std::unique_ptr<TList> lp(mon.GetListOfActives());
+      for (auto s : *lp)
+         giveTask(static_cast<TSocket *>(s));
+   };
+   giveFirstTasks();
+
+   //collect results, give out other tasks
+   unsigned nReceived = 0;
+   bool reforked = false;
+   while (nReceived < args.size()) {
+      if (mon.GetActive() == 0) {
+         //all the workers were lost: fork new ones, only once per call not
+         //to loop forever on an argument that makes the workers crash
+         ReapDeadWorkers();
+         if (reforked || !Start())
+            break;
+         reforked = true;
+         std::cerr << "[W][C] All the workers were lost. Forking new ones\n";
+         giveFirstTasks();
+         continue;
+      }
+      TSocket *s = mon.Select();
+      MPCodeBufPair msg = MPRecv(s);
+      unsigned code = msg.first;
+      if (code == MPCode::kRecvError || code == MPCode::kShutdownNotice || code == MPCode::kFatalError) {
+         //the worker is gone: its argument goes to another worker
+         auto it = busy.find(s);
+         if (it != busy.end()) {
+            pending.push_front(it->second);
+            busy.erase(it);
+         }
+         idle.erase(std::remove(idle.begin(), idle.end(), s), idle.end());
+         if (code == MPCode::kRecvError) {
+            std::cerr << "[E][C] Lost connection to a worker\n";
+            Remove(s);
+         } else {
+            HandleMPCode(msg, s);
+         }
+         if (!pending.empty() && !idle.empty()) {
+            TSocket *other = idle.back();
+            idle.pop_back();
+            giveTask(other);
+         }
+      } else if (code == PoolCode::kFuncResult) {
+         reslist[busy[s]] = ReadBuffer<Result_t>(msg.second.get());
+         busy.erase(s);
+         ++nReceived;
+         giveTask(s);
+      } else if (code >= 1000) {
+         HandleMPCode(msg, s);
+      } else {
+         std::cerr << "[W][C] unknown code received from server. code=" << code << "\n";
+      }
+   }
+
+   ReapDeadWorkers();
+   if (nReceived < args.size()) {
+      std::cerr << "[E][C] All the workers were lost. Aborting operation\n";
+      return std::vector<Result_t>();
+   }
+   return reslist;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// This method behaves just like Map, but an additional redfunc function
+/// must be provided. redfunc is applied by the client to the vector Map
+/// would return and must return the same type as func.
+template<class F, class I, class T>
+template<class R>
+auto TPersistentProcPool<F, I, T>::MapReduce(const std::vector<T> &args, R redfunc) -> Result_t
+{
+   static_assert(std::is_same<decltype(redfunc(std::declval<std::vector<Result_t>>())), Result_t>::value, "redfunc does not have the correct signature");
+   return redfunc(Map(args));
+}
+
+#endif
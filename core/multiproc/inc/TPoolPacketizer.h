@@ -0,0 +1,54 @@
+/* @(#)root/multiproc:$Id$ */
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TPoolPacketizer
+#define ROOT_TPoolPacketizer
+
+#include "PoolUtils.h"
+#include "RtypesCore.h"
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+class TSocket;
+
+class TPoolPacketizer {
+public:
+   TPoolPacketizer(const std::vector<std::string> &fileNames, const std::string &treeName, ULong64_t nToProcess, unsigned nWorkers);
+   //it doesn't make sense for a TPoolPacketizer to be copied
+   TPoolPacketizer(const TPoolPacketizer &) = delete;
+   TPoolPacketizer &operator=(const TPoolPacketizer &) = delete;
+
+   bool GetNextPacket(TSocket *worker, PoolUtils::TEntryPacket &packet);
+   ULong64_t GetNEntries() const { return fNEntries; }
+   void SetPacketTime(double seconds) { fPacketTime = seconds; }
+
+private:
+   using Clock_t = std::chrono::steady_clock;
+
+   /// What is known of a worker: the packet it is processing and its measured throughput
+   struct TWorkerStats {
+      Clock_t::time_point fSent; ///< when the current packet was sent
+      Long64_t fNEntries = 0;    ///< number of entries of the current packet
+      double fRate = 0;          ///< smoothed number of entries processed per second, 0 until measured
+   };
+
+   std::vector<std::vector<Long64_t>> fClusters; ///< for each file, the first entry of each cluster followed by the number of entries to process
+   unsigned fFileN;        ///< file of the next packet
+   unsigned fClusterN;     ///< first cluster of the next packet in fClusters[fFileN]
+   unsigned fNWorkers;     ///< the number of workers asking for packets
+   ULong64_t fNEntries;    ///< total number of entries to process
+   ULong64_t fNLeft;       ///< number of entries not handed out yet
+   double fPacketTime;     ///< time, in seconds, that a packet should take to be processed
+   std::map<TSocket *, TWorkerStats> fWorkers; ///< statistics of each worker
+};
+
+#endif
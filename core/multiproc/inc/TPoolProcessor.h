@@ -79,6 +79,8 @@ public:
 
 private:
    void Process(unsigned code, MPCodeBufPair& msg);
+   void ProcessPacket(MPCodeBufPair& msg);
+   void ReduceResult(typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type res);
    TFile *OpenFile(const std::string& fileName);
    TTree *RetrieveTree(TFile *fp);
    ULong64_t EvalMaxEntries(ULong64_t maxEntries);
@@ -92,6 +94,9 @@ private:
    ULong64_t fProcessedEntries; ///< the number of entries processed by this worker so far
    typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type fReducedResult; ///< the results of the executions of fProcFunc merged together
    bool fCanReduce; ///< true if fReducedResult can be reduced with a new result, false until we have produced one result
+   std::unique_ptr<TFile> fPacketFile; ///< the file of the last packet processed, kept open for the next packets
+   unsigned fPacketFileN; ///< the index in fFileNames of fPacketFile
+   TTree *fPacketTree; ///< the tree of fPacketFile, owned by the file
 };
 
 
@@ -99,7 +104,8 @@ template<class F>
 TPoolProcessor<F>::TPoolProcessor(F procFunc, const std::vector<std::string>& fileNames, const std::string& treeName, unsigned nWorkers, ULong64_t maxEntries) : TMPWorker(), fProcFunc(procFunc),
    fFileNames(fileNames), fTreeName(treeName), fTree(nullptr),
    fNWorkers(nWorkers), fMaxNEntries(maxEntries),
-   fProcessedEntries(0), fReducedResult(), fCanReduce(false)
+   fProcessedEntries(0), fReducedResult(), fCanReduce(false),
+   fPacketFile(), fPacketFileN(0), fPacketTree(nullptr)
 {}
 
 
@@ -108,7 +114,8 @@ TPoolProcessor<F>::TPoolProcessor(F procFunc, TTree *tree, unsigned nWorkers, UL
    TMPWorker(), fProcFunc(procFunc),
    fFileNames(), fTreeName(), fTree(tree),
    fNWorkers(nWorkers), fMaxNEntries(maxEntries),
-   fProcessedEntries(0), fReducedResult(), fCanReduce(false)
+   fProcessedEntries(0), fReducedResult(), fCanReduce(false),
+   fPacketFile(), fPacketFileN(0), fPacketTree(nullptr)
 {}
 
 
@@ -122,9 +129,28 @@ void TPoolProcessor<F>::HandleInput(MPCodeBufPair& msg)
          || code == PoolCode::kProcTree) {
       //execute fProcFunc on a file or a range of entries in a file
       Process(code, msg);
+   } else if (code == PoolCode::kProcEntries) {
+      //execute fProcFunc on a packet of entries
+      ProcessPacket(msg);
    } else if (code == PoolCode::kSendResult) {
       //send back result
       MPSend(GetSocket(), PoolCode::kProcResult, fReducedResult);
+   } else if (code == PoolCode::kStashResult) {
+      //leave the result to another worker if possible, send it to the client otherwise
+      if (fCanReduce && MPStash(GetSocket(), fReducedResult))
+         MPSend(GetSocket(), PoolCode::kResultStashed, GetNWorker());
+      else
+         MPSend(GetSocket(), PoolCode::kProcResult, fReducedResult);
+   } else if (code == PoolCode::kReduceWith) {
+      //merge the result of another worker into ours
+      std::unique_ptr<TBufferFile> buf = MPUnstash(GetSocket(), ReadBuffer<unsigned>(msg.second.get()));
+      if (buf) {
+         auto res = ReadBuffer<decltype(fReducedResult)>(buf.get());
+         //objects read from a buffer might be attached to the file we are reading
+         DetachRes(res);
+         ReduceResult(res);
+      }
+      MPSend(GetSocket(), PoolCode::kIdling);
    } else {
       //unknown code received
       std::string reply = "S" + std::to_string(GetNWorker());
@@ -237,13 +263,8 @@ void TPoolProcessor<F>::Process(unsigned code, MPCodeBufPair& msg)
    //update the number of processed entries
    fProcessedEntries += finish - start;
 
-   if(fCanReduce) {
-      fReducedResult = static_cast<decltype(fReducedResult)>(PoolUtils::ReduceObjects({res, fReducedResult})); //TODO try not to copy these into a vector, do everything by ref. std::vector<T&>?
-   } else {
-      fCanReduce = true;
-      fReducedResult = res;
-   }
-      
+   ReduceResult(res);
+
    if(fMaxNEntries == fProcessedEntries)
       //we are done forever
       MPSend(GetSocket(), PoolCode::kProcResult, fReducedResult);
@@ -253,6 +274,68 @@ void TPoolProcessor<F>::Process(unsigned code, MPCodeBufPair& msg)
 }
 
 
+template<class F>
+void TPoolProcessor<F>::ProcessPacket(MPCodeBufPair& msg)
+{
+   PoolUtils::TEntryPacket packet = ReadBuffer<PoolUtils::TEntryPacket>(msg.second.get());
+
+   //the consecutive packets of a file are usually sent to the same worker:
+   //keep the file, and the TTreeCache of its tree, from one packet to the next
+   if (fPacketTree == nullptr || fPacketFileN != packet.fFileN) {
+      fPacketTree = nullptr;
+      fPacketFile.reset(OpenFile(fFileNames[packet.fFileN]));
+      if (fPacketFile == nullptr) {
+         //errors are handled inside OpenFile
+         return;
+      }
+      fPacketFileN = packet.fFileN;
+      fPacketTree = RetrieveTree(fPacketFile.get());
+      if (fPacketTree == nullptr) {
+         //errors are handled inside RetrieveTree
+         fPacketFile.reset();
+         return;
+      }
+   }
+   //keep the prefetching within the packet
+   fPacketTree->SetCacheEntryRange(packet.fStart, packet.fEnd);
+
+   // create a TTreeReader that reads this range of entries
+   TTreeReader reader(fPacketTree);
+   //Set first entry to start-1 so that the next call to TTreeReader::Next() sets the entry to the right value
+   TTreeReader::EEntryStatus status = reader.SetEntriesRange(packet.fStart-1, packet.fEnd);
+   if(status != TTreeReader::kEntryValid) {
+      std::string reply = "S" + std::to_string(GetNWorker());
+      reply += ": could not set TTreeReader to range " + std::to_string(packet.fStart) + " " + std::to_string(packet.fEnd);
+      MPSend(GetSocket(), PoolCode::kProcError, reply.data());
+      return;
+   }
+
+   //execute function
+   auto res = fProcFunc(reader);
+
+   //detach result from file if needed (currently needed for TH1, TTree, TEventList)
+   DetachRes(res);
+
+   fProcessedEntries += packet.fEnd - packet.fStart;
+   ReduceResult(res);
+
+   //the client decides when we are done
+   MPSend(GetSocket(), PoolCode::kIdling);
+}
+
+
+template<class F>
+void TPoolProcessor<F>::ReduceResult(typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type res)
+{
+   if(fCanReduce) {
+      fReducedResult = static_cast<decltype(fReducedResult)>(PoolUtils::ReduceObjects({res, fReducedResult})); //TODO try not to copy these into a vector, do everything by ref. std::vector<T&>?
+   } else {
+      fCanReduce = true;
+      fReducedResult = res;
+   }
+}
+
+
 template<class F>
 TFile *TPoolProcessor<F>::OpenFile(const std::string& fileName)
 {
@@ -275,20 +358,7 @@ TTree *TPoolProcessor<F>::RetrieveTree(TFile *fp)
 {
    //retrieve the TTree with the specified name from file
    //we are not the owner of the TTree object, the file is!
-   TTree *tree = nullptr;
-   if(fTreeName == "") {
-      // retrieve the first TTree
-      // (re-adapted from TEventIter.cxx)
-      if (fp->GetListOfKeys()) {
-         for(auto k : *fp->GetListOfKeys()) {
-            TKey *key = static_cast<TKey*>(k);
-            if (!strcmp(key->GetClassName(), "TTree") || !strcmp(key->GetClassName(), "TNtuple"))
-               tree = static_cast<TTree*>(fp->Get(key->GetName()));
-         }
-      }    
-   } else {
-      tree = static_cast<TTree*>(fp->Get(fTreeName.c_str()));
-   }
+   TTree *tree = PoolUtils::GetTree(fp, fTreeName);
    if (tree == nullptr) {
       std::string reply = "S" + std::to_string(GetNWorker());
       std::stringstream ss;
@@ -16,6 +16,7 @@
 #include "PoolUtils.h"
 #include "MPCode.h"
 #include "MPSendRecv.h"
+#include <memory> //unique_ptr
 #include <string>
 #include <vector>
 
@@ -69,6 +70,27 @@ public:
          }
       } else if (code == PoolCode::kSendResult) {
          MPSend(s, PoolCode::kFuncResult, fReducedResult);
+      } else if (code == PoolCode::kStashResult) {
+         // leave the result to another worker if possible, send it to the client otherwise
+         if (fCanReduce && MPStash(s, fReducedResult))
+            MPSend(s, PoolCode::kResultStashed, GetNWorker());
+         else
+            MPSend(s, PoolCode::kFuncResult, fReducedResult);
+      } else if (code == PoolCode::kReduceWith) {
+         // reduce the result of another worker with ours
+         unsigned n;
+         msg.second->ReadUInt(n);
+         std::unique_ptr<TBufferFile> buf = MPUnstash(s, n);
+         if (buf) {
+            const auto &res = ReadBuffer<decltype(fFunc(fArgs.front()))>(buf.get());
+            if (fCanReduce) {
+               fReducedResult = fRedFunc({res, fReducedResult});
+            } else {
+               fCanReduce = true;
+               fReducedResult = res;
+            }
+         }
+         MPSend(s, PoolCode::kIdling);
       } else {
          reply += ": unknown code received: " + std::to_string(code);
          MPSend(s, MPCode::kError, reply.data());
@@ -112,6 +134,27 @@ public:
          }
       } else if (code == PoolCode::kSendResult) {
          MPSend(s, PoolCode::kFuncResult, fReducedResult);
+      } else if (code == PoolCode::kStashResult) {
+         // leave the result to another worker if possible, send it to the client otherwise
+         if (fCanReduce && MPStash(s, fReducedResult))
+            MPSend(s, PoolCode::kResultStashed, GetNWorker());
+         else
+            MPSend(s, PoolCode::kFuncResult, fReducedResult);
+      } else if (code == PoolCode::kReduceWith) {
+         // reduce the result of another worker with ours
+         unsigned n;
+         msg.second->ReadUInt(n);
+         std::unique_ptr<TBufferFile> buf = MPUnstash(s, n);
+         if (buf) {
+            const auto &res = ReadBuffer<decltype(fFunc())>(buf.get());
+            if (fCanReduce) {
+               fReducedResult = fRedFunc({res, fReducedResult});
+            } else {
+               fCanReduce = true;
+               fReducedResult = res;
+            }
+         }
+         MPSend(s, PoolCode::kIdling);
       } else {
          reply += ": unknown code received: " + std::to_string(code);
          MPSend(s, MPCode::kError, reply.data());
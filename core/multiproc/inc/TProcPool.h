@@ -20,6 +20,7 @@
 #include "PoolUtils.h"
 #include "MPCode.h"
 #include "TPoolProcessor.h"
+#include "TPoolPacketizer.h"
 #include "TTreeReader.h"
 #include "TFileCollection.h"
 #include "TChain.h"
@@ -34,6 +35,8 @@
 #include <algorithm> //std::generate
 #include <functional> //std::reference_wrapper
 #include <iostream>
+#include <map>
+#include <memory> //std::unique_ptr
 
 class TProcPool : private TMPClient {
 public:
@@ -76,6 +79,8 @@ public:
 
    void SetNWorkers(unsigned n) { TMPClient::SetNWorkers(n); }
    unsigned GetNWorkers() const { return TMPClient::GetNWorkers(); }
+   void SetSharedMemSize(ULong_t size) { TMPClient::SetSharedMemSize(size); }
+   ULong_t GetSharedMemSize() const { return TMPClient::GetSharedMemSize(); }
 
 private:
    template<class T> void Collect(std::vector<T> &reslist);
@@ -85,9 +90,18 @@ private:
    template<class T, class R> T Reduce(const std::vector<T> &objs, R redfunc);
    void ReplyToFuncResult(TSocket *s);
    void ReplyToIdle(TSocket *s);
+   void ReplyToStashed(TSocket *s, unsigned workerN);
+   void ReduceInWorkers(TSocket *s);
+   void PairWorkers();
+   void ForgetWorker(TSocket *s);
+   static bool IsPlainFileTree(TTree &tree, std::string &treeName);
 
    unsigned fNProcessed; ///< number of arguments already passed to the workers
    unsigned fNToProcess; ///< total number of arguments to pass to the workers
+   std::unique_ptr<TPoolPacketizer> fPacketizer; ///< hands out the packets of entries during ProcTree
+   unsigned fNResults; ///< number of workers holding a result during a reduction in the workers, 0 if none is ongoing
+   std::vector<TSocket*> fReadyToReduce; ///< workers done with their tasks, waiting to be paired with another one
+   std::map<TSocket*, TSocket*> fReducePartner; ///< the worker that will reduce the result stashed by each worker
 
    /// A collection of the types of tasks that TProcPool can execute.
    /// It is used to interpret in the right way and properly reply to the
@@ -99,7 +113,7 @@ private:
       kMapRed,       ///< a MapReduce method with no arguments is being executed
       kMapRedWithArg, ///< a MapReduce method with arguments is being executed
       kProcByRange,   ///< a ProcTree method is being executed and each worker will process a certain range of each file
-      kProcByFile,    ///< a ProcTree method is being executed and each worker will process a different file
+      kProcByPacket,  ///< a ProcTree method is being executed and the workers are given packets of clusters on demand
    } fTask; ///< the kind of task that is being executed, if any
 };
 
@@ -383,34 +397,31 @@ auto TProcPool::ProcTree(const std::vector<std::string>& fileNames, F procFunc,
    Reset();
    unsigned nWorkers = GetNWorkers();
 
+   //read the clusters of the trees before forking, so that workers do not have to
+   fPacketizer.reset(new TPoolPacketizer(fileNames, treeName, nToProcess, nWorkers));
+   if(fPacketizer->GetNEntries() == 0) {
+      fPacketizer.reset();
+      return nullptr;
+   }
+
    //fork
-   TPoolProcessor<F> worker(procFunc, fileNames, treeName, nWorkers, nToProcess);
+   //the packets already take nToProcess into account: workers must not stop by themselves
+   TPoolProcessor<F> worker(procFunc, fileNames, treeName, nWorkers, 0);
    bool ok = Fork(worker);
    if(!ok) {
       std::cerr << "[E][C] Could not fork. Aborting operation\n";
+      fPacketizer.reset();
       return nullptr;
    }
 
-   if(fileNames.size() < nWorkers) {
-      //TTree entry granularity. For each file, we divide entries equally between workers
-      fTask = ETask::kProcByRange;
-      //Tell workers to start processing entries
-      fNToProcess = nWorkers*fileNames.size(); //this is the total number of ranges that will be processed by all workers cumulatively
-      std::vector<unsigned> args(nWorkers);
-      std::iota(args.begin(), args.end(), 0);
-      fNProcessed = Broadcast(PoolCode::kProcRange, args);
-      if(fNProcessed < nWorkers)
-         std::cerr << "[E][C] There was an error while sending tasks to workers. Some entries might not be processed.\n";
-   } else {
-      //file granularity. each worker processes one whole file as a single task
-      fTask = ETask::kProcByFile;
-      fNToProcess = fileNames.size();
-      std::vector<unsigned> args(nWorkers);
-      std::iota(args.begin(), args.end(), 0);
-      fNProcessed = Broadcast(PoolCode::kProcFile, args);
-      if(fNProcessed < nWorkers)
-         std::cerr << "[E][C] There was an error while sending tasks to workers. Some entries might not be processed.\n";
-   }
+   //cluster granularity. Packets of clusters are handed out to the workers
+   //as they become idle, sized after the throughput measured for each of them
+   fTask = ETask::kProcByPacket;
+   TMonitor &mon = GetMonitor();
+   mon.ActivateAll();
+   std::unique_ptr<TList> lp(mon.GetListOfActives());
+   for (auto s : *lp)
+      ReplyToIdle(static_cast<TSocket*>(s));
 
    //collect results, distribute new tasks
    std::vector<TObject*> reslist;
@@ -421,6 +432,7 @@ auto TProcPool::ProcTree(const std::vector<std::string>& fileNames, F procFunc,
 
    //clean-up and return
    ReapWorkers();
+   fPacketizer.reset();
    fTask = ETask::kNoTask;
    return static_cast<retType>(res);
 }
@@ -465,6 +477,14 @@ auto TProcPool::ProcTree(TTree& tree, F procFunc, ULong64_t nToProcess) -> typen
    using retType = typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type;
    static_assert(std::is_constructible<TObject*, retType>::value, "procFunc must return a pointer to a class inheriting from TObject, and must take a reference to TTreeReader as the only argument");
 
+   //a tree that is only read from a file is re-opened by the workers and
+   //processed in packets of clusters, like a list of files
+   std::string treeName;
+   if (IsPlainFileTree(tree, treeName)) {
+      std::vector<std::string> fileNames(1, tree.GetCurrentFile()->GetName());
+      return ProcTree(fileNames, procFunc, treeName, nToProcess);
+   }
+
    //prepare environment
    Reset();
    unsigned nWorkers = GetNWorkers();
@@ -515,6 +535,7 @@ void TProcPool::Collect(std::vector<T> &reslist)
       MPCodeBufPair msg = MPRecv(s);
       if (msg.first == MPCode::kRecvError) {
          std::cerr << "[E][C] Lost connection to a worker\n";
+         ForgetWorker(s);
          Remove(s);
       } else if (msg.first < 1000)
          HandlePoolCode(msg, s, reslist);
@@ -532,12 +553,16 @@ void TProcPool::HandlePoolCode(MPCodeBufPair &msg, TSocket *s, std::vector<T> &r
    unsigned code = msg.first;
    if (code == PoolCode::kFuncResult) {
       reslist.push_back(std::move(ReadBuffer<T>(msg.second.get())));
+      ForgetWorker(s);
       ReplyToFuncResult(s);
    } else if (code == PoolCode::kIdling) {
       ReplyToIdle(s);
+   } else if (code == PoolCode::kResultStashed) {
+      ReplyToStashed(s, ReadBuffer<unsigned>(msg.second.get()));
    } else if(code == PoolCode::kProcResult) {
       if(msg.second != nullptr)
          reslist.push_back(std::move(ReadBuffer<T>(msg.second.get())));
+      ForgetWorker(s);
       MPSend(s, MPCode::kShutdownOrder);
    } else if(code == PoolCode::kProcError) {
       const char *str = ReadBuffer<const char*>(msg.second.get());
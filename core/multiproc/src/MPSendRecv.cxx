@@ -1,8 +1,40 @@
 #include "MPSendRecv.h"
 #include "TBufferFile.h"
+#include "TMPSharedMem.h"
 #include "MPCode.h"
+#include <map>
 #include <memory> //unique_ptr
 
+namespace {
+   /// The value of the size of an object in a message header meaning
+   /// that the object is in the shared memory region of the sender.
+   const ULong_t kInSharedMem = (ULong_t)-1;
+
+   /// Objects smaller than this are sent through the socket even if a
+   /// shared memory region is available.
+   const ULong_t kMinSharedMemObjSize = 1 << 20;
+
+   /// The shared memory region associated to a socket.
+   struct TSharedMemInfo {
+      TMPSharedMem *fMem; ///< the regions shared by the client and the workers
+      unsigned fRegionN;  ///< the region of the worker at the other end of the socket (client) or of this worker (worker)
+      bool fIsWorker;     ///< true if this process is the worker, i.e. the one writing in the region
+   };
+
+   std::map<TSocket *, TSharedMemInfo> &GetSharedMemInfos()
+   {
+      static std::map<TSocket *, TSharedMemInfo> infos;
+      return infos;
+   }
+
+   const TSharedMemInfo *FindSharedMem(TSocket *s)
+   {
+      auto &infos = GetSharedMemInfos();
+      auto it = infos.find(s);
+      return it == infos.end() ? nullptr : &it->second;
+   }
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Send a message with the specified code on the specified socket.
 /// This standalone function can be used to send a code
@@ -38,6 +70,8 @@ int MPSend(TSocket *s, unsigned code)
 /// * non-pointer built-in types: TBufferFile::operator>> must be used\n
 /// * c-strings: TBufferFile::ReadString must be used\n
 /// * class types: TBufferFile::ReadObjectAny must be used\n
+/// Objects that the sender left in shared memory (see MPSendObjBuf()) are
+/// copied in the returned buffer as if they had been read from the socket.\n
 /// \param s a pointer to a valid TSocket. No validity checks are performed\n
 /// \return ::MPCodeBufPair, i.e. an std::pair containing message code and (possibly) object
 MPCodeBufPair MPRecv(TSocket *s)
@@ -64,7 +98,14 @@ MPCodeBufPair MPRecv(TSocket *s)
 
    //receive object if needed
    std::unique_ptr<TBufferFile> objBuf; //defaults to nullptr
-   if (classBufSize != 0) {
+   if (classBufSize == kInSharedMem) {
+      //the sender left the object in its shared memory region
+      const TSharedMemInfo *info = FindSharedMem(s);
+      if (info && !info->fIsWorker)
+         objBuf = info->fMem->Take(info->fRegionN);
+      if (objBuf == nullptr)
+         return std::make_pair(MPCode::kRecvError, nullptr);
+   } else if (classBufSize != 0) {
       char *classBuf = new char[classBufSize];
       s->RecvRaw(classBuf, classBufSize);
       objBuf.reset(new TBufferFile(TBuffer::kRead, classBufSize, classBuf, true)); //the buffer is deleted by TBuffer's dtor
@@ -72,3 +113,101 @@ MPCodeBufPair MPRecv(TSocket *s)
 
    return std::make_pair(code, std::move(objBuf));
 }
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Associate a socket to a shared memory region.
+/// Large objects sent with MPSend() by the worker on this socket are
+/// then copied in the region instead of being streamed through the
+/// socket, and MPRecv() retrieves them from there.
+/// \param s the socket connecting the client and the worker
+/// \param mem the shared memory regions, created before forking
+/// \param regionN the region of the worker, i.e. its ordinal number
+/// \param isWorker true in the worker process, false in the client process
+void MPAttachSharedMem(TSocket *s, TMPSharedMem *mem, unsigned regionN, bool isWorker)
+{
+   GetSharedMemInfos()[s] = {mem, regionN, isWorker};
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Stop using a shared memory region for the messages on socket s.
+/// This must be called before the socket is deleted.
+void MPDetachSharedMem(TSocket *s)
+{
+   GetSharedMemInfos().erase(s);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Stop using the regions of mem for the messages on any socket.
+/// This must be called before mem is deleted.
+void MPDetachSharedMem(TMPSharedMem *mem)
+{
+   auto &infos = GetSharedMemInfos();
+   for (auto it = infos.begin(); it != infos.end();) {
+      if (it->second.fMem == mem)
+         it = infos.erase(it);
+      else
+         ++it;
+   }
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Send a message with a code and an already streamed object.
+/// This is the function that MPSend() calls to send objects: if the
+/// object is large, this process is a worker with a shared memory region
+/// (see MPAttachSharedMem()) and the region is free, the object is copied
+/// there and only the message header goes through the socket.
+/// \param s a pointer to a valid TSocket. No validity checks are performed\n
+/// \param code the code to be sent
+/// \param objBuf the streamed object, possibly empty
+/// \return the number of bytes sent through the socket, as per TSocket::SendRaw
+int MPSendObjBuf(TSocket *s, unsigned code, const TBufferFile &objBuf)
+{
+   TBufferFile wBuf(TBuffer::kWrite);
+   wBuf.WriteUInt(code);
+   ULong_t len = objBuf.Length();
+   const TSharedMemInfo *info = FindSharedMem(s);
+   if (info && info->fIsWorker && len >= kMinSharedMemObjSize
+         && info->fMem->Put(info->fRegionN, objBuf.Buffer(), len)) {
+      wBuf.WriteULong(kInSharedMem);
+   } else {
+      wBuf.WriteULong(len);
+      if (len)
+         wBuf.WriteBuf(objBuf.Buffer(), len);
+   }
+   return s->SendRaw(wBuf.Buffer(), wBuf.Length());
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Copy a streamed object in the shared memory region of this worker.
+/// See MPStash().
+/// \return false if there is no region attached to s, the region is busy
+/// or the object does not fit in it
+bool MPStashBuf(TSocket *s, const TBufferFile &objBuf)
+{
+   const TSharedMemInfo *info = FindSharedMem(s);
+   if (!info || !info->fIsWorker)
+      return false;
+   return info->fMem->Put(info->fRegionN, objBuf.Buffer(), objBuf.Length());
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Retrieve the object stashed by another worker with MPStash().
+/// The object can then be read from the buffer with ReadBuffer().
+/// \param s the socket of this worker, which must be attached to the same
+/// shared memory regions as the other worker
+/// \param regionN the region of the other worker, i.e. its ordinal number
+/// \return the buffer containing the object, or a null pointer if there is
+/// no such object
+std::unique_ptr<TBufferFile> MPUnstash(TSocket *s, unsigned regionN)
+{
+   const TSharedMemInfo *info = FindSharedMem(s);
+   if (!info)
+      return nullptr;
+   return info->fMem->Take(regionN);
+}
@@ -1,6 +1,10 @@
 #include "PoolUtils.h"
 #include "TClass.h"
+#include "TFile.h"
+#include "TKey.h"
 #include "TList.h"
+#include "TTree.h"
+#include <cstring> //strcmp
 #include <iostream>
 
 //////////////////////////////////////////////////////////////////////////
@@ -38,3 +42,24 @@ TObject* PoolUtils::ReduceObjects(const std::vector<TObject *>& objs)
    //return result
    return obj;
 }
+
+//////////////////////////////////////////////////////////////////////////
+/// Retrieve the tree called treeName from file fp, or the first TTree (or
+/// TNtuple) of the top directory of fp if treeName is empty.
+/// The tree is owned by the file. A null pointer is returned if the tree
+/// cannot be found.
+TTree* PoolUtils::GetTree(TFile *fp, const std::string &treeName)
+{
+   if (treeName.empty()) {
+      // (re-adapted from TEventIter.cxx)
+      if (fp->GetListOfKeys()) {
+         for (auto k : *fp->GetListOfKeys()) {
+            TKey *key = static_cast<TKey *>(k);
+            if (!strcmp(key->GetClassName(), "TTree") || !strcmp(key->GetClassName(), "TNtuple"))
+               return dynamic_cast<TTree *>(fp->Get(key->GetName()));
+         }
+      }
+      return nullptr;
+   }
+   return dynamic_cast<TTree *>(fp->Get(treeName.c_str()));
+}
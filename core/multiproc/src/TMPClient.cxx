@@ -11,6 +11,7 @@
 #include <sys/wait.h> // waitpid
 #include <errno.h> //errno, used by socketpair
 #include <sys/socket.h> //socketpair
+#include <algorithm> //std::remove_if
 #include <memory> //unique_ptr
 #include <iostream>
 
@@ -24,9 +25,19 @@
 /// on TMPClient and TMPWorker: the class providing multiprocess
 /// functionalities to users should inherit (possibly privately) from
 /// TMPClient, and the workers executing tasks should inherit from TMPWorker.
+/// Large objects sent by the workers, and objects exchanged between
+/// workers, go through a region of memory shared with the client (see
+/// TMPSharedMem) rather than through the sockets. The size of the region
+/// of each worker can be changed with SetSharedMemSize; 0 disables it.
 ///
 //////////////////////////////////////////////////////////////////////////
 
+namespace {
+   /// Default size, in bytes, of the shared memory region of each worker.
+   /// The pages are only allocated when they are used.
+   const ULong_t kDefaultSharedMemSize = 256 << 20;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// Class constructor.
 /// \param nWorkers
@@ -37,7 +48,8 @@
 /// of cores of the machine is going to be spawned. If that information is
 /// not available, 2 workers are created instead.
 /// \endparblock
-TMPClient::TMPClient(unsigned nWorkers) : fIsParent(true), fWorkerPids(), fMon(), fNWorkers(0)
+TMPClient::TMPClient(unsigned nWorkers) : fIsParent(true), fWorkerPids(), fMon(), fNWorkers(0),
+   fSharedMem(), fSharedMemSize(kDefaultSharedMemSize)
 {
    // decide on number of workers
    if (nWorkers) {
@@ -94,6 +106,18 @@ bool TMPClient::Fork(TMPWorker &server)
    pid_t pid = 1; //must be positive to handle the case in which fNWorkers is 0
    int sockets[2]; //sockets file descriptors
    unsigned nWorker = 0;
+
+   //map the shared memory before forking, so that every worker sees the regions of all the others
+   if (fSharedMem) {
+      MPDetachSharedMem(fSharedMem.get());
+      fSharedMem.reset();
+   }
+   if (fSharedMemSize && fNWorkers) {
+      fSharedMem.reset(new TMPSharedMem(fNWorkers, fSharedMemSize));
+      if (!fSharedMem->IsValid())
+         fSharedMem.reset();
+   }
+
    for (; nWorker < fNWorkers; ++nWorker) {
       //create socket pair
       int ret = socketpair(AF_UNIX, SOCK_STREAM, 0, sockets);
@@ -116,6 +140,8 @@ bool TMPClient::Fork(TMPWorker &server)
          if (s && s->IsValid()) {
             fMon.Add(s);
             fWorkerPids.push_back(pid);
+            if (fSharedMem)
+               MPAttachSharedMem(s, fSharedMem.get(), nWorker, false);
          } else {
             std::cerr << "[E][C] Could not connect to worker with pid " << pid << ". Giving up.\n";
             delete s;
@@ -164,6 +190,8 @@ bool TMPClient::Fork(TMPWorker &server)
 
       //prepare server and add it to eventloop
       server.Init(sockets[1], nWorker);
+      if (fSharedMem)
+         MPAttachSharedMem(server.GetSocket(), fSharedMem.get(), nWorker, true);
 
       //enter worker loop
       server.Run();
@@ -238,6 +266,7 @@ void TMPClient::DeActivate(TSocket *s)
 /// \param s the socket to be removed from the monitor fMon
 void TMPClient::Remove(TSocket *s)
 {
+   MPDetachSharedMem(s);
    fMon.Remove(s);
    delete s;
 }
@@ -249,12 +278,29 @@ void TMPClient::Remove(TSocket *s)
 /// execution since ReapWorkers should only be called when all workers
 /// have already quit. ReapWorkers is then called not to leave zombie
 /// processes hanging around, and to clean-up fWorkerPids.
+/// The shared memory regions of the workers are released too.
 void TMPClient::ReapWorkers()
 {
    for (auto &pid : fWorkerPids) {
       waitpid(pid, nullptr, 0);
    }
    fWorkerPids.clear();
+   if (fSharedMem) {
+      MPDetachSharedMem(fSharedMem.get());
+      fSharedMem.reset();
+   }
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Reap the workers that have already quit, without waiting for the others,
+/// and remove their pids from fWorkerPids.
+/// Clients that keep their workers alive across several tasks call this
+/// method not to leave zombie processes around when some workers are lost.
+void TMPClient::ReapDeadWorkers()
+{
+   auto isDead = [](pid_t pid) { return waitpid(pid, nullptr, WNOHANG) != 0; };
+   fWorkerPids.erase(std::remove_if(fWorkerPids.begin(), fWorkerPids.end(), isDead), fWorkerPids.end());
 }
 
 
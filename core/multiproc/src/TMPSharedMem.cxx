@@ -0,0 +1,129 @@
+#include "TMPSharedMem.h"
+#include <sys/mman.h> //mmap, munmap, madvise
+#include <unistd.h> //sysconf
+#include <atomic>
+#include <cstring> //memcpy
+#include <new> //placement new
+#include <iostream>
+
+//////////////////////////////////////////////////////////////////////////
+///
+/// \class TMPSharedMem
+///
+/// A set of memory regions shared between a TMPClient and the workers it
+/// forks, one region per worker. The mapping is created by the client
+/// _before_ forking, so that all the processes see the same pages at the
+/// same address. A worker uses its region to hand large messages over to
+/// the client, or over to another worker, with a single copy instead of
+/// streaming them through a socket (see MPSend and MPStash).
+///
+/// Each region holds at most one message at a time: Put fails if the
+/// previous message has not been taken yet. The pages of a region are
+/// only allocated when they are first written, and are released when the
+/// message is taken.
+///
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+   /// The header at the beginning of each region.
+   struct TRegionHeader {
+      std::atomic<ULong_t> fLength; ///< the length of the message in the region, 0 if the region is free
+   };
+
+   ULong_t RoundToPage(ULong_t size, ULong_t page)
+   {
+      return (size + page - 1) / page * page;
+   }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Class constructor.
+/// Map nRegions regions of regionSize bytes each. If the mapping fails
+/// IsValid() returns false and the object must not be used.
+TMPSharedMem::TMPSharedMem(unsigned nRegions, ULong_t regionSize) :
+   fBase(nullptr), fNRegions(nRegions), fRegionSize(0), fStride(0)
+{
+   ULong_t page = sysconf(_SC_PAGESIZE);
+   //the header takes a page of its own, so that the data can be released page by page
+   fRegionSize = RoundToPage(regionSize, page);
+   fStride = page + fRegionSize;
+   if (fNRegions == 0 || fRegionSize == 0)
+      return;
+
+   int flags = MAP_SHARED | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+   flags |= MAP_NORESERVE;
+#endif
+   void *base = mmap(nullptr, fNRegions * fStride, PROT_READ | PROT_WRITE, flags, -1, 0);
+   if (base == MAP_FAILED) {
+      std::cerr << "[W][C] Could not map shared memory for the workers, messages will go through sockets\n";
+      return;
+   }
+   fBase = static_cast<char *>(base);
+   for (unsigned n = 0; n < fNRegions; ++n)
+      new (GetRegion(n)) TRegionHeader{{0}};
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Class destructor.
+/// Unmap the regions. The processes forked while the mapping existed keep
+/// their own view of it.
+TMPSharedMem::~TMPSharedMem()
+{
+   if (fBase)
+      munmap(fBase, fNRegions * fStride);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Copy len bytes from buf into region regionN.
+/// \return false if the region does not exist, is still holding a message
+/// that has not been taken, or is too small
+bool TMPSharedMem::Put(unsigned regionN, const char *buf, ULong_t len)
+{
+   if (!fBase || regionN >= fNRegions || len == 0 || len > fRegionSize)
+      return false;
+   char *region = GetRegion(regionN);
+   TRegionHeader *header = reinterpret_cast<TRegionHeader *>(region);
+   if (header->fLength.load(std::memory_order_acquire) != 0)
+      return false;
+   memcpy(region + (fStride - fRegionSize), buf, len);
+   header->fLength.store(len, std::memory_order_release);
+   return true;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Copy the message contained in region regionN into a new buffer ready
+/// for reading, and free the region.
+/// \return the buffer, or a null pointer if the region holds no message
+std::unique_ptr<TBufferFile> TMPSharedMem::Take(unsigned regionN)
+{
+   if (!fBase || regionN >= fNRegions)
+      return nullptr;
+   char *region = GetRegion(regionN);
+   TRegionHeader *header = reinterpret_cast<TRegionHeader *>(region);
+   ULong_t len = header->fLength.load(std::memory_order_acquire);
+   if (len == 0)
+      return nullptr;
+
+   char *data = region + (fStride - fRegionSize);
+   char *buf = new char[len];
+   memcpy(buf, data, len);
+#ifdef MADV_REMOVE
+   //give the pages back to the system: most messages are much smaller than the region
+   madvise(data, RoundToPage(len, fStride - fRegionSize), MADV_REMOVE);
+#endif
+   header->fLength.store(0, std::memory_order_release);
+
+   return std::unique_ptr<TBufferFile>(new TBufferFile(TBuffer::kRead, len, buf, true)); //the buffer is deleted by TBuffer's dtor
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Return the address of the header of region regionN.
+char *TMPSharedMem::GetRegion(unsigned regionN) const
+{
+   return fBase + regionN * fStride;
+}
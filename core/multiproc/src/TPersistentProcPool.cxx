@@ -0,0 +1,56 @@
+/* @(#)root/multiproc:$Id$ */
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#include "TPersistentProcPool.h"
+
+//////////////////////////////////////////////////////////////////////////
+///
+/// \class TPersistentProcPool
+/// \brief A pool of workers that are forked once and reused by all the
+/// calls to Map and MapReduce, keeping a state between them.
+///
+/// TProcPool forks a new set of workers at each call, which is the right
+/// thing to do when the function to execute changes from one call to the
+/// next. Iterative algorithms, such as a likelihood scan, instead call
+/// the same function hundreds of times with different arguments, and
+/// each call must open the same files or build the same objects again.
+///
+/// A TPersistentProcPool is built with two functions:
+/// * initFunc, which takes no arguments, is called once by each worker
+/// right after forking. The object it returns is the state of the worker.
+/// * func, which is called as `func(state, arg)` for each argument of
+/// type T passed to Map or MapReduce, in whichever worker is idle.
+///
+/// The workers are forked at the first call to Map or MapReduce, and are
+/// shut down when the pool is destroyed. Afterwards only the arguments
+/// and the results travel between the client and the workers, through
+/// sockets or shared memory as with TProcPool. Since the workers are
+/// forked only once, the changes made in the client after the first call
+/// are not seen by the workers: anything that varies between calls must
+/// be passed as argument. As with TProcPool::Map, arguments and results
+/// must be of a type known to cling.
+///
+/// The arguments of a worker that crashes are given to the other workers.
+/// If all of them are lost during a call, new workers are forked once and
+/// build their state again; if these are lost too, the call prints an
+/// error and returns an empty vector.
+///
+/// #### Example:
+/// ~~~{.cpp}
+/// auto init = []() { return std::make_shared<TFile>("data.root"); };
+/// auto nll = [](std::shared_ptr<TFile> &f, double mu) { return ComputeNLL(*f, mu); };
+/// TPersistentProcPool<decltype(nll), decltype(init), double> pool(nll, init, 8);
+/// for (double mu : scanPoints) {
+///    std::vector<double> shifts = MakeShifts(mu);
+///    auto values = pool.Map(shifts); // the file is opened once per worker
+/// }
+/// ~~~
+///
+//////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,121 @@
+#include "TPoolPacketizer.h"
+#include "TFile.h"
+#include "TTree.h"
+#include <algorithm> //std::min, std::max
+#include <memory> //unique_ptr
+#include <iostream>
+
+//////////////////////////////////////////////////////////////////////////
+///
+/// \class TPoolPacketizer
+///
+/// Hands out the entries processed by TProcPool::ProcTree to the workers
+/// in packets, on demand. A packet is a range of entries of one file made
+/// of whole clusters (see TTree::GetClusterIterator), so that no basket
+/// is read by two workers.
+///
+/// The size of the packets adapts to the throughput measured for each
+/// worker: a worker gets the clusters it is expected to process in
+/// fPacketTime seconds. Until its throughput is known, and towards the end
+/// of the processing, the packets are kept small enough for all the workers
+/// to finish at about the same time.
+///
+//////////////////////////////////////////////////////////////////////////
+
+namespace {
+   /// Default time, in seconds, that a packet should take to be processed.
+   const double kDefaultPacketTime = 2.;
+   /// Number of packets per worker the entries are split into until the throughput is known.
+   const unsigned kInitialPacketsPerWorker = 16;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Class constructor.
+/// Read the cluster boundaries of the tree treeName in each file (or of the
+/// first tree if treeName is empty). Only the first nToProcess entries are
+/// handed out, all of them if nToProcess is 0.
+TPoolPacketizer::TPoolPacketizer(const std::vector<std::string> &fileNames, const std::string &treeName, ULong64_t nToProcess, unsigned nWorkers) :
+   fClusters(fileNames.size()), fFileN(0), fClusterN(0), fNWorkers(std::max(nWorkers, 1u)),
+   fNEntries(0), fNLeft(0), fPacketTime(kDefaultPacketTime), fWorkers()
+{
+   for (unsigned fileN = 0; fileN < fileNames.size(); ++fileN) {
+      if (nToProcess && fNEntries == nToProcess)
+         break;
+      std::unique_ptr<TFile> fp(TFile::Open(fileNames[fileN].c_str()));
+      if (fp == nullptr || fp->IsZombie()) {
+         std::cerr << "[E][C] could not open file " << fileNames[fileN] << ". Skipping it.\n";
+         continue;
+      }
+      //the same lookup as in TPoolProcessor, so that the packets index the same tree
+      TTree *tree = PoolUtils::GetTree(fp.get(), treeName);
+      if (tree == nullptr) {
+         std::cerr << "[E][C] cannot find tree with name " << treeName << " in file " << fileNames[fileN] << ". Skipping it.\n";
+         continue;
+      }
+
+      Long64_t nEntries = tree->GetEntries();
+      if (nToProcess && fNEntries + nEntries > nToProcess)
+         nEntries = nToProcess - fNEntries;
+      std::vector<Long64_t> &clusters = fClusters[fileN];
+      TTree::TClusterIterator it = tree->GetClusterIterator(0);
+      Long64_t start;
+      while ((start = it()) < nEntries)
+         clusters.push_back(start);
+      if (clusters.empty())
+         continue;
+      clusters.push_back(nEntries);
+      fNEntries += nEntries;
+   }
+   fNLeft = fNEntries;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Fill packet with the next entries to be processed by worker.
+/// Return false if all the entries have already been handed out.
+bool TPoolPacketizer::GetNextPacket(TSocket *worker, PoolUtils::TEntryPacket &packet)
+{
+   TWorkerStats &stats = fWorkers[worker];
+   Clock_t::time_point now = Clock_t::now();
+   if (stats.fNEntries > 0) {
+      // the worker is done with its previous packet: update its throughput
+      double elapsed = std::chrono::duration<double>(now - stats.fSent).count();
+      if (elapsed > 0) {
+         double rate = stats.fNEntries / elapsed;
+         stats.fRate = stats.fRate > 0 ? 0.5 * (stats.fRate + rate) : rate;
+      }
+      stats.fNEntries = 0;
+   }
+
+   // skip the files without entries (or that could not be opened)
+   while (fFileN < fClusters.size() && fClusterN + 1 >= fClusters[fFileN].size()) {
+      ++fFileN;
+      fClusterN = 0;
+   }
+   if (fFileN == fClusters.size())
+      return false;
+
+   // number of entries this worker should get
+   ULong64_t target;
+   if (stats.fRate > 0)
+      target = stats.fRate * fPacketTime;
+   else
+      target = fNEntries / (fNWorkers * kInitialPacketsPerWorker);
+   // guided self-scheduling: never more than a share of what is left,
+   // so that the last packets are small and the workers end together
+   target = std::min(target, fNLeft / fNWorkers);
+
+   const std::vector<Long64_t> &clusters = fClusters[fFileN];
+   packet.fFileN = fFileN;
+   packet.fStart = clusters[fClusterN];
+   // at least one cluster, never across files
+   do {
+      ++fClusterN;
+   } while (fClusterN + 1 < clusters.size() && ULong64_t(clusters[fClusterN] - packet.fStart) < target);
+   packet.fEnd = clusters[fClusterN];
+
+   Long64_t nEntries = packet.fEnd - packet.fStart;
+   fNLeft -= nEntries;
+   stats.fSent = now;
+   stats.fNEntries = nEntries;
+   return true;
+}
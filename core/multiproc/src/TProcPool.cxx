@@ -1,4 +1,6 @@
 #include "TProcPool.h"
+#include "TFile.h"
+#include <algorithm> //std::remove
 
 //////////////////////////////////////////////////////////////////////////
 ///
@@ -22,6 +24,8 @@
 /// **Note:** that the usage of TProcPool::Map is indicated only when the task to be
 /// executed takes more than a few seconds, otherwise the overhead introduced
 /// by Map will outrun the benefits of parallel execution on most machines.
+/// Each call forks a new set of workers: to call the same function many
+/// times, keeping a state in each worker, see TPersistentProcPool.
 ///
 /// \param func
 /// \parblock
@@ -69,6 +73,29 @@
 /// root[] TProcPool pool; auto hist = pool.MapReduce(CreateAndFillHists, 10, PoolUtils::ReduceObjects);
 /// ~~~
 ///
+/// ###TProcPool::ProcTree
+/// This set of methods executes a function taking a TTreeReader& on the
+/// entries of a tree, a chain or a list of files, and merges the objects it
+/// returns. The entries are handed out to the workers on demand, in packets
+/// of whole clusters sized after the throughput measured for each worker
+/// (see TPoolPacketizer), so that all workers end at about the same time
+/// even when the files have very different sizes. The workers re-open the
+/// file of a tree passed by reference only if the tree is read as is from
+/// a file opened for reading. Other trees (in memory or in a TMemFile,
+/// being written, with friends, aliases or an entry list) are processed as
+/// forked by the workers, divided in one range of entries per worker.
+///
+/// ###Reduction in the workers
+/// With MapReduce and ProcTree on files, the results are reduced by the
+/// workers themselves in a tree pattern rather than by the client one
+/// after the other: each time two workers are done, one of them leaves its
+/// result in shared memory and the other one reduces it with its own. The
+/// client only receives the result of the last worker standing (and the
+/// results that do not fit in shared memory, which it reduces itself).
+/// Large results are also read from shared memory instead of a socket.
+/// The size of the shared memory region of each worker can be changed with
+/// SetSharedMemSize; setting it to 0 disables both features.
+///
 //////////////////////////////////////////////////////////////////////////
 
 
@@ -88,6 +115,10 @@ void TProcPool::Reset()
 {
    fNProcessed = 0;
    fNToProcess = 0;
+   fPacketizer.reset();
+   fNResults = 0;
+   fReadyToReduce.clear();
+   fReducePartner.clear();
    fTask = ETask::kNoTask;
 }
 
@@ -116,6 +147,16 @@ void TProcPool::ReplyToFuncResult(TSocket *s)
 /// ask for a result
 void TProcPool::ReplyToIdle(TSocket *s)
 {
+   if (fTask == ETask::kProcByPacket) {
+      //the packetizer knows how many entries are left
+      PoolUtils::TEntryPacket packet;
+      if (fPacketizer->GetNextPacket(s, packet))
+         MPSend(s, PoolCode::kProcEntries, packet);
+      else
+         ReduceInWorkers(s);
+      return;
+   }
+
    if (fNProcessed < fNToProcess) {
       //we are executing a "greedy worker" task
       if (fTask == ETask::kMapRedWithArg)
@@ -124,9 +165,127 @@ void TProcPool::ReplyToIdle(TSocket *s)
          MPSend(s, PoolCode::kExecFunc);
       else if (fTask == ETask::kProcByRange)
          MPSend(s, PoolCode::kProcRange, fNProcessed);
-      else if (fTask == ETask::kProcByFile)
-         MPSend(s, PoolCode::kProcFile, fNProcessed);
       ++fNProcessed;
-   } else
+   } else if (fTask == ETask::kMapRed || fTask == ETask::kMapRedWithArg)
+      ReduceInWorkers(s);
+   else
       MPSend(s, PoolCode::kSendResult);
 }
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Reply to a worker who left its result in shared memory.
+/// Tell the worker it was paired with to reduce it, and shut the worker
+/// down: the result stays available after the worker exits.
+void TProcPool::ReplyToStashed(TSocket *s, unsigned workerN)
+{
+   auto it = fReducePartner.find(s);
+   if (it == fReducePartner.end()) {
+      //we lost the worker that was going to reduce this result: keep it in the tree
+      fReadyToReduce.push_back(s);
+      PairWorkers();
+      return;
+   }
+   TSocket *into = it->second;
+   fReducePartner.erase(it);
+   --fNResults;
+   MPSend(into, PoolCode::kReduceWith, workerN);
+   MPSend(s, MPCode::kShutdownOrder);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Reply to a worker who has no more tasks to execute.
+/// If shared memory is available the results are reduced by the workers
+/// in a tree pattern: the workers that are done are paired, one of the
+/// two leaves its result in shared memory and the other one reduces it
+/// with its own, and so on until one worker holds the final result and
+/// sends it to the client. Otherwise the worker is asked for its result.
+void TProcPool::ReduceInWorkers(TSocket *s)
+{
+   if (!HasSharedMem()) {
+      MPSend(s, PoolCode::kSendResult);
+      return;
+   }
+   if (fNResults == 0) {
+      //the first worker to be done: all the workers we are connected to hold a result
+      TMonitor &mon = GetMonitor();
+      fNResults = mon.GetActive() + mon.GetDeActive();
+   }
+   fReadyToReduce.push_back(s);
+   PairWorkers();
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Pair the workers waiting in fReadyToReduce, or ask the last one
+/// holding a result to send it.
+void TProcPool::PairWorkers()
+{
+   while (fReadyToReduce.size() >= 2) {
+      TSocket *into = fReadyToReduce.back();
+      fReadyToReduce.pop_back();
+      TSocket *from = fReadyToReduce.back();
+      fReadyToReduce.pop_back();
+      fReducePartner[from] = into;
+      MPSend(from, PoolCode::kStashResult);
+   }
+   if (fNResults == 1 && fReadyToReduce.size() == 1) {
+      MPSend(fReadyToReduce.back(), PoolCode::kSendResult);
+      fReadyToReduce.clear();
+   }
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+/// Return true if tree is nothing more than a tree read from a file opened
+/// for reading, so that re-opening the file gives the same entries. In
+/// that case, treeName is set to the path of the tree in the file.
+bool TProcPool::IsPlainFileTree(TTree &tree, std::string &treeName)
+{
+   TFile *file = tree.GetCurrentFile();
+   TDirectory *dir = tree.GetDirectory();
+   if (!file || !dir || file->IsWritable() || file->InheritsFrom("TMemFile"))
+      return false;
+   if (tree.InheritsFrom(TChain::Class()) || tree.GetEntryList() || tree.GetEventList())
+      return false;
+   if ((tree.GetListOfFriends() && tree.GetListOfFriends()->GetSize() > 0) ||
+       (tree.GetListOfAliases() && tree.GetListOfAliases()->GetSize() > 0))
+      return false;
+
+   //the path of a directory starts with the path of its file, which may itself contain ":/" (e.g. root://)
+   std::string filePath = file->GetPath();
+   std::string dirPath = dir->GetPath();
+   if (dirPath.compare(0, filePath.size(), filePath) != 0)
+      return false;
+   std::string path = dirPath.substr(filePath.size());
+   if (!path.empty() && path[0] == '/')
+      path.erase(0, 1);
+   treeName = path.empty() ? tree.GetName() : path + "/" + tree.GetName();
+   return true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// Take note that the result of a worker does not take part in the
+/// reduction in the workers anymore, because the worker sent it to the
+/// client or because we lost the connection to the worker.
+void TProcPool::ForgetWorker(TSocket *s)
+{
+   if (fNResults == 0)
+      return;
+   --fNResults;
+   fReadyToReduce.erase(std::remove(fReadyToReduce.begin(), fReadyToReduce.end(), s), fReadyToReduce.end());
+   auto it = fReducePartner.find(s);
+   if (it != fReducePartner.end()) {
+      //the worker paired with s is ready to be paired again
+      fReadyToReduce.push_back(it->second);
+      fReducePartner.erase(it);
+   }
+   for (it = fReducePartner.begin(); it != fReducePartner.end();) {
+      if (it->second == s)
+         it = fReducePartner.erase(it);
+      else
+         ++it;
+   }
+   PairWorkers();
+}
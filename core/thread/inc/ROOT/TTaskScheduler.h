@@ -0,0 +1,218 @@
+// @(#)root/thread:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TTaskScheduler
+#define ROOT_TTaskScheduler
+
+#include "ROOT/TSeq.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ROOT {
+
+   class TTaskScheduler;
+
+   /// The result of a task started with TTaskScheduler::Async.
+   /// Unlike std::future, waiting for it executes other tasks of the
+   /// scheduler, so that it can be done from within a task.
+   template<class T>
+   class TTaskFuture {
+   public:
+      TTaskFuture(std::future<T> &&future, TTaskScheduler &scheduler) :
+         fFuture(std::move(future)), fScheduler(&scheduler) {}
+
+      bool IsReady() const;
+      void Wait();
+      T Get();
+
+   private:
+      std::future<T> fFuture;        ///< the future of the std::packaged_task wrapping the task
+      TTaskScheduler *fScheduler;    ///< the scheduler executing the task
+   };
+
+   class TTaskScheduler {
+   public:
+      using Task_t = std::function<void()>;
+
+      explicit TTaskScheduler(unsigned nThreads = 0);
+      ~TTaskScheduler();
+      TTaskScheduler(const TTaskScheduler &) = delete;
+      TTaskScheduler &operator=(const TTaskScheduler &) = delete;
+
+      static TTaskScheduler &GetGlobal();
+
+      unsigned GetNThreads() const { return fThreads.size(); }
+
+      void Spawn(Task_t task);
+      bool RunPendingTask();
+
+      template<class F> auto Async(F func) -> TTaskFuture<decltype(func())>;
+      template<class T, class F> void ParallelFor(const TSeq<T> &seq, F func, std::size_t grain = 0);
+
+   private:
+      /// The tasks spawned by one thread: the owner works at the back,
+      /// the other threads steal from the front.
+      struct TTaskQueue {
+         std::mutex fMutex;
+         std::deque<Task_t> fTasks;
+      };
+
+      void Work(unsigned threadN);
+      bool RunTask(unsigned queueN);
+      bool PopTask(unsigned queueN, Task_t &task);
+      bool StealTask(unsigned queueN, Task_t &task);
+
+      std::vector<std::unique_ptr<TTaskQueue>> fQueues; ///< one queue per thread, plus one for the threads outside the pool
+      std::vector<std::thread> fThreads;   ///< the threads of the pool
+      std::atomic<unsigned> fNQueued;      ///< the number of tasks in the queues
+      std::atomic<unsigned> fNSleeping;    ///< the number of threads waiting for tasks
+      std::mutex fSleepMutex;              ///< protects the sleep of the threads
+      std::condition_variable fWakeUp;     ///< notified when tasks are spawned or the pool is stopped
+      bool fStop;                          ///< true when the threads must exit, protected by fSleepMutex
+   };
+
+   /// A set of tasks that can be waited for together. Tasks can be added
+   /// to the group from within the tasks of the group; waiting for the
+   /// group executes pending tasks, so that groups can be nested.
+   class TTaskGroup {
+   public:
+      explicit TTaskGroup(TTaskScheduler &scheduler = TTaskScheduler::GetGlobal()) :
+         fScheduler(scheduler), fNPending(0), fException() {}
+      ~TTaskGroup();
+      TTaskGroup(const TTaskGroup &) = delete;
+      TTaskGroup &operator=(const TTaskGroup &) = delete;
+
+      template<class F> void Run(F func);
+      void Wait();
+
+   private:
+      void Done();
+
+      TTaskScheduler &fScheduler;      ///< the scheduler executing the tasks
+      std::atomic<unsigned> fNPending; ///< the number of tasks not completed yet
+      std::mutex fMutex;               ///< protects fException and the wait for the tasks
+      std::condition_variable fAllDone;///< notified when the last pending task completes
+      std::exception_ptr fException;   ///< the first exception thrown by a task, rethrown by Wait
+   };
+
+
+   /************ TEMPLATE METHODS IMPLEMENTATION ******************/
+
+   ////////////////////////////////////////////////////////////////////////////////
+   /// Execute func in the pool and return a TTaskFuture holding its result.
+
+   template<class F>
+   auto TTaskScheduler::Async(F func) -> TTaskFuture<decltype(func())>
+   {
+      using Ret_t = decltype(func());
+      auto task = std::make_shared<std::packaged_task<Ret_t()>>(func);
+      TTaskFuture<Ret_t> future(task->get_future(), *this);
+      Spawn([task]() { (*task)(); });
+      return future;
+   }
+
+   ////////////////////////////////////////////////////////////////////////////////
+   /// Call func on each element of seq, in parallel, and return when all the
+   /// calls are done. The sequence is split recursively in halves, one of
+   /// which is left to be stolen by idle threads, down to chunks of grain
+   /// elements. The default grain gives about eight chunks per thread.
+   /// func can itself call ParallelFor.
+
+   template<class T, class F>
+   void TTaskScheduler::ParallelFor(const TSeq<T> &seq, F func, std::size_t grain)
+   {
+      const std::size_t n = seq.size();
+      if (n == 0)
+         return;
+      if (grain == 0)
+         grain = std::max<std::size_t>(1, n / (8 * std::max(1u, GetNThreads())));
+
+      // run is declared before the group: the destructor of the group waits
+      // for the tasks using it, also when func throws in this thread
+      std::function<void(std::size_t, std::size_t)> run;
+      TTaskGroup group(*this);
+      run = [&](std::size_t begin, std::size_t end) {
+         while (end - begin > grain) {
+            std::size_t middle = begin + (end - begin) / 2;
+            group.Run([&run, middle, end]() { run(middle, end); });
+            end = middle;
+         }
+         for (std::size_t i = begin; i < end; ++i)
+            func(seq[i]);
+      };
+      run(0, n);
+      group.Wait();
+   }
+
+   ////////////////////////////////////////////////////////////////////////////////
+   /// Add func to the group and spawn it in the scheduler.
+
+   template<class F>
+   void TTaskGroup::Run(F func)
+   {
+      ++fNPending;
+      fScheduler.Spawn([this, func]() {
+         try {
+            func();
+         } catch (...) {
+            std::lock_guard<std::mutex> lock(fMutex);
+            if (!fException)
+               fException = std::current_exception();
+         }
+         Done();
+      });
+   }
+
+   ////////////////////////////////////////////////////////////////////////////////
+   /// Return true if the task has completed.
+
+   template<class T>
+   bool TTaskFuture<T>::IsReady() const
+   {
+      return fFuture.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+   }
+
+   ////////////////////////////////////////////////////////////////////////////////
+   /// Wait for the task to complete, executing other tasks meanwhile.
+
+   template<class T>
+   void TTaskFuture<T>::Wait()
+   {
+      while (!IsReady()) {
+         if (!fScheduler->RunPendingTask())
+            fFuture.wait_for(std::chrono::microseconds(100));
+      }
+   }
+
+   ////////////////////////////////////////////////////////////////////////////////
+   /// Wait for the task and return its result, or rethrow its exception.
+
+   template<class T>
+   T TTaskFuture<T>::Get()
+   {
+      Wait();
+      return fFuture.get();
+   }
+
+}
+
+#endif
@@ -0,0 +1,257 @@
+// @(#)root/thread:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+//////////////////////////////////////////////////////////////////////////
+///
+/// \class ROOT::TTaskScheduler
+///
+/// A pool of threads executing tasks with work stealing.
+///
+/// Each thread of the pool owns a queue of tasks. The tasks spawned by a
+/// thread of the pool go to its own queue, and the thread executes them
+/// last in, first out: the most recent task is the one whose data is
+/// still in the cache. An idle thread steals the oldest task of another
+/// queue, which in a recursive decomposition is the biggest piece of
+/// work left. Every queue has its own lock, so that the threads do not
+/// contend on a single lock as they do with TThreadPool. The tasks
+/// spawned by threads outside the pool go to an additional queue, from
+/// which any thread of the pool can take them.
+///
+/// A thread waiting for a TTaskGroup or a TTaskFuture executes pending
+/// tasks instead of blocking, so tasks can spawn and wait for other
+/// tasks (nested parallelism) without exhausting the pool.
+///
+/// ~~~{.cpp}
+/// ROOT::TTaskScheduler &sched = ROOT::TTaskScheduler::GetGlobal();
+/// std::vector<double> v(1000);
+/// sched.ParallelFor(ROOT::TSeqI(v.size()), [&](int i) { v[i] = std::sqrt(i); });
+///
+/// ROOT::TTaskGroup group(sched);
+/// group.Run([&]() { FillFirstHalf(); });
+/// group.Run([&]() { FillSecondHalf(); });
+/// group.Wait(); // rethrows the first exception thrown by the tasks
+///
+/// auto future = sched.Async([]() { return Integrate(); });
+/// double res = future.Get();
+/// ~~~
+///
+//////////////////////////////////////////////////////////////////////////
+
+#include "ROOT/TTaskScheduler.h"
+#include "TThread.h"
+#include "ThreadLocalStorage.h"
+
+namespace {
+   /// The scheduler owning the current thread, if it is a thread of a pool.
+   ROOT::TTaskScheduler *&CurrentScheduler()
+   {
+      TTHREAD_TLS(ROOT::TTaskScheduler *) scheduler = nullptr;
+      return scheduler;
+   }
+
+   /// The index of the current thread in the pool of CurrentScheduler().
+   unsigned &CurrentThreadN()
+   {
+      TTHREAD_TLS(unsigned) threadN = 0;
+      return threadN;
+   }
+}
+
+namespace ROOT {
+
+////////////////////////////////////////////////////////////////////////////////
+/// Start nThreads threads. If nThreads is 0, start as many threads as
+/// the hardware supports.
+
+TTaskScheduler::TTaskScheduler(unsigned nThreads) :
+   fNQueued(0), fNSleeping(0), fStop(false)
+{
+   if (nThreads == 0)
+      nThreads = std::max(1u, std::thread::hardware_concurrency());
+   // make ROOT aware that several threads are running
+   TThread::Initialize();
+
+   for (unsigned i = 0; i <= nThreads; ++i)
+      fQueues.emplace_back(new TTaskQueue);
+   fThreads.reserve(nThreads);
+   for (unsigned i = 0; i < nThreads; ++i)
+      fThreads.emplace_back(&TTaskScheduler::Work, this, i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Execute the tasks still queued and join the threads.
+
+TTaskScheduler::~TTaskScheduler()
+{
+   {
+      std::lock_guard<std::mutex> lock(fSleepMutex);
+      fStop = true;
+   }
+   fWakeUp.notify_all();
+   for (auto &t : fThreads)
+      t.join();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return the scheduler shared by the whole process, which starts as many
+/// threads as the hardware supports the first time it is used.
+
+TTaskScheduler &TTaskScheduler::GetGlobal()
+{
+   static TTaskScheduler scheduler;
+   return scheduler;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Queue task for execution. Called from a thread of the pool, the task
+/// goes to the queue of that thread.
+
+void TTaskScheduler::Spawn(Task_t task)
+{
+   const unsigned queueN = CurrentScheduler() == this ? CurrentThreadN() : fThreads.size();
+   {
+      TTaskQueue &queue = *fQueues[queueN];
+      std::lock_guard<std::mutex> lock(queue.fMutex);
+      queue.fTasks.push_back(std::move(task));
+   }
+   ++fNQueued;
+   // a sleeping thread checks fNQueued after incrementing fNSleeping
+   if (fNSleeping > 0) {
+      std::lock_guard<std::mutex> lock(fSleepMutex);
+      fWakeUp.notify_one();
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Execute one of the queued tasks in the calling thread.
+/// \return false if no task was queued
+
+bool TTaskScheduler::RunPendingTask()
+{
+   return RunTask(CurrentScheduler() == this ? CurrentThreadN() : fThreads.size());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// The loop of thread threadN: execute tasks, sleep when there are none.
+
+void TTaskScheduler::Work(unsigned threadN)
+{
+   CurrentScheduler() = this;
+   CurrentThreadN() = threadN;
+
+   while (true) {
+      if (RunTask(threadN))
+         continue;
+      std::unique_lock<std::mutex> lock(fSleepMutex);
+      if (fStop && fNQueued == 0)
+         break;
+      ++fNSleeping;
+      fWakeUp.wait(lock, [this]() { return fStop || fNQueued > 0; });
+      --fNSleeping;
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Execute a task of queue queueN, or one stolen from another queue.
+/// \return false if all the queues were empty
+
+bool TTaskScheduler::RunTask(unsigned queueN)
+{
+   Task_t task;
+   if (!PopTask(queueN, task) && !StealTask(queueN, task))
+      return false;
+   task();
+   return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Take the most recent task of queue queueN.
+
+bool TTaskScheduler::PopTask(unsigned queueN, Task_t &task)
+{
+   TTaskQueue &queue = *fQueues[queueN];
+   std::lock_guard<std::mutex> lock(queue.fMutex);
+   if (queue.fTasks.empty())
+      return false;
+   task = std::move(queue.fTasks.back());
+   queue.fTasks.pop_back();
+   --fNQueued;
+   return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Take the oldest task of the first non-empty queue other than queueN.
+/// The queues are visited starting from the one after queueN, so that the
+/// threads do not all steal from the same queue.
+
+bool TTaskScheduler::StealTask(unsigned queueN, Task_t &task)
+{
+   const unsigned nQueues = fQueues.size();
+   for (unsigned i = 1; i < nQueues; ++i) {
+      TTaskQueue &queue = *fQueues[(queueN + i) % nQueues];
+      std::lock_guard<std::mutex> lock(queue.fMutex);
+      if (queue.fTasks.empty())
+         continue;
+      task = std::move(queue.fTasks.front());
+      queue.fTasks.pop_front();
+      --fNQueued;
+      return true;
+   }
+   return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Wait for the tasks of the group, ignoring their exceptions.
+
+TTaskGroup::~TTaskGroup()
+{
+   try {
+      Wait();
+   } catch (...) {
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Wait for all the tasks of the group, including those added meanwhile,
+/// executing queued tasks instead of blocking. Rethrow the first exception
+/// thrown by a task of the group, if any.
+
+void TTaskGroup::Wait()
+{
+   while (fNPending > 0) {
+      if (fScheduler.RunPendingTask())
+         continue;
+      // the tasks left are running in other threads
+      std::unique_lock<std::mutex> lock(fMutex);
+      fAllDone.wait_for(lock, std::chrono::microseconds(100), [this]() { return fNPending == 0; });
+   }
+
+   std::exception_ptr exception;
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      std::swap(exception, fException);
+   }
+   if (exception)
+      std::rethrow_exception(exception);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Called by each task of the group when it completes. The counter is
+/// decremented under the lock, so that Wait cannot return, and the group
+/// be destroyed, before the notification is done.
+
+void TTaskGroup::Done()
+{
+   std::lock_guard<std::mutex> lock(fMutex);
+   if (--fNPending == 0)
+      fAllDone.notify_all();
+}
+
+}
@@ -25,6 +25,13 @@ namespace ROOT {
    // in greater compression factors, but takes more CPU time
    // and memory when compressing.  LZMA memory usage is particularly
    // high for compression levels 8 and 9.
+   // The LZ4 algorithm (bundled with ROOT) trades a somewhat lower
+   // compression factor for much faster decompression, which makes
+   // it a good choice for data that is read many times.
+   // The ZSTD algorithm (Zstandard, requires ROOT to be built with
+   // libzstd) gives compression factors close to LZMA with decompression
+   // speed close to ZLIB. It can use a dictionary trained on the first
+   // baskets of a branch, see TBranch::SetCompressionDictionary.
    //
    // The current algorithms support level 1 to 9. The higher
    // the level the greater the compression and more CPU time
@@ -34,6 +41,8 @@ namespace ROOT {
                                 kZLIB,
                                 kLZMA,
                                 kOldCompressionAlgo,
+                                kLZ4,
+                                kZSTD,
                                 // if adding new algorithm types,
                                 // keep this enum value last
                                 kUndefinedCompressionAlgorithm
@@ -18,12 +18,29 @@ extern "C" unsigned long R__memcompress(char *tgt, unsigned long tgtsize, char *
 
 extern "C" void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm);
 
+extern "C" void R__zipMultipleAlgorithmWithDict(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm, const char *dict, int dictsize);
+
+extern "C" int R__zipTrainDict(int compressionAlgorithm, char *dict, int dictcapacity, const char *samples, const int *samplesizes, int nsamples);
+
 extern "C" void R__zip(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep);
 
 extern "C" void R__unzip(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep);
 
+extern "C" void R__unzipWithDict(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep, const char *dict, int dictsize);
+
 extern "C" int R__unzip_header(int *srcsize, unsigned char *src, int *tgtsize);
 
+extern "C" int R__filter(int filter, int elemsize, int srcsize, const char *src, char *tgt);
+
+extern "C" int R__unfilter(int filter, int elemsize, int srcsize, const char *src, char *tgt);
+
+extern "C" void R__filter_write_header(int filter, int elemsize, int srcsize, unsigned char *tgt);
+
+extern "C" int R__filter_header(unsigned char *src, int *filter, int *elemsize, int *srcsize);
+
 enum { kMAXZIPBUF = 0xffffff };
 
+// Pre-compression filters (they can be combined), see R__filter.
+enum { kFilterShuffle = 1, kFilterDelta = 2, kFilterHeaderSize = 9 };
+
 #endif
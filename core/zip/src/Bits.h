@@ -15,6 +15,8 @@
 #include "zlib.h"
 #include "RConfigure.h"
 #include "ZipLZMA.h"
+#include "ZipLZ4.h"
+#include "ZipZSTD.h"
 
 #include <stdio.h>
 #include <assert.h>
@@ -288,10 +290,14 @@ struct bits_internal_state {
    R__ZipMode = 1 : ZLIB compression algorithm is used (default)
    R__ZipMode = 2 : LZMA compression algorithm is used
    R__ZipMode = 0 or 3 : a very old compression algorithm is used
+   R__ZipMode = 4 : LZ4 compression algorithm is used
+   R__ZipMode = 5 : ZSTD compression algorithm is used (ZLIB if ROOT was built
+                    without libzstd)
    (the very old algorithm is supported for backward compatibility)
    The LZMA algorithm requires the external XZ package be installed when linking
    is done. LZMA typically has significantly higher compression factors, but takes
-   more CPU time and memory resources while compressing.
+   more CPU time and memory resources while compressing. LZ4 is bundled with
+   ROOT; it compresses less than ZLIB but decompresses several times faster.
 */
 int R__ZipMode = 1;
 
@@ -566,6 +572,8 @@ void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize,
      /*                      1 = zlib */
      /*                      2 = lzma */
      /*                      3 = old */
+     /*                      4 = lz4 */
+     /*                      5 = zstd */
 {
   int err;
   int method   = Z_DEFLATED;
@@ -585,6 +593,19 @@ void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize,
     return;
   }
 
+  // The LZ4 compression algorithm, favouring decompression speed
+  if (compressionAlgorithm == 4) {
+    R__zipLZ4(cxlevel, srcsize, src, tgtsize, tgt, irep);
+    return;
+  }
+
+  // The Zstandard compression algorithm, falls back to ZLIB (below) when
+  // ROOT was built without libzstd
+  if (compressionAlgorithm == 5 && R__availableZSTD()) {
+    R__zipZSTD(cxlevel, srcsize, src, tgtsize, tgt, irep, 0, 0);
+    return;
+  }
+
   // The very old algorithm for backward compatibility
   // 0 for selecting with R__ZipMode in a backward compatible way
   // 3 for selecting in other cases
@@ -712,6 +733,38 @@ void R__zipMultipleAlgorithm(int cxlevel, int *srcsize, char *src, int *tgtsize,
   }
 }
 
+/* ===========================================================================
+   Same as R__zipMultipleAlgorithm, but algorithms supporting it (ZSTD)
+   compress against the dictionary dict of size dictsize. The dictionary
+   is ignored if it is empty or the algorithm does not support it.
+*/
+void R__zipMultipleAlgorithmWithDict(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, int compressionAlgorithm, const char *dict, int dictsize)
+{
+  if (compressionAlgorithm == 0) {
+    compressionAlgorithm = R__ZipMode;
+  }
+  if (cxlevel > 0 && compressionAlgorithm == 5 && dict && dictsize > 0 && R__availableZSTD()) {
+    R__zipZSTD(cxlevel, srcsize, src, tgtsize, tgt, irep, dict, dictsize);
+    return;
+  }
+  R__zipMultipleAlgorithm(cxlevel, srcsize, src, tgtsize, tgt, irep, compressionAlgorithm);
+}
+
+/* ===========================================================================
+   Train a compression dictionary for the given algorithm from nsamples
+   buffers concatenated in samples.  Returns the size of the dictionary
+   written into dict, or 0 if the algorithm does not support dictionaries
+   or the training failed.
+*/
+int R__zipTrainDict(int compressionAlgorithm, char *dict, int dictcapacity, const char *samples, const int *samplesizes, int nsamples)
+{
+  if (compressionAlgorithm == 0) {
+    compressionAlgorithm = R__ZipMode;
+  }
+  if (compressionAlgorithm != 5) return 0;
+  return R__trainZSTD(dict, dictcapacity, samples, samplesizes, nsamples);
+}
+
 void R__zip(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep)
 {
   R__zipMultipleAlgorithm(cxlevel, srcsize, src, tgtsize, tgt, irep, 0);
@@ -13,7 +13,157 @@
 
 #include "zlib.h"
 
+#include <string.h>
+
 unsigned long R__crc32(unsigned long crc, const unsigned char* buf, unsigned int len)
 {
    return crc32(crc, buf, len);
 }
+
+////////////////////////////////////////////////////////////////////////////////
+// Pre-compression filters.
+//
+// A filtered buffer is preceded, in front of the compressed records, by a
+// record header of kFilterHeaderSize bytes:
+//    'P','F', filter bits, element size, 4 bytes (little endian) filtered size, 0
+// The header does not match any compression algorithm signature, so that
+// readers not knowing about filters fail in R__unzip_header.
+//
+// kFilterDelta replaces each (big endian) integer element by the difference
+// with the previous one; kFilterShuffle then transposes the bytes of the
+// elements so that the bytes of same significance are stored together.
+// Both transformations make the typical content of numeric baskets (slowly
+// varying values, small integers, float exponents) much easier to compress.
+
+namespace {
+
+template <typename T>
+T R__readBE(const unsigned char *p, int elemsize)
+{
+   T v = 0;
+   for (int i = 0; i < elemsize; ++i) v = (v << 8) | p[i];
+   return v;
+}
+
+template <typename T>
+void R__writeBE(unsigned char *p, int elemsize, T v)
+{
+   for (int i = elemsize - 1; i >= 0; --i) {
+      p[i] = (unsigned char)(v & 0xff);
+      v >>= 8;
+   }
+}
+
+void R__delta(int elemsize, int n, unsigned char *buf, bool forward)
+{
+   unsigned long long prev = 0;
+   for (int i = 0; i < n; ++i) {
+      unsigned char *p = buf + i * elemsize;
+      unsigned long long v = R__readBE<unsigned long long>(p, elemsize);
+      if (forward) {
+         R__writeBE(p, elemsize, v - prev);
+         prev = v;
+      } else {
+         prev += v;
+         R__writeBE(p, elemsize, prev);
+      }
+   }
+}
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/// Apply the filters to the srcsize bytes of src, made of elements of
+/// elemsize bytes, and store the result in tgt (of at least srcsize bytes).
+/// Returns 1 on success and 0 if the filters cannot be applied (the
+/// content of tgt is then undefined).
+
+int R__filter(int filter, int elemsize, int srcsize, const char *src, char *tgt)
+{
+   if (filter <= 0 || (filter & ~(kFilterShuffle | kFilterDelta))) return 0;
+   if (elemsize <= 0 || elemsize > 8 || srcsize <= 0 || srcsize % elemsize) return 0;
+   if ((filter & kFilterDelta) && elemsize != 2 && elemsize != 4 && elemsize != 8) return 0;
+
+   const int n = srcsize / elemsize;
+   const unsigned char *in = (const unsigned char *)src;
+   unsigned char *out = (unsigned char *)tgt;
+
+   if (filter & kFilterDelta) {
+      if (filter & kFilterShuffle) {
+         // Compute the differences on the fly to avoid a temporary buffer
+         unsigned long long prev = 0;
+         for (int i = 0; i < n; ++i) {
+            unsigned long long v = R__readBE<unsigned long long>(in + i * elemsize, elemsize);
+            unsigned long long d = v - prev;
+            prev = v;
+            for (int b = elemsize - 1; b >= 0; --b) {
+               out[b * n + i] = (unsigned char)(d & 0xff);
+               d >>= 8;
+            }
+         }
+         return 1;
+      }
+      memcpy(out, in, srcsize);
+      R__delta(elemsize, n, out, true);
+      return 1;
+   }
+
+   for (int i = 0; i < n; ++i) {
+      for (int b = 0; b < elemsize; ++b) out[b * n + i] = in[i * elemsize + b];
+   }
+   return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Revert R__filter: store in tgt the srcsize bytes of the original buffer
+/// from the filtered buffer src. Returns 1 on success, 0 otherwise.
+
+int R__unfilter(int filter, int elemsize, int srcsize, const char *src, char *tgt)
+{
+   if (filter <= 0 || (filter & ~(kFilterShuffle | kFilterDelta))) return 0;
+   if (elemsize <= 0 || elemsize > 8 || srcsize <= 0 || srcsize % elemsize) return 0;
+   if ((filter & kFilterDelta) && elemsize != 2 && elemsize != 4 && elemsize != 8) return 0;
+
+   const int n = srcsize / elemsize;
+   const unsigned char *in = (const unsigned char *)src;
+   unsigned char *out = (unsigned char *)tgt;
+
+   if (filter & kFilterShuffle) {
+      for (int i = 0; i < n; ++i) {
+         for (int b = 0; b < elemsize; ++b) out[i * elemsize + b] = in[b * n + i];
+      }
+   } else {
+      memcpy(out, in, srcsize);
+   }
+   if (filter & kFilterDelta) R__delta(elemsize, n, out, false);
+   return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the filter record header in tgt (kFilterHeaderSize bytes).
+
+void R__filter_write_header(int filter, int elemsize, int srcsize, unsigned char *tgt)
+{
+   tgt[0] = 'P';
+   tgt[1] = 'F';
+   tgt[2] = (unsigned char)filter;
+   tgt[3] = (unsigned char)elemsize;
+   tgt[4] = (unsigned char)(srcsize & 0xff);
+   tgt[5] = (unsigned char)((srcsize >> 8) & 0xff);
+   tgt[6] = (unsigned char)((srcsize >> 16) & 0xff);
+   tgt[7] = (unsigned char)((srcsize >> 24) & 0xff);
+   tgt[8] = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Reads the filter record header in front of the compressed records.
+/// Returns 0 if src starts with a filter record, 1 otherwise.
+
+int R__filter_header(unsigned char *src, int *filter, int *elemsize, int *srcsize)
+{
+   if (src[0] != 'P' || src[1] != 'F') return 1;
+   *filter   = src[2];
+   *elemsize = src[3];
+   *srcsize  = (int)((unsigned)src[4] | ((unsigned)src[5] << 8) | ((unsigned)src[6] << 16) | ((unsigned)src[7] << 24));
+   return 0;
+}
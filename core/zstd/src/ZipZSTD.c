@@ -0,0 +1,180 @@
+// @(#)root/zstd:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/* Zstandard compression of ROOT buffers.
+   The ROOT header uses the signature 'Z','S' followed by a flag byte:
+   0 for a plain zstd frame and 1 for a frame compressed against a
+   dictionary (see TBranch::SetCompressionDictionary).  A buffer compressed
+   with a dictionary can only be decompressed with the same dictionary;
+   zstd verifies the dictionary ID stored in the frame.
+
+   ROOT compression levels 1 to 9 are mapped onto the zstd levels 1 to 19. */
+
+#include "ZipZSTD.h"
+#include "RConfigure.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef R__HAS_ZSTD
+#include "zstd.h"
+#include "zdict.h"
+#endif
+
+static const int kHeaderSize = 9;
+
+int R__availableZSTD(void)
+{
+#ifdef R__HAS_ZSTD
+   return 1;
+#else
+   return 0;
+#endif
+}
+
+#ifdef R__HAS_ZSTD
+
+void R__zipZSTD(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, const char *dict, int dictsize)
+{
+   size_t out_size;
+   unsigned in_size = (unsigned) (*srcsize);
+   int level;
+   ZSTD_CCtx *cctx;
+
+   *irep = 0;
+
+   if (*tgtsize <= kHeaderSize) {
+      return;
+   }
+
+   if (*srcsize > 0xffffff || *srcsize < 0) {
+      return;
+   }
+
+   if (cxlevel > 9) cxlevel = 9;
+   level = (cxlevel <= 1) ? 1 : 2 * cxlevel + 1;
+
+   cctx = ZSTD_createCCtx();
+   if (!cctx) {
+      return;
+   }
+   if (dict && dictsize > 0) {
+      out_size = ZSTD_compress_usingDict(cctx, &tgt[kHeaderSize], (size_t)(*tgtsize - kHeaderSize),
+                                         src, (size_t)in_size, dict, (size_t)dictsize, level);
+   } else {
+      out_size = ZSTD_compressCCtx(cctx, &tgt[kHeaderSize], (size_t)(*tgtsize - kHeaderSize),
+                                   src, (size_t)in_size, level);
+   }
+   ZSTD_freeCCtx(cctx);
+
+   if (ZSTD_isError(out_size) || out_size > 0xffffff) {
+      /* No need to print an error message. We simply abandon the compression
+         the buffer cannot be compressed or compressed buffer would be larger than original buffer
+      */
+      return;
+   }
+
+   tgt[0] = 'Z';  /* Signature of Zstandard */
+   tgt[1] = 'S';
+   tgt[2] = (dict && dictsize > 0) ? 1 : 0;
+
+   tgt[3] = (char)(out_size & 0xff);
+   tgt[4] = (char)((out_size >> 8) & 0xff);
+   tgt[5] = (char)((out_size >> 16) & 0xff);
+
+   tgt[6] = (char)(in_size & 0xff);         /* decompressed size */
+   tgt[7] = (char)((in_size >> 8) & 0xff);
+   tgt[8] = (char)((in_size >> 16) & 0xff);
+
+   *irep = (int)out_size + kHeaderSize;
+}
+
+void R__unzipZSTD(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep, const char *dict, int dictsize)
+{
+   size_t in_size, out_size;
+   ZSTD_DCtx *dctx;
+
+   *irep = 0;
+
+   in_size = (size_t)src[3] | ((size_t)src[4] << 8) | ((size_t)src[5] << 16);
+   if ((int)in_size + kHeaderSize > *srcsize) {
+      fprintf(stderr, "R__unzipZSTD: discrepancy in source length\n");
+      return;
+   }
+   if (src[2] == 1 && (!dict || dictsize <= 0)) {
+      fprintf(stderr, "R__unzipZSTD: buffer was compressed with a dictionary which was not provided\n");
+      return;
+   }
+
+   dctx = ZSTD_createDCtx();
+   if (!dctx) {
+      fprintf(stderr, "R__unzipZSTD: cannot allocate the decompression context\n");
+      return;
+   }
+   if (src[2] == 1) {
+      out_size = ZSTD_decompress_usingDict(dctx, tgt, (size_t)(*tgtsize), &src[kHeaderSize], in_size,
+                                           dict, (size_t)dictsize);
+   } else {
+      out_size = ZSTD_decompressDCtx(dctx, tgt, (size_t)(*tgtsize), &src[kHeaderSize], in_size);
+   }
+   ZSTD_freeDCtx(dctx);
+
+   if (ZSTD_isError(out_size)) {
+      fprintf(stderr, "R__unzipZSTD: error in decompression: %s\n", ZSTD_getErrorName(out_size));
+      return;
+   }
+
+   *irep = (int)out_size;
+}
+
+int R__trainZSTD(char *dict, int dictcapacity, const char *samples, const int *samplesizes, int nsamples)
+{
+   size_t *sizes;
+   size_t result;
+   int i;
+
+   if (nsamples <= 0 || dictcapacity <= 0) return 0;
+
+   sizes = (size_t *)malloc(nsamples * sizeof(size_t));
+   if (!sizes) return 0;
+   for (i = 0; i < nsamples; ++i) sizes[i] = (size_t)samplesizes[i];
+
+   result = ZDICT_trainFromBuffer(dict, (size_t)dictcapacity, samples, sizes, (unsigned)nsamples);
+   free(sizes);
+
+   if (ZDICT_isError(result)) {
+      /* Typically not enough (or not diverse enough) samples; the caller
+         continues without a dictionary. */
+      return 0;
+   }
+   return (int)result;
+}
+
+#else
+
+void R__zipZSTD(int cxlevel, int *srcsize, char *src, int *tgtsize, char *tgt, int *irep, const char *dict, int dictsize)
+{
+   (void)cxlevel; (void)srcsize; (void)src; (void)tgtsize; (void)tgt; (void)dict; (void)dictsize;
+   *irep = 0;
+}
+
+void R__unzipZSTD(int *srcsize, unsigned char *src, int *tgtsize, unsigned char *tgt, int *irep, const char *dict, int dictsize)
+{
+   (void)srcsize; (void)src; (void)tgtsize; (void)tgt; (void)dict; (void)dictsize;
+   *irep = 0;
+   fprintf(stderr, "R__unzipZSTD: ROOT was built without ZSTD support, cannot decompress this buffer\n");
+}
+
+int R__trainZSTD(char *dict, int dictcapacity, const char *samples, const int *samplesizes, int nsamples)
+{
+   (void)dict; (void)dictcapacity; (void)samples; (void)samplesizes; (void)nsamples;
+   return 0;
+}
+
+#endif
@@ -27,6 +27,11 @@ IODEP        := $(IOO:.o=.d) $(IODO:.o=.d)
 IOLIB        := $(LPATH)/libRIO.$(SOEXT)
 IOMAP        := $(IOLIB:.$(SOEXT)=.rootmap)
 
+# POSIX asynchronous I/O (aio_read) used by TFile::ReadBuffersAsyncIO
+ifneq ($(findstring linux,$(ARCH)),)
+IOLIBEXTRA   += -lrt
+endif
+
 # used in the main Makefile
 ALLHDRS      += $(patsubst $(MODDIRI)/%.h,include/%.h,$(IOH))
 ALLLIBS      += $(IOLIB)
@@ -15,6 +15,8 @@
 #pragma link off all functions;
 
 #pragma link C++ class TBufferFile;
+#pragma link C++ class TBufferMerger-;
+#pragma link C++ class TBufferMergerFile;
 #pragma link C++ class TDirectoryFile-;
 #pragma link C++ class TFile-;
 #pragma link C++ class TFileCacheRead+;
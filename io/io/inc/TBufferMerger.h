@@ -0,0 +1,82 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TBufferMerger
+#define ROOT_TBufferMerger
+
+#ifndef ROOT_TMemFile
+#include "TMemFile.h"
+#endif
+#ifndef ROOT_TString
+#include "TString.h"
+#endif
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class TBufferFile;
+class TBufferMergerFile;
+class TFileMerger;
+
+class TBufferMerger {
+private:
+   TBufferMerger(const TBufferMerger &);            // Not implemented
+   TBufferMerger &operator=(const TBufferMerger &); // Not implemented
+
+   TString                   fName;           ///< Name of the output file
+   Int_t                     fCompress;       ///< Compression settings of the sub-files
+   TFileMerger              *fMerger;         ///< Merger owning the output file, only used by the merging thread
+   std::thread              *fMergingThread;  ///< Thread merging the queued buffers into the output file
+   mutable std::mutex        fQueueMutex;     ///< Protects fQueue and fAttachedFiles
+   std::condition_variable   fDataAvailable;  ///< Signals a new buffer in fQueue
+   std::queue<TBufferFile*>  fQueue;          ///< Serialized sub-files waiting to be merged, 0 stops the merging thread
+   std::vector<std::weak_ptr<TBufferMergerFile> > fAttachedFiles; ///< Sub-files handed out by GetFile
+   std::function<void(void)> fCallback;       ///< Called after each merge
+
+   void Push(TBufferFile *buffer);
+   void WriteOutputFile();
+
+   friend class TBufferMergerFile;
+
+public:
+   TBufferMerger(const char *name, Option_t *option = "RECREATE", Int_t compress = 1);
+   virtual ~TBufferMerger();
+
+   std::shared_ptr<TBufferMergerFile> GetFile();
+   size_t GetQueueSize() const;
+   Bool_t IsZombie() const { return fMergingThread == 0; }
+   void   RegisterCallback(const std::function<void(void)> &f);
+};
+
+class TBufferMergerFile : public TMemFile {
+private:
+   TBufferMerger *fMerger; ///<! Merger receiving the content of this file
+
+   TBufferMergerFile(TBufferMerger &merger);
+   TBufferMergerFile(const TBufferMergerFile &);            // Not implemented
+   TBufferMergerFile &operator=(const TBufferMergerFile &); // Not implemented
+
+   friend class TBufferMerger;
+
+public:
+   virtual ~TBufferMergerFile();
+
+   virtual Int_t Write(const char *name=0, Int_t opt=0, Int_t bufsiz=0);
+   virtual Int_t Write(const char *name=0, Int_t opt=0, Int_t bufsiz=0) const;
+
+   ClassDef(TBufferMergerFile,0);  // In memory sub-file whose content is merged by a TBufferMerger.
+};
+
+#endif
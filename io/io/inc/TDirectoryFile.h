@@ -25,6 +25,9 @@
 #include "TDirectory.h"
 #endif
 
+#include <utility>
+#include <vector>
+
 class TList;
 class TBrowser;
 class TKey;
@@ -45,14 +48,23 @@ protected:
    Long64_t    fSeekKeys;        ///< Location of Keys record on file
    TFile      *fFile;            ///< Pointer to current file in memory
    TList      *fKeys;            ///< Pointer to keys list in memory
+   mutable char *fKeysBuffer;    ///<! Keys record not unstreamed yet (option "lazykeys=1" of TFile::Open)
+   mutable Int_t fKeysBufferSize; ///<! Size of fKeysBuffer
+   mutable std::vector<std::pair<UInt_t,Int_t> > fKeysIndex; ///<! Hash of the name and offset in fKeysBuffer of each key, sorted
 
    virtual void         CleanTargets();
    void Init(TClass *cl = 0);
+   Int_t                CountKeys(const char *classname) const;
+   void                 LoadLazyKeys() const;
 
 private:
    TDirectoryFile(const TDirectoryFile &directory);  //Directories cannot be copied
    void operator=(const TDirectoryFile &); //Directories cannot be copied
 
+   void                 DeleteKeys(Option_t *option = "slow");
+   Int_t                IndexKeys(const char *buffer, Int_t nbytes, Int_t nkeys);
+   TKey                *LookupKey(const char *name, Short_t cycle, Bool_t exact) const;
+
 public:
    // TDirectory status bits
    enum { kCloseDirectory = BIT(7) };
@@ -88,10 +100,10 @@ public:
    const TDatime      &GetCreationDate() const { return fDatimeC; }
    virtual TFile      *GetFile() const { return fFile; }
    virtual TKey       *GetKey(const char *name, Short_t cycle=9999) const;
-   virtual TList      *GetListOfKeys() const { return fKeys; }
+   virtual TList      *GetListOfKeys() const { if (fKeysBuffer) LoadLazyKeys(); return fKeys; }
    const TDatime      &GetModificationDate() const { return fDatimeM; }
    virtual Int_t       GetNbytesKeys() const { return fNbytesKeys; }
-   virtual Int_t       GetNkeys() const { return fKeys->GetSize(); }
+   virtual Int_t       GetNkeys() const { return fKeysBuffer ? (Int_t)fKeysIndex.size() : fKeys->GetSize(); }
    virtual Long64_t    GetSeekDir() const { return fSeekDir; }
    virtual Long64_t    GetSeekParent() const { return fSeekParent; }
    virtual Long64_t    GetSeekKeys() const { return fSeekKeys; }
@@ -25,6 +25,10 @@ public:
    typedef Cont_t            *PCont_t;
 protected:
 
+   // Key and value are emulated classes with only fundamental members (-1: not yet known)
+   Int_t fPlainKey;
+   Int_t fPlainVal;
+
    // Some hack to avoid const-ness
    virtual TGenCollectionProxy* InitializeEx(Bool_t silent);
 
@@ -40,6 +44,15 @@ protected:
    // Expand the container
    void Expand(UInt_t nCurr, UInt_t left);
 
+   // Check whether the objects of 'v' need neither construction nor destruction
+   Bool_t HasPlainObjects(const Value *v, Int_t &plain);
+
+   // Input streamer of 'nElements' objects with only fundamental members
+   void ReadPlainObjects(TClass *cl, char *addr, UInt_t nElements, TBuffer &b);
+
+   // Output streamer of 'nElements' objects with only fundamental members
+   void WritePlainObjects(TClass *cl, char *addr, UInt_t nElements, TBuffer &b);
+
 private:
    TEmulatedCollectionProxy &operator=(const TEmulatedCollectionProxy &); // Not implemented.
 
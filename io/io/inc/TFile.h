@@ -22,6 +22,8 @@
 //////////////////////////////////////////////////////////////////////////
 
 #include <atomic>
+#include <utility>
+#include <vector>
 #ifndef ROOT_TDirectoryFile
 #include "TDirectoryFile.h"
 #endif
@@ -45,6 +47,7 @@ class TFilePrefetch;
 class TFile : public TDirectoryFile {
   friend class TDirectoryFile;
   friend class TFilePrefetch;
+  friend class TFileCacheWrite;
 
 public:
    /// Asynchronous open request status
@@ -85,11 +88,15 @@ protected:
    TFileCacheRead  *fCacheRead;      ///<!Pointer to the read cache (if any)
    TMap            *fCacheReadMap;   ///<!Pointer to the read cache (if any)
    TFileCacheWrite *fCacheWrite;     ///<!Pointer to the write cache (if any)
+   char            *fMapBuffer;      ///<!Memory mapping of the file when opened with option "mmap=1"
+   Long64_t         fMapSize;        ///<!Size of the memory mapping
+   std::vector<std::pair<char*, Long64_t> > fRetiredMaps; ///<!Mappings no longer used for reading, kept until Close since baskets may point into them
    Long64_t         fArchiveOffset;  ///<!Offset at which file starts in archive
    Bool_t           fIsArchive : 1;  ///<!True if this is a pure archive file
    Bool_t           fNoAnchorInName : 1; ///<!True if we don't want to force the anchor to be appended to the file name
    Bool_t           fIsRootFile : 1; ///<!True is this is a ROOT file, raw file otherwise
    Bool_t           fInitDone : 1;   ///<!True if the file has been initialized
+   Bool_t           fLazyKeys : 1;   ///<!True if the keys are created on demand (option "lazykeys=1")
    Bool_t           fMustFlush : 1;  ///<!True if the file buffers must be flushed
    Bool_t           fIsPcmFile : 1;  ///<!True if the file is a ROOT pcm file.
    TFileOpenHandle *fAsyncHandle;    ///<!For proper automatic cleanup
@@ -112,12 +119,19 @@ protected:
    static std::atomic<Long64_t>  fgFileCounter;           ///<Counter for all opened files
    static std::atomic<Int_t>     fgReadCalls;             ///<Number of bytes read from all TFile objects
    static Int_t     fgReadaheadSize;         ///<Readahead buffer size
+   static Int_t     fgAsyncIODepth;          ///<Max number of asynchronous reads in flight in ReadBuffers (0: disabled)
    static Bool_t    fgReadInfo;              ///<if true (default) ReadStreamerInfo is called when opening a file
    virtual EAsyncOpenStatus GetAsyncOpenStatus() { return fAsyncOpenStatus; }
    virtual void  Init(Bool_t create);
    Bool_t        FlushWriteCache();
    Int_t         ReadBufferViaCache(char *buf, Int_t len);
    Int_t         WriteBufferViaCache(const char *buf, Int_t len);
+   Bool_t        MapFile();
+   void          UnmapFile();
+   void          RetireMapping();
+   Bool_t        ReadBufferMapped(char *buf, Long64_t offset, Int_t len);
+   Int_t         ReadBuffersAsyncIO(char **buf, Long64_t *pos, Int_t *len, Int_t nbuf);
+   TList        *GetStreamerInfoListImpl(TString *digest, Bool_t &known);
 
    // Creating projects
    Int_t         MakeProjectParMake(const char *packname, const char *filename);
@@ -192,6 +206,7 @@ public:
    virtual Int_t       GetErrno() const;
    virtual void        ResetErrno() const;
    Int_t               GetFd() const { return fD; }
+   char               *GetMappedBuffer(Long64_t pos, Int_t len);
    virtual const TUrl *GetEndpointUrl() const { return &fUrl; }
    TObjArray          *GetListOfProcessIDs() const {return fProcessIDs;}
    TList              *GetListOfFree() const { return fFree; }
@@ -217,6 +232,8 @@ public:
    virtual void        IncrementProcessIDs() { fNProcessIDs++; }
    virtual Bool_t      IsArchive() const { return fIsArchive; }
            Bool_t      IsBinary() const { return TestBit(kBinaryFile); }
+           Bool_t      IsMapped() const { return fMapBuffer != 0; }
+           Bool_t      HasLazyKeys() const { return fLazyKeys; }
            Bool_t      IsRaw() const { return !fIsRootFile; }
    virtual Bool_t      IsOpen() const;
    virtual void        ls(Option_t *option="") const;
@@ -277,11 +294,13 @@ public:
    static Long64_t     GetFileBytesWritten();
    static Int_t        GetFileReadCalls();
    static Int_t        GetReadaheadSize();
+   static Int_t        GetAsyncIODepth();
 
    static void         SetFileBytesRead(Long64_t bytes = 0);
    static void         SetFileBytesWritten(Long64_t bytes = 0);
    static void         SetFileReadCalls(Int_t readcalls = 0);
    static void         SetReadaheadSize(Int_t bufsize = 256000);
+   static void         SetAsyncIODepth(Int_t depth = 64);
    static void         SetReadStreamerInfo(Bool_t readinfo=kTRUE);
    static Bool_t       GetReadStreamerInfo();
 
@@ -16,6 +16,10 @@
 #include "TObject.h"
 #endif
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 class TFile;
 
 class TFileCacheWrite : public TObject {
@@ -27,6 +31,20 @@ protected:
    TFile        *fFile;           ///< Pointer to file
    char         *fBuffer;         ///< [fBufferSize] buffer of contiguous prefetched blocks
    Bool_t        fRecursive;      ///< flag to avoid recursive calls
+   Bool_t        fWriteBehind;    ///<! True if the buffers are written by a background thread
+   Bool_t        fWriteError;     ///<! True if a background write failed
+   Bool_t        fStopWriter;     ///<! Asks the background thread to exit
+   char         *fWriteBuffer;    ///<! Buffer being written by the background thread
+   Long64_t      fWriteSeek;      ///<! Seek value of fWriteBuffer
+   Int_t         fWriteNtot;      ///<! Number of bytes of fWriteBuffer still to be written (0 when idle)
+   Int_t         fWriteFd;        ///<! File descriptor used by the background thread
+   std::thread  *fWriter;         ///<! Background (write-behind) thread
+   std::mutex    fWriteMutex;     ///<! Protects the hand over of fWriteBuffer
+   std::condition_variable fWriteCond; ///<! Signals a buffer to write or the end of a write
+
+   Bool_t        FlushAsync();
+   Bool_t        WaitWriteBehind();
+   void          WriteBehindLoop();
 
 private:
    TFileCacheWrite(const TFileCacheWrite &);            //cannot be copied
@@ -42,6 +60,8 @@ public:
    virtual Int_t       ReadBuffer(char *buf, Long64_t pos, Int_t len);
    virtual Int_t       WriteBuffer(const char *buf, Long64_t pos, Int_t len);
    virtual void        SetFile(TFile *file);
+   Bool_t              IsWriteBehind() const { return fWriteBehind; }
+   void                SetWriteBehind(Bool_t on = kTRUE);
 
    ClassDef(TFileCacheWrite,1)  //TFile cache when writing
 };
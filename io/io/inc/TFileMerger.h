@@ -40,7 +40,7 @@ protected:
    Bool_t         fFastMethod;       ///< True if using Fast merging algorithm (default)
    Bool_t         fNoTrees;          ///< True if Trees should not be merged (default is kFALSE)
    Bool_t         fExplicitCompLevel;///< True if the user explicitly requested a compressio level change (default kFALSE)
-   Bool_t         fCompressionChange;///< True if the output and input have different compression level (default kFALSE)
+   Bool_t         fCompressionChange;///< True if the output and input have different compression settings (default kFALSE)
    Int_t          fPrintLevel;       ///< How much information to print out at run time.
    TString        fMsgPrefix;        ///< Prefix to be used when printing informational message (default TFileMerger)
 
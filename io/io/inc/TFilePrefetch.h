@@ -46,6 +46,7 @@
 #include <atomic>
 #include <condition_variable>
 #include <mutex>
+#include <vector>
 
 
 class TFilePrefetch : public TObject {
@@ -73,6 +74,7 @@ public:
 
    void      ReadAsync(TFPBlock*, Bool_t&);
    void      ReadListOfBlocks();
+   void      ReadListOfBlocksAsync(const std::vector<TFPBlock*> &blocks);
 
    void      AddPendingBlock(TFPBlock*);
    TFPBlock *GetPendingBlock();
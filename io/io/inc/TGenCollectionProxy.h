@@ -301,6 +301,7 @@ protected:
    mutable TObjArray *fReadMemberWise;                                   ///< Array of bundle of TStreamerInfoActions to stream out (read)
    mutable std::map<std::string, TObjArray*> *fConversionReadMemberWise; ///< Array of bundle of TStreamerInfoActions to stream out (read) derived from another class.
    mutable TStreamerInfoActions::TActionSequence *fWriteMemberWise;
+   mutable UInt_t fSharedActionsGeneration;                              ///< Generation of the shared action sequences held by fReadMemberWise and fConversionReadMemberWise
    typedef void (*Sizing_t)(void *obj, size_t size);
    typedef void* (*Feedfunc_t)(void *from, void *to, size_t size);
    typedef void* (*Collectfunc_t)(void *from, void *to);
@@ -345,6 +346,8 @@ protected:
    virtual void DeleteItem(Bool_t force, void* ptr) const;
    // Allow to check function pointers.
    void CheckFunctions()  const;
+   // Drop the cached action sequences if shared ones were deleted.
+   void CheckSharedActions() const;
 
    // Set pointer to the TClass representing the content.
    virtual void UpdateValueClass(const TClass *oldcl, TClass *newcl);
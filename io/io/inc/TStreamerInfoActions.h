@@ -153,6 +153,10 @@ namespace TStreamerInfoActions {
       TActionSequence *CreateCopy();
       static TActionSequence *CreateReadMemberWiseActions(TVirtualStreamerInfo *info, TVirtualCollectionProxy &proxy);
       static TActionSequence *CreateWriteMemberWiseActions(TVirtualStreamerInfo *info, TVirtualCollectionProxy &proxy);
+      static TActionSequence *GetSharedReadMemberWiseActions(TVirtualStreamerInfo *info, TVirtualCollectionProxy &proxy);
+      static void             ReleaseSharedActions(TVirtualStreamerInfo *info);
+      static void             DeleteSharedActions(TVirtualStreamerInfo *info);
+      static UInt_t           GetSharedActionsGeneration();
       TActionSequence *CreateSubSequence(const std::vector<Int_t> &element_ids, size_t offset);
 
       void Print(Option_t * = "") const;
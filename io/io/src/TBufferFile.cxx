@@ -39,14 +39,7 @@ The concrete implementation of TBuffer for writing/reading to/from a ROOT file o
 #include "TVirtualMutex.h"
 #include "TArrayC.h"
 
-#if (defined(__linux) || defined(__APPLE__)) && defined(__i386__) && \
-     defined(__GNUC__)
-#define USE_BSWAPCPY
-#endif
-
-#ifdef USE_BSWAPCPY
 #include "Bswapcpy.h"
-#endif
 
 
 const UInt_t kNullTag           = 0;
@@ -60,6 +53,103 @@ const Int_t  kMapOffset         = 2;   // first 2 map entries are taken by null
 
 Int_t TBufferFile::fgMapSize   = kMapSize;
 
+namespace {
+
+// Number of elements converted per batch by the Float16_t and Double32_t
+// array streamers: the 4-byte on-file values are byte swapped in one go
+// into a stack buffer and converted from there.
+const Int_t kConvertChunk = 256;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read n 4-byte values from buf into tmp and advance buf.
+
+template <typename T>
+inline void R__UnpackChunk(char *&buf, T *tmp, Int_t n)
+{
+#ifdef R__BYTESWAP
+   R__bswapcpy32(tmp, buf, n);
+#else
+   memcpy(tmp, buf, n*sizeof(T));
+#endif
+   buf += n*sizeof(T);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write n 4-byte values from tmp into buf and advance buf.
+
+template <typename T>
+inline void R__PackChunk(char *&buf, const T *tmp, Int_t n)
+{
+#ifdef R__BYTESWAP
+   R__bswapcpy32(buf, tmp, n);
+#else
+   memcpy(buf, tmp, n*sizeof(T));
+#endif
+   buf += n*sizeof(T);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read n integers and convert them back to floating point values
+/// in the range [minvalue, minvalue+2^nbits/factor].
+
+template <typename T>
+void R__ReadArrayWithFactor(char *&buf, T *ptr, Int_t n, Double_t factor, Double_t minvalue)
+{
+   UInt_t aint[kConvertChunk];
+   for (Int_t j = 0; j < n; j += kConvertChunk) {
+      Int_t m = (n - j < kConvertChunk) ? n - j : kConvertChunk;
+      R__UnpackChunk(buf, aint, m);
+      for (Int_t k = 0; k < m; k++) ptr[j+k] = (T)(aint[k]/factor + minvalue);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Normalize n values to the range [xmin,xmax] and write them as integers.
+
+template <typename T>
+void R__WriteArrayWithFactor(char *&buf, const T *ptr, Int_t n, Double_t factor, Double_t xmin, Double_t xmax)
+{
+   UInt_t aint[kConvertChunk];
+   for (Int_t j = 0; j < n; j += kConvertChunk) {
+      Int_t m = (n - j < kConvertChunk) ? n - j : kConvertChunk;
+      for (Int_t k = 0; k < m; k++) {
+         T x = ptr[j+k];
+         if (x < xmin) x = xmin;
+         if (x > xmax) x = xmax;
+         aint[k] = UInt_t(0.5+factor*(x-xmin));
+      }
+      R__PackChunk(buf, aint, m);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read n floats and convert them to doubles.
+
+void R__ReadArrayFloatAsDouble(char *&buf, Double_t *d, Int_t n)
+{
+   Float_t afloat[kConvertChunk];
+   for (Int_t j = 0; j < n; j += kConvertChunk) {
+      Int_t m = (n - j < kConvertChunk) ? n - j : kConvertChunk;
+      R__UnpackChunk(buf, afloat, m);
+      for (Int_t k = 0; k < m; k++) d[j+k] = (Double_t)afloat[k];
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Convert n doubles to floats and write them.
+
+void R__WriteArrayDoubleAsFloat(char *&buf, const Double_t *d, Int_t n)
+{
+   Float_t afloat[kConvertChunk];
+   for (Int_t j = 0; j < n; j += kConvertChunk) {
+      Int_t m = (n - j < kConvertChunk) ? n - j : kConvertChunk;
+      for (Int_t k = 0; k < m; k++) afloat[k] = (Float_t)d[j+k];
+      R__PackChunk(buf, afloat, m);
+   }
+}
+
+} // anonymous namespace
+
 
 ClassImp(TBufferFile)
 
@@ -789,17 +879,11 @@ Int_t TBufferFile::ReadArray(Short_t *&h)
    if (!h) h = new Short_t[n];
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(h, fBufCur, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &h[i]);
-# endif
+   R__bswapcpy16(h, fBufCur, n);
 #else
    memcpy(h, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -822,17 +906,11 @@ Int_t TBufferFile::ReadArray(Int_t *&ii)
    if (!ii) ii = new Int_t[n];
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(ii, fBufCur, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ii[i]);
-# endif
+   R__bswapcpy32(ii, fBufCur, n);
 #else
    memcpy(ii, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -881,12 +959,11 @@ Int_t TBufferFile::ReadArray(Long64_t *&ll)
    if (!ll) ll = new Long64_t[n];
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ll[i]);
+   R__bswapcpy64(ll, fBufCur, n);
 #else
    memcpy(ll, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -909,17 +986,11 @@ Int_t TBufferFile::ReadArray(Float_t *&f)
    if (!f) f = new Float_t[n];
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(f, fBufCur, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &f[i]);
-# endif
+   R__bswapcpy32(f, fBufCur, n);
 #else
    memcpy(f, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -942,12 +1013,11 @@ Int_t TBufferFile::ReadArray(Double_t *&d)
    if (!d) d = new Double_t[n];
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &d[i]);
+   R__bswapcpy64(d, fBufCur, n);
 #else
    memcpy(d, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -1062,17 +1132,11 @@ Int_t TBufferFile::ReadStaticArray(Short_t *h)
    if (!h) return 0;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(h, fBufCur, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &h[i]);
-# endif
+   R__bswapcpy16(h, fBufCur, n);
 #else
    memcpy(h, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -1094,17 +1158,11 @@ Int_t TBufferFile::ReadStaticArray(Int_t *ii)
    if (!ii) return 0;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(ii, fBufCur, n);
-   fBufCur += sizeof(Int_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ii[i]);
-# endif
+   R__bswapcpy32(ii, fBufCur, n);
 #else
    memcpy(ii, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -1151,12 +1209,11 @@ Int_t TBufferFile::ReadStaticArray(Long64_t *ll)
    if (!ll) return 0;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ll[i]);
+   R__bswapcpy64(ll, fBufCur, n);
 #else
    memcpy(ll, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -1178,17 +1235,11 @@ Int_t TBufferFile::ReadStaticArray(Float_t *f)
    if (!f) return 0;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(f, fBufCur, n);
-   fBufCur += sizeof(Float_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &f[i]);
-# endif
+   R__bswapcpy32(f, fBufCur, n);
 #else
    memcpy(f, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -1210,12 +1261,11 @@ Int_t TBufferFile::ReadStaticArray(Double_t *d)
    if (!d) return 0;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &d[i]);
+   R__bswapcpy64(d, fBufCur, n);
 #else
    memcpy(d, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 
    return n;
 }
@@ -1328,17 +1378,11 @@ void TBufferFile::ReadFastArray(Short_t *h, Int_t n)
    if (n <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(h, fBufCur, n);
-   fBufCur += sizeof(Short_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &h[i]);
-# endif
+   R__bswapcpy16(h, fBufCur, n);
 #else
    memcpy(h, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1350,17 +1394,11 @@ void TBufferFile::ReadFastArray(Int_t *ii, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(ii, fBufCur, n);
-   fBufCur += sizeof(Int_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ii[i]);
-# endif
+   R__bswapcpy32(ii, fBufCur, n);
 #else
    memcpy(ii, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1388,12 +1426,11 @@ void TBufferFile::ReadFastArray(Long64_t *ll, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &ll[i]);
+   R__bswapcpy64(ll, fBufCur, n);
 #else
    memcpy(ll, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1405,17 +1442,11 @@ void TBufferFile::ReadFastArray(Float_t *f, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(f, fBufCur, n);
-   fBufCur += sizeof(Float_t)*n;
-# else
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &f[i]);
-# endif
+   R__bswapcpy32(f, fBufCur, n);
 #else
    memcpy(f, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1427,12 +1458,11 @@ void TBufferFile::ReadFastArray(Double_t *d, Int_t n)
    if (l <= 0 || l > fBufSize) return;
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      frombuf(fBufCur, &d[i]);
+   R__bswapcpy64(d, fBufCur, n);
 #else
    memcpy(d, fBufCur, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1445,11 +1475,7 @@ void TBufferFile::ReadFastArrayFloat16(Float_t *f, Int_t n, TStreamerElement *el
 
    if (ele && ele->GetFactor() != 0) {
       //a range was specified. We read an integer and convert it back to a float
-      Double_t xmin = ele->GetXmin();
-      Double_t factor = ele->GetFactor();
-      for (int j=0;j < n; j++) {
-         UInt_t aint; *this >> aint; f[j] = (Float_t)(aint/factor + xmin);
-      }
+      R__ReadArrayWithFactor(fBufCur, f, n, ele->GetFactor(), ele->GetXmin());
    } else {
       Int_t i;
       Int_t nbits = 0;
@@ -1484,9 +1510,7 @@ void TBufferFile::ReadFastArrayWithFactor(Float_t *ptr, Int_t n, Double_t factor
    if (n <= 0 || 3*n > fBufSize) return;
 
    //a range was specified. We read an integer and convert it back to a float
-   for (int j=0;j < n; j++) {
-      UInt_t aint; *this >> aint; ptr[j] = (Float_t)(aint/factor + minvalue);
-   }
+   R__ReadArrayWithFactor(fBufCur, ptr, n, factor, minvalue);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1527,22 +1551,14 @@ void TBufferFile::ReadFastArrayDouble32(Double_t *d, Int_t n, TStreamerElement *
 
    if (ele && ele->GetFactor() != 0) {
       //a range was specified. We read an integer and convert it back to a double.
-      Double_t xmin = ele->GetXmin();
-      Double_t factor = ele->GetFactor();
-      for (int j=0;j < n; j++) {
-         UInt_t aint; *this >> aint; d[j] = (Double_t)(aint/factor + xmin);
-      }
+      R__ReadArrayWithFactor(fBufCur, d, n, ele->GetFactor(), ele->GetXmin());
    } else {
       Int_t i;
       Int_t nbits = 0;
       if (ele) nbits = (Int_t)ele->GetXmin();
       if (!nbits) {
          //we read a float and convert it to double
-         Float_t afloat;
-         for (i = 0; i < n; i++) {
-            *this >> afloat;
-            d[i] = (Double_t)afloat;
-         }
+         R__ReadArrayFloatAsDouble(fBufCur, d, n);
       } else {
          //we read the exponent and the truncated mantissa of the float
          //and rebuild the double.
@@ -1574,9 +1590,7 @@ void TBufferFile::ReadFastArrayWithFactor(Double_t *d, Int_t n, Double_t factor,
    if (n <= 0 || 3*n > fBufSize) return;
 
    //a range was specified. We read an integer and convert it back to a double.
-   for (int j=0;j < n; j++) {
-      UInt_t aint; *this >> aint; d[j] = (Double_t)(aint/factor + minvalue);
-   }
+   R__ReadArrayWithFactor(fBufCur, d, n, factor, minvalue);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1589,11 +1603,7 @@ void TBufferFile::ReadFastArrayWithNbits(Double_t *d, Int_t n, Int_t nbits)
 
    if (!nbits) {
       //we read a float and convert it to double
-      Float_t afloat;
-      for (Int_t i = 0; i < n; i++) {
-         *this >> afloat;
-         d[i] = (Double_t)afloat;
-      }
+      R__ReadArrayFloatAsDouble(fBufCur, d, n);
    } else {
       //we read the exponent and the truncated mantissa of the float
       //and rebuild the double.
@@ -1761,17 +1771,11 @@ void TBufferFile::WriteArray(const Short_t *h, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(fBufCur, h, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, h[i]);
-# endif
+   R__bswapcpy16(fBufCur, h, n);
 #else
    memcpy(fBufCur, h, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1791,17 +1795,11 @@ void TBufferFile::WriteArray(const Int_t *ii, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, ii, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ii[i]);
-# endif
+   R__bswapcpy32(fBufCur, ii, n);
 #else
    memcpy(fBufCur, ii, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1859,12 +1857,11 @@ void TBufferFile::WriteArray(const Long64_t *ll, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ll[i]);
+   R__bswapcpy64(fBufCur, ll, n);
 #else
    memcpy(fBufCur, ll, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1884,17 +1881,11 @@ void TBufferFile::WriteArray(const Float_t *f, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, f, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, f[i]);
-# endif
+   R__bswapcpy32(fBufCur, f, n);
 #else
    memcpy(fBufCur, f, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -1914,12 +1905,11 @@ void TBufferFile::WriteArray(const Double_t *d, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, d[i]);
+   R__bswapcpy64(fBufCur, d, n);
 #else
    memcpy(fBufCur, d, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2027,17 +2017,11 @@ void TBufferFile::WriteFastArray(const Short_t *h, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy16(fBufCur, h, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, h[i]);
-# endif
+   R__bswapcpy16(fBufCur, h, n);
 #else
    memcpy(fBufCur, h, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2051,17 +2035,11 @@ void TBufferFile::WriteFastArray(const Int_t *ii, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, ii, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ii[i]);
-# endif
+   R__bswapcpy32(fBufCur, ii, n);
 #else
    memcpy(fBufCur, ii, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2103,12 +2081,11 @@ void TBufferFile::WriteFastArray(const Long64_t *ll, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, ll[i]);
+   R__bswapcpy64(fBufCur, ll, n);
 #else
    memcpy(fBufCur, ll, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2122,17 +2099,11 @@ void TBufferFile::WriteFastArray(const Float_t *f, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-# ifdef USE_BSWAPCPY
-   bswapcpy32(fBufCur, f, n);
-   fBufCur += l;
-# else
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, f[i]);
-# endif
+   R__bswapcpy32(fBufCur, f, n);
 #else
    memcpy(fBufCur, f, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2146,12 +2117,11 @@ void TBufferFile::WriteFastArray(const Double_t *d, Int_t n)
    if (fBufCur + l > fBufMax) AutoExpand(fBufSize+l);
 
 #ifdef R__BYTESWAP
-   for (int i = 0; i < n; i++)
-      tobuf(fBufCur, d[i]);
+   R__bswapcpy64(fBufCur, d, n);
 #else
    memcpy(fBufCur, d, l);
-   fBufCur += l;
 #endif
+   fBufCur += l;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2169,15 +2139,7 @@ void TBufferFile::WriteFastArrayFloat16(const Float_t *f, Int_t n, TStreamerElem
       //A range is specified. We normalize the float to the range and
       //convert it to an integer using a scaling factor that is a function of nbits.
       //see TStreamerElement::GetRange.
-      Double_t factor = ele->GetFactor();
-      Double_t xmin = ele->GetXmin();
-      Double_t xmax = ele->GetXmax();
-      for (int j = 0; j < n; j++) {
-         Float_t x = f[j];
-         if (x < xmin) x = xmin;
-         if (x > xmax) x = xmax;
-         UInt_t aint = UInt_t(0.5+factor*(x-xmin)); *this << aint;
-      }
+      R__WriteArrayWithFactor(fBufCur, f, n, ele->GetFactor(), ele->GetXmin(), ele->GetXmax());
    } else {
       Int_t nbits = 0;
       //number of bits stored in fXmin (see TStreamerElement::GetRange)
@@ -2220,15 +2182,7 @@ void TBufferFile::WriteFastArrayDouble32(const Double_t *d, Int_t n, TStreamerEl
       //A range is specified. We normalize the double to the range and
       //convert it to an integer using a scaling factor that is a function of nbits.
       //see TStreamerElement::GetRange.
-      Double_t factor = ele->GetFactor();
-      Double_t xmin = ele->GetXmin();
-      Double_t xmax = ele->GetXmax();
-      for (int j = 0; j < n; j++) {
-         Double_t x = d[j];
-         if (x < xmin) x = xmin;
-         if (x > xmax) x = xmax;
-         UInt_t aint = UInt_t(0.5+factor*(x-xmin)); *this << aint;
-      }
+      R__WriteArrayWithFactor(fBufCur, d, n, ele->GetFactor(), ele->GetXmin(), ele->GetXmax());
    } else {
       Int_t nbits = 0;
       //number of bits stored in fXmin (see TStreamerElement::GetRange)
@@ -2236,10 +2190,7 @@ void TBufferFile::WriteFastArrayDouble32(const Double_t *d, Int_t n, TStreamerEl
       Int_t i;
       if (!nbits) {
          //if no range and no bits specified, we convert from double to float
-         for (i = 0; i < n; i++) {
-            Float_t afloat = (Float_t)d[i];
-            *this << afloat;
-         }
+         R__WriteArrayDoubleAsFloat(fBufCur, d, n);
       } else {
          //a range is not specified, but nbits is.
          //In this case we truncate the mantissa to nbits and we stream
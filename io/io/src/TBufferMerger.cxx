@@ -0,0 +1,234 @@
+// @(#)root/io:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/**
+\class TBufferMerger TBufferMerger.cxx
+\ingroup IO
+
+TBufferMerger collects the content written by several threads into a
+single output file, without intermediate files on disk.
+
+Each thread obtains its own TBufferMergerFile with GetFile and fills its
+objects (typically a TTree) in it. Each call to TBufferMergerFile::Write
+serializes the in-memory file, queues it, and resets the objects which
+support it (see TMemFile::ResetAfterMerge). A dedicated thread merges the
+queued buffers, one after the other, into the output file with the
+incremental merge of TFileMerger, as done for TParallelMergingFile
+through a socket. The output file is closed when the TBufferMerger is
+destroyed, which must happen after all its TBufferMergerFile are gone.
+
+~~~{.cpp}
+ROOT::EnableThreadSafety();
+TBufferMerger merger("output.root");
+auto work = [&merger]() {
+   auto f = merger.GetFile();
+   f->cd(); // GetFile does not change gDirectory, attach the tree to f
+   TTree t("t", "t");
+   ...
+   for (...) {
+      t.Fill();
+      if (...) f->Write(); // Hand over the entries filled so far.
+   }
+   f->Write();
+};
+~~~
+
+Objects which can not be reset after a merge (histograms for example)
+are merged again each time the sub-file is written; they should only be
+written once.
+*/
+
+#include "TBufferMerger.h"
+
+#include "TBufferFile.h"
+#include "TError.h"
+#include "TFileMerger.h"
+#include "TROOT.h"
+#include "TVirtualMutex.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Constructor. Open the output file 'name' with 'option' (see TFile::Open)
+/// and start the merging thread. 'compress' is the compression setting of
+/// the output file and of the sub-files.
+
+TBufferMerger::TBufferMerger(const char *name, Option_t *option, Int_t compress)
+   : fName(name), fCompress(compress), fMerger(0), fMergingThread(0)
+{
+   fMerger = new TFileMerger(kFALSE, kFALSE);
+   fMerger->SetMsgPrefix("TBufferMerger");
+   if (!fMerger->OutputFile(name, option, compress)) {
+      Error("TBufferMerger", "cannot open the output file %s", name);
+      return;
+   }
+   fMergingThread = new std::thread(&TBufferMerger::WriteOutputFile, this);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Destructor. Merge the buffers still queued, then close the output file.
+
+TBufferMerger::~TBufferMerger()
+{
+   {
+      std::lock_guard<std::mutex> lock(fQueueMutex);
+      for (auto &f : fAttachedFiles) {
+         if (!f.expired()) {
+            Error("~TBufferMerger", "a TBufferMergerFile of %s is still in use", fName.Data());
+            break;
+         }
+      }
+   }
+   if (fMergingThread) {
+      Push(0);
+      fMergingThread->join();
+      delete fMergingThread;
+   }
+   R__LOCKGUARD2(gROOTMutex);
+   delete fMerger;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return a new in-memory file whose content is merged into the output
+/// file each time it is written. Each thread should use its own file.
+/// Returns a null pointer if the output file could not be opened.
+
+std::shared_ptr<TBufferMergerFile> TBufferMerger::GetFile()
+{
+   std::shared_ptr<TBufferMergerFile> f;
+   if (IsZombie()) {
+      Error("GetFile", "the output file %s is not open", fName.Data());
+      return f;
+   }
+   {
+      R__LOCKGUARD2(gROOTMutex);
+      TDirectory::TContext ctxt;
+      f.reset(new TBufferMergerFile(*this));
+   }
+   std::lock_guard<std::mutex> lock(fQueueMutex);
+   fAttachedFiles.push_back(f);
+   return f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return the number of buffers waiting to be merged. Producers can use it
+/// to slow down when the merging can not keep up.
+
+size_t TBufferMerger::GetQueueSize() const
+{
+   std::lock_guard<std::mutex> lock(fQueueMutex);
+   return fQueue.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Register a function called by the merging thread after each merge.
+
+void TBufferMerger::RegisterCallback(const std::function<void(void)> &f)
+{
+   std::lock_guard<std::mutex> lock(fQueueMutex);
+   fCallback = f;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Queue a serialized sub-file, the merger takes ownership of the buffer.
+/// A null buffer stops the merging thread once the queue is drained.
+
+void TBufferMerger::Push(TBufferFile *buffer)
+{
+   {
+      std::lock_guard<std::mutex> lock(fQueueMutex);
+      fQueue.push(buffer);
+   }
+   fDataAvailable.notify_one();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Body of the merging thread: merge the queued buffers, in order, into
+/// the output file.
+
+void TBufferMerger::WriteOutputFile()
+{
+   while (1) {
+      TBufferFile *buffer;
+      std::function<void(void)> callback;
+      {
+         std::unique_lock<std::mutex> lock(fQueueMutex);
+         fDataAvailable.wait(lock, [this]() { return !fQueue.empty(); });
+         buffer = fQueue.front();
+         fQueue.pop();
+         callback = fCallback;
+      }
+      if (!buffer) return;
+
+      Long64_t length;
+      buffer->SetReadMode();
+      buffer->SetBufferOffset(0);
+      buffer->ReadLong64(length);
+      {
+         R__LOCKGUARD2(gROOTMutex);
+         TDirectory::TContext ctxt;
+         TMemFile *memfile = new TMemFile(fName, buffer->Buffer() + buffer->Length(), length, "READ");
+         fMerger->AddFile(memfile, kFALSE);
+         if (!fMerger->PartialMerge(TFileMerger::kAllIncremental)) {
+            Error("WriteOutputFile", "failed to merge a buffer into %s", fName.Data());
+         }
+         fMerger->Reset();
+         delete memfile;
+      }
+      delete buffer;
+
+      if (callback) callback();
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Constructor, see TBufferMerger::GetFile.
+
+TBufferMergerFile::TBufferMergerFile(TBufferMerger &merger)
+   : TMemFile(merger.fName, "RECREATE", "", merger.fCompress), fMerger(&merger)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Destructor. The content not written yet is discarded.
+
+TBufferMergerFile::~TBufferMergerFile()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the objects to this in-memory file, hand the content over to the
+/// TBufferMerger and reset the objects which support it (like TTree), so
+/// that only the new content is sent at the next call.
+/// Nothing is written if the output file of the merger is not open.
+
+Int_t TBufferMergerFile::Write(const char *name, Int_t opt, Int_t bufsiz)
+{
+   if (fMerger->IsZombie()) {
+      Error("Write", "the output file %s is not open", fMerger->fName.Data());
+      return 0;
+   }
+   Int_t nbytes = TMemFile::Write(name, opt, bufsiz);
+   if (nbytes) {
+      TBufferFile *buffer = new TBufferFile(TBuffer::kWrite, GetEND() + sizeof(Long64_t));
+      buffer->WriteLong64(GetEND());
+      CopyTo(*buffer);
+      fMerger->Push(buffer);
+      ResetAfterMerge(0);
+   }
+   return nbytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// One can not save a const TDirectory object.
+
+Int_t TBufferMergerFile::Write(const char *name, Int_t opt, Int_t bufsiz) const
+{
+   Error("Write const","A const TFile object should not be saved. We try to proceed anyway.");
+   return const_cast<TBufferMergerFile*>(this)->Write(name, opt, bufsiz);
+}
@@ -47,8 +47,87 @@ End_Macro
 #include "TVirtualMutex.h"
 #include "TEmulatedCollectionProxy.h"
 
+#include <algorithm>
+#include <map>
+
 const UInt_t kIsBigFile = BIT(16);
 const Int_t  kMaxLen = 2048;
+const ULong64_t kSeekPdirMask = 0xffffffffffffULL; // See kPidOffsetMask in TKey.cxx
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fields of a key of the keys record needed to find it without creating
+/// the TKey. See TKey::ReadKeyBuffer for the layout.
+
+struct TKeyEntry {
+   Short_t     fCycle;
+   Long64_t    fSeekKey;
+   Long64_t    fSeekPdir;
+   const char *fClassName;
+   Int_t       fClassNameLen;
+   const char *fName;
+   Int_t       fNameLen;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Locate a TString streamed at buffer (see TString::ReadBuffer).
+
+Bool_t R__ReadKeyString(char *&buffer, const char *end, const char *&str, Int_t &len)
+{
+   if (buffer >= end) return kFALSE;
+   UChar_t nwh;
+   frombuf(buffer, &nwh);
+   if (nwh == 255) {
+      if (buffer + sizeof(Int_t) > end) return kFALSE;
+      frombuf(buffer, &len);
+   } else {
+      len = nwh;
+   }
+   if (len < 0 || buffer + len > end) return kFALSE;
+   str = buffer;
+   buffer += len;
+   return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Decode the key streamed at buffer and move buffer to the next key.
+/// Return false if the key overflows the record.
+
+Bool_t R__ReadKeyEntry(char *&buffer, const char *end, TKeyEntry &entry)
+{
+   // fNbytes, version, fObjlen, fDatime, fKeylen, fCycle and the two
+   // seek values in their short form.
+   if (buffer + 26 > end) return kFALSE;
+   Int_t nbytes, objlen;
+   UInt_t datime;
+   Version_t version;
+   Short_t keylen;
+   frombuf(buffer, &nbytes);
+   frombuf(buffer, &version);
+   frombuf(buffer, &objlen);
+   frombuf(buffer, &datime);
+   frombuf(buffer, &keylen);
+   frombuf(buffer, &entry.fCycle);
+   if (version > 1000) {
+      if (buffer + 2*sizeof(Long64_t) > end) return kFALSE;
+      Long64_t pdir;
+      frombuf(buffer, &entry.fSeekKey);
+      frombuf(buffer, &pdir);
+      entry.fSeekPdir = pdir & kSeekPdirMask;
+   } else {
+      Int_t seekkey, seekdir;
+      frombuf(buffer, &seekkey); entry.fSeekKey  = (Long64_t)seekkey;
+      frombuf(buffer, &seekdir); entry.fSeekPdir = (Long64_t)seekdir;
+   }
+   const char *title;
+   Int_t titlelen;
+   return R__ReadKeyString(buffer, end, entry.fClassName, entry.fClassNameLen)
+       && R__ReadKeyString(buffer, end, entry.fName, entry.fNameLen)
+       && R__ReadKeyString(buffer, end, title, titlelen);
+}
+
+} // anonymous namespace
 
 ClassImp(TDirectoryFile)
 
@@ -59,7 +138,7 @@ ClassImp(TDirectoryFile)
 TDirectoryFile::TDirectoryFile() : TDirectory()
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeysBuffer(0), fKeysBufferSize(0)
 {
 }
 
@@ -79,7 +158,7 @@ TDirectoryFile::TDirectoryFile(const char *name, const char *title, Option_t *cl
            : TDirectory()
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeysBuffer(0), fKeysBufferSize(0)
 {
    fName = name;
    fTitle = title;
@@ -167,7 +246,7 @@ void TDirectoryFile::Init(TClass *cl)
 TDirectoryFile::TDirectoryFile(const TDirectoryFile & directory) : TDirectory(directory)
    , fModified(kFALSE), fWritable(kFALSE), fNbytesKeys(0), fNbytesName(0)
    , fBufferSize(0), fSeekDir(0), fSeekParent(0), fSeekKeys(0)
-   , fFile(0), fKeys(0)
+   , fFile(0), fKeys(0), fKeysBuffer(0), fKeysBufferSize(0)
 {
    ((TDirectoryFile&)directory).Copy(*this);
 }
@@ -178,7 +257,7 @@ TDirectoryFile::TDirectoryFile(const TDirectoryFile & directory) : TDirectory(di
 TDirectoryFile::~TDirectoryFile()
 {
    if (fKeys) {
-      fKeys->Delete("slow");
+      DeleteKeys();
       SafeDelete(fKeys);
    }
 
@@ -225,6 +304,7 @@ void TDirectoryFile::Append(TObject *obj, Bool_t replace /* = kFALSE */)
 
 Int_t TDirectoryFile::AppendKey(TKey *key)
 {
+   if (fKeysBuffer) LoadLazyKeys();
    fModified = kTRUE;
 
    key->SetMotherDir(this);
@@ -261,7 +341,7 @@ void TDirectoryFile::Browse(TBrowser *b)
       TObject *obj = 0;
       TIter nextin(fList);
       TKey *key = 0, *keyo = 0;
-      TIter next(fKeys);
+      TIter next(GetListOfKeys());
 
       cd();
 
@@ -559,12 +639,50 @@ void TDirectoryFile::Close(Option_t *)
 
    // Delete keys from key list (but don't delete the list header)
    if (fKeys) {
-      fKeys->Delete("slow");
+      DeleteKeys();
    }
 
    CleanTargets();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Return the number of keys of the given class in this directory, without
+/// creating the keys not looked up yet.
+
+Int_t TDirectoryFile::CountKeys(const char *classname) const
+{
+   Int_t n = 0;
+   if (fKeysBuffer) {
+      Int_t len = strlen(classname);
+      Int_t nkeys = fKeysIndex.size();
+      char *buffer = fKeysBuffer;
+      TKeyEntry entry;
+      for (Int_t i = 0; i < nkeys && R__ReadKeyEntry(buffer, fKeysBuffer + fKeysBufferSize, entry); ++i) {
+         if (entry.fClassNameLen == len && !strncmp(entry.fClassName, classname, len)) ++n;
+      }
+   } else {
+      TIter next(fKeys);
+      TKey *key;
+      while ((key = (TKey*)next())) {
+         if (!strcmp(key->GetClassName(), classname)) ++n;
+      }
+   }
+   return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Delete the keys of this directory from memory, including the record of
+/// the keys not created yet.
+
+void TDirectoryFile::DeleteKeys(Option_t *option)
+{
+   delete [] fKeysBuffer;
+   fKeysBuffer = 0;
+   fKeysBufferSize = 0;
+   std::vector<std::pair<UInt_t,Int_t> >().swap(fKeysIndex);
+   fKeys->Delete(option);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Delete Objects or/and keys in a directory
 ///
@@ -911,16 +1029,10 @@ TObject *TDirectoryFile::Get(const char *namecycle)
 
 //*-*---------------------Case of Key---------------------
 //                        ===========
-   TKey *key;
-   TIter nextkey(GetListOfKeys());
-   while ((key = (TKey *) nextkey())) {
-      if (strcmp(namobj,key->GetName()) == 0) {
-         if ((cycle == 9999) || (cycle == key->GetCycle())) {
-            TDirectory::TContext ctxt(this);
-            idcur = key->ReadObj();
-            break;
-         }
-      }
+   TKey *key = LookupKey(namobj, cycle, kTRUE);
+   if (key) {
+      TDirectory::TContext ctxt(this);
+      idcur = key->ReadObj();
    }
 
    return idcur;
@@ -1025,16 +1137,10 @@ void *TDirectoryFile::GetObjectChecked(const char *namecycle, const TClass* expe
 //*-*---------------------Case of Key---------------------
 //                        ===========
    void *idcur = 0;
-   TKey *key;
-   TIter nextkey(GetListOfKeys());
-   while ((key = (TKey *) nextkey())) {
-      if (strcmp(namobj,key->GetName()) == 0) {
-         if ((cycle == 9999) || (cycle == key->GetCycle())) {
-            TDirectory::TContext ctxt(this);
-            idcur = key->ReadObjectAny(expectedClass);
-            break;
-         }
-      }
+   TKey *key = LookupKey(namobj, cycle, kTRUE);
+   if (key) {
+      TDirectory::TContext ctxt(this);
+      idcur = key->ReadObjectAny(expectedClass);
    }
 
    return idcur;
@@ -1060,17 +1166,138 @@ Int_t TDirectoryFile::GetBufferSize() const
 
 TKey *TDirectoryFile::GetKey(const char *name, Short_t cycle) const
 {
-   // TIter::TIter() already checks for null pointers
-   TIter next( ((THashList *)(GetListOfKeys()))->GetListForObject(name) );
+   return LookupKey(name, cycle, kFALSE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Keep the keys record read from the file and index its nkeys keys by
+/// name, instead of creating all the keys (see ReadKeys).
+/// Return the number of valid keys.
+
+Int_t TDirectoryFile::IndexKeys(const char *buffer, Int_t nbytes, Int_t nkeys)
+{
+   if (nkeys <= 0 || nbytes <= 0) return 0;
 
+   fKeysBufferSize = nbytes;
+   fKeysBuffer = new char[nbytes];
+   memcpy(fKeysBuffer, buffer, nbytes);
+   fKeysIndex.reserve(std::min(nkeys, nbytes / 26));
+
+   Long64_t fsize = fFile->GetSize();
+   char *cursor = fKeysBuffer;
+   TKeyEntry entry;
+   for (Int_t i = 0; i < nkeys; i++) {
+      Int_t offset = cursor - fKeysBuffer;
+      if (!R__ReadKeyEntry(cursor, fKeysBuffer + fKeysBufferSize, entry)
+          || entry.fSeekKey < 64 || entry.fSeekKey > fsize
+          || entry.fSeekPdir < 64 || entry.fSeekPdir > fsize) {
+         Error("ReadKeys","reading illegal key, exiting after %d keys",i);
+         break;
+      }
+      fKeysIndex.push_back(std::make_pair(TString::Hash(entry.fName, entry.fNameLen), offset));
+   }
+   // Within a hash value, the keys stay in the order of the record, i.e.
+   // the highest cycle first.
+   std::sort(fKeysIndex.begin(), fKeysIndex.end());
+   return fKeysIndex.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Create the keys not looked up yet and put all the keys in the list, in
+/// the order of the record, as ReadKeys does without the option "lazykeys".
+
+void TDirectoryFile::LoadLazyKeys() const
+{
+   if (!fKeysBuffer) return;
+
+   // The keys already created by GetKey or Get are identified by their
+   // location in the file.
+   std::map<Long64_t, TKey*> created;
+   TIter next(fKeys);
    TKey *key;
-   while (( key = (TKey *)next() )) {
-      if (!strcmp(name, key->GetName())) {
-         if ((cycle == 9999) || (cycle >= key->GetCycle()))
-            return key;
+   while ((key = (TKey*)next())) {
+      created[key->GetSeekKey()] = key;
+   }
+   fKeys->Clear("nodelete");
+
+   Int_t nkeys = fKeysIndex.size();
+   ((THashList*)fKeys)->Rehash(nkeys);
+   char *buffer = fKeysBuffer;
+   TKeyEntry entry;
+   for (Int_t i = 0; i < nkeys; i++) {
+      char *start = buffer;
+      if (!R__ReadKeyEntry(buffer, fKeysBuffer + fKeysBufferSize, entry)) break;
+      key = 0;
+      if (!created.empty()) {
+         std::map<Long64_t, TKey*>::iterator iter = created.find(entry.fSeekKey);
+         if (iter != created.end()) {
+            key = iter->second;
+            created.erase(iter);
+         }
+      }
+      if (!key) {
+         key = new TKey(const_cast<TDirectoryFile*>(this));
+         key->ReadKeyBuffer(start);
       }
+      fKeys->Add(key);
    }
+   for (std::map<Long64_t, TKey*>::iterator iter = created.begin(); iter != created.end(); ++iter) {
+      fKeys->Add(iter->second);
+   }
+
+   delete [] fKeysBuffer;
+   fKeysBuffer = 0;
+   fKeysBufferSize = 0;
+   std::vector<std::pair<UInt_t,Int_t> >().swap(fKeysIndex);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return the key with the given name and cycle, see GetKey. If exact is
+/// true, the key must have this cycle (unless cycle is 9999).
+///
+/// With the option "lazykeys", the key is found through the index of the
+/// keys record and only this key is created.
+
+TKey *TDirectoryFile::LookupKey(const char *name, Short_t cycle, Bool_t exact) const
+{
+   if (!fKeysBuffer) {
+      // TIter::TIter() already checks for null pointers
+      TIter next( ((THashList *)(fKeys))->GetListForObject(name) );
+
+      TKey *key;
+      while (( key = (TKey *)next() )) {
+         if (!strcmp(name, key->GetName())) {
+            if ((cycle == 9999) || (exact ? cycle == key->GetCycle() : cycle >= key->GetCycle()))
+               return key;
+         }
+      }
+      return 0;
+   }
+
+   Int_t len = strlen(name);
+   UInt_t hash = TString::Hash(name, len);
+   std::vector<std::pair<UInt_t,Int_t> >::const_iterator iter;
+   iter = std::lower_bound(fKeysIndex.begin(), fKeysIndex.end(), std::make_pair(hash, 0));
+   for (; iter != fKeysIndex.end() && iter->first == hash; ++iter) {
+      char *buffer = fKeysBuffer + iter->second;
+      TKeyEntry entry;
+      if (!R__ReadKeyEntry(buffer, fKeysBuffer + fKeysBufferSize, entry)) break;
+      if (entry.fNameLen != len || strncmp(name, entry.fName, len)) continue;
+      if ((cycle != 9999) && (exact ? cycle != entry.fCycle : cycle < entry.fCycle)) continue;
 
+      // The key may have been created by a previous lookup.
+      TIter next( ((THashList *)(fKeys))->GetListForObject(name) );
+      TKey *key;
+      while (( key = (TKey *)next() )) {
+         if (key->GetSeekKey() == entry.fSeekKey && !strcmp(name, key->GetName()))
+            return key;
+      }
+      key = new TKey(const_cast<TDirectoryFile*>(this));
+      buffer = fKeysBuffer + iter->second;
+      key->ReadKeyBuffer(buffer);
+      fKeys->Add(key);
+      return key;
+   }
    return 0;
 }
 
@@ -1278,6 +1505,12 @@ void TDirectoryFile::ReadAll(Option_t* opt)
 /// This is an efficient way (without opening/closing files) to view
 /// the latest updates of a file being modified by another process
 /// as it is typically the case in a data acquisition system.
+///
+/// If the file was opened for reading with the option "lazykeys=1" (see
+/// TFile::TFile), the record is only indexed by key name: GetKey and Get
+/// create the key they return, and the other keys are created when the
+/// whole list is needed (GetListOfKeys). Opening a directory holding a
+/// very large number of keys to read a few objects is then much faster.
 
 Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
 {
@@ -1290,7 +1523,7 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
 
    char *buffer;
    if (forceRead) {
-      fKeys->Delete();
+      DeleteKeys("");
       //In case directory was updated by another process, read new
       //position for the keys
       Int_t nbytes = fNbytesName + TDirectoryFile::Sizeof();
@@ -1332,6 +1565,16 @@ Int_t TDirectoryFile::ReadKeys(Bool_t forceRead)
 
       TKey *key;
       frombuf(buffer, &nkeys);
+      if (fFile->HasLazyKeys() && !fFile->IsWritable()) {
+         // Only index the keys, they are created when looked up.
+         nkeys = IndexKeys(buffer, headerkey->GetBuffer() + fNbytesKeys - buffer, nkeys);
+         delete headerkey;
+         return nkeys;
+      }
+      if (nkeys > 0) {
+         // Size the hash table once instead of growing it key after key.
+         ((THashList*)fKeys)->Rehash(nkeys);
+      }
       for (Int_t i = 0; i < nkeys; i++) {
          key = new TKey(this);
          key->ReadKeyBuffer(buffer);
@@ -1410,7 +1653,7 @@ void TDirectoryFile::ResetAfterMerge(TFileMergeInfo *info)
    // NOTE: We should check that the content is really mergeable and in
    // the in-mmeory list, before deleting the keys.
    if (fKeys) {
-      fKeys->Delete("slow");
+      DeleteKeys();
    }
 
    Init(cl);
@@ -1568,6 +1811,9 @@ void TDirectoryFile::SetWritable(Bool_t writable)
 {
    TDirectory::TContext ctxt(this);
 
+   // The keys list is about to be modified.
+   if (writable && fKeysBuffer) LoadLazyKeys();
+
    fWritable = writable;
 
    // recursively set all sub-directories
@@ -26,7 +26,9 @@ the class TEmulatedMapProxy.
 #include "TEmulatedCollectionProxy.h"
 #include "TStreamerElement.h"
 #include "TStreamerInfo.h"
+#include "TBufferFile.h"
 #include "TClassEdit.h"
+#include "TFile.h"
 #include "TError.h"
 #include "TROOT.h"
 #include "Riostream.h"
@@ -43,14 +45,15 @@ static TStreamerElement* R__CreateEmulatedElement(const char *dmName, const char
 static TStreamerInfo *R__GenerateTClassForPair(const std::string &f, const std::string &s);
 
 TEmulatedCollectionProxy::TEmulatedCollectionProxy(const TEmulatedCollectionProxy& copy)
-   : TGenCollectionProxy(copy)
+   : TGenCollectionProxy(copy), fPlainKey(copy.fPlainKey), fPlainVal(copy.fPlainVal)
 {
    // Build a Streamer for an emulated vector whose type is 'name'.
    fProperties |= kIsEmulated;
 }
 
 TEmulatedCollectionProxy::TEmulatedCollectionProxy(const char* cl_name, Bool_t silent)
-   : TGenCollectionProxy(typeid(std::vector<char>), sizeof(std::vector<char>::iterator))
+   : TGenCollectionProxy(typeid(std::vector<char>), sizeof(std::vector<char>::iterator)),
+     fPlainKey(-1), fPlainVal(-1)
 {
    // Build a Streamer for a collection whose type is described by 'collectionClass'.
 
@@ -237,6 +240,7 @@ void TEmulatedCollectionProxy::Shrink(UInt_t nCurr, UInt_t left, Bool_t force )
             case kIsEnum:
                break;
             case kIsClass:
+               if (HasPlainObjects(fKey, fPlainKey)) break;  // See Expand
                for( i= fKey->fType ? left : nCurr; i<nCurr; ++i, addr += fValDiff ) {
                   // Call emulation in case non-compiled content
                   fKey->fType->Destructor(addr, kTRUE);
@@ -284,6 +288,7 @@ void TEmulatedCollectionProxy::Shrink(UInt_t nCurr, UInt_t left, Bool_t force )
             case kIsEnum:
                break;
             case kIsClass:
+               if (HasPlainObjects(fVal, fPlainVal)) break;  // See Expand
                for( i=left; i<nCurr; ++i, addr += fValDiff )  {
                   // Call emulation in case non-compiled content
                   fVal->fType->Destructor(addr,kTRUE);
@@ -342,6 +347,12 @@ void TEmulatedCollectionProxy::Expand(UInt_t nCurr, UInt_t left)
             case kIsEnum:
                break;
             case kIsClass:
+               if (HasPlainObjects(fKey, fPlainKey)) {
+                  // The new objects are already zeroed by the resize, which
+                  // is all their emulated constructor does, and they are not
+                  // registered, so they need no 'Move' either.
+                  break;
+               }
                if (oldstart && oldstart != fEnv->fStart) {
                   Long_t offset = 0;
                   for( i=0; i<=nCurr; ++i, offset += fValDiff ) {
@@ -375,6 +386,10 @@ void TEmulatedCollectionProxy::Expand(UInt_t nCurr, UInt_t left)
             case kIsEnum:
                break;
             case kIsClass:
+               if (HasPlainObjects(fVal, fPlainVal)) {
+                  // See the key case above.
+                  break;
+               }
                if (oldstart && oldstart != fEnv->fStart) {
                   Long_t offset = 0;
                   for( i=0; i<=nCurr; ++i, offset += fValDiff ) {
@@ -495,6 +510,10 @@ void TEmulatedCollectionProxy::ReadItems(int nElements, TBuffer &b)
 #define DOLOOP(x) {int idx=0; while(idx<nElements) {StreamHelper* i=(StreamHelper*)(((char*)itm) + fValDiff*idx); { x ;} ++idx;} break;}
 
       case kIsClass:
+         if (HasPlainObjects(fVal, fPlainVal)) {
+            ReadPlainObjects(fVal->fType, (char*)itm, nElements, b);
+            break;
+         }
          DOLOOP( b.StreamObject(i,fVal->fType) );
       case kBIT_ISSTRING:
          DOLOOP( i->read_std_string(b) );
@@ -543,6 +562,10 @@ void TEmulatedCollectionProxy::WriteItems(int nElements, TBuffer &b)
          break;
 #define DOLOOP(x) {int idx=0; while(idx<nElements) {StreamHelper* i=(StreamHelper*)(((char*)itm) + fValDiff*idx); { x ;} ++idx;} break;}
       case kIsClass:
+         if (HasPlainObjects(fVal, fPlainVal)) {
+            WritePlainObjects(fVal->fType, (char*)itm, nElements, b);
+            break;
+         }
          DOLOOP( b.StreamObject(i,fVal->fType) );
       case kBIT_ISSTRING:
          DOLOOP( TString(i->c_str()).Streamer(b) );
@@ -556,6 +579,104 @@ void TEmulatedCollectionProxy::WriteItems(int nElements, TBuffer &b)
 #undef DOLOOP
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Return true if the objects described by 'v' are emulated objects whose
+/// data members are all fundamental types (or arrays of them). The emulated
+/// constructor of such objects only zeroes them and their destructor has
+/// nothing to release, so the container can be resized in bulk.
+/// The answer is computed once and kept in 'plain', so that the objects
+/// are always created and destroyed the same way.
+
+Bool_t TEmulatedCollectionProxy::HasPlainObjects(const Value *v, Int_t &plain)
+{
+   if (plain >= 0) return plain;
+   plain = 0;
+   TClass *cl = v->fType;
+   if (!cl || cl->HasInterpreterInfo() || cl->GetCollectionProxy() || cl->GetStreamer()) {
+      return kFALSE;
+   }
+   TStreamerInfo *info = (TStreamerInfo*)cl->GetStreamerInfo();
+   if (!info) {
+      return kFALSE;
+   }
+   TIter next(info->GetElements());
+   while (TStreamerElement *element = (TStreamerElement*)next()) {
+      Int_t type = element->GetType();
+      if (type > TStreamerInfo::kOffsetL && type < TStreamerInfo::kOffsetP) {
+         type -= TStreamerInfo::kOffsetL;
+      }
+      if (type <= TStreamerInfo::kBase || type >= TStreamerInfo::kOffsetL || type == TStreamerInfo::kCharStar) {
+         return kFALSE;
+      }
+   }
+   plain = 1;
+   return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read 'nElements' objects of the class 'cl', which has only fundamental
+/// data members, starting at 'addr'. Each object still comes with its own
+/// version and byte count but the StreamerInfo is looked up once (under
+/// the interpreter lock) for all the objects written with the same class
+/// version, and its actions are applied directly.
+
+void TEmulatedCollectionProxy::ReadPlainObjects(TClass *cl, char *addr, UInt_t nElements, TBuffer &b)
+{
+   TFile *file = (TFile*)b.GetParent();
+   if (b.IsA() != TBufferFile::Class() || (file && file->GetVersion() < 30000)) {
+      for (UInt_t idx = 0; idx < nElements; ++idx, addr += fValDiff) {
+         b.StreamObject(addr, cl);
+      }
+      return;
+   }
+   TStreamerInfo *info = 0;
+   for (UInt_t idx = 0; idx < nElements; ++idx, addr += fValDiff) {
+      UInt_t start = 0, count = 0;
+      Version_t version = b.ReadVersion(&start, &count, cl);
+      if (!info || info->GetClassVersion() != version) {
+         info = 0;
+         {
+            R__LOCKGUARD(gInterpreterMutex);
+            const TObjArray *infos = cl->GetStreamerInfos();
+            if (version > 0 && version < infos->GetSize())
+               info = (TStreamerInfo*)infos->At(version);
+         }
+         if (!info || !info->IsCompiled() || info->IsRecovered()) {
+            // Let the buffer find, or build, the StreamerInfo of this version;
+            // the next object picks it up from the list.
+            b.ReadClassBuffer(cl, addr, version, start, count);
+            info = 0;
+            continue;
+         }
+      }
+      b.ApplySequence(*info->GetReadObjectWiseActions(), addr);
+      b.CheckByteCount(start, count, cl);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write 'nElements' objects of the class 'cl', which has only fundamental
+/// data members, starting at 'addr', with the same layout as
+/// TBufferFile::WriteClassBuffer but looking up and tagging the StreamerInfo
+/// only once.
+
+void TEmulatedCollectionProxy::WritePlainObjects(TClass *cl, char *addr, UInt_t nElements, TBuffer &b)
+{
+   TStreamerInfo *info = (TStreamerInfo*)cl->GetCurrentStreamerInfo();
+   if (b.IsA() != TBufferFile::Class() || !info || !info->IsCompiled()) {
+      for (UInt_t idx = 0; idx < nElements; ++idx, addr += fValDiff) {
+         b.StreamObject(addr, cl);
+      }
+      return;
+   }
+   b.TagStreamerInfo(info);
+   for (UInt_t idx = 0; idx < nElements; ++idx, addr += fValDiff) {
+      UInt_t pos = b.WriteVersion(cl, kTRUE);
+      b.ApplySequence(*info->GetWriteObjectWiseActions(), addr);
+      b.SetByteCount(pos, kTRUE);
+   }
+}
+
 void TEmulatedCollectionProxy::ReadBuffer(TBuffer &b, void *obj, const TClass *onfileClass)
 {
    // Read portion of the streamer.
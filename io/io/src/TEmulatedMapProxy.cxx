@@ -134,6 +134,10 @@ void TEmulatedMapProxy::ReadMap(UInt_t nElements, TBuffer &b)
             }
             break;
          case kIsClass:
+            if (HasPlainObjects(v, loop ? fPlainVal : fPlainKey)) {
+               ReadPlainObjects(v->fType, addr, 1, b);
+               break;
+            }
             b.StreamObject(helper,v->fType);
             break;
          case kBIT_ISSTRING:
@@ -194,6 +198,10 @@ void TEmulatedMapProxy::WriteMap(UInt_t nElements, TBuffer &b)
             }
             break;
          case kIsClass:
+            if (HasPlainObjects(v, loop ? fPlainVal : fPlainKey)) {
+               WritePlainObjects(v->fType, addr, 1, b);
+               break;
+            }
             b.StreamObject(i,v->fType);
             break;
          case kBIT_ISSTRING:
@@ -84,6 +84,7 @@ The structure of a directory is shown in TDirectoryFile::TDirectoryFile
 #include <sys/stat.h>
 #ifndef WIN32
 #   include <unistd.h>
+#   include <sys/mman.h>
 #else
 #   define ssize_t int
 #   include <io.h>
@@ -107,6 +108,7 @@ The structure of a directory is shown in TDirectoryFile::TDirectoryFile
 #include "TFree.h"
 #include "TInterpreter.h"
 #include "TKey.h"
+#include "TMD5.h"
 #include "TMakeProject.h"
 #include "TPluginManager.h"
 #include "TProcessUUID.h"
@@ -127,7 +129,14 @@ The structure of a directory is shown in TDirectoryFile::TDirectoryFile
 #include "TStopwatch.h"
 #include "compiledata.h"
 #include <cmath>
+#include <map>
 #include <set>
+#include <string>
+#include <vector>
+#if defined(R__LINUX) || defined(R__MACOSX)
+#define R__HAS_POSIX_AIO
+#include <aio.h>
+#endif
 #include "TSchemaRule.h"
 #include "TSchemaRuleSet.h"
 #include "TThreadSlots.h"
@@ -140,6 +149,7 @@ std::atomic<Long64_t> TFile::fgBytesWrite{0};
 std::atomic<Long64_t> TFile::fgFileCounter{0};
 std::atomic<Int_t>    TFile::fgReadCalls{0};
 Int_t    TFile::fgReadaheadSize = 256000;
+Int_t    TFile::fgAsyncIODepth = -1; // -1: take it from the TFile.AsyncIODepth resource
 Bool_t   TFile::fgReadInfo = kTRUE;
 TList   *TFile::fgAsyncOpenRequests = 0;
 TString  TFile::fgCacheFileDir;
@@ -152,6 +162,41 @@ const Int_t kBEGIN = 100;
 
 ClassImp(TFile)
 
+////////////////////////////////////////////////////////////////////////////////
+/// Return true if the file should be memory mapped when opened for reading:
+/// URL option "mmap=1", or "TFile.MMap: 1" in the environment unless the
+/// URL says "mmap=0".
+
+static Bool_t R__MapRequested(const TUrl &url)
+{
+   Int_t map = url.GetIntValueFromOptions("mmap");
+   if (map < 0) map = gEnv->GetValue("TFile.MMap", 0);
+   return map == 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return true if the keys of a file opened for reading should be created
+/// on demand: URL option "lazykeys=1", or "TFile.LazyKeys: 1" in the
+/// environment unless the URL says "lazykeys=0".
+
+static Bool_t R__LazyKeysRequested(const TUrl &url)
+{
+   Int_t lazy = url.GetIntValueFromOptions("lazykeys");
+   if (lazy < 0) lazy = gEnv->GetValue("TFile.LazyKeys", 0);
+   return lazy == 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Process-wide cache of the StreamerInfo records already read (see
+/// TFile::ReadStreamerInfo): digest of the record -> numbers of the
+/// TStreamerInfo it was resolved to. Protected by gROOTMutex.
+
+static std::map<std::string, std::vector<Int_t> > &R__GetStreamerInfoRecords()
+{
+   static std::map<std::string, std::vector<Int_t> > records;
+   return records;
+}
+
 //*-*x17 macros/layout_file
 // Needed to add the "fake" global gFile to the list of globals.
 namespace {
@@ -183,6 +228,8 @@ TFile::TFile() : TDirectoryFile(), fInfoCache(0)
    fCacheRead       = 0;
    fCacheReadMap    = new TMap();
    fCacheWrite      = 0;
+   fMapBuffer       = 0;
+   fMapSize         = 0;
    fArchiveOffset   = 0;
    fReadCalls       = 0;
    fInfoCache       = 0;
@@ -191,6 +238,7 @@ TFile::TFile() : TDirectoryFile(), fInfoCache(0)
    fIsRootFile      = kTRUE;
    fIsArchive       = kFALSE;
    fInitDone        = kFALSE;
+   fLazyKeys        = kFALSE;
    fMustFlush       = kTRUE;
    fIsPcmFile       = kFALSE;
    fAsyncHandle     = 0;
@@ -259,6 +307,24 @@ TFile::TFile() : TDirectoryFile(), fInfoCache(0)
 ///
 /// This is convenient because the many remote file access plugins allow
 /// easy access to/from the many different mass storage systems.
+/// A local file opened for reading can be memory mapped with:
+///
+///     file.root?mmap=1
+///
+/// (or for all local files with "TFile.MMap: 1" in the system.rootrc
+/// file). The reads are then served from the mapping instead of the
+/// read system call, and the TTree baskets are used or unzipped in place
+/// (see GetMappedBuffer). This pays off for random access to files on
+/// fast local disks; no automatic TTreeCache is created for such files.
+/// The keys of the directories of a file opened for reading can be
+/// created on demand with:
+///
+///     file.root?lazykeys=1
+///
+/// (or "TFile.LazyKeys: 1" in the system.rootrc file). Opening the file
+/// then only indexes the keys records; Get or GetKey create only the key
+/// they look up. This pays off for directories with very many keys of
+/// which only a few are read.
 /// The title of the file (ftitle) will be shown by the ROOT browsers.
 /// A ROOT file (like a Unix file system) may contain objects and
 /// directories. There are no restrictions for the number of levels
@@ -294,6 +360,12 @@ TFile::TFile() : TDirectoryFile(), fInfoCache(0)
 /// will build an integer which will set the compression to use
 /// the LZMA algorithm and compression level 1.  These are defined
 /// in the header file <em>Compression.h</em>.
+/// ROOT::kLZ4 selects the bundled LZ4 algorithm: it compresses less
+/// than ZLIB but decompresses several times faster, which pays off
+/// for files that are read many times.
+/// ROOT::kZSTD selects Zstandard when ROOT is built with libzstd (and
+/// falls back to ZLIB otherwise); see TTree::SetCompressionDictionary
+/// to compress small baskets against a trained dictionary.
 /// Note that the compression settings may be changed at any time.
 /// The new compression settings will only apply to branches created
 /// or attached after the setting is changed and other objects written
@@ -349,6 +421,7 @@ TFile::TFile(const char *fname1, Option_t *option, const char *ftitle, Int_t com
 
    // Init initialization control flag
    fInitDone   = kFALSE;
+   fLazyKeys   = kFALSE;
    fMustFlush  = kTRUE;
 
    // We are opening synchronously
@@ -378,6 +451,8 @@ TFile::TFile(const char *fname1, Option_t *option, const char *ftitle, Int_t com
    fCacheRead    = 0;
    fCacheReadMap = new TMap();
    fCacheWrite   = 0;
+   fMapBuffer    = 0;
+   fMapSize      = 0;
    fReadCalls    = 0;
    SetBit(kBinaryFile, kTRUE);
 
@@ -511,6 +586,8 @@ TFile::TFile(const char *fname1, Option_t *option, const char *ftitle, Int_t com
          goto zombie;
       }
       fWritable = kFALSE;
+      if (R__MapRequested(fUrl))
+         MapFile();
    }
 
    Init(create);
@@ -789,6 +866,7 @@ void TFile::Init(Bool_t create)
       Bool_t tryrecover = (gEnv->GetValue("TFile.Recover", 1) == 1) ? kTRUE : kFALSE;
 
       //*-* -------------Read keys of the top directory
+      fLazyKeys = !IsWritable() && R__LazyKeysRequested(fUrl);
       if (fSeekKeys > fBEGIN && fEND <= size) {
          //normal case. Recover only if file has no keys
          TDirectoryFile::ReadKeys(kFALSE);
@@ -861,14 +939,8 @@ void TFile::Init(Bool_t create)
    }
 
    // Count number of TProcessIDs in this file
-   {
-      TIter next(fKeys);
-      TKey *key;
-      while ((key = (TKey*)next())) {
-         if (!strcmp(key->GetClassName(),"TProcessID")) fNProcessIDs++;
-      }
-      fProcessIDs = new TObjArray(fNProcessIDs+1);
-   }
+   fNProcessIDs += CountKeys("TProcessID");
+   fProcessIDs = new TObjArray(fNProcessIDs+1);
    return;
 
 zombie:
@@ -904,6 +976,7 @@ void TFile::Close(Option_t *option)
 
    if (fIsArchive || !fIsRootFile) {
       FlushWriteCache();
+      UnmapFile();
       SysClose(fD);
       fD = -1;
 
@@ -959,6 +1032,7 @@ void TFile::Close(Option_t *option)
    }
 
    if (IsOpen()) {
+      UnmapFile();
       SysClose(fD);
       fD = -1;
    }
@@ -1317,6 +1391,21 @@ const TList *TFile::GetStreamerInfoCache()
 
 TList *TFile::GetStreamerInfoList()
 {
+   Bool_t known;
+   return GetStreamerInfoListImpl(0, known);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Implementation of GetStreamerInfoList.
+///
+/// If digest is not null, it is set to the digest of the StreamerInfo
+/// record (its content after the key header, and the file version). If the
+/// same record was already read by this process, known is set to true and
+/// the list is not unstreamed: 0 is returned.
+
+TList *TFile::GetStreamerInfoListImpl(TString *digest, Bool_t &known)
+{
+   known = kFALSE;
    if (fIsPcmFile) return 0; // No schema evolution for ROOT PCM files.
 
    TList *list = 0;
@@ -1333,6 +1422,33 @@ TList *TFile::GetStreamerInfoList()
          return 0;
       }
       key->ReadKeyBuffer(buf);
+      if (digest && key->GetKeylen() < fNbytesInfo) {
+         // The key header holds the date and location of the record, which
+         // differ from one file to the other even for identical content.
+         TMD5 md5;
+         md5.Update((const UChar_t*)buffer + key->GetKeylen(), fNbytesInfo - key->GetKeylen());
+         md5.Final();
+         digest->Form("%s-%d", md5.AsString(), fVersion);
+         R__LOCKGUARD2(gROOTMutex);
+         std::map<std::string, std::vector<Int_t> >::iterator record = R__GetStreamerInfoRecords().find(digest->Data());
+         if (record != R__GetStreamerInfoRecords().end()) {
+            // The TStreamerInfo must still be there (e.g. not unloaded).
+            known = kTRUE;
+            TSeqCollection *infos = gROOT->GetListOfStreamerInfo();
+            for (size_t i = 0; i < record->second.size(); ++i) {
+               if (record->second[i] >= infos->GetSize() || !infos->At(record->second[i])) {
+                  known = kFALSE;
+                  R__GetStreamerInfoRecords().erase(record);
+                  break;
+               }
+            }
+            if (known) {
+               delete [] buffer;
+               delete key;
+               return 0;
+            }
+         }
+      }
       list = dynamic_cast<TList*>(key->ReadObjWithBuffer(buffer));
       if (list) list->SetOwner();
       delete [] buffer;
@@ -1443,6 +1559,9 @@ void TFile::MakeFree(Long64_t first, Long64_t last)
 ///     20010404/150443  At:403130    N=4548      StreamerInfo   CX =  3.65
 ///     20010404/150443  At:407678    N=86        FreeSegments
 ///     20010404/150443  At:407764    N=1         END
+///
+/// The records holding the compression dictionaries of the branches (see
+/// TTree::SetCompressionDictionary) are not listed.
 
 void TFile::Map()
 {
@@ -1502,6 +1621,11 @@ void TFile::Map()
       frombuf(buffer, &nwhc);
       for (int i = 0;i < nwhc; i++) frombuf(buffer, &classname[i]);
       classname[(int)nwhc] = '\0'; //cast to avoid warning with gcc3.4
+      if (!strcmp(classname, "TBranchCompressionDict")) {
+         // Compression dictionary of a branch (see TBranch::WriteCompressionDict).
+         idcur += nbytes;
+         continue;
+      }
       if (idcur == fSeekFree) strlcpy(classname,"FreeSegments",512);
       if (idcur == fSeekInfo) strlcpy(classname,"StreamerInfo",512);
       if (idcur == fSeekKeys) strlcpy(classname,"KeysList",512);
@@ -1558,6 +1682,9 @@ Bool_t TFile::ReadBuffer(char *buf, Long64_t pos, Int_t len)
          return kFALSE;
       }
 
+      if (fMapBuffer)
+         return ReadBufferMapped(buf, fOffset, len);
+
       Seek(pos);
       ssize_t siz;
 
@@ -1603,6 +1730,9 @@ Bool_t TFile::ReadBuffer(char *buf, Int_t len)
          return kFALSE;
       }
 
+      if (fMapBuffer)
+         return ReadBufferMapped(buf, fOffset, len);
+
       ssize_t siz;
       Double_t start = 0;
 
@@ -1655,6 +1785,30 @@ Bool_t TFile::ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
       return kFALSE;
    }
 
+   if (GetAsyncIODepth() > 0 && !fMapBuffer) {
+      // Submit all the blocks at once, they are read directly in place
+      std::vector<char*> bufs(nbuf);
+      Long64_t k = 0;
+      for (Int_t i = 0; i < nbuf; i++) {
+         bufs[i] = &buf[k];
+         k += len[i];
+      }
+      Int_t st = ReadBuffersAsyncIO(bufs.data(), pos, len, nbuf);
+      if (st >= 0)
+         return st != 0;
+   }
+
+   if (fMapBuffer) {
+      // Merging the blocks in read-ahead buffers brings nothing with a mapping
+      Int_t k = 0;
+      for (Int_t i = 0; i < nbuf; i++) {
+         if (ReadBufferMapped(&buf[k], pos[i] + fArchiveOffset, len[i]))
+            return kTRUE;
+         k += len[i];
+      }
+      return kFALSE;
+   }
+
    Int_t k = 0;
    Bool_t result = kTRUE;
    TFileCacheRead *old = fCacheRead;
@@ -1705,6 +1859,256 @@ Bool_t TFile::ReadBuffers(char *buf, Long64_t *pos, Int_t *len, Int_t nbuf)
    return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Copy len bytes at the (absolute) offset from the memory mapping of the
+/// file and advance the offset, as a read would do. The bytes beyond the
+/// end of the mapping, written after the file was mapped, are read from
+/// the file.
+/// Returns kTRUE in case of failure.
+
+Bool_t TFile::ReadBufferMapped(char *buf, Long64_t offset, Int_t len)
+{
+   if (offset < 0 || len < 0) {
+      Error("ReadBuffer", "error reading %d bytes at offset %lld from file %s", len, offset, GetName());
+      return kTRUE;
+   }
+   Double_t start = 0;
+   if (gPerfStats != 0) start = TTimeStamp();
+
+   if (offset + len <= fMapSize) {
+      memcpy(buf, fMapBuffer + offset, len);
+   } else {
+      if (SysSeek(fD, offset, SEEK_SET) < 0) {
+         SysError("ReadBuffer", "cannot seek to position %lld in file %s", offset, GetName());
+         return kTRUE;
+      }
+      ssize_t siz;
+      while ((siz = SysRead(fD, buf, len)) < 0 && GetErrno() == EINTR)
+         ResetErrno();
+      if (siz < 0) {
+         SysError("ReadBuffer", "error reading from file %s", GetName());
+         return kTRUE;
+      }
+      if (siz != len) {
+         Error("ReadBuffer", "error reading all requested bytes from file %s, got %ld of %d",
+               GetName(), (Long_t)siz, len);
+         return kTRUE;
+      }
+   }
+   fOffset = offset + len;
+
+   fBytesRead  += len;
+   fgBytesRead += len;
+   fReadCalls++;
+   fgReadCalls++;
+
+   if (gMonitoringWriter)
+      gMonitoringWriter->SendFileReadProgress(this);
+   if (gPerfStats != 0) {
+      gPerfStats->FileReadEvent(this, len, start);
+   }
+   return kFALSE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return a pointer to the len bytes at position pos in the memory mapping
+/// of the file, or 0 if the file is not mapped (see option "mmap=1" of the
+/// constructor) or the range is not in the file.
+///
+/// The bytes are accounted as read. The mapping is private: writing into
+/// it does not modify the file, the pages are copied on write. The pointer
+/// is valid until the file is closed.
+
+char *TFile::GetMappedBuffer(Long64_t pos, Int_t len)
+{
+   if (!fMapBuffer) return 0;
+   Long64_t offset = pos + fArchiveOffset;
+   if (offset < 0 || len < 0 || offset + len > fMapSize) return 0;
+   fBytesRead  += len;
+   fgBytesRead += len;
+   return fMapBuffer + offset;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Map the whole file (opened for reading) in memory.
+/// Returns kTRUE if the file could be mapped; otherwise the file is read
+/// with the system read calls as usual.
+
+Bool_t TFile::MapFile()
+{
+#ifndef WIN32
+   if (fMapBuffer) return kTRUE;
+   Long_t id, flags, modtime;
+   Long64_t size;
+   if (SysStat(fD, &id, &size, &flags, &modtime) || size <= 0)
+      return kFALSE;
+   void *addr = mmap(0, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fD, 0);
+   if (addr == MAP_FAILED) {
+      Warning("MapFile", "file %s can not be memory mapped (errno: %d), using regular reads",
+              GetName(), GetErrno());
+      return kFALSE;
+   }
+   fMapBuffer = (char*)addr;
+   fMapSize   = size;
+   return kTRUE;
+#else
+   Warning("MapFile", "memory mapped files are not supported on this platform");
+   return kFALSE;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Release the memory mapping of the file, if any, and the mappings
+/// retired by ReOpen.
+
+void TFile::UnmapFile()
+{
+   RetireMapping();
+#ifndef WIN32
+   for (auto &m : fRetiredMaps)
+      munmap(m.first, (size_t)m.second);
+#endif
+   fRetiredMaps.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Stop reading from the memory mapping of the file, without releasing it:
+/// the uncompressed baskets read from it point into the mapping (see
+/// GetMappedBuffer), and remain in use until the trees are deleted. The
+/// mapping stays valid when the file descriptor is closed, and is released
+/// by UnmapFile when the file is closed.
+
+void TFile::RetireMapping()
+{
+   if (fMapBuffer)
+      fRetiredMaps.emplace_back(fMapBuffer, fMapSize);
+   fMapBuffer = 0;
+   fMapSize   = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the nbuf blocks described in the arrays pos and len into the
+/// buffers buf[i] with POSIX asynchronous I/O.
+///
+/// All the requests are queued at once (up to GetAsyncIODepth() requests
+/// in flight) and are collected in the order they complete. Used by
+/// ReadBuffers, hence by the TTreeCache fills and by TFilePrefetch, for
+/// local files when SetAsyncIODepth() (or the TFile.AsyncIODepth resource)
+/// is larger than 0.
+///
+/// Note that the glibc implementation of POSIX AIO serves the requests
+/// on one file descriptor one after the other from a single helper
+/// thread, so on Linux the reads are not issued concurrently: the device
+/// sees a queue depth of 1, as with the synchronous reads. What is gained
+/// is that the blocks are read in place, without the read-ahead copy, and
+/// that the caller can queue a whole batch at once. The positions are
+/// relative to the file (or archive member), fArchiveOffset is added here.
+///
+/// Returns 0 in case of success, 1 in case of failure and -1 if the
+/// asynchronous I/O is not available, in which case nothing was read.
+
+Int_t TFile::ReadBuffersAsyncIO(char **buf, Long64_t *pos, Int_t *len, Int_t nbuf)
+{
+#ifdef R__HAS_POSIX_AIO
+   // Only for plain local files, the I/O plugins have their own vectored reads
+   Int_t depth = GetAsyncIODepth();
+   if (depth <= 0 || fD < 0 || IsA() != TFile::Class()) return -1;
+   if (nbuf <= 0) return 0;
+
+   Double_t start = 0;
+   if (gPerfStats != 0) start = TTimeStamp();
+
+   std::vector<struct aiocb> cbs(nbuf);
+   std::vector<const struct aiocb*> inflight;
+   inflight.reserve(depth < nbuf ? depth : nbuf);
+   Long64_t nread = 0;
+   Int_t next = 0;
+   Bool_t failed = kFALSE;
+
+   while (next < nbuf || !inflight.empty()) {
+      // Queue as many requests as allowed
+      while (!failed && next < nbuf && (Int_t)inflight.size() < depth) {
+         struct aiocb &cb = cbs[next];
+         memset(&cb, 0, sizeof(struct aiocb));
+         cb.aio_fildes = fD;
+         cb.aio_offset = pos[next] + fArchiveOffset;
+         cb.aio_buf    = buf[next];
+         cb.aio_nbytes = len[next];
+         cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+         if (aio_read(&cb)) {
+            if (errno == EAGAIN && !inflight.empty())
+               break; // the system queue is full, retry once some requests completed
+            if (errno == ENOSYS && next == 0)
+               return -1;
+            SysError("ReadBuffersAsyncIO", "cannot queue the read of %d bytes at %lld in file %s",
+                     len[next], pos[next], GetName());
+            failed = kTRUE;
+            break;
+         }
+         inflight.push_back(&cb);
+         next++;
+      }
+      if (inflight.empty())
+         break;
+
+      // Wait for at least one of the requests to complete
+      if (aio_suspend(inflight.data(), inflight.size(), 0) && errno != EINTR && errno != EAGAIN) {
+         SysError("ReadBuffersAsyncIO", "error waiting for the reads of file %s", GetName());
+         failed = kTRUE;
+      }
+
+      // Collect the completed requests, in any order
+      for (size_t j = 0; j < inflight.size(); ) {
+         struct aiocb *cb = const_cast<struct aiocb*>(inflight[j]);
+         Int_t err = aio_error(cb);
+         if (err == EINPROGRESS) {
+            j++;
+            continue;
+         }
+         ssize_t siz = aio_return(cb);
+         if (err || siz <= 0) {
+            if (!failed)
+               Error("ReadBuffersAsyncIO", "error reading %ld bytes at %lld from file %s (errno: %d)",
+                     (Long_t)cb->aio_nbytes, (Long64_t)cb->aio_offset, GetName(), err);
+            failed = kTRUE;
+         } else {
+            nread += siz;
+            if ((size_t)siz < cb->aio_nbytes && !failed) {
+               // Short read, queue the remainder
+               cb->aio_buf     = (char*)cb->aio_buf + siz;
+               cb->aio_offset += siz;
+               cb->aio_nbytes -= siz;
+               if (aio_read(cb) == 0) {
+                  j++;
+                  continue;
+               }
+               SysError("ReadBuffersAsyncIO", "cannot queue the read of %ld bytes at %lld in file %s",
+                        (Long_t)cb->aio_nbytes, (Long64_t)cb->aio_offset, GetName());
+               failed = kTRUE;
+            }
+         }
+         inflight[j] = inflight.back();
+         inflight.pop_back();
+      }
+   }
+
+   fBytesRead  += nread;
+   fgBytesRead += nread;
+   fReadCalls  += nbuf;
+   fgReadCalls += nbuf;
+
+   if (gMonitoringWriter)
+      gMonitoringWriter->SendFileReadProgress(this);
+   if (gPerfStats != 0) {
+      gPerfStats->FileReadEvent(this, (Int_t)nread, start);
+   }
+   return failed ? 1 : 0;
+#else
+   (void)buf; (void)pos; (void)len; (void)nbuf;
+   return -1;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read buffer via cache.
 ///
@@ -1925,7 +2329,8 @@ Int_t TFile::Recover()
       TDatime::GetDateTime(datime, date, time);
       TClass *tclass = TClass::GetClass(classname);
       if (seekpdir == fSeekDir && tclass && !tclass->InheritsFrom(TFile::Class())
-                               && strcmp(classname,"TBasket")) {
+                               && strcmp(classname,"TBasket")
+                               && strcmp(classname,"TBranchCompressionDict")) {
          key = new TKey(this);
          key->ReadKeyBuffer(bufread);
          if (!strcmp(key->GetName(),"StreamerInfo")) {
@@ -2024,12 +2429,17 @@ Int_t TFile::ReOpen(Option_t *mode)
          return -1;
       }
       SetWritable(kFALSE);
+      if (R__MapRequested(fUrl))
+         MapFile();
 
    } else {
       // switch to UPDATE mode
 
       // close readonly file
       if (IsOpen()) {
+         // Baskets read from the mapping may still point into it, so it
+         // can only be released when the file is closed.
+         RetireMapping();
          SysClose(fD);
          fD = -1;
       }
@@ -3379,14 +3789,36 @@ Int_t TFile::MakeProjectParProofInf(const char *pack, const char *proofinf)
 /// The corresponding TClass objects are updated.
 /// Note that this function is not called if the static member fgReadInfo is false.
 /// (see TFile::SetReadStreamerInfo)
+///
+/// Files written by the same job usually hold the very same StreamerInfo
+/// record. The digest of the records read so far is kept, process-wide,
+/// with the TStreamerInfo they were resolved to: for a record already seen
+/// (for example from the previous file of a TChain), the list is neither
+/// unstreamed nor checked again, the TStreamerInfo (and their streaming
+/// actions) already in memory are used as is.
 
 void TFile::ReadStreamerInfo()
 {
-   TList *list = GetStreamerInfoList();
+   TString digest;
+   Bool_t known = kFALSE;
+   TList *list = IsBinary() ? GetStreamerInfoListImpl(&digest, known) : GetStreamerInfoList();
+   if (known) {
+      R__LOCKGUARD2(gROOTMutex);
+      const std::vector<Int_t> &uids = R__GetStreamerInfoRecords()[digest.Data()];
+      for (size_t i = 0; i < uids.size(); ++i) {
+         Int_t asize = fClassIndex->GetSize();
+         if (uids[i] >= asize) fClassIndex->Set(TMath::Max(2*asize, uids[i]+1));
+         fClassIndex->fArray[uids[i]] = 1;
+      }
+      fClassIndex->fArray[0] = 0;
+      if (gDebug > 0) Info("ReadStreamerInfo", "StreamerInfo record of %s already read", GetName());
+      return;
+   }
    if (!list) {
       MakeZombie();
       return;
    }
+   std::vector<Int_t> uids;
 
    list->SetOwner(kFALSE);
 
@@ -3472,8 +3904,10 @@ void TFile::ReadStreamerInfo()
             Int_t uid = info->GetNumber();
             Int_t asize = fClassIndex->GetSize();
             if (uid >= asize && uid <100000) fClassIndex->Set(2*asize);
-            if (uid >= 0 && uid < fClassIndex->GetSize()) fClassIndex->fArray[uid] = 1;
-            else {
+            if (uid >= 0 && uid < fClassIndex->GetSize()) {
+               fClassIndex->fArray[uid] = 1;
+               uids.push_back(uid);
+            } else {
                printf("ReadStreamerInfo, class:%s, illegal uid=%d\n",info->GetName(),uid);
             }
             if (gDebug > 0) printf(" -class: %s version: %d info read at slot %d\n",info->GetName(), info->GetClassVersion(),uid);
@@ -3484,6 +3918,11 @@ void TFile::ReadStreamerInfo()
    fClassIndex->fArray[0] = 0;
    list->Clear();  //this will delete all TStreamerInfo objects with kCanDelete bit set
    delete list;
+
+   if (!digest.IsNull()) {
+      R__LOCKGUARD2(gROOTMutex);
+      R__GetStreamerInfoRecords()[digest.Data()].swap(uids);
+   }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -4348,6 +4787,28 @@ Int_t TFile::GetReadaheadSize()
 //______________________________________________________________________________
 void TFile::SetReadaheadSize(Int_t bytes) { fgReadaheadSize = bytes; }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Static function returning the maximum number of asynchronous reads in
+/// flight used by ReadBuffers for local files (0 if disabled, the default).
+/// Unless set with SetAsyncIODepth it is taken from the resource
+/// TFile.AsyncIODepth.
+
+Int_t TFile::GetAsyncIODepth()
+{
+   if (fgAsyncIODepth < 0) {
+      Int_t depth = gEnv ? gEnv->GetValue("TFile.AsyncIODepth", 0) : 0;
+      fgAsyncIODepth = depth > 0 ? depth : 0;
+   }
+   return fgAsyncIODepth;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Set the maximum number of asynchronous reads in flight used by
+/// ReadBuffers for local files (see ReadBuffersAsyncIO); 0 disables the
+/// asynchronous reads.
+
+void TFile::SetAsyncIODepth(Int_t depth) { fgAsyncIODepth = depth > 0 ? depth : 0; }
+
 //______________________________________________________________________________
 void TFile::SetFileBytesRead(Long64_t bytes) { fgBytesRead = bytes; }
 
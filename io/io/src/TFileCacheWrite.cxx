@@ -23,12 +23,25 @@ TXNetFile and TWebFile (via TFile::WriteBuffers()).
                                                                    
 The write cache is automatically created when writing a remote file
 (created in TFile::Open()).                                        
+
+For a local file the cache can be created explicitly and put in
+write-behind mode with SetWriteBehind(): the cache then has two
+buffers, and when the buffer being filled is full it is handed over
+to a background thread which writes it (with pwrite) while the
+filling thread continues with the other buffer. Flush() (hence
+TFile::Flush, TFile::Write and TFile::Close) still returns only once
+all the data has been written to the file.
 */
 
 
 #include "TFile.h"
 #include "TFileCacheWrite.h"
 
+#include <errno.h>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
 ClassImp(TFileCacheWrite)
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -42,6 +55,14 @@ TFileCacheWrite::TFileCacheWrite() : TObject()
    fFile        = 0;
    fBuffer      = 0;
    fRecursive   = kFALSE;
+   fWriteBehind = kFALSE;
+   fWriteError  = kFALSE;
+   fStopWriter  = kFALSE;
+   fWriteBuffer = 0;
+   fWriteSeek   = 0;
+   fWriteNtot   = 0;
+   fWriteFd     = -1;
+   fWriter      = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -60,6 +81,14 @@ TFileCacheWrite::TFileCacheWrite(TFile *file, Int_t buffersize)
    fFile        = file;
    fRecursive   = kFALSE;
    fBuffer      = new char[fBufferSize];
+   fWriteBehind = kFALSE;
+   fWriteError  = kFALSE;
+   fStopWriter  = kFALSE;
+   fWriteBuffer = 0;
+   fWriteSeek   = 0;
+   fWriteNtot   = 0;
+   fWriteFd     = -1;
+   fWriter      = 0;
    if (file) file->SetCacheWrite(this);
    if (gDebug > 0) Info("TFileCacheWrite","Creating a write cache with buffersize=%d bytes",buffersize);
 }
@@ -69,7 +98,17 @@ TFileCacheWrite::TFileCacheWrite(TFile *file, Int_t buffersize)
 
 TFileCacheWrite::~TFileCacheWrite()
 {
+   if (fWriter) {
+      {
+         std::lock_guard<std::mutex> lk(fWriteMutex);
+         fStopWriter = kTRUE;
+      }
+      fWriteCond.notify_all();
+      fWriter->join();
+      delete fWriter;
+   }
    delete [] fBuffer;
+   delete [] fWriteBuffer;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -78,6 +117,12 @@ TFileCacheWrite::~TFileCacheWrite()
 
 Bool_t TFileCacheWrite::Flush()
 {
+   if (fWriteBehind) {
+      // Hand over the current buffer and wait until all is on the file.
+      Bool_t status = FlushAsync();
+      if (WaitWriteBehind()) status = kTRUE;
+      return status;
+   }
    if (!fNtot) return kFALSE;
    fFile->Seek(fSeekStart);
    //printf("Flushing buffer at fSeekStart=%lld, fNtot=%d\n",fSeekStart,fNtot);
@@ -107,6 +152,18 @@ void TFileCacheWrite::Print(Option_t *option) const
 
 Int_t TFileCacheWrite::ReadBuffer(char *buf, Long64_t pos, Int_t len)
 {
+   if (fWriteBehind) {
+      std::unique_lock<std::mutex> lk(fWriteMutex);
+      if (fWriteNtot && pos < fWriteSeek+fWriteNtot && pos+len > fWriteSeek) {
+         if (pos >= fWriteSeek && pos+len <= fWriteSeek+fWriteNtot) {
+            // The buffer is not modified while it is being written
+            memcpy(buf,fWriteBuffer+pos-fWriteSeek,len);
+            return 0;
+         }
+         // Partly written: the data will be in the file once the write is done
+         fWriteCond.wait(lk, [this]{ return fWriteNtot == 0; });
+      }
+   }
    if (pos < fSeekStart || pos+len > fSeekStart+fNtot) return -1;
    memcpy(buf,fBuffer+pos-fSeekStart,len);
    return 0;
@@ -126,10 +183,12 @@ Int_t TFileCacheWrite::WriteBuffer(const char *buf, Long64_t pos, Int_t len)
 
    if (fSeekStart + fNtot != pos) {
       //we must flush the current cache
-      if (Flush()) return -1; //failure
+      if (fWriteBehind ? FlushAsync() : Flush()) return -1; //failure
    }
    if (fNtot + len >= fBufferSize) {
-      if (Flush()) return -1; //failure
+      if (fWriteBehind && len < fBufferSize) {
+         if (FlushAsync()) return -1; //failure
+      } else if (Flush()) return -1; //failure
       if (len >= fBufferSize) {
          //buffer larger than the cache itself: direct write to file
          fRecursive = kTRUE;
@@ -151,5 +210,130 @@ Int_t TFileCacheWrite::WriteBuffer(const char *buf, Long64_t pos, Int_t len)
 
 void TFileCacheWrite::SetFile(TFile *file)
 {
+   if (fWriteBehind) {
+      WaitWriteBehind();
+      if (file && file->GetFd() < 0) {
+         Warning("SetFile", "write-behind is only supported for local files, disabling it");
+         fWriteBehind = kFALSE;
+      }
+   }
    fFile = file;
 }
+
+////////////////////////////////////////////////////////////////////////////////
+/// Enable (or disable) the write-behind mode.
+///
+/// In write-behind mode a full buffer is written to the file by a
+/// background thread while the next writes go to a second buffer, so
+/// that the writing thread (typically TTree::Fill) does not wait for
+/// the disk. Only available for local files (TFile itself, not the
+/// remote access plugins) on systems providing pwrite.
+
+void TFileCacheWrite::SetWriteBehind(Bool_t on)
+{
+   if (on == fWriteBehind) return;
+   if (!on) {
+      Flush();
+      fWriteBehind = kFALSE;
+      return;
+   }
+#ifndef WIN32
+   if (!fFile || fFile->IsA() != TFile::Class() || fFile->GetFd() < 0) {
+      Warning("SetWriteBehind", "write-behind is only supported for local files");
+      return;
+   }
+   if (!fWriteBuffer) fWriteBuffer = new char[fBufferSize];
+   fWriteBehind = kTRUE;
+#else
+   Warning("SetWriteBehind", "write-behind is not supported on this platform");
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Hand the current buffer over to the background thread, after waiting
+/// for the previous one to be written. Returns kTRUE in case of error
+/// (of this or of a previous background write).
+
+Bool_t TFileCacheWrite::FlushAsync()
+{
+   Bool_t status = WaitWriteBehind();
+   if (!fNtot) return status;
+
+   if (!fWriter) fWriter = new std::thread(&TFileCacheWrite::WriteBehindLoop, this);
+   {
+      std::lock_guard<std::mutex> lk(fWriteMutex);
+      char *buffer = fWriteBuffer;
+      fWriteBuffer = fBuffer;
+      fBuffer      = buffer;
+      fWriteSeek   = fSeekStart;
+      fWriteNtot   = fNtot;
+      fWriteFd     = fFile->GetFd();
+   }
+   fWriteCond.notify_all();
+
+   // The bytes are accounted for when they leave the cache, as with Flush.
+   fFile->fBytesWrite   += fNtot;
+   TFile::fgBytesWrite  += fNtot;
+   fNtot = 0;
+   return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Wait for the background thread to finish writing its buffer.
+/// Returns kTRUE if a background write failed since the last call.
+
+Bool_t TFileCacheWrite::WaitWriteBehind()
+{
+   std::unique_lock<std::mutex> lk(fWriteMutex);
+   fWriteCond.wait(lk, [this]{ return fWriteNtot == 0; });
+   Bool_t status = fWriteError;
+   fWriteError = kFALSE;
+   if (status && fFile) {
+      fFile->SetBit(TFile::kWriteError);
+      Error("Flush", "error writing to file %s", fFile->GetName());
+   }
+   return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Execution loop of the background thread: write each buffer handed
+/// over by FlushAsync at its position in the file.
+
+void TFileCacheWrite::WriteBehindLoop()
+{
+   std::unique_lock<std::mutex> lk(fWriteMutex);
+   while (1) {
+      fWriteCond.wait(lk, [this]{ return fWriteNtot > 0 || fStopWriter; });
+      if (!fWriteNtot) return; // asked to stop and nothing left to write
+
+      // The filling thread does not touch these while fWriteNtot > 0
+      const char *buf = fWriteBuffer;
+      Long64_t off = fWriteSeek + fFile->GetArchiveOffset();
+      Long64_t len = fWriteNtot;
+      Int_t fd = fWriteFd;
+      lk.unlock();
+
+      Bool_t error = kFALSE;
+#ifndef WIN32
+      while (len > 0) {
+         ssize_t siz = pwrite(fd, buf, len, off);
+         if (siz < 0 && errno == EINTR) continue;
+         if (siz <= 0) {
+            error = kTRUE;
+            break;
+         }
+         buf += siz;
+         off += siz;
+         len -= siz;
+      }
+#else
+      (void)fd; (void)off;
+      error = kTRUE;
+#endif
+
+      lk.lock();
+      if (error) fWriteError = kTRUE;
+      fWriteNtot = 0;
+      fWriteCond.notify_all();
+   }
+}
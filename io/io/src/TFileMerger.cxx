@@ -171,7 +171,7 @@ Bool_t TFileMerger::AddFile(const char *url, Bool_t cpProgress)
          Error("AddFile", "cannot open file %s", url);
       return kFALSE;
    } else {
-      if (fOutputFile && fOutputFile->GetCompressionLevel() != newfile->GetCompressionLevel()) fCompressionChange = kTRUE;
+      if (fOutputFile && fOutputFile->GetCompressionSettings() != newfile->GetCompressionSettings()) fCompressionChange = kTRUE;
 
       newfile->SetBit(kCanDelete);
       fFileList->Add(newfile);
@@ -246,7 +246,7 @@ Bool_t TFileMerger::AddFile(TFile *source, Bool_t own, Bool_t cpProgress)
          Error("AddFile", "cannot open file %s", source->GetName());
       return kFALSE;
    } else {
-      if (fOutputFile && fOutputFile->GetCompressionLevel() != newfile->GetCompressionLevel()) fCompressionChange = kTRUE;
+      if (fOutputFile && fOutputFile->GetCompressionSettings() != newfile->GetCompressionSettings()) fCompressionChange = kTRUE;
 
       if (own || newfile != source) {
          newfile->SetBit(kCanDelete);
@@ -379,8 +379,13 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
 
    TFileMergeInfo info(target);
 
-   if (fFastMethod && ((type&kKeepCompression) || !fCompressionChange) ) {
-      info.fOptions.Append(" fast");
+   if (fFastMethod) {
+      if ((type&kKeepCompression) || !fCompressionChange) {
+         info.fOptions.Append(" fast");
+      } else {
+         // Copy the baskets, converting them to the output compression.
+         info.fOptions.Append(" fast recompress");
+      }
    }
 
    TFile      *current_file;
@@ -526,7 +531,10 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                if (nextsource == 0) {
                   // There is only one file in the list
                   ROOT::MergeFunc_t func = cl->GetMerge();
-                  func(obj, &inputs, &info);
+                  if (func(obj, &inputs, &info) < 0) {
+                     Error("MergeRecursive", "calling Merge() on '%s'", obj->GetName());
+                     status = kFALSE;
+                  }
                   info.fIsFirst = kFALSE;
                } else {
                   do {
@@ -556,6 +564,7 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                               if (result < 0) {
                                  Error("MergeRecursive", "calling Merge() on '%s' with the corresponding object in '%s'",
                                        obj->GetName(), nextsource->GetName());
+                                 status = kFALSE;
                               }
                               inputs.Delete();
                            }
@@ -566,7 +575,10 @@ Bool_t TFileMerger::MergeRecursive(TDirectory *target, TList *sourcelist, Int_t
                   // Merge the list, if still to be done
                   if (oneGo || info.fIsFirst) {
                      ROOT::MergeFunc_t func = cl->GetMerge();
-                     func(obj, &inputs, &info);
+                     if (func(obj, &inputs, &info) < 0) {
+                        Error("MergeRecursive", "calling Merge() on '%s'", obj->GetName());
+                        status = kFALSE;
+                     }
                      info.fIsFirst = kFALSE;
                      inputs.Delete();
                   }
@@ -906,7 +918,7 @@ Bool_t TFileMerger::OpenExcessFiles()
             Error("OpenExcessFiles", "cannot open file %s", url->GetName());
          return kFALSE;
       } else {
-         if (fOutputFile && fOutputFile->GetCompressionLevel() != newfile->GetCompressionLevel()) fCompressionChange = kTRUE;
+         if (fOutputFile && fOutputFile->GetCompressionSettings() != newfile->GetCompressionSettings()) fCompressionChange = kTRUE;
 
          newfile->SetBit(kCanDelete);
          fFileList->Add(newfile);
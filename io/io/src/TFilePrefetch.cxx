@@ -128,6 +128,20 @@ void TFilePrefetch::ReadListOfBlocks()
    TFPBlock*  block = 0;
 
    while((block = GetPendingBlock())){
+      if (TFile::GetAsyncIODepth() > 0) {
+         // Read the pieces of all the blocks pending at this time in one
+         // batch of asynchronous reads.
+         std::vector<TFPBlock*> blocks(1, block);
+         {
+            std::lock_guard<std::mutex> lk(fMutexPendingList);
+            while (fPendingBlocks->GetSize()) {
+               TFPBlock *next = (TFPBlock*)fPendingBlocks->First();
+               blocks.push_back((TFPBlock*)fPendingBlocks->Remove(next));
+            }
+         }
+         ReadListOfBlocksAsync(blocks);
+         continue;
+      }
       ReadAsync(block, inCache);
       AddReadBlock(block);
       if (!inCache)
@@ -135,6 +149,53 @@ void TFilePrefetch::ReadListOfBlocks()
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Read the given blocks, submitting all the pieces of the blocks not found
+/// in the local cache directory as one batch of asynchronous reads (see
+/// TFile::ReadBuffersAsyncIO); falls back to ReadAsync if the file does
+/// not support asynchronous reads.
+
+void TFilePrefetch::ReadListOfBlocksAsync(const std::vector<TFPBlock*> &blocks)
+{
+   std::vector<Bool_t> inCache(blocks.size(), kFALSE);
+   std::vector<char*> bufs;
+   std::vector<Long64_t> pos;
+   std::vector<Int_t> len;
+
+   for (size_t i = 0; i < blocks.size(); i++) {
+      TFPBlock *block = blocks[i];
+      char *path = 0;
+      if (CheckBlockInCache(path, block)) {
+         block->SetBuffer(GetBlockFromCache(path, block->GetDataSize()));
+         inCache[i] = kTRUE;
+      } else {
+         for (Int_t j = 0; j < block->GetNoElem(); j++) {
+            bufs.push_back(block->GetPtrToPiece(j));
+            pos.push_back(block->GetPos(j));
+            len.push_back(block->GetLen(j));
+         }
+      }
+      delete[] path;
+   }
+
+   Int_t st = bufs.empty() ? 0 : fFile->ReadBuffersAsyncIO(bufs.data(), pos.data(), len.data(), bufs.size());
+
+   for (size_t i = 0; i < blocks.size(); i++) {
+      TFPBlock *block = blocks[i];
+      if (!inCache[i]) {
+         // the positions are relative to the archive member, TFile adds
+         // the archive offset itself
+         if (st < 0) {
+            Bool_t cached;
+            ReadAsync(block, cached);
+         }
+      }
+      AddReadBlock(block);
+      if (!inCache[i])
+         SaveBlockInCache(block);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Search for a requested element in a block and return the index.
 
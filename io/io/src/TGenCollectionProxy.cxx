@@ -584,6 +584,7 @@ TGenCollectionProxy::TGenCollectionProxy(const TGenCollectionProxy& copy)
    fKey            = copy.fKey   ? new Value(*copy.fKey)   : 0;
    fOnFileClass    = copy.fOnFileClass;
    fReadMemberWise = new TObjArray(TCollection::kInitCapacity,-1);
+   fSharedActionsGeneration = TStreamerInfoActions::TActionSequence::GetSharedActionsGeneration();
    fConversionReadMemberWise = 0;
    fWriteMemberWise = 0;
    fProperties     = copy.fProperties;
@@ -630,6 +631,7 @@ TGenCollectionProxy::TGenCollectionProxy(Info_t info, size_t iter_size)
             (Long_t)sizeof(e.fIterator));
    }
    fReadMemberWise = new TObjArray(TCollection::kInitCapacity,-1);
+   fSharedActionsGeneration = TStreamerInfoActions::TActionSequence::GetSharedActionsGeneration();
    fConversionReadMemberWise   = 0;
    fWriteMemberWise            = 0;
    fFunctionCreateIterators    = 0;
@@ -681,6 +683,7 @@ TGenCollectionProxy::TGenCollectionProxy(const ROOT::TCollectionProxyInfo &info,
             (Long_t)sizeof(e.fIterator));
    }
    fReadMemberWise = new TObjArray(TCollection::kInitCapacity,-1);
+   fSharedActionsGeneration = TStreamerInfoActions::TActionSequence::GetSharedActionsGeneration();
    fConversionReadMemberWise   = 0;
    fWriteMemberWise            = 0;
    fFunctionCreateIterators    = info.fCreateIterators;
@@ -1656,6 +1659,27 @@ TVirtualCollectionProxy::DeleteTwoIterators_t TGenCollectionProxy::GetFunctionDe
       return fFunctionDeleteTwoIterators = TGenCollectionProxy__SlowDeleteTwoIterators;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Forget the action sequences cached by this proxy if some of the shared
+/// sequences (see TActionSequence::GetSharedReadMemberWiseActions) were
+/// released since they were cached, e.g. because the StreamerInfo they were
+/// derived from was rebuilt; they are then looked up again.
+
+void TGenCollectionProxy::CheckSharedActions() const
+{
+   UInt_t generation = TStreamerInfoActions::TActionSequence::GetSharedActionsGeneration();
+   if (generation == fSharedActionsGeneration) {
+      return;
+   }
+   fReadMemberWise->Clear();
+   if (fConversionReadMemberWise) {
+      for (auto &conv : *fConversionReadMemberWise) {
+         conv.second->Clear();
+      }
+   }
+   fSharedActionsGeneration = generation;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Return the set of action necessary to stream in this collection member-wise coming from
 /// the old value class layout refered to by 'version'.
@@ -1665,6 +1689,7 @@ TStreamerInfoActions::TActionSequence *TGenCollectionProxy::GetConversionReadMem
    if (oldClass == 0) {
       return 0;
    }
+   CheckSharedActions();
    TObjArray* arr = 0;
    TStreamerInfoActions::TActionSequence *result = 0;
    if (fConversionReadMemberWise) {
@@ -1693,7 +1718,10 @@ TStreamerInfoActions::TActionSequence *TGenCollectionProxy::GetConversionReadMem
    if (info == 0) {
       return 0;
    }
-   result = TStreamerInfoActions::TActionSequence::CreateReadMemberWiseActions(info,*this);
+   result = TStreamerInfoActions::TActionSequence::GetSharedReadMemberWiseActions(info,*this);
+   if (!result) {
+      result = TStreamerInfoActions::TActionSequence::CreateReadMemberWiseActions(info,*this);
+   }
 
    if (!arr) {
       arr = new TObjArray(version+10, -1);
@@ -1713,6 +1741,7 @@ TStreamerInfoActions::TActionSequence *TGenCollectionProxy::GetConversionReadMem
 
 TStreamerInfoActions::TActionSequence *TGenCollectionProxy::GetReadMemberWiseActions(Int_t version)
 {
+   CheckSharedActions();
    TStreamerInfoActions::TActionSequence *result = 0;
    if (version < (fReadMemberWise->GetSize()-1)) { // -1 because the 'index' starts at -1
       result = (TStreamerInfoActions::TActionSequence *)fReadMemberWise->At(version);
@@ -1724,7 +1753,11 @@ TStreamerInfoActions::TActionSequence *TGenCollectionProxy::GetReadMemberWiseAct
       if (valueClass) {
          info = valueClass->GetStreamerInfo(version);
       }
-      result = TStreamerInfoActions::TActionSequence::CreateReadMemberWiseActions(info,*this);
+      // The proxies of the same collection (one per branch) share the sequence.
+      result = TStreamerInfoActions::TActionSequence::GetSharedReadMemberWiseActions(info,*this);
+      if (!result) {
+         result = TStreamerInfoActions::TActionSequence::CreateReadMemberWiseActions(info,*this);
+      }
       fReadMemberWise->AddAtAndExpand(result,version);
    }
    return result;
@@ -208,6 +208,7 @@ TStreamerInfo::~TStreamerInfo()
    delete fWriteObjectWise;
    delete fWriteMemberWise;
    delete fWriteMemberWiseVecPtr;
+   TStreamerInfoActions::TActionSequence::DeleteSharedActions(this);
 
    if (!fElements) return;
    fElements->Delete();
@@ -2448,6 +2449,8 @@ void TStreamerInfo::Clear(Option_t *option)
    if (opt.Contains("build")) {
       R__LOCKGUARD2(gInterpreterMutex);
 
+      // The shared member-wise sequences point into the arrays deleted here.
+      TStreamerInfoActions::TActionSequence::ReleaseSharedActions(this);
       delete [] fComp;     fComp    = 0;
       delete [] fCompFull; fCompFull= 0;
       delete [] fCompOpt;  fCompOpt = 0;
@@ -24,6 +24,10 @@
 #include "TVirtualCollectionIterators.h"
 #include "TProcessID.h"
 
+#include <atomic>
+#include <map>
+#include <mutex>
+
 static const Int_t kRegrouped = TStreamerInfo::kOffsetL;
 
 // More possible optimizations:
@@ -969,6 +973,19 @@ namespace TStreamerInfoActions
       }
    }
 
+   // Number of values moved at once between the buffer and a data member of
+   // the elements of a vector (see VectorLooper::ReadBasicType).
+   const Int_t kStridedChunkSize = 256;
+
+   inline Bool_t CanStreamStrided(TBuffer &buf)
+   {
+      // Return true if a series of values has the same representation in the
+      // buffer whether it is streamed value by value or as an array, which
+      // is the case of the binary format but not of XML or SQL.
+
+      return buf.IsA() == TBufferFile::Class();
+   }
+
    struct VectorLooper {
 
       template <typename T>
@@ -977,6 +994,26 @@ namespace TStreamerInfoActions
          const Int_t incr = ((TVectorLoopConfig*)loopconfig)->fIncrement;
          iter = (char*)iter + config->fOffset;
          end = (char*)end + config->fOffset;
+         if (CanStreamStrided(buf)) {
+            // The elements are contiguous: read the values in bulk and spread
+            // them over the elements, instead of one virtual call per value.
+            char *addr = (char*)iter;
+            Int_t n = (((char*)end) - addr) / incr;
+            if (incr == (Int_t)sizeof(T)) {
+               if (n > 0) buf.ReadFastArray((T*)addr, n);
+               return 0;
+            }
+            T values[kStridedChunkSize];
+            while (n > 0) {
+               const Int_t chunk = n < kStridedChunkSize ? n : kStridedChunkSize;
+               buf.ReadFastArray(values, chunk);
+               for (Int_t i = 0; i < chunk; ++i, addr += incr) {
+                  *(T*)addr = values[i];
+               }
+               n -= chunk;
+            }
+            return 0;
+         }
          for(; iter != end; iter = (char*)iter + incr ) {
             T *x = (T*) ((char*) iter);
             buf >> *x;
@@ -1065,6 +1102,25 @@ namespace TStreamerInfoActions
          const Int_t incr = ((TVectorLoopConfig*)loopconfig)->fIncrement;
          iter = (char*)iter + config->fOffset;
          end = (char*)end + config->fOffset;
+         if (CanStreamStrided(buf)) {
+            // See ReadBasicType.
+            const char *addr = (const char*)iter;
+            Int_t n = (((const char*)end) - addr) / incr;
+            if (incr == (Int_t)sizeof(T)) {
+               if (n > 0) buf.WriteFastArray((const T*)addr, n);
+               return 0;
+            }
+            T values[kStridedChunkSize];
+            while (n > 0) {
+               const Int_t chunk = n < kStridedChunkSize ? n : kStridedChunkSize;
+               for (Int_t i = 0; i < chunk; ++i, addr += incr) {
+                  values[i] = *(const T*)addr;
+               }
+               buf.WriteFastArray(values, chunk);
+               n -= chunk;
+            }
+            return 0;
+         }
          for(; iter != end; iter = (char*)iter + incr ) {
             T *x = (T*) ((char*) iter);
             buf << *x;
@@ -1181,6 +1237,27 @@ namespace TStreamerInfoActions
          return 0;
       }
 
+      template <typename T>
+      static INLINE_TEMPLATE_ARGS Int_t WriteCollectionBasicType(TBuffer &buf, void *addr, const TConfiguration *conf)
+      {
+         // Collection of numbers, written in the same format as the
+         // TGenCollectionStreamer (see the kSTL case of WriteBufferAux) but
+         // without going through the collection proxy.
+
+         TConfigSTL *config = (TConfigSTL*)conf;
+         UInt_t start = buf.WriteVersion(config->fInfo->IsA(), kTRUE);
+
+         std::vector<T> *const vec = (std::vector<T>*)(((char*)addr)+config->fOffset);
+         Int_t nvalues = vec->size();
+         buf.WriteInt(nvalues);
+         if (nvalues > 0) {
+            buf.WriteFastArray(&(*vec->begin()), nvalues);
+         }
+
+         buf.SetByteCount(start, kTRUE);
+         return 0;
+      }
+
       static INLINE_TEMPLATE_ARGS Int_t ReadCollectionBool(TBuffer &buf, void *addr, const TConfiguration *conf)
       {
          // Collection of numbers.  Memberwise or not, it is all the same.
@@ -2007,6 +2084,33 @@ static TConfiguredAction GetNumericCollectionReadAction(Int_t type, TConfigSTL *
    return TConfiguredAction();
 }
 
+template <class Looper>
+static TConfiguredAction GetNumericCollectionWriteAction(Int_t type, TConfigSTL *conf)
+{
+   // Return the action writing a std::vector of numbers of the given type,
+   // or an empty action if there is no specialized version for the type
+   // (bool and the types with a compression factor).
+
+   switch (type) {
+      case TStreamerInfo::kChar:    return TConfiguredAction( Looper::template WriteCollectionBasicType<Char_t>, conf );    break;
+      case TStreamerInfo::kShort:   return TConfiguredAction( Looper::template WriteCollectionBasicType<Short_t>,conf );   break;
+      case TStreamerInfo::kInt:     return TConfiguredAction( Looper::template WriteCollectionBasicType<Int_t>,  conf );     break;
+      case TStreamerInfo::kLong:    return TConfiguredAction( Looper::template WriteCollectionBasicType<Long_t>, conf );    break;
+      case TStreamerInfo::kLong64:  return TConfiguredAction( Looper::template WriteCollectionBasicType<Long64_t>, conf );  break;
+      case TStreamerInfo::kFloat:   return TConfiguredAction( Looper::template WriteCollectionBasicType<Float_t>,  conf );   break;
+      case TStreamerInfo::kDouble:  return TConfiguredAction( Looper::template WriteCollectionBasicType<Double_t>, conf );  break;
+      case TStreamerInfo::kUChar:   return TConfiguredAction( Looper::template WriteCollectionBasicType<UChar_t>,  conf );   break;
+      case TStreamerInfo::kUShort:  return TConfiguredAction( Looper::template WriteCollectionBasicType<UShort_t>, conf );  break;
+      case TStreamerInfo::kUInt:    return TConfiguredAction( Looper::template WriteCollectionBasicType<UInt_t>,   conf );    break;
+      case TStreamerInfo::kULong:   return TConfiguredAction( Looper::template WriteCollectionBasicType<ULong_t>,  conf );   break;
+      case TStreamerInfo::kULong64: return TConfiguredAction( Looper::template WriteCollectionBasicType<ULong64_t>, conf ); break;
+      default:
+         break;
+   }
+   delete conf;
+   return TConfiguredAction();
+}
+
 template <typename Looper, typename From>
 static TConfiguredAction GetConvertCollectionReadActionFrom(Int_t newtype, TConfiguration *conf)
 {
@@ -2260,6 +2364,10 @@ void TStreamerInfo::Compile()
    }
    R__LOCKGUARD(gInterpreterMutex);
 
+   // The shared member-wise sequences derived from a previous compilation
+   // point into its (deleted) arrays.
+   TStreamerInfoActions::TActionSequence::ReleaseSharedActions(this);
+
    // fprintf(stderr,"Running Compile for %s %d %d req=%d,%d\n",GetName(),fClassVersion,fOptimized,CanOptimize(),TestBit(kCannotOptimize));
 
    // if (IsCompiled() && (!fOptimized || (CanOptimize() && !TestBit(kCannotOptimize)))) return;
@@ -2782,6 +2890,26 @@ void TStreamerInfo::AddWriteAction(TStreamerInfoActions::TActionSequence *writeS
       case TStreamerInfo::kUInt:    writeSequence->AddAction( WriteBasicType<UInt_t>, new TConfiguration(this,i,compinfo,compinfo->fOffset) );    break;
       case TStreamerInfo::kULong:   writeSequence->AddAction( WriteBasicType<ULong_t>, new TConfiguration(this,i,compinfo,compinfo->fOffset) );   break;
       case TStreamerInfo::kULong64: writeSequence->AddAction( WriteBasicType<ULong64_t>, new TConfiguration(this,i,compinfo,compinfo->fOffset) ); break;
+      case TStreamerInfo::kSTL: {
+         // A std::vector of numbers is written directly from its data,
+         // everything else goes through the collection proxy.
+         TClass *cl = element->GetClassPointer();
+         TVirtualCollectionProxy *proxy = cl ? cl->GetCollectionProxy() : 0;
+         TConfiguredAction action;
+         if (element->GetArrayLength() <= 1 && !element->GetStreamer()
+             && proxy && !proxy->GetValueClass() && !proxy->HasPointers()
+             && proxy->GetCollectionType() == ROOT::kSTLvector
+             && !(proxy->GetProperties() & TVirtualCollectionProxy::kIsEmulated)) {
+            Bool_t isSTLbase = element->IsBase() && element->IsA()!=TStreamerBase::Class();
+            action = GetNumericCollectionWriteAction<VectorLooper>(proxy->GetType(), new TConfigSTL(this,i,compinfo,compinfo->fOffset,1,cl,element->GetTypeName(),isSTLbase));
+         }
+         if (action.fAction) {
+            writeSequence->AddAction( action );
+         } else {
+            writeSequence->AddAction( GenericWriteAction, new TGenericConfiguration(this,i,compinfo) );
+         }
+         break;
+      }
        // case TStreamerInfo::kBits:    writeSequence->AddAction( WriteBasicType<BitsMarker>, new TConfiguration(this,i,compinfo,compinfo->fOffset) );    break;
      /*case TStreamerInfo::kFloat16: {
          if (element->GetFactor() != 0) {
@@ -3004,6 +3132,162 @@ TStreamerInfoActions::TActionSequence *TStreamerInfoActions::TActionSequence::Cr
    return sequence;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Key of the read member-wise sequences shared by all the collection
+/// proxies. The sequence only depends on the StreamerInfo (identified by
+/// its address and its checksum) and, through its loop configuration, on
+/// the size of the elements of the collection.
+
+namespace {
+   struct TSharedSequenceKey {
+      TVirtualStreamerInfo *fInfo;
+      UInt_t                fCheckSum;
+      Long_t                fIncrement;
+      Bool_t                fHasPointers;
+
+      bool operator<(const TSharedSequenceKey &rhs) const
+      {
+         if (fInfo != rhs.fInfo) return fInfo < rhs.fInfo;
+         if (fCheckSum != rhs.fCheckSum) return fCheckSum < rhs.fCheckSum;
+         if (fIncrement != rhs.fIncrement) return fIncrement < rhs.fIncrement;
+         return fHasPointers < rhs.fHasPointers;
+      }
+   };
+
+   typedef std::map<TSharedSequenceKey, TStreamerInfoActions::TActionSequence*> SharedSequences_t;
+   typedef std::multimap<TVirtualStreamerInfo*, TStreamerInfoActions::TActionSequence*> RetiredSequences_t;
+
+   SharedSequences_t &GetSharedSequences()
+   {
+      static SharedSequences_t sequences;
+      return sequences;
+   }
+
+   // The sequences removed from the cache while their StreamerInfo is
+   // alive: other threads may still be using them.
+   RetiredSequences_t &GetRetiredSequences()
+   {
+      static RetiredSequences_t sequences;
+      return sequences;
+   }
+
+   std::mutex &GetSharedSequencesMutex()
+   {
+      static std::mutex mutex;
+      return mutex;
+   }
+
+   std::atomic<UInt_t> &GetSharedSequencesGeneration()
+   {
+      static std::atomic<UInt_t> generation(0);
+      return generation;
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return the bundle of actions streaming memberwise the content described
+/// by 'info' into the collection described by 'proxy', shared by all the
+/// collection proxies (and thus all the branches and all the files) using
+/// the same StreamerInfo. The sequence is owned by the cache and must not
+/// be deleted nor modified; use CreateSubSequence or CreateCopy. It stays
+/// valid until the StreamerInfo is deleted (see DeleteSharedActions).
+///
+/// Return 0 if the sequence depends on the proxy instance itself (generic
+/// collections iterated through the proxy); use CreateReadMemberWiseActions
+/// in that case.
+
+TStreamerInfoActions::TActionSequence *TStreamerInfoActions::TActionSequence::GetSharedReadMemberWiseActions(TVirtualStreamerInfo *info, TVirtualCollectionProxy &proxy)
+{
+   if (info == 0 || SelectLooper(proxy) == kGenericLooper) {
+      return 0;
+   }
+
+   TSharedSequenceKey key;
+   key.fInfo = info;
+   key.fCheckSum = info->GetCheckSum();
+   key.fIncrement = proxy.GetIncrement();
+   key.fHasPointers = proxy.HasPointers();
+
+   SharedSequences_t &sequences = GetSharedSequences();
+   {
+      std::lock_guard<std::mutex> lock(GetSharedSequencesMutex());
+      SharedSequences_t::iterator iter = sequences.find(key);
+      if (iter != sequences.end()) {
+         return iter->second;
+      }
+   }
+
+   // Build the sequence outside of the lock, it might need to compile the
+   // StreamerInfo.
+   TActionSequence *sequence = CreateReadMemberWiseActions(info, proxy);
+
+   std::lock_guard<std::mutex> lock(GetSharedSequencesMutex());
+   std::pair<SharedSequences_t::iterator, bool> res = sequences.insert(std::make_pair(key, sequence));
+   if (!res.second) {
+      // Another thread was faster.
+      delete sequence;
+   }
+   return res.first->second;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Remove from the cache the shared sequences derived from 'info', called
+/// when its compiled form is discarded (see TStreamerInfo::Clear("build")
+/// and TStreamerInfo::Compile): the following calls to
+/// GetSharedReadMemberWiseActions build new sequences. The collection
+/// proxies holding one of the removed sequences drop it the next time they
+/// are asked for a sequence (see GetSharedActionsGeneration). Since other
+/// threads may be using them without holding the lock of the cache, the
+/// removed sequences are only deleted with the StreamerInfo.
+
+void TStreamerInfoActions::TActionSequence::ReleaseSharedActions(TVirtualStreamerInfo *info)
+{
+   std::lock_guard<std::mutex> lock(GetSharedSequencesMutex());
+   SharedSequences_t &sequences = GetSharedSequences();
+   RetiredSequences_t &retired = GetRetiredSequences();
+   TSharedSequenceKey key;
+   key.fInfo = info;
+   key.fCheckSum = 0;
+   key.fIncrement = 0;
+   key.fHasPointers = kFALSE;
+   SharedSequences_t::iterator iter = sequences.lower_bound(key);
+   if (iter == sequences.end() || iter->first.fInfo != info) {
+      return;
+   }
+   ++GetSharedSequencesGeneration();
+   while (iter != sequences.end() && iter->first.fInfo == info) {
+      retired.insert(std::make_pair(info, iter->second));
+      sequences.erase(iter++);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Delete all the shared sequences derived from 'info', including the ones
+/// already removed from the cache, called when the StreamerInfo is deleted.
+
+void TStreamerInfoActions::TActionSequence::DeleteSharedActions(TVirtualStreamerInfo *info)
+{
+   ReleaseSharedActions(info);
+
+   std::lock_guard<std::mutex> lock(GetSharedSequencesMutex());
+   RetiredSequences_t &retired = GetRetiredSequences();
+   std::pair<RetiredSequences_t::iterator, RetiredSequences_t::iterator> range = retired.equal_range(info);
+   for (RetiredSequences_t::iterator iter = range.first; iter != range.second; ++iter) {
+      delete iter->second;
+   }
+   retired.erase(range.first, range.second);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return a counter incremented each time shared sequences are deleted.
+/// A user caching the result of GetSharedReadMemberWiseActions must drop
+/// it when the counter changes.
+
+UInt_t TStreamerInfoActions::TActionSequence::GetSharedActionsGeneration()
+{
+   return GetSharedSequencesGeneration().load();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Create the bundle of the actions necessary for the streaming memberwise of the content described by 'info' into the collection described by 'proxy'
 
@@ -97,6 +97,10 @@ HADDS        := $(MODDIRS)/hadd.cxx
 HADDO        := $(call stripsrc,$(HADDS:.cxx=.o))
 HADDDEP      := $(HADDO:.o=.d)
 HADD         := bin/hadd$(EXEEXT)
+ifneq ($(ARCH),win32)
+HADDLIBS     := -lMultiProc -lTreePlayer
+HADDLIBSDEP   = $(MULTIPROCLIB) $(TREEPLAYERLIB)
+endif
 
 ##### h2root #####
 H2ROOTS1     := $(MODDIRS)/h2root.cxx
@@ -184,9 +188,9 @@ $(ROOTSSH):     $(call stripsrc,$(MAINDIRS)/roots.sh)
 		@cp $< $@
 		@chmod 0755 $@
 
-$(HADD):        $(HADDO) $(ROOTLIBSDEP)
+$(HADD):        $(HADDO) $(ROOTLIBSDEP) $(HADDLIBSDEP)
 		$(LD) $(LDFLAGS) -o $@ $(HADDO) $(ROOTULIBS) \
-		   $(RPATH) $(ROOTLIBS) $(SYSLIBS)
+		   $(RPATH) $(HADDLIBS) $(ROOTLIBS) $(SYSLIBS)
 
 $(SSH2RPD):     $(SSH2RPDO) $(SNPRINTFO) $(STRLCPYO)
 		$(LD) $(LDFLAGS) -o $@ $(SSH2RPDO) $(SNPRINTFO) $(STRLCPYO) \
@@ -48,6 +48,19 @@
   (i.e. direct copy of the raw byte on disk). The "fast" mode is typically
   5 times faster than the mode unzipping and unstreaming the baskets.
 
+  The merge can be distributed over several processes with
+       hadd -j 4 targetfile source1 source2 ...
+  The sources are split, in order, into contiguous groups which are merged
+  concurrently into temporary files (in the directory given by -d, or the
+  system temporary directory). The temporary files are then merged, in the
+  same order, into the target file, so that the entries of the Trees
+  appear in the same order as with a sequential merge. When -n is used
+  together with -j, the maximum number of opened files is shared between
+  the processes. If -j is given without a number, one process per core
+  is used.
+  The histograms are summed group by group, so their contents may differ
+  from the ones of a sequential merge in the last digits.
+
   NOTE1: By default histograms are added. However hadd does not support the case where
          histograms have their bit TH1::kIsAverage set.
 
@@ -68,16 +81,23 @@
 #include "Riostream.h"
 #include "TClass.h"
 #include "TSystem.h"
+#include "TMath.h"
+#include "TROOT.h"
 #include <stdlib.h>
 
 #include "TFileMerger.h"
+#ifndef R__WIN32
+#include "TProcPool.h"
+#endif
+
+#include <vector>
 
 ////////////////////////////////////////////////////////////////////////////////
 
 int main( int argc, char **argv )
 {
    if ( argc < 3 || "-h" == std::string(argv[1]) || "--help" == std::string(argv[1]) ) {
-      std::cout << "Usage: " << argv[0] << " [-f[fk][0-9]] [-k] [-T] [-O] [-a] [-n maxopenedfiles] [-v [verbosity]] targetfile source1 [source2 source3 ...]" << std::endl;
+      std::cout << "Usage: " << argv[0] << " [-f[fk][0-9]] [-k] [-T] [-O] [-a] [-n maxopenedfiles] [-j [nprocesses]] [-d tmpdir] [-v [verbosity]] targetfile source1 [source2 source3 ...]" << std::endl;
       std::cout << "This program will add histograms from a list of root files and write them" << std::endl;
       std::cout << "to a target root file. The target file is newly created and must not " << std::endl;
       std::cout << "exist, or if -f (\"force\") is given, must not be one of the source files." << std::endl;
@@ -88,6 +108,10 @@ int main( int argc, char **argv )
       std::cout << "If the option -O is used, when merging TTree, the basket size is re-optimized" <<std::endl;
       std::cout << "If the option -v is used, explicitly set the verbosity level; 0 request no output, 99 is the default" <<std::endl;
       std::cout << "If the option -n is used, hadd will open at most 'maxopenedfiles' at once, use 0 to request to use the system maximum." << std::endl;
+      std::cout << "If the option -j is used, the inputs are split into 'nprocesses' groups merged in parallel before\n"
+                   "  being merged into the target; the default is the number of cores. The histograms being summed group by\n"
+                   "  group, their contents may differ from the ones of a sequential merge in the last digits (rounding)." << std::endl;
+      std::cout << "If the option -d is used, the temporary files of the parallel merge are written in 'tmpdir'." << std::endl;
       std::cout << "When -the -f option is specified, one can also specify the compression level of the target file.\n"
                    "By default the compression level is 1, but" <<std::endl;
       std::cout << "if \"-fk\" is specified, the target file contain the baskets with the same compression as in the input files \n"
@@ -110,6 +134,8 @@ int main( int argc, char **argv )
    Bool_t useFirstInputCompression = kFALSE;
    Int_t maxopenedfiles = 0;
    Int_t verbosity = 99;
+   Int_t nProcesses = 1;
+   TString workingDir;
 
    int outputPlace = 0;
    int ffirst = 2;
@@ -144,6 +170,34 @@ int main( int argc, char **argv )
             }
          }
          ++ffirst;
+      } else if ( strcmp(argv[a],"-j") == 0 ) {
+         if (a+1 < argc && isdigit(argv[a+1][0])) {
+            Long_t request = strtol(argv[a+1], 0, 10);
+            if (request < kMaxInt && request >= 0) {
+               nProcesses = (Int_t)request;
+            } else {
+               std::cerr << "Error: could not parse the number of processes passed after -j: " << argv[a+1] << ". We will use the number of cores.\n";
+               nProcesses = 0;
+            }
+            ++a;
+            ++ffirst;
+         } else {
+            nProcesses = 0;
+         }
+         if (nProcesses == 0) {
+            SysInfo_t info;
+            nProcesses = (gSystem->GetSysInfo(&info) == 0 && info.fCpus > 0) ? info.fCpus : 1;
+         }
+         ++ffirst;
+      } else if ( strcmp(argv[a],"-d") == 0 ) {
+         if (a+1 >= argc) {
+            std::cerr << "Error: no directory was provided after -d.\n";
+         } else {
+            workingDir = argv[a+1];
+            ++a;
+            ++ffirst;
+         }
+         ++ffirst;
       } else if ( strcmp(argv[a],"-v") == 0 ) {
          if (a+1 == argc || argv[a+1][0] == '-') {
             // Verbosity level was not specified use the default:
@@ -265,36 +319,112 @@ int main( int argc, char **argv )
       else
          std::cout << "hadd compression setting for all ouput: " << newcomp << '\n';
    }
+   // Expand the indirect files, the list of inputs is needed up front to
+   // split it between the processes of a parallel merge.
+   // An error in a file listed in an indirect file is fatal, even with -k.
+   std::vector<std::string> sources;
+   std::vector<Bool_t> indirectSources;
+   for ( int i = ffirst; i < argc; i++ ) {
+      if (argv[i] && argv[i][0]=='@') {
+         std::ifstream indirect_file(argv[i]+1);
+         if( ! indirect_file.is_open() ) {
+            std::cerr<< "hadd could not open indirect file " << (argv[i]+1) << std::endl;
+            return 1;
+         }
+         while( indirect_file ){
+            std::string line;
+            if( std::getline(indirect_file, line) && line.length() ) {
+               sources.push_back(line);
+               indirectSources.push_back(kTRUE);
+            }
+         }
+      } else {
+         sources.push_back(argv[i]);
+         indirectSources.push_back(kFALSE);
+      }
+   }
+
+   // Parallel merge: each process merges a contiguous group of the sources
+   // in a temporary file, the temporary files then replace the sources.
+   // This is done before the target is opened so that no TFile opened for
+   // writing is shared with the forked processes.
+   std::vector<std::string> partialFiles;
+#ifndef R__WIN32
+   UInt_t nGroups = TMath::Min((UInt_t)nProcesses, (UInt_t)(sources.size() / 2));
+   if (nGroups > 1) {
+      if (workingDir.IsNull()) workingDir = gSystem->TempDirectory();
+      for (UInt_t g = 0; g < nGroups; ++g) {
+         partialFiles.push_back(Form("%s/hadd_%d_partial%u.root", workingDir.Data(), gSystem->GetPid(), g));
+      }
+      // Share the limit on the number of opened files between the processes.
+      Int_t groupMaxOpened = maxopenedfiles > 0 ? TMath::Max(2, maxopenedfiles / (Int_t)nGroups) : 0;
+      auto mergeGroup = [&](UInt_t g) -> Int_t {
+         TFileMerger partial(kFALSE,kFALSE);
+         partial.SetMsgPrefix(Form("hadd[%u]", g));
+         partial.SetPrintLevel(verbosity - 1);
+         if (groupMaxOpened > 0) {
+            partial.SetMaxOpenedFiles(groupMaxOpened);
+         }
+         if (!partial.OutputFile(partialFiles[g].c_str(), kTRUE, newcomp)) {
+            std::cerr << "hadd error opening temporary file " << partialFiles[g] << std::endl;
+            return 0;
+         }
+         size_t first = sources.size() * g / nGroups;
+         size_t last = sources.size() * (g + 1) / nGroups;
+         for (size_t i = first; i < last; ++i) {
+            if (!partial.AddFile(sources[i].c_str())) {
+               if ( skip_errors && !indirectSources[i] ) {
+                  std::cerr << "hadd skipping file with error: " << sources[i] << std::endl;
+               } else {
+                  std::cerr << "hadd exiting due to error in " << sources[i] << std::endl;
+                  return 0;
+               }
+            }
+         }
+         partial.SetFastMethod(!reoptimize);
+         partial.SetNotrees(noTrees);
+         return partial.Merge() ? 1 : 0;
+      };
+      if (verbosity > 1) {
+         std::cout << "hadd merging " << sources.size() << " input files in " << nGroups << " parallel groups" << std::endl;
+      }
+      std::vector<UInt_t> groups(nGroups);
+      for (UInt_t g = 0; g < nGroups; ++g) groups[g] = g;
+      TProcPool pool(nGroups);
+      std::vector<Int_t> done = pool.Map(mergeGroup, groups);
+      Bool_t ok = done.size() == nGroups;
+      for (auto d : done) ok &= (d == 1);
+      if (!ok) {
+         std::cerr << "hadd error during the parallel merge of the input files." << std::endl;
+         for (const auto &f : partialFiles) gSystem->Unlink(f.c_str());
+         return 1;
+      }
+      sources = partialFiles;
+      indirectSources.assign(sources.size(), kFALSE);
+   }
+#endif
+
    if (append) {
       if (!merger.OutputFile(targetname,"UPDATE",newcomp)) {
          std::cerr << "hadd error opening target file for update :" << argv[ffirst-1] << "." << std::endl;
+         for (const auto &f : partialFiles) gSystem->Unlink(f.c_str());
          exit(2);
       }
    } else if (!merger.OutputFile(targetname,force,newcomp) ) {
       std::cerr << "hadd error opening target file (does " << argv[ffirst-1] << " exist?)." << std::endl;
       if (!force) std::cerr << "Pass \"-f\" argument to force re-creation of output file." << std::endl;
+      for (const auto &f : partialFiles) gSystem->Unlink(f.c_str());
       exit(1);
    }
 
 
-   for ( int i = ffirst; i < argc; i++ ) {
-      if (argv[i] && argv[i][0]=='@') {
-         std::ifstream indirect_file(argv[i]+1);
-         if( ! indirect_file.is_open() ) {
-            std::cerr<< "hadd could not open indirect file " << (argv[i]+1) << std::endl;
-            return 1;
-         }
-         while( indirect_file ){
-            std::string line;
-            if( std::getline(indirect_file, line) && line.length() &&  !merger.AddFile(line.c_str()) ) {
-               return 1;
-            }
-         }
-      } else if( ! merger.AddFile(argv[i]) ) {
-         if ( skip_errors ) {
-            std::cerr << "hadd skipping file with error: " << argv[i] << std::endl;
+   for (size_t i = 0; i < sources.size(); ++i) {
+      if( ! merger.AddFile(sources[i].c_str()) ) {
+         if ( skip_errors && !indirectSources[i] && partialFiles.empty() ) {
+            std::cerr << "hadd skipping file with error: " << sources[i] << std::endl;
          } else {
-            std::cerr << "hadd exiting due to error in " << argv[i] << std::endl;
+            std::cerr << "hadd exiting due to error in " << sources[i] << std::endl;
+            for (const auto &f : partialFiles) gSystem->Unlink(f.c_str());
             return 1;
          }
       }
@@ -306,12 +436,20 @@ int main( int argc, char **argv )
          // Don't warn if the user any request re-optimization.
          std::cout <<"hadd Sources and Target have different compression levels"<<std::endl;
          std::cout <<"hadd merging will be slower"<<std::endl;
+#ifdef R__USE_IMT
+         // The baskets are recompressed concurrently by the implicit
+         // multi-threading pool, sized by -j like the parallel merge.
+         if (nProcesses > 1) {
+            ROOT::EnableImplicitMT(nProcesses);
+         }
+#endif
       }
    }
    merger.SetNotrees(noTrees);
    Bool_t status;
    if (append) status = merger.PartialMerge(TFileMerger::kIncremental | TFileMerger::kAll);
    else status = merger.Merge();
+   for (const auto &f : partialFiles) gSystem->Unlink(f.c_str());
 
    if (status) {
       if (verbosity == 1) {
@@ -0,0 +1,107 @@
+// @(#)root/test:$Id$
+
+//
+// This program benchmarks the setup of the reading of trees with many
+// split branches: the time spent between the opening of a file and the
+// reading of the first entry, mostly spent creating the streaming actions
+// of each branch.
+//
+// The tree has 'nbranches' top level branches, each holding a split
+// std::vector<Track> (see Event.h), so every data member of Track becomes a
+// branch. The tree is written once and then read back from 'nfiles'
+// successive openings of the file.
+//
+// Usage: benchSplitBranches [nbranches] [nfiles]
+//
+//   nbranches - number of split std::vector<Track> branches (default 250)
+//   nfiles    - number of times the file is opened and read (default 4)
+//
+
+#include <stdlib.h>
+#include <vector>
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TStopwatch.h"
+#include "TTree.h"
+#include "Event.h"
+
+static const char *gFileName = "benchSplitBranches.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the tree with 'nbranches' split collection branches.
+
+void WriteTree(Int_t nbranches)
+{
+   TFile f(gFileName, "RECREATE");
+   TTree tree("T", "many split branches");
+   std::vector<std::vector<Track> > tracks(nbranches);
+   std::vector<std::vector<Track>* > addresses(nbranches);
+   for (Int_t i = 0; i < nbranches; ++i) {
+      addresses[i] = &tracks[i];
+      tree.Branch(TString::Format("tracks%d.", i), &addresses[i], 32000, 99);
+   }
+   Track track(0.5);
+   for (Int_t entry = 0; entry < 10; ++entry) {
+      for (Int_t i = 0; i < nbranches; ++i) {
+         tracks[i].assign(3, track);
+      }
+      tree.Fill();
+   }
+   tree.Write();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Open the file and read the first entry of all the branches.
+/// Return the number of bytes read.
+
+Int_t ReadTree(Double_t &setup, Double_t &read)
+{
+   TStopwatch timer;
+   TFile f(gFileName);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree) return 0;
+   Int_t nbytes = tree->GetEntry(0);
+   setup = timer.RealTime();
+   timer.Start();
+   for (Long64_t entry = 1; entry < tree->GetEntries(); ++entry) {
+      nbytes += tree->GetEntry(entry);
+   }
+   read = timer.RealTime();
+   tree->ResetBranchAddresses();
+   delete tree;
+   return nbytes;
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nbranches = argc > 1 ? atoi(argv[1]) : 250;
+   Int_t nfiles    = argc > 2 ? atoi(argv[2]) : 4;
+
+   TStopwatch timer;
+   WriteTree(nbranches);
+   Int_t nsplit = 0;
+   {
+      TFile f(gFileName);
+      TTree *tree = (TTree*)f.Get("T");
+      if (!tree) {
+         Printf("benchSplitBranches: FAILED to read back the tree");
+         return 1;
+      }
+      nsplit = tree->GetListOfLeaves()->GetEntries();
+      delete tree;
+   }
+   Printf("Wrote %d collection branches (%d leaves) in %.2fs", nbranches, nsplit, timer.RealTime());
+
+   for (Int_t i = 0; i < nfiles; ++i) {
+      Double_t setup = 0, read = 0;
+      Int_t nbytes = ReadTree(setup, read);
+      if (nbytes <= 0) {
+         Printf("benchSplitBranches: FAILED to read the entries");
+         return 1;
+      }
+      Printf("File %d: setup and first entry %.3fs, next entries %.3fs (%d bytes)", i, setup, read, nbytes);
+   }
+   return 0;
+}
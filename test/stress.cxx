@@ -70,6 +70,9 @@
 #ifndef __CINT__
 
 #include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
 #include <TROOT.h>
 #include <TSystem.h>
 #include <TH1.h>
@@ -743,10 +746,11 @@ void stress7()
 ///  Read the event file
 ///  Loop on all events in the file (reading everything).
 ///  Count number of bytes read
+///  If sum is given, add to it a checksum of the events read.
 
-Int_t stress8read(Int_t nevent)
+Int_t stress8read(Int_t nevent, const char *filename = "Event.root", Bool_t prefetch = kFALSE, Double_t *sum = 0)
 {
-   TFile *hfile = new TFile("Event.root");
+   TFile *hfile = new TFile(filename);
    TTree *tree; hfile->GetObject("T",tree);
    Event *event = 0;
    tree->SetBranchAddress("event",&event);
@@ -758,9 +762,11 @@ Int_t stress8read(Int_t nevent)
    TTreeCache::SetLearnEntries(1); //one entry is sufficient to learn
    TTreeCache *tc = (TTreeCache*)hfile->GetCacheRead();
    tc->SetEntryRange(0,nevent);
+   if (prefetch) tc->SetEnablePrefetching(kTRUE);
    Int_t nb = 0;
    for (Int_t ev = 0; ev < nev; ev++) {
       nb += tree->GetEntry(ev);        //read complete event in memory
+      if (sum) *sum += event->GetNtrack() + event->GetTemperature();
    }
    ntotin  += hfile->GetBytesRead();
 
@@ -769,6 +775,65 @@ Int_t stress8read(Int_t nevent)
    return nb;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+///  Append the n low bytes of value to s, little endian (n = 6 or 12 are
+///  runs of zeros).
+
+void stress8put(std::string &s, UInt_t value, Int_t n)
+{
+   for (Int_t b = 0; b < n; b++) s += (char)(b < 4 ? value >> (8*b) : 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+///  Store the file member, uncompressed, in the zip archive archive.
+///  Return kFALSE in case of failure.
+
+Bool_t stress8zip(const char *member, const char *archive)
+{
+   FILE *in = fopen(member, "rb");
+   if (!in) return kFALSE;
+   std::vector<char> data;
+   char buf[65536];
+   size_t n;
+   while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+      data.insert(data.end(), buf, buf + n);
+   fclose(in);
+
+   UInt_t crc = 0xffffffff;
+   for (size_t i = 0; i < data.size(); i++) {
+      crc ^= (UChar_t)data[i];
+      for (Int_t k = 0; k < 8; k++)
+         crc = (crc >> 1) ^ (0xedb88320 & (0 - (crc & 1)));
+   }
+   crc = ~crc;
+
+   // local header, central directory and end record, stored method,
+   // dated 1 January 1980
+   std::string local, dir, end;
+   UInt_t size = data.size(), namelen = strlen(member);
+   stress8put(local,0x04034b50,4); stress8put(local,20,2); stress8put(local,0,6);
+   stress8put(local,0x21,2); stress8put(local,crc,4); stress8put(local,size,4);
+   stress8put(local,size,4); stress8put(local,namelen,2); stress8put(local,0,2);
+   local += member;
+   stress8put(dir,0x02014b50,4); stress8put(dir,20,2); stress8put(dir,20,2);
+   stress8put(dir,0,6); stress8put(dir,0x21,2); stress8put(dir,crc,4);
+   stress8put(dir,size,4); stress8put(dir,size,4); stress8put(dir,namelen,2);
+   stress8put(dir,0,12); stress8put(dir,0,4);
+   dir += member;
+   stress8put(end,0x06054b50,4); stress8put(end,0,4); stress8put(end,1,2);
+   stress8put(end,1,2); stress8put(end,dir.size(),4); stress8put(end,local.size() + size,4);
+   stress8put(end,0,2);
+
+   FILE *out = fopen(archive, "wb");
+   if (!out) return kFALSE;
+   Bool_t ok = fwrite(local.data(), 1, local.size(), out) == local.size() &&
+               fwrite(data.data(), 1, size, out) == size &&
+               fwrite(dir.data(), 1, dir.size(), out) == dir.size() &&
+               fwrite(end.data(), 1, end.size(), out) == end.size();
+   fclose(out);
+   return ok;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 ///  Create the Event file in various modes
@@ -850,17 +915,37 @@ void stress8(Int_t nevent)
    // Create the file compressed, in split mode and read it back
    gRandom->SetSeed(65539);
    Int_t nbw2 = stress8write(nevent,1,9);
-   Int_t nbr2 = stress8read(0);
+   Double_t sum2 = 0;
+   Int_t nbr2 = stress8read(0,"Event.root",kFALSE,&sum2);
    Event::Reset();
 
+   // Read it back with the asynchronous reads, with and without the
+   // prefetching thread, from the file and from a zip archive member
+   Bool_t zipOK = stress8zip("Event.root","Event.zip");
+   const char *names[] = {"Event.root","Event.zip#Event.root"};
+   Int_t nbra[6] = {0};
+   Double_t suma[6] = {0};
+   for (Int_t i = 0; i < 6; i++) {
+      TFile::SetAsyncIODepth(i%3 ? 64 : 0);
+      nbra[i] = stress8read(0,names[i/3],i%3 == 2,&suma[i]);
+      Event::Reset();
+   }
+   TFile::SetAsyncIODepth(0);
+
    Bool_t OK = kTRUE;
    if (nbw0 != nbr0 || nbw1 != nbr1 || nbw2 != nbr2) OK = kFALSE;
    if (nbw0 != nbw1) OK = kFALSE;
+   if (!zipOK) OK = kFALSE;
+   for (Int_t i = 0; i < 6; i++)
+      if (nbra[i] != nbr2 || suma[i] != sum2) OK = kFALSE;
    if (OK) printf("OK\n");
    else    {
       printf("FAILED\n");
       printf("%-8s nbw0=%d, nbr0=%d, nbw1=%d\n"," ",nbw0,nbr0,nbw1);
       printf("%-8s nbr1=%d, nbw2=%d, nbr2=%d\n"," ",nbr1,nbw2,nbr2);
+      for (Int_t i = 0; i < 6; i++)
+         printf("%-8s %s (async=%d, prefetch=%d): nbr=%d, sum=%g, expected sum=%g\n"," ",
+                names[i/3],i%3 != 0,i%3 == 2,nbra[i],suma[i],sum2);
    }
    if (gPrintSubBench) { printf("Test  8 : "); gBenchmark->Show("stress");gBenchmark->Start("stress"); }
 }
@@ -1211,7 +1296,9 @@ void stress10()
    for (file=0;file<10;file++) {
       snprintf(filename,20,"Event_%d.root",file);
       chfile[file] = new TFile(filename,"recreate");
-      if (file>=5) {
+      if (file>=8) {
+         chfile[file]->SetCompressionAlgorithm(ROOT::kLZ4);
+      } else if (file>=5) {
          chfile[file]->SetCompressionAlgorithm(ROOT::kLZMA);
       }
       chTree[file] = (TTree*)tree->CloneTree(0);
@@ -1572,6 +1659,7 @@ void stress16()
 void cleanup()
 {
    gSystem->Unlink("Event.root");
+   gSystem->Unlink("Event.zip");
    gSystem->Unlink("Event_0.root");
    gSystem->Unlink("Event_1.root");
    gSystem->Unlink("Event_2.root");
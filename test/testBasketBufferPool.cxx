@@ -0,0 +1,144 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the pool of basket buffers of a tree (see
+// TTree::AcquireBasketBuffer and TTree::ReleaseBasketBuffer): a released
+// buffer must be handed out again, in write mode and empty, a basket
+// detached from its branch must drop its buffers without the pool, and a
+// tree read back with and without the pool must give the same values.
+//
+// Usage: testBasketBufferPool [nentries]
+//
+//   nentries - number of entries of the tree (default 50000)
+//
+
+#include <stdlib.h>
+
+#include "TBasket.h"
+#include "TBranch.h"
+#include "TBuffer.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const char *gFileName = "testBasketBufferPool.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Acquire and release buffers directly.
+
+Bool_t TestAcquireRelease()
+{
+   TTree tree("P", "pool");
+   tree.SetMaxBasketBufferPoolSize(1000000);
+
+   TBuffer *buffer = tree.AcquireBasketBuffer(1000);
+   if (!buffer || buffer->BufferSize() < 1000 || !buffer->IsWriting()) return kFALSE;
+   buffer->WriteInt(42);
+   tree.ReleaseBasketBuffer(buffer);
+
+   // The released buffer comes back, empty and in write mode.
+   TBuffer *reused = tree.AcquireBasketBuffer(500);
+   if (reused != buffer || reused->Length() != 0 || !reused->IsWriting()) return kFALSE;
+   reused->SetReadMode();
+   tree.ReleaseBasketBuffer(reused);
+
+   // A larger request expands the pooled buffer.
+   TBuffer *expanded = tree.AcquireBasketBuffer(5000);
+   if (expanded != buffer || expanded->BufferSize() < 5000 || !expanded->IsWriting()) return kFALSE;
+   tree.ReleaseBasketBuffer(expanded);
+
+   // Without a pool the buffers are freed.
+   tree.SetMaxBasketBufferPoolSize(0);
+   TBuffer *fresh = tree.AcquireBasketBuffer(100);
+   if (!fresh || fresh->BufferSize() < 100) return kFALSE;
+   tree.ReleaseBasketBuffer(fresh);
+   return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// A basket detached from its branch drops its buffers itself.
+
+Bool_t TestDetachedBasket()
+{
+   TTree tree("D", "detached basket");
+   Int_t x = 0;
+   TBranch *branch = tree.Branch("x", &x, "x/I");
+   TBasket *basket = new TBasket("x", "D", branch);
+   basket->SetBranch(0);
+   Int_t dropped = basket->DropBuffers();
+   delete basket;
+   return dropped > 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write a tree with many small baskets.
+
+void WriteTree(Long64_t nentries)
+{
+   TFile f(gFileName, "RECREATE");
+   TTree tree("T", "basket buffer pool");
+   Double_t x = 0;
+   Int_t n = 0;
+   Int_t values[20];
+   tree.Branch("x", &x, "x/D", 2000);
+   tree.Branch("n", &n, "n/I", 2000);
+   tree.Branch("values", values, "values[n]/I", 2000);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      x = i * 0.5;
+      n = i % 20;
+      for (Int_t k = 0; k < n; ++k) values[k] = i - k;
+      tree.Fill();
+   }
+   tree.Write();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the tree back with a pool of 'poolsize' bytes and check its values.
+
+Bool_t ReadTree(Long64_t nentries, Long64_t poolsize)
+{
+   TFile f(gFileName);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || tree->GetEntries() != nentries) return kFALSE;
+   tree->SetMaxBasketBufferPoolSize(poolsize);
+   Double_t x = 0;
+   Int_t n = 0;
+   Int_t values[20];
+   tree->SetBranchAddress("x", &x);
+   tree->SetBranchAddress("n", &n);
+   tree->SetBranchAddress("values", values);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      if (tree->GetEntry(i) <= 0) return kFALSE;
+      if (x != i * 0.5 || n != i % 20) return kFALSE;
+      for (Int_t k = 0; k < n; ++k)
+         if (values[k] != i - k) return kFALSE;
+   }
+   delete tree;
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Long64_t nentries = argc > 1 ? atoll(argv[1]) : 50000;
+
+   if (!TestAcquireRelease()) {
+      Printf("testBasketBufferPool: FAILED to reuse a released buffer");
+      return 1;
+   }
+   if (!TestDetachedBasket()) {
+      Printf("testBasketBufferPool: FAILED to drop the buffers of a basket without branch");
+      return 1;
+   }
+   WriteTree(nentries);
+   if (!ReadTree(nentries, 16000000)) {
+      Printf("testBasketBufferPool: FAILED to read back the tree with the pool");
+      return 1;
+   }
+   if (!ReadTree(nentries, 0)) {
+      Printf("testBasketBufferPool: FAILED to read back the tree without the pool");
+      return 1;
+   }
+
+   Printf("Read back %lld entries reusing the basket buffers", nentries);
+   return 0;
+}
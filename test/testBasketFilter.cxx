@@ -0,0 +1,122 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the pre-compression filters of the baskets (see
+// TBranch::SetBasketFilter): a tree whose branches use the shuffle and
+// delta filters is written and read back, then copied with a fast clone
+// recompressing the baskets for output branches with other filters, and
+// the copy is read back. A branch with several leaves must refuse a filter.
+//
+// Usage: testBasketFilter [nentries]
+//
+//   nentries - number of entries of the tree (default 50000)
+//
+
+#include <stdlib.h>
+
+#include "TBranch.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const char *gFileName = "testBasketFilter.root";
+static const char *gCopyName = "testBasketFilter_copy.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the tree back and check all its values.
+
+Bool_t ReadTree(const char *name, Long64_t nentries)
+{
+   TFile f(name);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || tree->GetEntries() != nentries) return kFALSE;
+   Double_t d = 0;
+   Int_t i = 0;
+   Long64_t l = 0;
+   Int_t n = 0;
+   Float_t v[10];
+   struct { Double_t b; Int_t a; } s;
+   tree->SetBranchAddress("d", &d);
+   tree->SetBranchAddress("i", &i);
+   tree->SetBranchAddress("l", &l);
+   tree->SetBranchAddress("n", &n);
+   tree->SetBranchAddress("v", v);
+   tree->SetBranchAddress("s", &s);
+   for (Long64_t e = 0; e < nentries; ++e) {
+      if (tree->GetEntry(e) <= 0) return kFALSE;
+      if (d != e * 0.25 || i != Int_t(e * 3) || l != e * 1000000007LL) return kFALSE;
+      if (n != e % 10) return kFALSE;
+      for (Int_t k = 0; k < n; ++k)
+         if (v[k] != Float_t(e + k)) return kFALSE;
+      if (s.a != Int_t(e) || s.b != -e * 0.5) return kFALSE;
+   }
+   delete tree;
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Long64_t nentries = argc > 1 ? atoll(argv[1]) : 50000;
+
+   {
+      TFile f(gFileName, "RECREATE", "", 1);
+      TTree tree("T", "basket filters");
+      Double_t d = 0;
+      Int_t i = 0;
+      Long64_t l = 0;
+      Int_t n = 0;
+      Float_t v[10];
+      struct { Double_t b; Int_t a; } s;
+      tree.Branch("d", &d, "d/D", 4000);
+      tree.Branch("i", &i, "i/I", 4000);
+      tree.Branch("l", &l, "l/L", 4000);
+      tree.Branch("n", &n, "n/I", 4000);
+      tree.Branch("v", v, "v[n]/F", 4000);
+      TBranch *multi = tree.Branch("s", &s, "b/D:a/I", 4000);
+      if (multi->SetBasketFilter(TBranch::kShuffle)) {
+         Printf("testBasketFilter: FAILED, a filter was accepted for a branch with several leaves");
+         return 1;
+      }
+      tree.SetBasketFilter("d", TBranch::kShuffle);
+      tree.SetBasketFilter("i", TBranch::kShuffle | TBranch::kDelta);
+      tree.SetBasketFilter("l", TBranch::kDelta);
+      tree.SetBasketFilter("v", TBranch::kShuffle);
+      for (Long64_t e = 0; e < nentries; ++e) {
+         d = e * 0.25;
+         i = e * 3;
+         l = e * 1000000007LL;
+         n = e % 10;
+         for (Int_t k = 0; k < n; ++k) v[k] = e + k;
+         s.a = e;
+         s.b = -e * 0.5;
+         tree.Fill();
+      }
+      tree.Write();
+   }
+   if (!ReadTree(gFileName, nentries)) {
+      Printf("testBasketFilter: FAILED to read back the filtered tree");
+      return 1;
+   }
+
+   {
+      TFile in(gFileName);
+      TTree *tree = (TTree*)in.Get("T");
+      TFile out(gCopyName, "RECREATE", "", 1);
+      TTree *copy = tree->CloneTree(0);
+      copy->SetBasketFilter("d", 0);
+      copy->SetBasketFilter("i", TBranch::kShuffle);
+      copy->SetBasketFilter("l", TBranch::kShuffle | TBranch::kDelta);
+      if (copy->CopyEntries(tree, -1, "fast recompress") < 0 || copy->GetEntries() != nentries) {
+         Printf("testBasketFilter: FAILED to copy the tree");
+         return 1;
+      }
+      copy->Write();
+   }
+   if (!ReadTree(gCopyName, nentries)) {
+      Printf("testBasketFilter: FAILED to read back the tree copied with other filters");
+      return 1;
+   }
+
+   Printf("Wrote, copied and read back %lld filtered entries", nentries);
+   return 0;
+}
@@ -0,0 +1,101 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests TBufferMerger: several threads fill a tree in their
+// own TBufferMergerFile, handing over their entries every 'nflush'
+// entries, and the merged output file must contain all the entries.
+// A merger whose output file can not be opened must hand out no file.
+//
+// Usage: testBufferMerger [nthreads] [nentries] [nflush]
+//
+//   nthreads - number of filling threads (default 4)
+//   nentries - number of entries filled by each thread (default 10000)
+//   nflush   - number of entries between two writes (default 1000)
+//
+
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#include "TBufferMerger.h"
+#include "TError.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const char *gFileName = "testBufferMerger.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fill 'nentries' entries of the tree of one thread, writing the sub-file
+/// every 'nflush' entries. Each entry holds the thread number and the
+/// entry number in the thread.
+
+void Fill(TBufferMerger &merger, Int_t thread, Int_t nentries, Int_t nflush)
+{
+   auto f = merger.GetFile();
+   f->cd();
+   TTree t("T", "filled by several threads");
+   Int_t ithread = thread, ientry = 0;
+   t.Branch("thread", &ithread, "thread/I");
+   t.Branch("entry", &ientry, "entry/I");
+   for (ientry = 0; ientry < nentries; ++ientry) {
+      t.Fill();
+      if ((ientry + 1) % nflush == 0) f->Write();
+   }
+   f->Write();
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nthreads = argc > 1 ? atoi(argv[1]) : 4;
+   Int_t nentries = argc > 2 ? atoi(argv[2]) : 10000;
+   Int_t nflush   = argc > 3 ? atoi(argv[3]) : 1000;
+
+   ROOT::EnableThreadSafety();
+   {
+      // The expected errors are not printed.
+      Int_t level = gErrorIgnoreLevel;
+      gErrorIgnoreLevel = kFatal;
+      TBufferMerger merger("/nonexistent/testBufferMerger.root");
+      Bool_t refused = merger.IsZombie() && !merger.GetFile();
+      gErrorIgnoreLevel = level;
+      if (!refused) {
+         Printf("testBufferMerger: FAILED, a file was handed out by a merger without output file");
+         return 1;
+      }
+   }
+   {
+      TBufferMerger merger(gFileName);
+      if (merger.IsZombie()) {
+         Printf("testBufferMerger: FAILED to open %s", gFileName);
+         return 1;
+      }
+      std::vector<std::thread> threads;
+      for (Int_t i = 0; i < nthreads; ++i)
+         threads.emplace_back(Fill, std::ref(merger), i, nentries, nflush);
+      for (auto &t : threads)
+         t.join();
+   }
+
+   TFile f(gFileName);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree) {
+      Printf("testBufferMerger: FAILED to read back the tree");
+      return 1;
+   }
+   Long64_t expected = Long64_t(nthreads) * nentries;
+   if (tree->GetEntries() != expected) {
+      Printf("testBufferMerger: FAILED, %lld entries merged instead of %lld", tree->GetEntries(), expected);
+      return 1;
+   }
+   // Every thread must have contributed all its entries
+   for (Int_t i = 0; i < nthreads; ++i) {
+      Long64_t n = tree->GetEntries(TString::Format("thread==%d", i));
+      if (n != nentries) {
+         Printf("testBufferMerger: FAILED, %lld entries of thread %d instead of %d", n, i, nentries);
+         return 1;
+      }
+   }
+   Printf("Merged %lld entries from %d threads", expected, nthreads);
+   return 0;
+}
@@ -0,0 +1,120 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the bulk reading of the entries of a branch (see
+// TBranch::GetBulkEntries and TBranch::GetEntriesSerialized): a tree is
+// read basket by basket while it is being filled, the last entries coming
+// from the basket still in memory, then after more entries are filled,
+// and again once it is written and read back from the file.
+//
+// Usage: testBulkEntries [nentries]
+//
+//   nentries - number of entries of the tree (default 20000)
+//
+
+#include <stdlib.h>
+
+#include "TBranch.h"
+#include "TBufferFile.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const char *gFileName = "testBulkEntries.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read all the entries of the tree in bulk and check their values.
+
+Bool_t ReadBulk(TTree *tree, Long64_t nentries)
+{
+   TBranch *px = tree->GetBranch("px");
+   TBranch *id = tree->GetBranch("id");
+   TBranch *v = tree->GetBranch("v");
+   if (!px || !id || !v || px->GetEntries() != nentries) return kFALSE;
+   TBufferFile buf(TBuffer::kWrite, 1000);
+
+   for (Long64_t entry = 0; entry < nentries; ) {
+      Int_t n = px->GetBulkEntries(entry, buf);
+      if (n <= 0) return kFALSE;
+      Float_t *values = (Float_t*)buf.Buffer();
+      for (Int_t i = 0; i < n; ++i)
+         if (values[i] != Float_t(entry + i) * 0.5f) return kFALSE;
+      entry += n;
+   }
+
+   // The serialized values are big endian: the buffer converts them back.
+   for (Long64_t entry = 0; entry < nentries; ) {
+      Int_t n = id->GetEntriesSerialized(entry, buf);
+      if (n <= 0) return kFALSE;
+      for (Int_t i = 0; i < n; ++i) {
+         Int_t value = 0;
+         buf.ReadInt(value);
+         if (value != Int_t(entry + i) * 3) return kFALSE;
+      }
+      entry += n;
+   }
+
+   for (Long64_t entry = 0; entry < nentries; ) {
+      Int_t n = v->GetBulkEntries(entry, buf);
+      if (n <= 0) return kFALSE;
+      Double_t *values = (Double_t*)buf.Buffer();
+      for (Int_t i = 0; i < n; ++i)
+         for (Int_t k = 0; k < 3; ++k)
+            if (values[3 * i + k] != Double_t(entry + i) + k) return kFALSE;
+      entry += n;
+   }
+   return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fill the entries first to last-1 of the tree.
+
+void Fill(TTree &tree, Float_t &px, Int_t &id, Double_t *v, Long64_t first, Long64_t last)
+{
+   for (Long64_t i = first; i < last; ++i) {
+      px = Float_t(i) * 0.5f;
+      id = i * 3;
+      for (Int_t k = 0; k < 3; ++k) v[k] = Double_t(i) + k;
+      tree.Fill();
+   }
+}
+
+int main(int argc, char **argv)
+{
+   Long64_t nentries = argc > 1 ? atoll(argv[1]) : 20000;
+   Long64_t nmore = 37;
+
+   {
+      TFile f(gFileName, "RECREATE");
+      TTree tree("T", "bulk reading");
+      tree.SetAutoSave(0);
+      Float_t px = 0;
+      Int_t id = 0;
+      Double_t v[3];
+      tree.Branch("px", &px, "px/F", 4000);
+      tree.Branch("id", &id, "id/I", 4000);
+      tree.Branch("v", v, "v[3]/D", 4000);
+      Fill(tree, px, id, v, 0, nentries);
+      if (!ReadBulk(&tree, nentries)) {
+         Printf("testBulkEntries: FAILED to read the tree in bulk while filling it");
+         return 1;
+      }
+      Fill(tree, px, id, v, nentries, nentries + nmore);
+      if (!ReadBulk(&tree, nentries + nmore)) {
+         Printf("testBulkEntries: FAILED to read the tree in bulk after filling more entries");
+         return 1;
+      }
+      tree.Write();
+   }
+
+   TFile f(gFileName);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || !ReadBulk(tree, nentries + nmore)) {
+      Printf("testBulkEntries: FAILED to read back the tree in bulk");
+      return 1;
+   }
+   delete tree;
+
+   Printf("Read %lld entries in bulk", nentries + nmore);
+   return 0;
+}
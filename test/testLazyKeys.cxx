@@ -0,0 +1,102 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the keys of a directory created on demand (option
+// "lazykeys=1" of TFile::Open): a file with many keys is opened, some
+// objects are read with Get, GetObject and GetObjectChecked, which must
+// only create the keys they look up, then the full list of keys is loaded.
+//
+// Usage: testLazyKeys [nkeys]
+//
+//   nkeys - number of objects written to the file (default 5000)
+//
+
+#include <stdlib.h>
+
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TNamed.h"
+#include "TROOT.h"
+
+static const char *gFileName = "testLazyKeys.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Identifier of the next key created: TKey numbers the keys it creates.
+
+UInt_t NextKeyId(TFile &f)
+{
+   TKey probe(&f);
+   return probe.GetUniqueID();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Check that 'obj' is the object 'name' with the title 'title'.
+
+Bool_t Check(const TNamed *obj, const char *name, const char *title, const char *how)
+{
+   if (!obj || strcmp(obj->GetName(), name) || strcmp(obj->GetTitle(), title)) {
+      Printf("testLazyKeys: FAILED to read %s with %s", name, how);
+      return kFALSE;
+   }
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nkeys = argc > 1 ? atoi(argv[1]) : 5000;
+
+   {
+      TFile f(gFileName, "RECREATE");
+      for (Int_t i = 0; i < nkeys; ++i) {
+         TNamed obj(TString::Format("obj%d", i), TString::Format("title%d", i));
+         obj.Write();
+      }
+      // A second cycle of the first object.
+      TNamed obj("obj0", "cycle2");
+      obj.Write();
+   }
+
+   TFile f(TString::Format("%s?lazykeys=1", gFileName));
+   if (f.IsZombie()) {
+      Printf("testLazyKeys: FAILED to open %s", gFileName);
+      return 1;
+   }
+   if (f.GetNkeys() != nkeys + 1) {
+      Printf("testLazyKeys: FAILED, %d keys instead of %d", f.GetNkeys(), nkeys + 1);
+      return 1;
+   }
+
+   UInt_t first = NextKeyId(f);
+   TString name = TString::Format("obj%d", nkeys / 2);
+   TString title = TString::Format("title%d", nkeys / 2);
+   if (!Check((TNamed*)f.Get(name), name, title, "Get")) return 1;
+   name = TString::Format("obj%d", nkeys / 3);
+   title = TString::Format("title%d", nkeys / 3);
+   TNamed *obj = nullptr;
+   f.GetObject(name, obj);
+   if (!Check(obj, name, title, "GetObject")) return 1;
+   if (!Check((TNamed*)f.GetObjectChecked("obj0;1", "TNamed"), "obj0", "title0", "GetObjectChecked and a cycle")) return 1;
+   obj = nullptr;
+   f.GetObject("obj0", obj);
+   if (!Check(obj, "obj0", "cycle2", "GetObject and the highest cycle")) return 1;
+   // Only the keys looked up (and the probes) may have been created.
+   UInt_t created = NextKeyId(f) - first - 1;
+   if (created > 8) {
+      Printf("testLazyKeys: FAILED, %u keys created to read 4 objects", created);
+      return 1;
+   }
+
+   if (!f.GetListOfKeys() || f.GetListOfKeys()->GetSize() != nkeys + 1) {
+      Printf("testLazyKeys: FAILED to load the list of keys");
+      return 1;
+   }
+   name = TString::Format("obj%d", nkeys - 1);
+   title = TString::Format("title%d", nkeys - 1);
+   obj = nullptr;
+   f.GetObject(name, obj);
+   if (!Check(obj, name, title, "GetObject after GetListOfKeys")) return 1;
+
+   Printf("Read objects among %d keys created on demand", nkeys);
+   return 0;
+}
@@ -0,0 +1,113 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the parallel compression of the baskets (see
+// TTree::SetParallelCompression): a tree with several branches and many
+// baskets is written with and without parallel compression, each tree is
+// read back and its values are checked, and both files must have the same
+// size.
+//
+// Usage: testParallelCompression [nentries] [nthreads]
+//
+//   nentries - number of entries of the tree (default 100000)
+//   nthreads - number of baskets compressed at the same time (default 4)
+//
+
+#include <stdlib.h>
+
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const Int_t kNbranches = 8;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Value of the branch 'b' at entry 'i'.
+
+Double_t Value(Int_t b, Long64_t i)
+{
+   return b * 1000.5 + (i % 977) * 0.25;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the tree with small baskets, compressing them in parallel if
+/// 'nthreads' is not 0. FlushBaskets is called periodically so that many
+/// baskets are queued at once. Return the size of the file.
+
+Long64_t WriteTree(const char *name, Long64_t nentries, Int_t nthreads)
+{
+   TFile f(name, "RECREATE", "", 1);
+   TTree tree("T", "parallel compression");
+   tree.SetParallelCompression(nthreads);
+   Double_t values[kNbranches];
+   Int_t n = 0;
+   Int_t counts[10];
+   for (Int_t b = 0; b < kNbranches; ++b)
+      tree.Branch(TString::Format("x%d", b), &values[b], TString::Format("x%d/D", b), 4000);
+   tree.Branch("n", &n, "n/I", 4000);
+   tree.Branch("counts", counts, "counts[n]/I", 4000);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      for (Int_t b = 0; b < kNbranches; ++b) values[b] = Value(b, i);
+      n = i % 10;
+      for (Int_t k = 0; k < n; ++k) counts[k] = i + k;
+      tree.Fill();
+      if (i % 10000 == 9999) tree.FlushBaskets();
+   }
+   tree.Write();
+   return f.GetEND();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the tree back and check all its values.
+
+Bool_t ReadTree(const char *name, Long64_t nentries)
+{
+   TFile f(name);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || tree->GetEntries() != nentries) return kFALSE;
+   Double_t values[kNbranches];
+   Int_t n = 0;
+   Int_t counts[10];
+   for (Int_t b = 0; b < kNbranches; ++b)
+      tree->SetBranchAddress(TString::Format("x%d", b), &values[b]);
+   tree->SetBranchAddress("n", &n);
+   tree->SetBranchAddress("counts", counts);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      if (tree->GetEntry(i) <= 0) return kFALSE;
+      for (Int_t b = 0; b < kNbranches; ++b)
+         if (values[b] != Value(b, i)) return kFALSE;
+      if (n != i % 10) return kFALSE;
+      for (Int_t k = 0; k < n; ++k)
+         if (counts[k] != i + k) return kFALSE;
+   }
+   delete tree;
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Long64_t nentries = argc > 1 ? atoll(argv[1]) : 100000;
+   Int_t nthreads    = argc > 2 ? atoi(argv[2]) : 4;
+
+#ifdef R__USE_IMT
+   ROOT::EnableImplicitMT(nthreads);
+#endif
+   Long64_t sequential = WriteTree("testParallelCompression_seq.root", nentries, 0);
+   Long64_t parallel   = WriteTree("testParallelCompression_par.root", nentries, nthreads);
+
+   if (!ReadTree("testParallelCompression_seq.root", nentries)) {
+      Printf("testParallelCompression: FAILED to read back the tree compressed sequentially");
+      return 1;
+   }
+   if (!ReadTree("testParallelCompression_par.root", nentries)) {
+      Printf("testParallelCompression: FAILED to read back the tree compressed in parallel");
+      return 1;
+   }
+   if (sequential != parallel) {
+      Printf("testParallelCompression: FAILED, file size %lld with parallel compression instead of %lld",
+             parallel, sequential);
+      return 1;
+   }
+   Printf("Wrote and read back %lld entries compressed with %d threads", nentries, nthreads);
+   return 0;
+}
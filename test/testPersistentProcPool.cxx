@@ -0,0 +1,100 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests TPersistentProcPool, whose workers are forked once
+// and keep their state across the calls to Map: each worker counts the
+// arguments it processed, and the counts seen over two calls must go on
+// from one call to the next. An argument making the workers crash must
+// give an empty result, and the pool must fork new workers afterwards.
+//
+// Usage: testPersistentProcPool [nargs] [nworkers]
+//
+//   nargs    - number of arguments of each call to Map (default 200)
+//   nworkers - number of workers of the pool (default 2)
+//
+
+#include <algorithm>
+#include <map>
+#include <stdlib.h>
+#include <unistd.h>
+#include <vector>
+
+#include "TPersistentProcPool.h"
+#include "TROOT.h"
+
+static const Long64_t kMaxCalls = 1000000;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Record the results of a call to Map: the pid of the worker that
+/// processed each argument and the number of arguments it had processed.
+
+Bool_t Record(const std::vector<Long64_t> &results, std::map<Long64_t, std::vector<Long64_t>> &calls)
+{
+   for (auto r : results) {
+      if (r < 0) return kFALSE;
+      calls[r / kMaxCalls].push_back(r % kMaxCalls);
+   }
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nargs    = argc > 1 ? atoi(argv[1]) : 200;
+   Int_t nworkers = argc > 2 ? atoi(argv[2]) : 2;
+
+   auto init = []() { return Long64_t(0); };
+   auto func = [](Long64_t &ncalls, Int_t arg) {
+      if (arg < 0) _exit(1);
+      ++ncalls;
+      return getpid() * kMaxCalls + ncalls;
+   };
+   TPersistentProcPool<decltype(func), decltype(init), Int_t> pool(func, init, nworkers);
+
+   std::vector<Int_t> args(nargs);
+   for (Int_t i = 0; i < nargs; ++i) args[i] = i;
+
+   std::map<Long64_t, std::vector<Long64_t>> calls;
+   std::vector<Long64_t> first = pool.Map(args);
+   std::vector<Long64_t> second = pool.Map(args);
+   if (first.size() != args.size() || second.size() != args.size() || !Record(first, calls) || !Record(second, calls)) {
+      Printf("testPersistentProcPool: FAILED, results are missing");
+      return 1;
+   }
+   // Each worker was forked once: its counts go on from 1 over both calls.
+   if ((Int_t)calls.size() > nworkers) {
+      Printf("testPersistentProcPool: FAILED, %d workers used instead of at most %d", (Int_t)calls.size(), nworkers);
+      return 1;
+   }
+   for (auto &worker : calls) {
+      std::vector<Long64_t> &counts = worker.second;
+      std::sort(counts.begin(), counts.end());
+      for (size_t k = 0; k < counts.size(); ++k) {
+         if (counts[k] != Long64_t(k + 1)) {
+            Printf("testPersistentProcPool: FAILED, the state of worker %lld was not kept across the calls", worker.first);
+            return 1;
+         }
+      }
+   }
+
+   // The workers crash on a negative argument, the replacements too.
+   args[nargs / 2] = -1;
+   if (!pool.Map(args).empty()) {
+      Printf("testPersistentProcPool: FAILED, results returned although all the workers were lost");
+      return 1;
+   }
+   args[nargs / 2] = 0;
+   calls.clear();
+   if (!Record(pool.Map(args), calls) || calls.empty()) {
+      Printf("testPersistentProcPool: FAILED, no new workers after losing them all");
+      return 1;
+   }
+   for (auto &worker : calls) {
+      if (worker.second.size() > 0 && *std::max_element(worker.second.begin(), worker.second.end()) != Long64_t(worker.second.size())) {
+         Printf("testPersistentProcPool: FAILED, the new worker %lld did not start from a new state", worker.first);
+         return 1;
+      }
+   }
+
+   Printf("Processed %d arguments twice with %d persistent workers", nargs, nworkers);
+   return 0;
+}
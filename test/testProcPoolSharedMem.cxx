@@ -0,0 +1,104 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the transfer of large results through the shared
+// memory of the workers of a TProcPool and their reduction in the workers
+// (see TMPClient::SetSharedMemSize): histograms larger than the threshold
+// of the shared memory are returned by Map and reduced by MapReduce, with
+// and without shared memory, and results of a built-in type are still
+// reduced by the client.
+//
+// Usage: testProcPoolSharedMem [nargs] [nworkers]
+//
+//   nargs    - number of arguments of each call (default 16)
+//   nworkers - number of workers of the pool (default 4)
+//
+
+#include <stdlib.h>
+#include <vector>
+
+#include "PoolUtils.h"
+#include "TH1D.h"
+#include "TProcPool.h"
+#include "TROOT.h"
+
+// More than 1 MB of bin contents: sent through the shared memory.
+static const Int_t kNbins = 200000;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Check the histogram obtained by summing the histograms of the arguments
+/// 'first' to 'last'-1.
+
+Bool_t CheckSum(TH1D *h, Int_t first, Int_t last)
+{
+   if (!h || h->GetNbinsX() != kNbins || h->GetEntries() != 2 * (last - first)) return kFALSE;
+   if (h->GetBinContent(kNbins) != last - first) return kFALSE;
+   for (Int_t i = first; i < last; ++i)
+      if (h->GetBinContent(i + 1) != i + 1) return kFALSE;
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nargs    = argc > 1 ? atoi(argv[1]) : 16;
+   Int_t nworkers = argc > 2 ? atoi(argv[2]) : 4;
+
+   TH1::AddDirectory(kFALSE);
+   auto fill = [](Int_t i) {
+      TH1D *h = new TH1D("h", "large result", kNbins, 0, kNbins);
+      h->Fill(i, i + 1);
+      h->Fill(kNbins - 1);
+      return h;
+   };
+   auto merge = [](const std::vector<TH1D *> &hists) {
+      return static_cast<TH1D *>(PoolUtils::ReduceObjects(std::vector<TObject *>(hists.begin(), hists.end())));
+   };
+   std::vector<Int_t> args(nargs);
+   for (Int_t i = 0; i < nargs; ++i) args[i] = i;
+
+   TProcPool pool(nworkers);
+   ULong_t sizes[] = { pool.GetSharedMemSize(), 0 };
+   for (auto size : sizes) {
+      pool.SetSharedMemSize(size);
+      const char *mode = size ? "with shared memory" : "without shared memory";
+
+      std::vector<TH1D *> hists = pool.Map(fill, args);
+      if ((Int_t)hists.size() != nargs) {
+         Printf("testProcPoolSharedMem: FAILED, %d results returned by Map %s", (Int_t)hists.size(), mode);
+         return 1;
+      }
+      for (Int_t i = 0; i < nargs; ++i) {
+         if (!CheckSum(hists[i], i, i + 1)) {
+            Printf("testProcPoolSharedMem: FAILED, wrong result of Map %s", mode);
+            return 1;
+         }
+         delete hists[i];
+      }
+
+      TH1D *sum = pool.MapReduce(fill, args, merge);
+      if (!CheckSum(sum, 0, nargs)) {
+         Printf("testProcPoolSharedMem: FAILED, wrong result of MapReduce %s", mode);
+         return 1;
+      }
+      delete sum;
+   }
+
+   // Results of a built-in type can not be stashed: the client reduces them.
+   pool.SetSharedMemSize(sizes[0]);
+   auto square = [](Int_t i) { return i * i; };
+   auto add = [](const std::vector<Int_t> &values) {
+      Int_t total = 0;
+      for (auto v : values) total += v;
+      return total;
+   };
+   Int_t expected = 0;
+   for (Int_t i = 0; i < nargs; ++i) expected += i * i;
+   Int_t total = pool.MapReduce(square, args, add);
+   if (total != expected) {
+      Printf("testProcPoolSharedMem: FAILED, sum of the squares %d instead of %d", total, expected);
+      return 1;
+   }
+
+   Printf("Reduced %d large results with %d workers", nargs, nworkers);
+   return 0;
+}
@@ -0,0 +1,136 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the processing of trees by TProcPool::ProcTree in
+// packets of clusters handed out on demand (see TPoolPacketizer): the
+// packets of files of very different sizes must be made of whole clusters
+// of one file and cover each entry once, and the trees processed by the
+// workers, from a list of files or from a TTree read from a file, must
+// give each entry to exactly one worker.
+//
+// Usage: testProcTreePackets [nworkers]
+//
+//   nworkers - number of workers of the pool (default 4)
+//
+
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TH1F.h"
+#include "TPoolPacketizer.h"
+#include "TProcPool.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+
+static const Int_t kClusterSize = 1000;
+static const Int_t kNFiles = 3;
+static const Int_t kNEntries[kNFiles] = { 30000, 2500, 700 };
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write a tree whose entries are numbered from 'first'.
+
+void WriteTree(const std::string &name, Int_t first, Int_t nentries)
+{
+   TFile f(name.c_str(), "RECREATE");
+   TTree tree("events", "processed in packets");
+   tree.SetAutoFlush(kClusterSize);
+   Int_t id = 0;
+   tree.Branch("id", &id, "id/I");
+   for (Int_t i = 0; i < nentries; ++i) {
+      id = first + i;
+      tree.Fill();
+   }
+   tree.Write();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Hand out all the packets of the files to 'nworkers' workers in turn and
+/// check that they are made of whole clusters and cover each entry once.
+
+Bool_t CheckPackets(const std::vector<std::string> &fileNames, Int_t nworkers, ULong64_t nToProcess)
+{
+   TPoolPacketizer packetizer(fileNames, "events", nToProcess, nworkers);
+   // The packetizer only uses the sockets to tell the workers apart.
+   std::vector<TSocket *> workers;
+   for (Int_t w = 0; w < nworkers; ++w)
+      workers.push_back(reinterpret_cast<TSocket *>(w + 1));
+
+   std::vector<Long64_t> next(fileNames.size(), 0);
+   ULong64_t total = 0;
+   PoolUtils::TEntryPacket packet;
+   for (Int_t n = 0; packetizer.GetNextPacket(workers[n % nworkers], packet); ++n) {
+      if (packet.fFileN >= fileNames.size() || packet.fStart != next[packet.fFileN] || packet.fEnd <= packet.fStart)
+         return kFALSE;
+      Long64_t fileEntries = kNEntries[packet.fFileN];
+      if (packet.fEnd % kClusterSize && packet.fEnd != fileEntries && total + packet.fEnd - packet.fStart != nToProcess)
+         return kFALSE;
+      next[packet.fFileN] = packet.fEnd;
+      total += packet.fEnd - packet.fStart;
+   }
+   return total == packetizer.GetNEntries() && (!nToProcess || total == nToProcess);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Check that the histogram of the entry numbers holds each of the 'nentries'
+/// first entries once.
+
+Bool_t CheckEntries(TH1F *h, Int_t nentries)
+{
+   if (!h || h->GetEntries() != nentries) return kFALSE;
+   for (Int_t i = 0; i < nentries; ++i)
+      if (h->GetBinContent(i + 1) != 1) return kFALSE;
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nworkers = argc > 1 ? atoi(argv[1]) : 4;
+
+   std::vector<std::string> fileNames;
+   Int_t total = 0;
+   for (Int_t i = 0; i < kNFiles; ++i) {
+      fileNames.emplace_back(TString::Format("testProcTreePackets_%d.root", i).Data());
+      WriteTree(fileNames.back(), total, kNEntries[i]);
+      total += kNEntries[i];
+   }
+
+   if (!CheckPackets(fileNames, nworkers, 0)) {
+      Printf("testProcTreePackets: FAILED, wrong packets for all the entries");
+      return 1;
+   }
+   if (!CheckPackets(fileNames, nworkers, kNEntries[0] + 1234)) {
+      Printf("testProcTreePackets: FAILED, wrong packets for a part of the entries");
+      return 1;
+   }
+
+   auto fill = [total](TTreeReader &reader) {
+      TTreeReaderValue<Int_t> id(reader, "id");
+      TH1F *h = new TH1F("id", "entry numbers", total, 0, total);
+      while (reader.Next()) h->Fill(*id);
+      return h;
+   };
+
+   TProcPool pool(nworkers);
+   TH1F *h = pool.ProcTree(fileNames, fill, "events");
+   if (!CheckEntries(h, total)) {
+      Printf("testProcTreePackets: FAILED, entries of the files missed or processed twice");
+      return 1;
+   }
+   delete h;
+
+   TFile f(fileNames[0].c_str());
+   TTree *tree = (TTree*)f.Get("events");
+   h = tree ? pool.ProcTree(*tree, fill) : nullptr;
+   if (!CheckEntries(h, kNEntries[0])) {
+      Printf("testProcTreePackets: FAILED, entries of the tree missed or processed twice");
+      return 1;
+   }
+   delete h;
+
+   Printf("Processed %d entries of %d files in packets of clusters", total, kNFiles);
+   return 0;
+}
@@ -0,0 +1,120 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the reuse of the StreamerInfo records already read by
+// the process (see TFile::ReadStreamerInfo): several files with the same
+// content are read through a TChain, one of them is then updated, and the
+// StreamerInfo record it is written back with must still describe all the
+// classes of the file.
+//
+// Usage: testStreamerInfoRecords [nfiles] [nentries]
+//
+//   nfiles   - number of files (default 3)
+//   nentries - number of entries of the tree of each file (default 1000)
+//
+
+#include <stdlib.h>
+#include <vector>
+
+#include "TChain.h"
+#include "TFile.h"
+#include "TH1F.h"
+#include "TList.h"
+#include "TObjString.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Name of the i-th file.
+
+TString FileName(Int_t i)
+{
+   return TString::Format("testStreamerInfoRecords_%d.root", i);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write a file holding a histogram and a tree with a vector branch.
+
+void WriteFile(const char *name, Int_t nentries)
+{
+   TFile f(name, "RECREATE");
+   TH1F h("h", "histogram", 10, 0, 10);
+   TTree tree("T", "same classes in all the files");
+   std::vector<Double_t> v;
+   tree.Branch("v", &v);
+   for (Int_t i = 0; i < nentries; ++i) {
+      v.assign(i % 5, i * 0.5);
+      h.Fill(i % 10);
+      tree.Fill();
+   }
+   h.Write();
+   tree.Write();
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nfiles   = argc > 1 ? atoi(argv[1]) : 3;
+   Int_t nentries = argc > 2 ? atoi(argv[2]) : 1000;
+
+   TChain chain("T");
+   for (Int_t i = 0; i < nfiles; ++i) {
+      WriteFile(FileName(i), nentries);
+      chain.Add(FileName(i));
+   }
+
+   std::vector<Double_t> *v = 0;
+   chain.SetBranchAddress("v", &v);
+   Long64_t nvalues = 0;
+   for (Long64_t e = 0; e < chain.GetEntries(); ++e) {
+      if (chain.GetEntry(e) <= 0) {
+         Printf("testStreamerInfoRecords: FAILED to read the entry %lld of the chain", e);
+         return 1;
+      }
+      Int_t i = e % nentries;
+      if ((Int_t)v->size() != i % 5) {
+         Printf("testStreamerInfoRecords: FAILED, wrong size of the vector of entry %lld", e);
+         return 1;
+      }
+      for (auto x : *v)
+         if (x != i * 0.5) {
+            Printf("testStreamerInfoRecords: FAILED, wrong value in entry %lld", e);
+            return 1;
+         }
+      nvalues += v->size();
+   }
+   chain.ResetBranchAddresses();
+   delete v;
+
+   // The record of the last file was already known when it was opened: the
+   // classes it describes must still be written back when an object of a
+   // new class is added to the file.
+   {
+      TFile f(FileName(nfiles - 1), "UPDATE");
+      TH1F *h = (TH1F*)f.Get("h");
+      if (!h || h->GetEntries() != nentries) {
+         Printf("testStreamerInfoRecords: FAILED to read the histogram of %s", f.GetName());
+         return 1;
+      }
+      TObjString added("added");
+      added.Write("added");
+      delete h;
+   }
+   TFile f(FileName(nfiles - 1));
+   TList *list = f.GetStreamerInfoList();
+   const char *classes[] = { "TH1F", "TH1", "TTree", "TNamed", "TObjString" };
+   for (auto name : classes) {
+      if (!list || !list->FindObject(name)) {
+         Printf("testStreamerInfoRecords: FAILED, no StreamerInfo of %s in the updated file", name);
+         return 1;
+      }
+   }
+   delete list;
+   TObjString *added = (TObjString*)f.Get("added");
+   if (!added || added->GetString() != "added") {
+      Printf("testStreamerInfoRecords: FAILED to read back the object added to the updated file");
+      return 1;
+   }
+
+   Printf("Read %lld values from %d files with the same StreamerInfo record", nvalues, nfiles);
+   return 0;
+}
@@ -0,0 +1,126 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the parallel unzipping of the baskets by the tree
+// cache (see TTreeCacheUnzip): a tree with several clusters is read back
+// with the cache, sequentially and jumping from cluster to cluster, first
+// without and then with implicit multi-threading, and its values are
+// checked.
+//
+// Usage: testTreeCacheUnzip [nentries] [nthreads]
+//
+//   nentries - number of entries of the tree (default 100000)
+//   nthreads - number of threads of the implicit multi-threading (default 4)
+//
+
+#include <stdlib.h>
+
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeCacheUnzip.h"
+
+static const char *gFileName = "testTreeCacheUnzip.root";
+static const Int_t kNbranches = 4;
+
+////////////////////////////////////////////////////////////////////////////////
+/// Value of the branch 'b' at entry 'i'.
+
+Double_t Value(Int_t b, Long64_t i)
+{
+   return b * 1000.5 + (i % 1013) * 0.5;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the tree, with a cluster every 5000 entries.
+
+void WriteTree(Long64_t nentries)
+{
+   TFile f(gFileName, "RECREATE", "", 1);
+   TTree tree("T", "parallel unzipping");
+   tree.SetAutoFlush(5000);
+   Double_t values[kNbranches];
+   Int_t n = 0;
+   Int_t counts[10];
+   for (Int_t b = 0; b < kNbranches; ++b)
+      tree.Branch(TString::Format("x%d", b), &values[b], TString::Format("x%d/D", b), 8000);
+   tree.Branch("n", &n, "n/I", 8000);
+   tree.Branch("counts", counts, "counts[n]/I", 8000);
+   for (Long64_t i = 0; i < nentries; ++i) {
+      for (Int_t b = 0; b < kNbranches; ++b) values[b] = Value(b, i);
+      n = i % 10;
+      for (Int_t k = 0; k < n; ++k) counts[k] = i + k;
+      tree.Fill();
+   }
+   tree.Write();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the entries first, first+step, ... of the tree through the cache
+/// and check their values.
+
+Bool_t ReadTree(Long64_t nentries, Long64_t step)
+{
+   TFile f(gFileName);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || tree->GetEntries() != nentries) return kFALSE;
+   tree->SetCacheSize(10000000);
+   tree->AddBranchToCache("*", kTRUE);
+   Double_t values[kNbranches];
+   Int_t n = 0;
+   Int_t counts[10];
+   for (Int_t b = 0; b < kNbranches; ++b)
+      tree->SetBranchAddress(TString::Format("x%d", b), &values[b]);
+   tree->SetBranchAddress("n", &n);
+   tree->SetBranchAddress("counts", counts);
+   for (Long64_t i = 0; i < nentries; i += step) {
+      if (tree->GetEntry(i) <= 0) return kFALSE;
+      for (Int_t b = 0; b < kNbranches; ++b)
+         if (values[b] != Value(b, i)) return kFALSE;
+      if (n != i % 10) return kFALSE;
+      for (Int_t k = 0; k < n; ++k)
+         if (counts[k] != i + k) return kFALSE;
+   }
+   delete tree;
+   return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the tree sequentially and jumping over clusters.
+
+Bool_t ReadTree(Long64_t nentries, const char *mode)
+{
+   if (!ReadTree(nentries, 1)) {
+      Printf("testTreeCacheUnzip: FAILED to read back the tree sequentially %s", mode);
+      return kFALSE;
+   }
+   if (!ReadTree(nentries, 7919)) {
+      Printf("testTreeCacheUnzip: FAILED to read back the tree jumping over clusters %s", mode);
+      return kFALSE;
+   }
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Long64_t nentries = argc > 1 ? atoll(argv[1]) : 100000;
+   Int_t nthreads    = argc > 2 ? atoi(argv[2]) : 4;
+
+   WriteTree(nentries);
+
+#ifdef R__USE_IMT
+   TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::kForce);
+#endif
+   if (!ReadTree(nentries, "without implicit multi-threading")) return 1;
+
+#ifdef R__USE_IMT
+   ROOT::EnableImplicitMT(nthreads);
+   if (!ReadTree(nentries, "with implicit multi-threading")) return 1;
+   ROOT::DisableImplicitMT();
+#else
+   (void)nthreads;
+#endif
+
+   Printf("Read back %lld entries through the unzipping cache", nentries);
+   return 0;
+}
@@ -0,0 +1,94 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests TTreeProcessorMT: the trees of several files, each
+// with several clusters, are processed by a function filling a histogram,
+// and the merged histogram must hold all the entries. The trees read by
+// the worker threads must not use implicit multi-threading themselves.
+//
+// Usage: testTreeProcessorMT [nfiles] [nentries] [nthreads]
+//
+//   nfiles   - number of files (default 3)
+//   nentries - number of entries of the tree of each file (default 20000)
+//   nthreads - number of threads of the implicit multi-threading (default 4)
+//
+
+#include <atomic>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "TFile.h"
+#include "TH1F.h"
+#include "TROOT.h"
+#include "TTree.h"
+#include "TTreeProcessorMT.h"
+#include "TTreeReader.h"
+#include "TTreeReaderValue.h"
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the tree of one file, with a cluster every 1000 entries.
+
+void WriteTree(const std::string &name, Int_t nentries)
+{
+   TFile f(name.c_str(), "RECREATE");
+   TTree tree("events", "processed by several threads");
+   tree.SetAutoFlush(1000);
+   Float_t px = 0;
+   tree.Branch("px", &px, "px/F");
+   for (Int_t i = 0; i < nentries; ++i) {
+      px = i % 100;
+      tree.Fill();
+   }
+   tree.Write();
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nfiles   = argc > 1 ? atoi(argv[1]) : 3;
+   Int_t nentries = argc > 2 ? atoi(argv[2]) : 20000;
+   Int_t nthreads = argc > 3 ? atoi(argv[3]) : 4;
+
+   std::vector<std::string> fileNames;
+   for (Int_t i = 0; i < nfiles; ++i) {
+      fileNames.emplace_back(TString::Format("testTreeProcessorMT_%d.root", i).Data());
+      WriteTree(fileNames.back(), nentries);
+   }
+
+#ifdef R__USE_IMT
+   ROOT::EnableImplicitMT(nthreads);
+#else
+   (void)nthreads;
+#endif
+   std::atomic<Int_t> imtTrees(0);
+   TTreeProcessorMT tp(fileNames, "events");
+   TH1F *h = tp.Process([&imtTrees](TTreeReader &reader) {
+      if (reader.GetTree()->GetImplicitMT()) ++imtTrees;
+      TTreeReaderValue<Float_t> px(reader, "px");
+      TH1F *hist = new TH1F("px", "px", 100, 0, 100);
+      while (reader.Next()) hist->Fill(*px);
+      return hist;
+   });
+
+   if (!h) {
+      Printf("testTreeProcessorMT: FAILED, no result");
+      return 1;
+   }
+   Long64_t expected = Long64_t(nfiles) * nentries;
+   if (Long64_t(h->GetEntries()) != expected) {
+      Printf("testTreeProcessorMT: FAILED, %lld entries processed instead of %lld", Long64_t(h->GetEntries()), expected);
+      return 1;
+   }
+   if (h->GetBinContent(h->FindBin(50.5)) != expected / 100) {
+      Printf("testTreeProcessorMT: FAILED, wrong content of the merged histogram");
+      return 1;
+   }
+   if (imtTrees.load()) {
+      Printf("testTreeProcessorMT: FAILED, %d ranges read with implicit multi-threading enabled on the tree", imtTrees.load());
+      return 1;
+   }
+   delete h;
+
+   Printf("Processed %lld entries of %d files", expected, nfiles);
+   return 0;
+}
@@ -0,0 +1,125 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the writing of the std::vector of numbers held by a
+// class (see TStreamerInfo::AddWriteAction): objects of a class with
+// vectors of several types, including the ones written through the
+// collection proxy (bool, Double32_t), are written to a file, object-wise
+// and in an unsplit branch, and read back.
+//
+// Usage: testVectorWrite [nobjects]
+//
+//   nobjects - number of entries of the tree (default 1000)
+//
+
+#include <stdlib.h>
+#include <vector>
+
+#include "TClass.h"
+#include "TFile.h"
+#include "TInterpreter.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const char *gFileName = "testVectorWrite.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Access to the data member 'name' of an object of the class 'cl'.
+
+template <typename T>
+std::vector<T> &Member(TClass *cl, void *obj, const char *name)
+{
+   return *(std::vector<T>*)((char*)obj + cl->GetDataMemberOffset(name));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Set the content of the object number 'i'.
+
+void Fill(TClass *cl, void *obj, Int_t i)
+{
+   Member<Int_t>(cl, obj, "fInts").assign(i % 7, i);
+   Member<Double_t>(cl, obj, "fDoubles").assign(i % 5, i * 0.25);
+   Member<Short_t>(cl, obj, "fShorts").assign(i % 3, Short_t(-i));
+   Member<ULong64_t>(cl, obj, "fULongs").assign(i % 4, ULong64_t(i) << 40);
+   Member<Bool_t>(cl, obj, "fBools").assign(i % 6, i % 2);
+   Member<Double32_t>(cl, obj, "fDouble32s").assign(i % 2, i * 0.5);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Check the content of the object number 'i'.
+
+Bool_t Check(TClass *cl, void *obj, Int_t i)
+{
+   return Member<Int_t>(cl, obj, "fInts") == std::vector<Int_t>(i % 7, i)
+       && Member<Double_t>(cl, obj, "fDoubles") == std::vector<Double_t>(i % 5, i * 0.25)
+       && Member<Short_t>(cl, obj, "fShorts") == std::vector<Short_t>(i % 3, Short_t(-i))
+       && Member<ULong64_t>(cl, obj, "fULongs") == std::vector<ULong64_t>(i % 4, ULong64_t(i) << 40)
+       && Member<Bool_t>(cl, obj, "fBools") == std::vector<Bool_t>(i % 6, i % 2)
+       && Member<Double32_t>(cl, obj, "fDouble32s") == std::vector<Double32_t>(i % 2, i * 0.5);
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nobjects = argc > 1 ? atoi(argv[1]) : 1000;
+
+   gInterpreter->Declare("#include <vector>\n"
+                         "#include \"RtypesCore.h\"\n"
+                         "class VectorHolder {\n"
+                         "public:\n"
+                         "   std::vector<int> fInts;\n"
+                         "   std::vector<double> fDoubles;\n"
+                         "   std::vector<short> fShorts;\n"
+                         "   std::vector<unsigned long long> fULongs;\n"
+                         "   std::vector<bool> fBools;\n"
+                         "   std::vector<Double32_t> fDouble32s;\n"
+                         "};");
+   TClass *cl = TClass::GetClass("VectorHolder");
+   if (!cl) {
+      Printf("testVectorWrite: FAILED to declare the class");
+      return 1;
+   }
+
+   {
+      TFile f(gFileName, "RECREATE");
+      void *obj = cl->New();
+      Fill(cl, obj, nobjects - 1);
+      f.WriteObjectAny(obj, cl, "holder");
+      TTree tree("T", "vectors of numbers");
+      tree.Branch("holder", "VectorHolder", &obj, 32000, 0);
+      for (Int_t i = 0; i < nobjects; ++i) {
+         Fill(cl, obj, i);
+         tree.Fill();
+      }
+      tree.Write();
+      tree.ResetBranchAddresses();
+      cl->Destructor(obj);
+   }
+
+   TFile f(gFileName);
+   void *obj = f.GetObjectChecked("holder", cl);
+   if (!obj || !Check(cl, obj, nobjects - 1)) {
+      Printf("testVectorWrite: FAILED to read back the object");
+      return 1;
+   }
+   cl->Destructor(obj);
+
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || tree->GetEntries() != nobjects) {
+      Printf("testVectorWrite: FAILED to read back the tree");
+      return 1;
+   }
+   obj = cl->New();
+   tree->SetBranchAddress("holder", &obj);
+   for (Int_t i = 0; i < nobjects; ++i) {
+      if (tree->GetEntry(i) <= 0 || !Check(cl, obj, i)) {
+         Printf("testVectorWrite: FAILED to read back the entry %d of the tree", i);
+         return 1;
+      }
+   }
+   tree->ResetBranchAddresses();
+   cl->Destructor(obj);
+   delete tree;
+
+   Printf("Wrote and read back the vectors of %d objects", nobjects);
+   return 0;
+}
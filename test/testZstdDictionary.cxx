@@ -0,0 +1,138 @@
+// @(#)root/test:$Id$
+
+//
+// This program tests the trained compression dictionaries of the branches
+// (see TTree::SetCompressionDictionary): a tree with small ZSTD compressed
+// baskets is written with a dictionary and read back, then the same tree is
+// filled by several threads through TBufferMerger, whose sub-files are reset
+// after each merge, and the merged tree is read back.
+//
+// Usage: testZstdDictionary [nentries] [nthreads]
+//
+//   nentries - number of entries of the tree (default 20000)
+//   nthreads - number of threads filling the merged tree (default 2)
+//
+
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+
+#include "Compression.h"
+#include "TBufferMerger.h"
+#include "TFile.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+static const char *gFileName   = "testZstdDictionary.root";
+static const char *gMergedName = "testZstdDictionary_merged.root";
+
+////////////////////////////////////////////////////////////////////////////////
+/// Create the branches of the tree: small baskets, trained dictionary.
+
+void Branch(TTree &tree, Int_t &thread, Int_t &entry, Double_t &x)
+{
+   tree.Branch("thread", &thread, "thread/I", 1000);
+   tree.Branch("entry", &entry, "entry/I", 1000);
+   tree.Branch("x", &x, "x/D", 1000);
+   tree.SetCompressionDictionary("*", 4);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Value of the branch x at the entry of the thread.
+
+Double_t Value(Int_t thread, Int_t entry)
+{
+   return thread * 100000.5 + (entry % 113) * 0.125;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Fill the tree of one thread of the merger, handing the entries over
+/// every 'nflush' entries.
+
+void Fill(TBufferMerger &merger, Int_t thread, Int_t nentries, Int_t nflush)
+{
+   auto f = merger.GetFile();
+   f->cd();
+   TTree t("T", "compression dictionary");
+   Int_t ithread = thread, ientry = 0;
+   Double_t x = 0;
+   Branch(t, ithread, ientry, x);
+   for (ientry = 0; ientry < nentries; ++ientry) {
+      x = Value(thread, ientry);
+      t.Fill();
+      if ((ientry + 1) % nflush == 0) f->Write();
+   }
+   f->Write();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the tree back and check its values; 'nthreads' threads filled
+/// 'nentries' entries each, in any order.
+
+Bool_t ReadTree(const char *name, Int_t nthreads, Int_t nentries)
+{
+   TFile f(name);
+   TTree *tree = (TTree*)f.Get("T");
+   if (!tree || tree->GetEntries() != Long64_t(nthreads) * nentries) return kFALSE;
+   // The dictionary records are not objects of the file.
+   if (f.GetListOfKeys()->GetSize() != 1) return kFALSE;
+   Int_t thread = 0, entry = 0;
+   Double_t x = 0;
+   tree->SetBranchAddress("thread", &thread);
+   tree->SetBranchAddress("entry", &entry);
+   tree->SetBranchAddress("x", &x);
+   std::vector<Int_t> next(nthreads, 0);
+   for (Long64_t i = 0; i < tree->GetEntries(); ++i) {
+      if (tree->GetEntry(i) <= 0) return kFALSE;
+      if (thread < 0 || thread >= nthreads || entry != next[thread]) return kFALSE;
+      if (x != Value(thread, entry)) return kFALSE;
+      ++next[thread];
+   }
+   delete tree;
+   return kTRUE;
+}
+
+int main(int argc, char **argv)
+{
+   Int_t nentries = argc > 1 ? atoi(argv[1]) : 20000;
+   Int_t nthreads = argc > 2 ? atoi(argv[2]) : 2;
+   Int_t compress = ROOT::CompressionSettings(ROOT::kZSTD, 5);
+
+   {
+      TFile f(gFileName, "RECREATE", "", compress);
+      TTree tree("T", "compression dictionary");
+      Int_t thread = 0, entry = 0;
+      Double_t x = 0;
+      Branch(tree, thread, entry, x);
+      for (entry = 0; entry < nentries; ++entry) {
+         x = Value(thread, entry);
+         tree.Fill();
+      }
+      tree.Write();
+   }
+   if (!ReadTree(gFileName, 1, nentries)) {
+      Printf("testZstdDictionary: FAILED to read back %s", gFileName);
+      return 1;
+   }
+
+   ROOT::EnableThreadSafety();
+   {
+      TBufferMerger merger(gMergedName, "RECREATE", compress);
+      if (merger.IsZombie()) {
+         Printf("testZstdDictionary: FAILED to open %s", gMergedName);
+         return 1;
+      }
+      std::vector<std::thread> threads;
+      for (Int_t i = 0; i < nthreads; ++i)
+         threads.emplace_back(Fill, std::ref(merger), i, nentries, nentries > 5 ? nentries / 5 : 1);
+      for (auto &t : threads)
+         t.join();
+   }
+   if (!ReadTree(gMergedName, nthreads, nentries)) {
+      Printf("testZstdDictionary: FAILED to read back %s", gMergedName);
+      return 1;
+   }
+
+   Printf("Wrote and read back %d entries with compression dictionaries", nentries);
+   return 0;
+}
@@ -60,6 +60,7 @@ protected:
    TBuffer    *fCompressedBufferRef; //! Compressed buffer.
    Bool_t      fOwnsCompressedBuffer; //! Whether or not we own the compressed buffer.
    Int_t       fLastWriteBufferSize; //! Size of the buffer last time we wrote it to disk
+   Int_t       fCompressedSize;  //! Size of the payload prepared by CompressBuffer, -1 if not prepared yet
 
 public:
 
@@ -69,6 +70,7 @@ public:
    virtual ~TBasket();
 
    virtual void    AdjustSize(Int_t newsize);
+           Int_t   CompressBuffer();
    virtual void    DeleteEntryOffset();
    virtual Int_t   DropBuffers();
    TBranch        *GetBranch() const {return fBranch;}
@@ -83,6 +85,7 @@ public:
    virtual void    PrepareBasket(Long64_t /* entry */) {};
            Int_t   ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file);
            Int_t   ReadBasketBytes(Long64_t pos, TFile *file);
+           Int_t   RecompressBuffer(TBranch *from, TBranch *to);
    virtual void    Reset();
 
            Int_t   LoadBasketBuffers(Long64_t pos, Int_t len, TFile *file, TTree *tree = 0);
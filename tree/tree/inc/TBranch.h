@@ -40,6 +40,9 @@
 #include "TDataType.h"
 #endif
 
+#include <atomic>
+#include <vector>
+
 class TTree;
 class TBasket;
 class TLeaf;
@@ -59,6 +62,7 @@ class TBranch : public TNamed , public TAttFill {
 
 protected:
    friend class TTreeCloner;
+   friend class TTree;
    // TBranch status bits
    enum EStatusBits {
       kAutoDelete = BIT(15),
@@ -100,6 +104,15 @@ protected:
    TBuffer    *fEntryBuffer;     //! Buffer used to directly pass the content without streaming
    TBuffer    *fTransientBuffer; //! Pointer to the current transient buffer.
    TList      *fBrowsables;      //! List of TVirtualBranchBrowsables used for Browse()
+   Long64_t    fCompressionDictSeek;   //  Address of the compression dictionary record on file (0 if none)
+   Int_t       fCompressionDictNbytes; //  Size of the compression dictionary record on file
+   Int_t       fCompressionDictTrain;  //! Number of baskets to collect before training the compression dictionary (0 if disabled)
+   Int_t       fCompressionDictRequest; //! Number of baskets requested with SetCompressionDictionary, used to train again after a Reset
+   std::vector<char>  fCompressionDict;            //! Compression dictionary (read on demand from fCompressionDictSeek)
+   std::atomic<Bool_t> fCompressionDictLoaded;    //! True once fCompressionDict holds the dictionary of fCompressionDictSeek
+   std::vector<char>  fCompressionDictSamples;     //! Basket payloads collected to train the compression dictionary
+   std::vector<Int_t> fCompressionDictSampleSizes; //! Size of each training sample
+   Int_t       fBasketFilter;    //  Pre-compression filter of the basket payload (see SetBasketFilter)
 
    Bool_t      fSkipZip;         //! After being read, the buffer will not be unzipped.
 
@@ -117,7 +130,12 @@ protected:
    void     Init(const char *name, const char *leaflist, Int_t compress);
 
    TBasket *GetFreshBasket();
+   void     AddCompressionDictSample(TBasket *basket);
    Int_t    WriteBasket(TBasket* basket, Int_t where);
+   Int_t    WriteBasketImpl(TBasket* basket, Int_t where);
+   Bool_t   WriteCompressionDict();
+   void     ResetCompressionDict();
+   void     ResetCompressionDictAfterMerge();
 
    TString  GetRealFileName() const;
 
@@ -127,6 +145,13 @@ private:
    TBranch& operator=(const TBranch&);  // not implemented
 
 public:
+   // Pre-compression filters of the basket payload (they can be combined)
+   enum EBasketFilter {
+      kNoFilter = 0,
+      kShuffle  = 1,  // Store together the bytes of same significance of the values
+      kDelta    = 2   // Store the difference with the previous value (integer leaves only)
+   };
+
    TBranch();
    TBranch(TTree *tree, const char *name, void *address, const char *leaflist, Int_t basketsize=32000, Int_t compress=-1);
    TBranch(TBranch *parent, const char *name, void *address, const char *leaflist, Int_t basketsize=32000, Int_t compress=-1);
@@ -149,14 +174,18 @@ public:
            Int_t    *GetBasketBytes() const {return fBasketBytes;}
            Long64_t *GetBasketEntry() const {return fBasketEntry;}
    virtual Long64_t  GetBasketSeek(Int_t basket) const;
+           Int_t     GetBasketFilter() const {return fBasketFilter;}
    virtual Int_t     GetBasketSize() const {return fBasketSize;}
    virtual TList    *GetBrowsables();
    virtual const char* GetClassName() const;
            Int_t     GetCompressionAlgorithm() const;
            Int_t     GetCompressionLevel() const;
            Int_t     GetCompressionSettings() const;
+   const char       *GetCompressionDict(Int_t &size);
    TDirectory       *GetDirectory() const {return fDirectory;}
    virtual Int_t     GetEntry(Long64_t entry=0, Int_t getall = 0);
+           Int_t     GetBulkEntries(Long64_t entry, TBuffer &user_buf);
+           Int_t     GetEntriesSerialized(Long64_t entry, TBuffer &user_buf);
    virtual Int_t     GetEntryExport(Long64_t entry, Int_t getall, TClonesArray *list, Int_t n);
            Int_t     GetEntryOffsetLen() const { return fEntryOffsetLen; }
            Int_t     GetEvent(Long64_t entry=0) {return GetEntry(entry);}
@@ -201,11 +230,13 @@ public:
    virtual void      SetAddress(void *add);
    virtual void      SetObject(void *objadd);
    virtual void      SetAutoDelete(Bool_t autodel=kTRUE);
+           Bool_t    SetBasketFilter(Int_t filter);
    virtual void      SetBasketSize(Int_t buffsize);
    virtual void      SetBufferAddress(TBuffer *entryBuffer);
    void              SetCompressionAlgorithm(Int_t algorithm=0);
    void              SetCompressionLevel(Int_t level=1);
    void              SetCompressionSettings(Int_t settings=1);
+   void              SetCompressionDictionary(Int_t nbaskets=10);
    virtual void      SetEntries(Long64_t entries);
    virtual void      SetEntryOffsetLen(Int_t len, Bool_t updateSubBranches = kFALSE);
    virtual void      SetFirstEntry( Long64_t entry );
@@ -221,7 +252,7 @@ public:
 
    static  void      ResetCount();
 
-   ClassDef(TBranch,12);  //Branch descriptor
+   ClassDef(TBranch,14);  //Branch descriptor
 };
 
 //______________________________________________________________________________
@@ -70,6 +70,9 @@
 #include "TVirtualTreePlayer.h"
 #endif
 
+#include <mutex>
+#include <vector>
+
 class TBranch;
 class TBrowser;
 class TFile;
@@ -152,6 +155,13 @@ protected:
    Bool_t         fIMTEnabled;        //! true if implicit multi-threading is enabled for this tree
    UInt_t         fNEntriesSinceSorting; //! Number of entries processed since the last re-sorting of branches
    std::vector<std::pair<Long64_t,TBranch*>> fSortedBranches; //! Branches sorted by average task time
+   Int_t          fParallelCompression; //! Maximum number of baskets compressed concurrently, 0 if parallel compression is disabled
+   Bool_t         fQueueBaskets;      //! true while the full baskets are queued for parallel compression
+   std::vector<std::pair<TBranch*,Int_t>> fPendingBaskets; //! Queued baskets (branch, basket number) waiting to be compressed and written
+   std::vector<TBuffer*> fBasketBufferPool; //! Buffers of the dropped baskets, kept for reuse by the next baskets
+   Long64_t       fBasketBufferPoolSize; //! Total size of the buffers in fBasketBufferPool
+   Long64_t       fMaxBasketBufferPoolSize; //! Maximum total size of the buffers kept in fBasketBufferPool
+   std::mutex     fBasketBufferPoolMutex; //! Protects the basket buffer pool against parallel TTree I/O
 
    static Int_t     fgBranchStyle;      //  Old/New branch style
    static Long64_t  fgMaxTreeSize;      //  Maximum size of a file containg a Tree
@@ -162,6 +172,8 @@ private:
 
    void             InitializeSortedBranches();
    void             SortBranchesByTime();
+   Bool_t           StartBasketQueue();
+   Int_t            WritePendingBaskets();
 
 protected:
    void             AddClone(TTree*);
@@ -296,6 +308,7 @@ public:
    TTree(const char* name, const char* title, Int_t splitlevel = 99);
    virtual ~TTree();
 
+           TBuffer*        AcquireBasketBuffer(Int_t size);
    virtual Int_t           AddBranchToCache(const char *bname, Bool_t subbranches = kFALSE);
    virtual Int_t           AddBranchToCache(TBranch *branch,   Bool_t subbranches = kFALSE);
    virtual Int_t           DropBranchFromCache(const char *bname, Bool_t subbranches = kFALSE);
@@ -426,11 +439,13 @@ public:
    virtual Double_t        GetMaximum(const char* columname);
    static  Long64_t        GetMaxTreeSize();
    virtual Long64_t        GetMaxVirtualSize() const { return fMaxVirtualSize; }
+           Long64_t        GetMaxBasketBufferPoolSize() const { return fMaxBasketBufferPoolSize; }
    virtual Double_t        GetMinimum(const char* columname);
    virtual Int_t           GetNbranches() { return fBranches.GetEntriesFast(); }
    TObject                *GetNotify() const { return fNotify; }
    TVirtualTreePlayer     *GetPlayer();
    virtual Int_t           GetPacketSize() const { return fPacketSize; }
+   virtual Int_t           GetParallelCompression() const { return fParallelCompression; }
    virtual TVirtualPerfStats *GetPerfStats() const { return fPerfStats; }
    virtual Long64_t        GetReadEntry()  const { return fReadEntry; }
    virtual Long64_t        GetReadEvent()  const { return fReadEntry; }
@@ -496,10 +511,12 @@ public:
 #endif
    virtual Long64_t        Project(const char* hname, const char* varexp, const char* selection = "", Option_t* option = "", Long64_t nentries = kMaxEntries, Long64_t firstentry = 0);
    virtual TSQLResult     *Query(const char* varexp = "", const char* selection = "", Option_t* option = "", Long64_t nentries = kMaxEntries, Long64_t firstentry = 0);
+           Bool_t          QueueBasket(TBranch *branch, Int_t where);
    virtual Long64_t        ReadFile(const char* filename, const char* branchDescriptor = "", char delimiter = ' ');
    virtual Long64_t        ReadStream(std::istream& inputStream, const char* branchDescriptor = "", char delimiter = ' ');
    virtual void            Refresh();
    virtual void            RecursiveRemove(TObject *obj);
+           void            ReleaseBasketBuffer(TBuffer *buffer);
    virtual void            RemoveFriend(TTree*);
    virtual void            Reset(Option_t* option = "");
    virtual void            ResetAfterMerge(TFileMergeInfo *);
@@ -509,6 +526,7 @@ public:
    virtual Bool_t          SetAlias(const char* aliasName, const char* aliasFormula);
    virtual void            SetAutoSave(Long64_t autos = -300000000);
    virtual void            SetAutoFlush(Long64_t autof = -30000000);
+   virtual void            SetBasketFilter(const char* bname, Int_t filter);
    virtual void            SetBasketSize(const char* bname, Int_t buffsize = 16000);
 #if !defined(__CINT__)
    virtual Int_t           SetBranchAddress(const char *bname,void *add, TBranch **ptr = 0);
@@ -539,6 +557,7 @@ public:
    virtual void            SetChainOffset(Long64_t offset = 0) { fChainOffset=offset; }
    virtual void            SetCircular(Long64_t maxEntries);
    virtual void            SetColor(Color_t mcolor=1) { SetLineColor(mcolor); SetMarkerColor(mcolor); }
+   virtual void            SetCompressionDictionary(const char* bname, Int_t nbaskets = 10);
    virtual void            SetDebug(Int_t level = 1, Long64_t min = 0, Long64_t max = 9999999); // *MENU*
    virtual void            SetDefaultEntryOffsetLen(Int_t newdefault, Bool_t updateExisting = kFALSE);
    virtual void            SetDirectory(TDirectory* dir);
@@ -552,9 +571,11 @@ public:
    virtual void            SetMaxEntryLoop(Long64_t maxev = kMaxEntries) { fMaxEntryLoop = maxev; } // *MENU*
    static  void            SetMaxTreeSize(Long64_t maxsize = 1900000000);
    virtual void            SetMaxVirtualSize(Long64_t size = 0) { fMaxVirtualSize = size; } // *MENU*
+           void            SetMaxBasketBufferPoolSize(Long64_t size = 16000000);
    virtual void            SetName(const char* name); // *MENU*
    virtual void            SetNotify(TObject* obj) { fNotify = obj; }
    virtual void            SetObject(const char* name, const char* title);
+   virtual void            SetParallelCompression(Int_t nthreads);
    virtual void            SetParallelUnzip(Bool_t opt=kTRUE, Float_t RelSize=-1);
    virtual void            SetPerfStats(TVirtualPerfStats* perf);
    virtual void            SetScanField(Int_t n = 50) { fScanField = n; } // *MENU*
@@ -45,6 +45,7 @@ class TTreeCloner {
    TTree     *fFromTree;
    TTree     *fToTree;
    Option_t  *fMethod;
+   Bool_t     fRecompress;       //True if the baskets may be recompressed to the compression settings of the output branches.
    TObjArray  fFromBranches;
    TObjArray  fToBranches;
 
@@ -106,6 +107,7 @@ public:
    UInt_t CollectBranches(TObjArray *from, TObjArray *to);
    UInt_t CollectBranches();
    void   CollectBaskets();
+   void   CopyCompressionDicts();
    void   CopyMemoryBaskets();
    void   CopyStreamerInfos();
    void   CopyProcessIds();
@@ -114,7 +116,8 @@ public:
    Bool_t IsValid() { return fIsValid; }
    Bool_t NeedConversion() { return fNeedConversion; }
    void   SortBaskets();
-   void   WriteBaskets();
+   Bool_t WriteBaskets();
+   Bool_t WriteBasketsRecompress();
 
    ClassDef(TTreeCloner,0); // helper used for the fast cloning of TTrees.
 };
@@ -13,6 +13,7 @@
 #include "TBufferFile.h"
 #include "TTree.h"
 #include "TBranch.h"
+#include "TLeaf.h"
 #include "TFile.h"
 #include "TBufferFile.h"
 #include "TMath.h"
@@ -23,6 +24,8 @@
 #include "TTimeStamp.h"
 #include "RZip.h"
 
+#include <vector>
+
 // TODO: Copied from TBranch.cxx
 #if (__GNUC__ >= 3) || defined(__INTEL_COMPILER)
 #if !defined(R__unlikely)
@@ -50,7 +53,7 @@ See picture in TTree.
 ////////////////////////////////////////////////////////////////////////////////
 /// Default contructor.
 
-TBasket::TBasket() : fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0)
+TBasket::TBasket() : fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0), fCompressedSize(-1)
 {
    fDisplacement  = 0;
    fEntryOffset   = 0;
@@ -67,7 +70,7 @@ TBasket::TBasket() : fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLa
 ////////////////////////////////////////////////////////////////////////////////
 /// Constructor used during reading.
 
-TBasket::TBasket(TDirectory *motherDir) : TKey(motherDir),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0)
+TBasket::TBasket(TDirectory *motherDir) : TKey(motherDir),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0), fCompressedSize(-1)
 {
    fDisplacement  = 0;
    fEntryOffset   = 0;
@@ -85,7 +88,7 @@ TBasket::TBasket(TDirectory *motherDir) : TKey(motherDir),fCompressedBufferRef(0
 /// Basket normal constructor, used during writing.
 
 TBasket::TBasket(const char *name, const char *title, TBranch *branch) :
-   TKey(branch->GetDirectory()),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0)
+   TKey(branch->GetDirectory()),fCompressedBufferRef(0), fOwnsCompressedBuffer(kFALSE), fLastWriteBufferSize(0), fCompressedSize(-1)
 {
    SetName(name);
    SetTitle(title);
@@ -96,7 +99,12 @@ TBasket::TBasket(const char *name, const char *title, TBranch *branch) :
    fEntryOffset = 0;
    fDisplacement= 0;
    fBuffer      = 0;
-   fBufferRef   = new TBufferFile(TBuffer::kWrite, fBufferSize);
+   if (branch->GetTree()) {
+      // Reuse the buffer of a dropped basket if the tree has one.
+      fBufferRef = branch->GetTree()->AcquireBasketBuffer(fBufferSize);
+   } else {
+      fBufferRef = new TBufferFile(TBuffer::kWrite, fBufferSize);
+   }
    fVersion    += 1000;
    if (branch->GetDirectory()) {
       TFile *file = branch->GetFile();
@@ -194,21 +202,28 @@ void TBasket::DeleteEntryOffset()
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Drop buffers of this basket if it is not the current basket.
+/// The uncompressed buffer goes back to the pool of the tree, to be used
+/// by the next basket (see TTree::AcquireBasketBuffer); a basket without a
+/// branch (or tree) simply deletes it.
 
 Int_t TBasket::DropBuffers()
 {
    if (!fBuffer && !fBufferRef) return 0;
 
+   TTree *tree = fBranch ? fBranch->GetTree() : 0;
    if (fDisplacement) delete [] fDisplacement;
    if (fEntryOffset)  delete [] fEntryOffset;
-   if (fBufferRef)    delete fBufferRef;
+   if (fBufferRef) {
+      if (tree) tree->ReleaseBasketBuffer(fBufferRef);
+      else      delete fBufferRef;
+   }
    if (fCompressedBufferRef && fOwnsCompressedBuffer) delete fCompressedBufferRef;
    fBufferRef   = 0;
    fCompressedBufferRef = 0;
    fBuffer      = 0;
    fDisplacement= 0;
    fEntryOffset = 0;
-   fBranch->GetTree()->IncrementTotalBuffers(-fBufferSize);
+   if (tree) tree->IncrementTotalBuffers(-fBufferSize);
    return fBufferSize;
 }
 
@@ -399,7 +414,11 @@ static inline TBuffer* R__InitializeReadBasketBuffer(TBuffer* bufferRef, Int_t l
    if (R__likely(bufferRef)) {
       bufferRef->SetReadMode();
       Int_t curBufferSize = bufferRef->BufferSize();
-      if (curBufferSize < len) {
+      if (R__unlikely(!bufferRef->TestBit(TBuffer::kIsOwner))) {
+         // The buffer was pointing into a memory mapped file (or a cache),
+         // get our own memory back.
+         bufferRef->SetBuffer(new char[len], len, kTRUE);
+      } else if (curBufferSize < len) {
          // Experience shows that giving 5% "wiggle-room" decreases churn.
          bufferRef->Expand(Int_t(len*1.05));
       }
@@ -447,6 +466,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
 
    Bool_t oldCase;
    char *rawUncompressedBuffer, *rawCompressedBuffer;
+   char *mapped = nullptr;
    Int_t uncompressedBufferLen;
 
    // See if the cache has already unzipped the buffer for us.
@@ -458,7 +478,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
    if (pf) {
       Int_t res = -1;
       Bool_t free = kTRUE;
-      char *buffer;
+      char *buffer = nullptr;
       res = pf->GetUnzipBuffer(&buffer, pos, len, &free);
       if (R__unlikely(res >= 0)) {
          len = ReadBasketBuffersUnzip(buffer, res, free, file);
@@ -472,6 +492,29 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
    // Determine which buffer to use, so that we can avoid a memcpy in case of
    // the basket was not compressed.
    TBuffer* readBufferRef;
+
+   // A memory mapped file (see TFile option "mmap=1") serves the basket in
+   // place: an uncompressed basket is used directly from the mapping and a
+   // compressed one is unzipped from it.
+   if (file->IsMapped() && file->GetVersion() > 30401) {
+      R__LOCKGUARD_IMT2(gROOTMutex); // Lock for parallel TTree I/O
+      mapped = file->GetMappedBuffer(pos, len);
+   }
+   if (mapped) {
+      fBranch->GetTree()->IncrementTotalBuffers(-fBufferSize);
+      if (fBufferRef) {
+         // Switch to read mode first: in write mode SetBuffer keeps
+         // kExtraSpace bytes of the mapping out of the buffer size.
+         fBufferRef->SetReadMode();
+         fBufferRef->SetBuffer(mapped, len, kFALSE);
+         fBufferRef->Reset();
+      } else {
+         fBufferRef = new TBufferFile(TBuffer::kRead, len, mapped, kFALSE);
+      }
+      fBufferRef->SetParent(file);
+      readBufferRef = fBufferRef;
+      goto AfterRead;
+   }
    if (R__unlikely(fBranch->GetCompressionLevel()==0)) {
       readBufferRef = fBufferRef;
    } else {
@@ -526,6 +569,8 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
       }
       else gPerfStats = temp;
    }
+
+AfterRead:
    Streamer(*readBufferRef);
    if (IsZombie()) {
       return 1;
@@ -538,7 +583,11 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
    {
       if (R__likely(fObjlen+fKeylen == fNbytes)) {
          // The basket was really not compressed as expected.
+         fBuffer = rawCompressedBuffer;
          goto AfterBuffer;
+      } else if (mapped) {
+         // The compressed data stays in the mapping, unzip from there into
+         // a buffer of our own (see R__InitializeReadBasketBuffer).
       } else {
          // Well, somehow the buffer was compressed anyway, we have the compressed data in the uncompressed buffer
          // Make sure the compressed buffer is initialized, and memcpy.
@@ -580,6 +629,15 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
       UChar_t *rawCompressedObjectBuffer = (UChar_t*)rawCompressedBuffer+fKeylen;
       Int_t nin, nbuf;
       Int_t nout = 0, noutot = 0, nintot = 0;
+      Int_t dictsize = 0;
+      const char *dict = fBranch->GetCompressionDict(dictsize);
+
+      // The values might have been filtered before compression (see TBranch::SetBasketFilter)
+      Int_t filter = 0, elemsize = 0, filtersize = 0;
+      if (R__filter_header(rawCompressedObjectBuffer, &filter, &elemsize, &filtersize) == 0) {
+         rawCompressedObjectBuffer += kFilterHeaderSize;
+         nintot += kFilterHeaderSize;
+      }
 
       // Unzip all the compressed objects in the compressed object buffer.
       while (1) {
@@ -594,7 +652,7 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
             goto AfterBuffer;
          }
 
-         R__unzip(&nin, rawCompressedObjectBuffer, &nbuf, (unsigned char*) rawUncompressedObjectBuffer, &nout);
+         R__unzipWithDict(&nin, rawCompressedObjectBuffer, &nbuf, (unsigned char*) rawUncompressedObjectBuffer, &nout, dict, dictsize);
          if (!nout) break;
          noutot += nout;
          nintot += nin;
@@ -609,6 +667,14 @@ Int_t TBasket::ReadBasketBuffers(Long64_t pos, Int_t len, TFile *file)
          fBranch->GetTree()->IncrementTotalBuffers(fBufferSize);
          return 1;
       }
+      if (filter) {
+         std::vector<char> filtered(rawUncompressedBuffer+fKeylen, rawUncompressedBuffer+fKeylen+TMath::Min(filtersize, fObjlen));
+         if (R__unlikely(filtersize > fObjlen || !R__unfilter(filter, elemsize, filtersize, filtered.data(), rawUncompressedBuffer+fKeylen))) {
+            Error("ReadBasketBuffers", "Unknown or inconsistent basket filter (filter=%d, elemsize=%d, size=%d, fObjlen=%d)", filter, elemsize, filtersize, fObjlen);
+            fBranch->GetTree()->IncrementTotalBuffers(fBufferSize);
+            return 1;
+         }
+      }
       len = fObjlen+fKeylen;
       TVirtualPerfStats* temp = gPerfStats;
       if (fBranch->GetTree()->GetPerfStats() != 0) gPerfStats = fBranch->GetTree()->GetPerfStats();
@@ -653,6 +719,118 @@ AfterBuffer:
    return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Convert the on-file basket loaded by LoadBasketBuffers from the
+/// compression of the branch 'from' to the compression of the branch 'to'.
+///
+/// The payload is decompressed (with the dictionary of 'from', if any) and
+/// compressed again with the settings, filter and dictionary of 'to'; the
+/// objects are not unstreamed. The key header is rewritten by CopyTo.
+/// This function is called by TTreeCloner, possibly concurrently for
+/// different baskets; the dictionaries must have been loaded beforehand.
+/// Returns the new number of bytes after the key, or -1 in case of error.
+
+Int_t TBasket::RecompressBuffer(TBranch *from, TBranch *to)
+{
+   if (!fBufferRef || fObjlen <= 0) return -1;
+
+   // Retrieve the uncompressed (and unfiltered) payload.
+   std::vector<char> objbuf(fObjlen);
+   Int_t nbytes = fNbytes - fKeylen;
+   UChar_t *src = (UChar_t*)fBufferRef->Buffer() + fKeylen;
+   if (fObjlen > nbytes) {
+      Int_t dictsize = 0;
+      const char *dict = from->GetCompressionDict(dictsize);
+      Int_t filter = 0, elemsize = 0, filtersize = 0;
+      if (R__filter_header(src, &filter, &elemsize, &filtersize) == 0) {
+         src += kFilterHeaderSize;
+      }
+      Int_t nin, nbuf, nout = 0, noutot = 0;
+      while (noutot < fObjlen) {
+         if (R__unzip_header(&nin, src, &nbuf) != 0) break;
+         if (nbuf > fObjlen - noutot) break;
+         R__unzipWithDict(&nin, src, &nbuf, (UChar_t*)&objbuf[noutot], &nout, dict, dictsize);
+         if (!nout) break;
+         noutot += nout;
+         src += nin;
+      }
+      if (noutot != fObjlen) {
+         Error("RecompressBuffer", "Inconsistent basket of branch %s (fNbytes=%d, fKeylen=%d, fObjlen=%d, noutot=%d)",
+               from->GetName(), fNbytes, fKeylen, fObjlen, noutot);
+         return -1;
+      }
+      if (filter) {
+         std::vector<char> filtered(objbuf.begin(), objbuf.begin() + TMath::Min(filtersize, fObjlen));
+         if (filtersize > fObjlen || !R__unfilter(filter, elemsize, filtersize, filtered.data(), &objbuf[0])) {
+            Error("RecompressBuffer", "Unknown or inconsistent basket filter (filter=%d, elemsize=%d, size=%d, fObjlen=%d)",
+                  filter, elemsize, filtersize, fObjlen);
+            return -1;
+         }
+      }
+   } else {
+      memcpy(&objbuf[0], src, fObjlen);
+   }
+
+   // Compress it again as CompressBuffer would do for the branch 'to'.
+   std::vector<char> zipbuf;
+   const char *payload = &objbuf[0];
+   Int_t nout = fObjlen;
+   Int_t cxlevel = to->GetCompressionLevel();
+   if (cxlevel > 0) {
+      Int_t cxAlgorithm = to->GetCompressionAlgorithm();
+      Int_t dictsize = 0;
+      const char *dict = to->GetCompressionDict(dictsize);
+      Int_t nbuffers = 1 + (fObjlen - 1) / kMAXZIPBUF;
+      zipbuf.resize(fObjlen + 9 * nbuffers + kFilterHeaderSize);
+      char *objcur = &objbuf[0];
+      char *bufcur = &zipbuf[0];
+      Int_t noutot = 0;
+      std::vector<char> filtered;
+      Int_t filter = to->GetBasketFilter();
+      // As in CompressBuffer, only a branch with a single leaf is filtered.
+      if (filter && fLast > fKeylen && to->GetNleaves() == 1) {
+         Int_t elemsize = ((TLeaf*)to->GetListOfLeaves()->UncheckedAt(0))->GetLenType();
+         Int_t datalen = fLast - fKeylen;
+         filtered.resize(fObjlen);
+         if (R__filter(filter, elemsize, datalen, objcur, &filtered[0])) {
+            memcpy(&filtered[datalen], objcur + datalen, fObjlen - datalen);
+            objcur = &filtered[0];
+            R__filter_write_header(filter, elemsize, datalen, (UChar_t*)bufcur);
+            bufcur += kFilterHeaderSize;
+            noutot += kFilterHeaderSize;
+         }
+      }
+      Int_t nzip = 0, bufmax, nzout;
+      for (Int_t i = 0; i < nbuffers; ++i) {
+         if (i == nbuffers - 1) bufmax = fObjlen - nzip;
+         else bufmax = kMAXZIPBUF;
+         R__zipMultipleAlgorithmWithDict(cxlevel, &bufmax, objcur, &bufmax, bufcur, &nzout, cxAlgorithm, dict, dictsize);
+         // As in CompressBuffer, keep the buffer uncompressed if compressing does not pay off.
+         if (nzout == 0 || noutot + nzout >= fObjlen) {
+            noutot = fObjlen;
+            break;
+         }
+         bufcur += nzout;
+         noutot += nzout;
+         objcur += kMAXZIPBUF;
+         nzip   += kMAXZIPBUF;
+      }
+      if (noutot < fObjlen) {
+         payload = &zipbuf[0];
+         nout = noutot;
+      }
+   }
+
+   // Replace the payload that follows the key.
+   fBufferRef->SetWriteMode();
+   if (fBufferRef->BufferSize() < fKeylen + nout) {
+      fBufferRef->Expand(fKeylen + nout);
+   }
+   memcpy(fBufferRef->Buffer() + fKeylen, payload, nout);
+   fNbytes = fKeylen + nout;
+   return nout;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read basket buffers in memory and cleanup
 ///
@@ -927,44 +1105,24 @@ void TBasket::Update(Int_t offset, Int_t skipped)
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// Write buffer of this basket on the current file.
+/// Append the entry offsets to the basket buffer and compress it.
 ///
-/// The function returns the number of bytes committed to the memory.
-/// If a write error occurs, the number of bytes returned is -1.
-/// If no data are written, the number of bytes returned is 0.
-
-Int_t TBasket::WriteBuffer()
+/// This is the part of WriteBuffer which does not modify the file: it may
+/// be run concurrently for baskets of different branches (see
+/// TTree::SetParallelCompression). The following call to WriteBuffer then
+/// only allocates the key and writes the prepared buffer.
+/// Returns the number of bytes to be written after the key, or -1 in case
+/// of error, in which case the basket buffer is left as it was so that
+/// CompressBuffer can be called again.
+
+Int_t TBasket::CompressBuffer()
 {
    const Int_t kWrite = 1;
 
-   TFile *file = fBranch->GetFile(kWrite);
-   if (!file) return 0;
-   if (!file->IsWritable()) {
-      return -1;
-   }
-   fMotherDir = file; // fBranch->GetDirectory();
-
-   if (R__unlikely(fBufferRef->TestBit(TBufferFile::kNotDecompressed))) {
-      // Read the basket information that was saved inside the buffer.
-      Bool_t writing = fBufferRef->IsWriting();
-      fBufferRef->SetReadMode();
-      fBufferRef->SetBufferOffset(0);
+   if (fCompressedSize >= 0) return fCompressedSize;
 
-      Streamer(*fBufferRef);
-      if (writing) fBufferRef->SetWriteMode();
-      Int_t nout = fNbytes - fKeylen;
-
-      fBuffer = fBufferRef->Buffer();
-
-      Create(nout,file);
-      fBufferRef->SetBufferOffset(0);
-      fHeaderOnly = kTRUE;
-
-      Streamer(*fBufferRef);         //write key itself again
-      int nBytes = WriteFileKeepBuffer();
-      fHeaderOnly = kFALSE;
-      return nBytes>0 ? fKeylen+nout : -1;
-   }
+   TFile *file = fBranch->GetFile(kWrite);
+   if (!file) return -1;
 
    // Transfer fEntryOffset table at the end of fBuffer.
    fLast = fBufferRef->Length();
@@ -979,7 +1137,6 @@ Int_t TBasket::WriteBuffer()
       fBufferRef->WriteArray(fEntryOffset,fNevBuf+1);
       if (fDisplacement) {
          fBufferRef->WriteArray(fDisplacement,fNevBuf+1);
-         delete [] fDisplacement; fDisplacement = 0;
       }
    }
 
@@ -991,12 +1148,16 @@ Int_t TBasket::WriteBuffer()
    fCycle = fBranch->GetWriteBasket();
    Int_t cxlevel = fBranch->GetCompressionLevel();
    Int_t cxAlgorithm = fBranch->GetCompressionAlgorithm();
+   Int_t dictsize = 0;
+   const char *dict = fBranch->GetCompressionDict(dictsize);
    if (cxlevel > 0) {
       Int_t nbuffers = 1 + (fObjlen - 1) / kMAXZIPBUF;
-      Int_t buflen = fKeylen + fObjlen + 9 * nbuffers + 28; //add 28 bytes in case object is placed in a deleted gap
+      Int_t buflen = fKeylen + fObjlen + 9 * nbuffers + kFilterHeaderSize + 28; //add 28 bytes in case object is placed in a deleted gap
       InitializeCompressedBuffer(buflen, file);
       if (!fCompressedBufferRef) {
-         Warning("WriteBuffer", "Unable to allocate the compressed buffer");
+         Warning("CompressBuffer", "Unable to allocate the compressed buffer");
+         // Remove the entry offsets again, a later call appends them anew.
+         fBufferRef->SetBufferOffset(fLast);
          return -1;
       }
       fCompressedBufferRef->SetWriteMode();
@@ -1005,29 +1166,48 @@ Int_t TBasket::WriteBuffer()
       char *bufcur = &fBuffer[fKeylen];
       noutot = 0;
       nzip   = 0;
+
+      // Apply the pre-compression filter to the values (not to the entry
+      // offsets which follow them). The filtered copy is compressed instead
+      // of the original buffer, which is still written as is if compressing
+      // does not pay off.
+      std::vector<char> filtered;
+      Int_t filter = fBranch->GetBasketFilter();
+      // SetBasketFilter only accepts a branch with a single leaf, but the
+      // filter of a branch read from a file was not checked.
+      if (filter && fLast > fKeylen && fBranch->GetNleaves() == 1) {
+         Int_t elemsize = ((TLeaf*)fBranch->GetListOfLeaves()->UncheckedAt(0))->GetLenType();
+         Int_t datalen = fLast - fKeylen;
+         filtered.resize(fObjlen);
+         if (R__filter(filter, elemsize, datalen, objbuf, &filtered[0])) {
+            memcpy(&filtered[datalen], objbuf + datalen, fObjlen - datalen);
+            objbuf = &filtered[0];
+            R__filter_write_header(filter, elemsize, datalen, (unsigned char*)bufcur);
+            bufcur += kFilterHeaderSize;
+            noutot += kFilterHeaderSize;
+         }
+      }
       for (Int_t i = 0; i < nbuffers; ++i) {
          if (i == nbuffers - 1) bufmax = fObjlen - nzip;
          else bufmax = kMAXZIPBUF;
          //compress the buffer
-         R__zipMultipleAlgorithm(cxlevel, &bufmax, objbuf, &bufmax, bufcur, &nout, cxAlgorithm);
+         R__zipMultipleAlgorithmWithDict(cxlevel, &bufmax, objbuf, &bufmax, bufcur, &nout, cxAlgorithm, dict, dictsize);
 
          // test if buffer has really been compressed. In case of small buffers
          // when the buffer contains random data, it may happen that the compressed
          // buffer is larger than the input. In this case, we write the original uncompressed buffer
-         if (nout == 0 || nout >= fObjlen) {
+         if (nout == 0 || noutot + nout >= fObjlen) {
             nout = fObjlen;
             // We used to delete fBuffer here, we no longer want to since
             // the buffer (held by fCompressedBufferRef) might be re-used later.
             fBuffer = fBufferRef->Buffer();
-            Create(fObjlen,file);
-            fBufferRef->SetBufferOffset(0);
-
-            Streamer(*fBufferRef);         //write key itself again
             if ((nout+fKeylen)>buflen) {
-               Warning("WriteBuffer","Possible memory corruption due to compression algorithm, wrote %d bytes past the end of a block of %d bytes. fNbytes=%d, fObjLen=%d, fKeylen=%d",
+               Warning("CompressBuffer","Possible memory corruption due to compression algorithm, wrote %d bytes past the end of a block of %d bytes. fNbytes=%d, fObjLen=%d, fKeylen=%d",
                   (nout+fKeylen-buflen),buflen,fNbytes,fObjlen,fKeylen);
             }
-            goto WriteFile;
+            delete [] fDisplacement; fDisplacement = 0;
+            fCompressedSize = nout;
+            return nout;
          }
          bufcur += nout;
          noutot += nout;
@@ -1035,21 +1215,70 @@ Int_t TBasket::WriteBuffer()
          nzip   += kMAXZIPBUF;
       }
       nout = noutot;
-      Create(noutot,file);
+   } else {
+      fBuffer = fBufferRef->Buffer();
+      nout = fObjlen;
+   }
+
+   delete [] fDisplacement; fDisplacement = 0;
+   fCompressedSize = nout;
+   return nout;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write buffer of this basket on the current file.
+///
+/// The function returns the number of bytes committed to the memory.
+/// If a write error occurs, the number of bytes returned is -1.
+/// If no data are written, the number of bytes returned is 0.
+
+Int_t TBasket::WriteBuffer()
+{
+   const Int_t kWrite = 1;
+
+   TFile *file = fBranch->GetFile(kWrite);
+   if (!file) return 0;
+   if (!file->IsWritable()) {
+      return -1;
+   }
+   fMotherDir = file; // fBranch->GetDirectory();
+
+   if (R__unlikely(fBufferRef->TestBit(TBufferFile::kNotDecompressed))) {
+      // Read the basket information that was saved inside the buffer.
+      Bool_t writing = fBufferRef->IsWriting();
+      fBufferRef->SetReadMode();
       fBufferRef->SetBufferOffset(0);
 
-      Streamer(*fBufferRef);         //write key itself again
-      memcpy(fBuffer,fBufferRef->Buffer(),fKeylen);
-   } else {
+      Streamer(*fBufferRef);
+      if (writing) fBufferRef->SetWriteMode();
+      Int_t nout = fNbytes - fKeylen;
+
       fBuffer = fBufferRef->Buffer();
-      Create(fObjlen,file);
+
+      Create(nout,file);
       fBufferRef->SetBufferOffset(0);
+      fHeaderOnly = kTRUE;
 
       Streamer(*fBufferRef);         //write key itself again
-      nout = fObjlen;
+      int nBytes = WriteFileKeepBuffer();
+      fHeaderOnly = kFALSE;
+      return nBytes>0 ? fKeylen+nout : -1;
+   }
+
+   Int_t nout = CompressBuffer();
+   fCompressedSize = -1;
+   if (nout < 0) {
+      return -1;
+   }
+
+   Create(nout,file);
+   fBufferRef->SetBufferOffset(0);
+
+   Streamer(*fBufferRef);         //write key itself again
+   if (fBuffer != fBufferRef->Buffer()) {
+      memcpy(fBuffer,fBufferRef->Buffer(),fKeylen);
    }
 
-WriteFile:
    Int_t nBytes = WriteFileKeepBuffer();
    fHeaderOnly = kFALSE;
    return nBytes>0 ? fKeylen+nout : -1;
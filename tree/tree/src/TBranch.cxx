@@ -14,6 +14,7 @@
 #include "Compression.h"
 #include "TBasket.h"
 #include "TBranchBrowsable.h"
+#include "TKey.h"
 #include "TBrowser.h"
 #include "TBuffer.h"
 #include "TClass.h"
@@ -39,6 +40,7 @@
 #include "TTreeCacheUnzip.h"
 #include "TVirtualMutex.h"
 #include "TVirtualPad.h"
+#include "RZip.h"
 
 #include <atomic>
 #include <cstddef>
@@ -59,6 +61,29 @@ Int_t TBranch::fgCount = 0;
   #define R__likely(expr) expr
 #endif
 
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+/// Key of the record holding the compression dictionary of a branch (see
+/// TBranch::WriteCompressionDict). The record is not an object of the file:
+/// its class name "TBranchCompressionDict" tells TFile::Map and
+/// TFile::Recover to skip it.
+
+class TCompressionDictKey : public TKey {
+public:
+   TCompressionDictKey(const char *name, Int_t nbytes, TDirectory *motherDir) : TKey(motherDir)
+   {
+      SetName(name);
+      SetTitle("compression dictionary");
+      Build(motherDir, "TBranchCompressionDict", -1);
+      fKeylen = Sizeof();
+      fObjlen = nbytes;
+      Create(nbytes);
+   }
+};
+
+} // anonymous namespace
+
 /** \class TBranch
 A TTree is a list of TBranches
 
@@ -115,6 +140,12 @@ TBranch::TBranch()
 , fEntryBuffer(0)
 , fTransientBuffer(0)
 , fBrowsables(0)
+, fCompressionDictSeek(0)
+, fCompressionDictNbytes(0)
+, fCompressionDictTrain(0)
+, fCompressionDictRequest(0)
+, fCompressionDictLoaded(kFALSE)
+, fBasketFilter(0)
 , fSkipZip(kFALSE)
 , fReadLeaves(&TBranch::ReadLeavesImpl)
 , fFillLeaves(&TBranch::FillLeavesImpl)
@@ -218,6 +249,12 @@ TBranch::TBranch(TTree *tree, const char* name, void* address, const char* leafl
 , fEntryBuffer(0)
 , fTransientBuffer(0)
 , fBrowsables(0)
+, fCompressionDictSeek(0)
+, fCompressionDictNbytes(0)
+, fCompressionDictTrain(0)
+, fCompressionDictRequest(0)
+, fCompressionDictLoaded(kFALSE)
+, fBasketFilter(0)
 , fSkipZip(kFALSE)
 , fReadLeaves(&TBranch::ReadLeavesImpl)
 , fFillLeaves(&TBranch::FillLeavesImpl)
@@ -268,6 +305,12 @@ TBranch::TBranch(TBranch *parent, const char* name, void* address, const char* l
 , fEntryBuffer(0)
 , fTransientBuffer(0)
 , fBrowsables(0)
+, fCompressionDictSeek(0)
+, fCompressionDictNbytes(0)
+, fCompressionDictTrain(0)
+, fCompressionDictRequest(0)
+, fCompressionDictLoaded(kFALSE)
+, fBasketFilter(0)
 , fSkipZip(kFALSE)
 , fReadLeaves(&TBranch::ReadLeavesImpl)
 , fFillLeaves(&TBranch::FillLeavesImpl)
@@ -587,6 +630,44 @@ void TBranch::AddLastBasket(Long64_t startEntry)
    fBaskets.AddAtAndExpand(0,fWriteBasket);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Collect the content of basket as a sample to train the compression
+/// dictionary (see SetCompressionDictionary). Once enough samples are
+/// collected, the dictionary is trained and written to the file; the
+/// following baskets of this branch are compressed against it.
+
+void TBranch::AddCompressionDictSample(TBasket *basket)
+{
+   TBuffer *buf = basket->GetBufferRef();
+   if (!buf || buf->TestBit(TBufferFile::kNotDecompressed)) return;
+
+   Int_t keylen = basket->GetKeylen();
+   Int_t len = buf->Length() - keylen;
+   if (len <= 0) return;
+   fCompressionDictSamples.insert(fCompressionDictSamples.end(), buf->Buffer() + keylen, buf->Buffer() + keylen + len);
+   fCompressionDictSampleSizes.push_back(len);
+   if ((Int_t)fCompressionDictSampleSizes.size() < fCompressionDictTrain) return;
+
+   fCompressionDictTrain = 0;
+
+   // A dictionary of about a tenth of the samples, up to 64kB, is a good
+   // compromise between the training time and the gain for small baskets.
+   Int_t capacity = TMath::Max(1024, TMath::Min(64*1024, (Int_t)(fCompressionDictSamples.size() / 10)));
+   std::vector<char> dict(capacity);
+   Int_t size = R__zipTrainDict(GetCompressionAlgorithm(), &dict[0], capacity,
+                                &fCompressionDictSamples[0], &fCompressionDictSampleSizes[0],
+                                (Int_t)fCompressionDictSampleSizes.size());
+   std::vector<char>().swap(fCompressionDictSamples);
+   std::vector<Int_t>().swap(fCompressionDictSampleSizes);
+   if (size <= 0) {
+      Warning("AddCompressionDictSample", "Training of the compression dictionary failed for branch %s, continuing without dictionary", GetName());
+      return;
+   }
+   dict.resize(size);
+   fCompressionDict.swap(dict);
+   WriteCompressionDict();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Browser interface.
 
@@ -1194,6 +1275,37 @@ const char * TBranch::GetClassName() const
    return "";
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Return the dictionary the baskets of this branch are compressed against
+/// and its size, or 0 if the branch does not use a compression dictionary.
+/// The dictionary is read from the file on first use.
+
+const char *TBranch::GetCompressionDict(Int_t &size)
+{
+   size = 0;
+   if (!fCompressionDictSeek) return 0;
+   // The dictionary is published through fCompressionDictLoaded: a thread
+   // seeing it set also sees the content of fCompressionDict.
+   if (!fCompressionDictLoaded.load(std::memory_order_acquire)) {
+      R__LOCKGUARD_IMT2(gROOTMutex); // Lock for parallel TTree I/O
+      if (!fCompressionDictLoaded.load(std::memory_order_relaxed)) {
+         TFile *file = GetFile(0);
+         if (!file) return 0;
+         TKey key(fCompressionDictSeek, fCompressionDictNbytes, file);
+         if (!key.ReadFile()) {
+            Error("GetCompressionDict", "Cannot read the compression dictionary of branch %s", GetName());
+            return 0;
+         }
+         char *buffer = key.GetBuffer();
+         key.ReadKeyBuffer(buffer);
+         fCompressionDict.assign(key.GetBuffer(), key.GetBuffer() + key.GetObjlen());
+         fCompressionDictLoaded.store(kTRUE, std::memory_order_release);
+      }
+   }
+   size = (Int_t)fCompressionDict.size();
+   return &fCompressionDict[0];
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Return icon name depending on type of branch.
 
@@ -1309,6 +1421,107 @@ Int_t TBranch::GetEntry(Long64_t entry, Int_t getall)
    return buf->Length() - bufbegin;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Read in one go all the entries of the basket containing entry, starting
+/// at entry, and store their values contiguously in user_buf, in their
+/// serialized (big endian) format.
+///
+/// This is only supported for branches with a single leaf of a fundamental
+/// type (or a fixed size array of it), for example created with
+/// `tree->Branch("px", &px, "px/F")`.
+///
+/// On return, user_buf is in read mode and positioned at the first value;
+/// its Buffer() holds the values of the returned number of entries (one
+/// after the other, each of GetLen() elements). Returns -1 if the branch
+/// is not supported or in case of error, 0 if entry is out of range.
+/// The entries not written to the file yet are read from the basket being
+/// filled.
+///
+/// A typical loop over all the entries is:
+/// ~~~ {.cpp}
+///     TBufferFile buf(TBuffer::kWrite, 10000);
+///     for (Long64_t entry = 0; entry < branch->GetEntries(); ) {
+///        Int_t n = branch->GetBulkEntries(entry, buf);
+///        if (n <= 0) break;
+///        Float_t *px = (Float_t*)buf.Buffer();
+///        for (Int_t i = 0; i < n; ++i) sum += px[i];
+///        entry += n;
+///     }
+/// ~~~
+
+Int_t TBranch::GetEntriesSerialized(Long64_t entry, TBuffer &user_buf)
+{
+   if (IsA() != TBranch::Class() || fNleaves != 1) return -1;
+   TLeaf *leaf = (TLeaf*)fLeaves.UncheckedAt(0);
+   if (leaf->GetLeafCount() || leaf->GetLenType() <= 0) return -1;
+   if ((entry < fFirstEntry) || (entry >= fEntryNumber)) return 0;
+
+   // Find and load the basket, like GetEntry does, so that reading the
+   // next entries one by one would use it.
+   if (!fCurrentBasket || entry < fFirstBasketEntry || entry >= fNextBasketEntry) {
+      fReadBasket = TMath::BinarySearch(fWriteBasket + 1, fBasketEntry, entry);
+      if (fReadBasket < 0) {
+         Error("GetEntriesSerialized", "In the branch %s, no basket contains the entry %lld\n", GetName(), entry);
+         return -1;
+      }
+      fNextBasketEntry = fReadBasket == fWriteBasket ? fEntryNumber : fBasketEntry[fReadBasket+1];
+      fFirstBasketEntry = fBasketEntry[fReadBasket];
+      TBasket *basket = (TBasket*) fBaskets.UncheckedAt(fReadBasket);
+      if (!basket) basket = GetBasket(fReadBasket);
+      fCurrentBasket = basket;
+      if (!basket) {
+         fFirstBasketEntry = -1;
+         fNextBasketEntry = -1;
+         return -1;
+      }
+   }
+   TBasket *basket = fCurrentBasket;
+   TBuffer *buf = basket->GetBufferRef();
+   if (!buf) return -1;
+   // The basket being filled holds the last entries in memory: switch it to
+   // read mode like GetEntry does, so that GetLast() covers all of them.
+   // Fill switches it back to write mode.
+   if (fReadBasket == fWriteBasket) {
+      fNextBasketEntry = fEntryNumber;
+      if (!buf->IsReading()) basket->SetReadMode();
+   }
+
+   // The values of the entries must be contiguous, one entry after the other.
+   Int_t entrysize = leaf->GetLenType() * leaf->GetLen();
+   Long64_t nentries = fNextBasketEntry - fFirstBasketEntry;
+   if (basket->GetLast() != basket->GetKeylen() + nentries * entrysize) return -1;
+
+   Int_t n = Int_t(fNextBasketEntry - entry);
+   Int_t nbytes = n * entrysize;
+   const char *values = buf->Buffer() + basket->GetKeylen() + (entry - fFirstBasketEntry) * entrysize;
+
+   user_buf.SetWriteMode();
+   if (user_buf.BufferSize() < nbytes) user_buf.Expand(nbytes, kFALSE);
+   memcpy(user_buf.Buffer(), values, nbytes);
+   user_buf.SetReadMode();
+   user_buf.SetBufferOffset(0);
+
+   return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Same as GetEntriesSerialized, but the values in user_buf are converted
+/// to the in-memory format of the machine (the conversion of a whole
+/// basket is done with a single call to TBuffer::ReadFastArray).
+///
+/// user_buf.Buffer() can then be used as an array of the type of the leaf.
+
+Int_t TBranch::GetBulkEntries(Long64_t entry, TBuffer &user_buf)
+{
+   Int_t n = GetEntriesSerialized(entry, user_buf);
+   if (n <= 0) return n;
+
+   TLeaf *leaf = (TLeaf*)fLeaves.UncheckedAt(0);
+   if (!leaf->ReadBasketFast(user_buf, n)) return -1;
+   user_buf.SetBufferOffset(0);
+   return n;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read all leaves of an entry and export buffers to real objects in a TClonesArray list.
 ///
@@ -1980,6 +2193,8 @@ void TBranch::Reset(Option_t*)
 
    fBaskets.Delete();
    fNBaskets = 0;
+
+   ResetCompressionDict();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2036,6 +2251,8 @@ void TBranch::ResetAfterMerge(TFileMergeInfo *)
    } else {
       fNBaskets = 0;
    }
+
+   ResetCompressionDictAfterMerge();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2115,6 +2332,47 @@ void TBranch::SetAutoDelete(Bool_t autodel)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Set the filter applied to the content of the baskets before they are
+/// compressed (and reverted after they are uncompressed).
+///
+/// filter is a combination of:
+///  - TBranch::kShuffle: store the first byte of all the values, then the
+///    second byte of all the values, etc. This groups the exponents of
+///    floating point values and the (often zero) high bytes of integers.
+///  - TBranch::kDelta: store the difference between consecutive values,
+///    for monotonic or slowly varying integers (event numbers, timestamps,
+///    offsets). Only valid for Int_t and Long64_t leaves.
+///
+/// The filters apply only to branches with a single leaf of a fundamental
+/// type of more than one byte and are ignored when the branch is not
+/// compressed. They are recorded in each basket: files using them cannot
+/// be read by versions of ROOT not supporting them (the reading fails with
+/// an error in the compression header).
+/// Returns kFALSE (and leaves the setting unchanged) if the filter cannot be
+/// used for this branch.
+
+Bool_t TBranch::SetBasketFilter(Int_t filter)
+{
+   if (filter & ~(kShuffle | kDelta)) {
+      Error("SetBasketFilter", "Unknown filter %d for branch %s", filter, GetName());
+      return kFALSE;
+   }
+   if (filter) {
+      TLeaf *leaf = fNleaves == 1 ? (TLeaf*)fLeaves.UncheckedAt(0) : 0;
+      if (IsA() != TBranch::Class() || !leaf || leaf->GetLenType() <= 1) {
+         Warning("SetBasketFilter", "Branch %s does not have a single leaf of a numerical type, no filter is applied", GetName());
+         return kFALSE;
+      }
+      if ((filter & kDelta) && leaf->IsA() != TLeafI::Class() && leaf->IsA() != TLeafL::Class()) {
+         Warning("SetBasketFilter", "The delta filter requires an integer leaf, branch %s has a leaf of type %s", GetName(), leaf->GetTypeName());
+         return kFALSE;
+      }
+   }
+   fBasketFilter = filter;
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Set the basket size
 /// The function makes sure that the basket size is greater than fEntryOffsetlen
@@ -2206,6 +2464,33 @@ void TBranch::SetCompressionSettings(Int_t settings)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Train a compression dictionary from the content of the first nbaskets
+/// baskets written for this branch (and its sub-branches).
+///
+/// The dictionary is stored in the file and referenced by the branch; the
+/// baskets written after the training are compressed against it, which
+/// gives much better compression factors for small baskets of repetitive
+/// data.  Only the ROOT::kZSTD algorithm supports dictionaries; for the
+/// other algorithms this setting is ignored. A value of 0 disables the
+/// training.
+
+void TBranch::SetCompressionDictionary(Int_t nbaskets)
+{
+   fCompressionDictRequest = nbaskets > 0 ? nbaskets : 0;
+   if (fCompressionDictSeek) {
+      Warning("SetCompressionDictionary", "Branch %s already has a compression dictionary", GetName());
+   } else {
+      fCompressionDictTrain = nbaskets > 0 ? nbaskets : 0;
+   }
+
+   Int_t nb = fBranches.GetEntriesFast();
+   for (Int_t i=0;i<nb;i++) {
+      TBranch *branch = (TBranch*)fBranches.UncheckedAt(i);
+      branch->SetCompressionDictionary(nbaskets);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Update the default value for the branch's fEntryOffsetLen if and only if
 /// it was already non zero (and the new value is not zero)
@@ -2579,7 +2864,8 @@ void TBranch::Streamer(TBuffer& b)
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Write the current basket to disk and return the number of bytes
-/// written to the file.
+/// written to the file. Returns 0 if the basket was queued by the tree
+/// for parallel compression (see TTree::SetParallelCompression).
 
 Int_t TBranch::WriteBasket(TBasket* basket, Int_t where)
 {
@@ -2592,6 +2878,31 @@ Int_t TBranch::WriteBasket(TBasket* basket, Int_t where)
       fEntryOffsetLen = 2*nevbuf; // assume some fluctuations.
    }
 
+   if (R__unlikely(fCompressionDictTrain > 0)) {
+      AddCompressionDictSample(basket);
+   } else if (R__unlikely(!fCompressionDictSeek && !fCompressionDict.empty())) {
+      // The file was reset after a merge (see ResetCompressionDictAfterMerge).
+      WriteCompressionDict();
+   }
+
+   // When the tree compresses its baskets in parallel, the basket is only
+   // queued here; the tree compresses the queued baskets concurrently and
+   // then calls WriteBasketImpl for each of them in the queue order.
+   if (fDirectory && !fEntryBuffer && basket->IsA() == TBasket::Class()
+       && !basket->GetBufferRef()->TestBit(TBufferFile::kNotDecompressed)
+       && fTree->QueueBasket(this, where)) {
+      return 0;
+   }
+
+   return WriteBasketImpl(basket, where);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the basket to the file and update the bookkeeping of the branch.
+/// The basket is then either reused as the new write basket or deleted.
+
+Int_t TBranch::WriteBasketImpl(TBasket* basket, Int_t where)
+{
    Int_t nout  = basket->WriteBuffer();    //  Write buffer
    fBasketBytes[where]  = basket->GetNbytes();
    fBasketSeek[where]   = basket->GetSeekKey();
@@ -2639,6 +2950,66 @@ Int_t TBranch::WriteBasket(TBasket* basket, Int_t where)
    return nout;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Forget the compression dictionary of the branch: its record belongs to
+/// the file the previous baskets were written to (see Reset, and
+/// TTree::ChangeFile which resets the trees before switching file). The
+/// training requested with SetCompressionDictionary starts again with the
+/// next baskets, so that the new file gets a dictionary of its own.
+
+void TBranch::ResetCompressionDict()
+{
+   fCompressionDictSeek = 0;
+   fCompressionDictNbytes = 0;
+   fCompressionDictTrain = fCompressionDictRequest;
+   fCompressionDictLoaded = kFALSE;
+   std::vector<char>().swap(fCompressionDict);
+   std::vector<char>().swap(fCompressionDictSamples);
+   std::vector<Int_t>().swap(fCompressionDictSampleSizes);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Forget the location of the compression dictionary record but keep the
+/// dictionary itself (see ResetAfterMerge). The baskets already merged away
+/// were compressed against it, so the branch must not train a second one for
+/// the same output: the record is written again to the reset file with the
+/// next basket (see WriteBasket), and all the baskets of the branch keep
+/// referring to a single dictionary.
+
+void TBranch::ResetCompressionDictAfterMerge()
+{
+   fCompressionDictSeek = 0;
+   fCompressionDictNbytes = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Write the compression dictionary (fCompressionDict) in a record of the
+/// branch's file and remember its location. Returns kFALSE in case of error,
+/// in which case the branch does not use the dictionary.
+
+Bool_t TBranch::WriteCompressionDict()
+{
+   Int_t size = (Int_t)fCompressionDict.size();
+   TFile *file = GetFile(1);
+   if (!size || !file || !file->IsWritable()) {
+      fCompressionDictLoaded = kFALSE;
+      fCompressionDict.clear();
+      return kFALSE;
+   }
+   TCompressionDictKey key(GetName(), size, file);
+   memcpy(key.GetBuffer(), &fCompressionDict[0], size);
+   if (key.WriteFile(1, file) < 0) {
+      Error("WriteCompressionDict", "Cannot write the compression dictionary of branch %s", GetName());
+      fCompressionDictLoaded = kFALSE;
+      fCompressionDict.clear();
+      return kFALSE;
+   }
+   fCompressionDictSeek = key.GetSeekKey();
+   fCompressionDictNbytes = key.GetNbytes();
+   fCompressionDictLoaded = kTRUE;
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ///set the first entry number (case of TBranchSTL)
 
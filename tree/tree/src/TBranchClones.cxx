@@ -324,6 +324,7 @@ void TBranchClones::Reset(Option_t* option)
       branch->Reset(option);
    }
    fBranchCount->Reset();
+   ResetCompressionDict();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -343,6 +344,7 @@ void TBranchClones::ResetAfterMerge(TFileMergeInfo *info)
       branch->ResetAfterMerge(info);
    }
    fBranchCount->ResetAfterMerge(info);
+   ResetCompressionDictAfterMerge();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -5063,8 +5063,11 @@ void TBranchElement::SetReadActionSequence()
          } else if (GetCollectionProxy()) {
             // Base class and embedded objects.
 
-            transient = TStreamerInfoActions::TActionSequence::CreateReadMemberWiseActions(info,*GetCollectionProxy());
-            original = transient;
+            original = TStreamerInfoActions::TActionSequence::GetSharedReadMemberWiseActions(info,*GetCollectionProxy());
+            if (!original) {
+               transient = TStreamerInfoActions::TActionSequence::CreateReadMemberWiseActions(info,*GetCollectionProxy());
+               original = transient;
+            }
          }
       }
    } else if (fType == 31) {
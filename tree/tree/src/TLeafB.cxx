@@ -154,6 +154,19 @@ void TLeafB::ReadBasket(TBuffer &b)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Convert in place the values of n entries, starting at the current
+/// position of b, from their serialized format to the in-memory one.
+/// Used by TBranch::GetBulkEntries, returns kFALSE for variable size arrays.
+
+Bool_t TLeafB::ReadBasketFast(TBuffer &b, Long64_t n)
+{
+   if (fLeafCount) return kFALSE;
+   // Single bytes, nothing to convert
+   b.SetBufferOffset(b.Length() + Int_t(n*fLen));
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read leaf elements from Basket input buffer and export buffer to
 /// TClonesArray objects.
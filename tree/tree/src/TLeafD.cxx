@@ -127,6 +127,24 @@ void TLeafD::ReadBasket(TBuffer &b)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Convert in place the values of n entries, starting at the current
+/// position of b, from their serialized format to the in-memory one.
+/// Used by TBranch::GetBulkEntries, returns kFALSE for variable size arrays.
+
+Bool_t TLeafD::ReadBasketFast(TBuffer &b, Long64_t n)
+{
+   if (fLeafCount) return kFALSE;
+   Int_t len = Int_t(n*fLen);
+#ifdef R__BYTESWAP
+   Double_t *values = (Double_t*)(b.Buffer() + b.Length());
+   b.ReadFastArray(values, len);
+#else
+   b.SetBufferOffset(b.Length() + len*sizeof(Double_t));
+#endif
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read leaf elements from Basket input buffer and export buffer to
 /// TClonesArray objects.
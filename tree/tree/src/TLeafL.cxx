@@ -175,6 +175,24 @@ void TLeafL::ReadBasket(TBuffer &b)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Convert in place the values of n entries, starting at the current
+/// position of b, from their serialized format to the in-memory one.
+/// Used by TBranch::GetBulkEntries, returns kFALSE for variable size arrays.
+
+Bool_t TLeafL::ReadBasketFast(TBuffer &b, Long64_t n)
+{
+   if (fLeafCount) return kFALSE;
+   Int_t len = Int_t(n*fLen);
+#ifdef R__BYTESWAP
+   Long64_t *values = (Long64_t*)(b.Buffer() + b.Length());
+   b.ReadFastArray(values, len);
+#else
+   b.SetBufferOffset(b.Length() + len*sizeof(Long64_t));
+#endif
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read leaf elements from Basket input buffer and export buffer to
 /// TClonesArray objects.
@@ -160,6 +160,24 @@ void TLeafS::ReadBasket(TBuffer &b)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Convert in place the values of n entries, starting at the current
+/// position of b, from their serialized format to the in-memory one.
+/// Used by TBranch::GetBulkEntries, returns kFALSE for variable size arrays.
+
+Bool_t TLeafS::ReadBasketFast(TBuffer &b, Long64_t n)
+{
+   if (fLeafCount) return kFALSE;
+   Int_t len = Int_t(n*fLen);
+#ifdef R__BYTESWAP
+   Short_t *values = (Short_t*)(b.Buffer() + b.Length());
+   b.ReadFastArray(values, len);
+#else
+   b.SetBufferOffset(b.Length() + len*sizeof(Short_t));
+#endif
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Read leaf elements from Basket input buffer and export buffer to
 /// TClonesArray objects.
@@ -691,6 +691,10 @@ TTree::TTree()
 , fCacheUserSet(kFALSE)
 , fIMTEnabled(ROOT::IsImplicitMTEnabled())
 , fNEntriesSinceSorting(0)
+, fParallelCompression(0)
+, fQueueBaskets(kFALSE)
+, fBasketBufferPoolSize(0)
+, fMaxBasketBufferPoolSize(16000000)
 {
    fMaxEntries = 1000000000;
    fMaxEntries *= 1000;
@@ -769,6 +773,10 @@ TTree::TTree(const char* name, const char* title, Int_t splitlevel /* = 99 */)
 , fCacheUserSet(kFALSE)
 , fIMTEnabled(ROOT::IsImplicitMTEnabled())
 , fNEntriesSinceSorting(0)
+, fParallelCompression(0)
+, fQueueBaskets(kFALSE)
+, fBasketBufferPoolSize(0)
+, fMaxBasketBufferPoolSize(16000000)
 {
    // TAttLine state.
    SetLineColor(gStyle->GetHistLineColor());
@@ -896,6 +904,77 @@ TTree::~TTree()
       delete fTransientBuffer;
       fTransientBuffer = 0;
    }
+   // Must be done after the destruction of the branches, which give the
+   // buffers of their baskets back to the pool.
+   SetMaxBasketBufferPoolSize(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Return a buffer of at least 'size' bytes, in write mode, for a new basket.
+///
+/// The buffers of the dropped baskets are kept in a pool (see
+/// ReleaseBasketBuffer) so that reading a tree does not allocate and free
+/// the uncompressed buffer of every basket. The smallest pooled buffer large
+/// enough is used; if none is, the largest one is expanded, as the baskets
+/// of a tree tend to need the same sizes over and over. A new buffer is
+/// allocated only when the pool is empty.
+
+TBuffer* TTree::AcquireBasketBuffer(Int_t size)
+{
+   TBuffer *buffer = 0;
+   {
+      std::lock_guard<std::mutex> lock(fBasketBufferPoolMutex);
+      Int_t n = fBasketBufferPool.size();
+      Int_t best = -1;
+      for (Int_t i = 0; i < n; ++i) {
+         Int_t bufsize = fBasketBufferPool[i]->BufferSize();
+         if (best < 0) {
+            best = i;
+         } else {
+            Int_t bestsize = fBasketBufferPool[best]->BufferSize();
+            if (bestsize < size ? bufsize > bestsize : (bufsize >= size && bufsize < bestsize)) {
+               best = i;
+            }
+         }
+      }
+      if (best >= 0) {
+         buffer = fBasketBufferPool[best];
+         fBasketBufferPool[best] = fBasketBufferPool.back();
+         fBasketBufferPool.pop_back();
+         fBasketBufferPoolSize -= buffer->BufferSize();
+      }
+   }
+   if (!buffer) {
+      return new TBufferFile(TBuffer::kWrite, size);
+   }
+   if (buffer->BufferSize() < size) {
+      buffer->Expand(size, kFALSE);
+   }
+   return buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Give the buffer of a dropped basket back to the pool, or delete it if
+/// the pool is full (see SetMaxBasketBufferPoolSize). Buffers which do not
+/// own their memory (memory mapped files, unzip cache) are always deleted.
+
+void TTree::ReleaseBasketBuffer(TBuffer *buffer)
+{
+   if (!buffer) return;
+   Int_t bufsize = buffer->BufferSize();
+   if (buffer->TestBit(TBuffer::kIsOwner) && bufsize > 0) {
+      std::lock_guard<std::mutex> lock(fBasketBufferPoolMutex);
+      if (fBasketBufferPoolSize + bufsize <= fMaxBasketBufferPoolSize) {
+         buffer->SetWriteMode();
+         buffer->Reset();
+         buffer->SetParent(0);
+         buffer->ResetBit(TBufferFile::kNotDecompressed);
+         fBasketBufferPool.push_back(buffer);
+         fBasketBufferPoolSize += bufsize;
+         return;
+      }
+   }
+   delete buffer;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -2614,6 +2693,8 @@ TFile* TTree::ChangeFile(TFile* file)
 {
    file->cd();
    Write();
+   // Reset also forgets the compression dictionaries of the branches, which
+   // are records of the old file (see TBranch::ResetCompressionDict).
    Reset();
    char* fname = new char[2000];
    ++fFileNumber;
@@ -2946,6 +3027,12 @@ Int_t TTree::CheckBranchAddressType(TBranch* branch, TClass* ptrClass, EDataType
 /// cloning will be done without unzipping or unstreaming the baskets
 /// (i.e., a direct copy of the raw bytes on disk).
 ///
+/// If 'option' also contains the word 'recompress', the baskets whose
+/// compression settings differ from the ones of the cloned branches are
+/// decompressed and compressed again, still without being unstreamed
+/// (see TTreeCloner). With implicit multi-threading enabled the baskets
+/// are recompressed concurrently.
+///
 /// When 'fast' is specified, 'option' can also contain a sorting
 /// order for the baskets in the output file.
 ///
@@ -3399,7 +3486,11 @@ Long64_t TTree::CopyEntries(TTree* tree, Long64_t nentries /* = -1 */, Option_t*
          TTreeCloner cloner(tree->GetTree(), this, option, TTreeCloner::kNoWarnings);
          if (cloner.IsValid()) {
             this->SetEntries(this->GetEntries() + tree->GetTree()->GetEntries());
-            cloner.Exec();
+            if (!cloner.Exec()) {
+               // Some baskets were not copied, the output tree is incomplete.
+               Error("CopyEntries", "%s", cloner.GetWarning());
+               return -1;
+            }
          } else {
             if (i == 0) {
                Warning("CopyEntries","%s",cloner.GetWarning());
@@ -4350,6 +4441,7 @@ Int_t TTree::Fill()
    if (fBranchRef) {
       fBranchRef->Clear();
    }
+   Bool_t queueBaskets = StartBasketQueue();
    for (Int_t i = 0; i < nb; ++i) {
       // Loop over all branches, filling and accumulating bytes written and error counts.
       TBranch* branch = (TBranch*) fBranches.UncheckedAt(i);
@@ -4379,6 +4471,10 @@ Int_t TTree::Fill()
    if (fBranchRef) {
       fBranchRef->Fill();
    }
+   if (queueBaskets && WritePendingBaskets() < 0) {
+      Error("Fill", "Failed writing the baskets compressed in parallel, entry=%lld", fEntries+1);
+      ++nerror;
+   }
    ++fEntries;
    if (fEntries > fMaxEntries) {
       KeepCircular();
@@ -4766,7 +4862,9 @@ Int_t TTree::FlushBaskets() const
    if (!fDirectory) return 0;
    Int_t nbytes = 0;
    Int_t nerror = 0;
-   TObjArray *lb = const_cast<TTree*>(this)->GetListOfBranches();
+   TTree *self = const_cast<TTree*>(this);
+   Bool_t queueBaskets = self->StartBasketQueue();
+   TObjArray *lb = self->GetListOfBranches();
    Int_t nb = lb->GetEntriesFast();
    for (Int_t j = 0; j < nb; j++) {
       TBranch* branch = (TBranch*) lb->UncheckedAt(j);
@@ -4779,6 +4877,14 @@ Int_t TTree::FlushBaskets() const
          }
       }
    }
+   if (queueBaskets) {
+      Int_t nwrite = self->WritePendingBaskets();
+      if (nwrite<0) {
+         ++nerror;
+      } else {
+         nbytes += nwrite;
+      }
+   }
    if (nerror) {
       return -1;
    } else {
@@ -5331,6 +5437,75 @@ void TTree::SortBranchesByTime()
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Start collecting the full baskets for parallel compression, if enabled.
+/// Returns kTRUE if the caller must call WritePendingBaskets afterwards.
+
+Bool_t TTree::StartBasketQueue()
+{
+#ifdef R__USE_IMT
+   if (fQueueBaskets || fParallelCompression <= 0 || !fIMTEnabled || !ROOT::IsImplicitMTEnabled()) {
+      return kFALSE;
+   }
+   fQueueBaskets = kTRUE;
+   return kTRUE;
+#else
+   return kFALSE;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Compress the queued baskets concurrently, then write them to the file
+/// sequentially in the order in which they were queued.
+///
+/// Return the number of bytes written or -1 in case of write error.
+
+Int_t TTree::WritePendingBaskets()
+{
+   fQueueBaskets = kFALSE;
+   Int_t npending = fPendingBaskets.size();
+   if (!npending) return 0;
+
+#ifdef R__USE_IMT
+   if (npending > 1) {
+      // Each task compresses the next queued basket until the queue is
+      // exhausted; at most fParallelCompression baskets are compressed at
+      // the same time.
+      std::atomic<Int_t> pos(0);
+      tbb::task_group g;
+      Int_t ntasks = TMath::Min(fParallelCompression, npending);
+      for (Int_t t = 0; t < ntasks; ++t) {
+         g.run([&]() {
+            for (Int_t j = pos.fetch_add(1); j < npending; j = pos.fetch_add(1)) {
+               TBranch *branch = fPendingBaskets[j].first;
+               TBasket *basket = (TBasket*)branch->GetListOfBaskets()->UncheckedAt(fPendingBaskets[j].second);
+               basket->CompressBuffer();
+            }
+         });
+      }
+      g.wait();
+   }
+#endif
+
+   // A basket whose compression failed was left untouched, it is compressed
+   // again (and the error reported) by TBasket::WriteBuffer.
+   Int_t nbytes = 0;
+   Int_t nerror = 0;
+   for (Int_t j = 0; j < npending; ++j) {
+      TBranch *branch = fPendingBaskets[j].first;
+      Int_t where = fPendingBaskets[j].second;
+      TBasket *basket = (TBasket*)branch->GetListOfBaskets()->UncheckedAt(where);
+      Int_t nwrite = branch->WriteBasketImpl(basket, where);
+      if (nwrite < 0) {
+         ++nerror;
+      } else {
+         nbytes += nwrite;
+      }
+   }
+   fPendingBaskets.clear();
+   return nerror ? -1 : nbytes;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ///Returns the entry list, set to this tree
 
@@ -6431,7 +6606,11 @@ Long64_t TTree::Merge(TCollection* li, TFileMergeInfo *info)
       // Copy branch addresses.
       CopyAddresses(tree);
 
-      CopyEntries(tree,-1,options);
+      if (CopyEntries(tree,-1,options) < 0) {
+         tree->ResetBranchAddresses();
+         fAutoSave = storeAutoSave;
+         return -1;
+      }
 
       tree->ResetBranchAddresses();
    }
@@ -6899,6 +7078,28 @@ TSQLResult* TTree::Query(const char* varexp, const char* selection, Option_t* op
    return 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Queue the basket number 'where' of 'branch' for parallel compression.
+///
+/// This is called by TBranch::WriteBasket while TTree::Fill or
+/// TTree::FlushBaskets collect the full baskets (see SetParallelCompression).
+/// Returns kFALSE if the basket must be written immediately.
+
+Bool_t TTree::QueueBasket(TBranch *branch, Int_t where)
+{
+   if (!fQueueBaskets) return kFALSE;
+   // The tasks do not share a compression buffer: each one compresses its
+   // basket into the compressed buffer of that basket (the transient buffer
+   // of its branch with imt). The key cycle however is taken from the write
+   // basket number of the branch, which only advances once the previous
+   // basket of the branch is written, so a second basket of the same branch
+   // (only FlushBaskets queues several, one after the other) is written
+   // immediately.
+   if (!fPendingBaskets.empty() && fPendingBaskets.back().first == branch) return kFALSE;
+   fPendingBaskets.emplace_back(branch, where);
+   return kTRUE;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Create or simply read branches from filename.
 ///
@@ -7612,6 +7813,36 @@ void TTree::SetAutoSave(Long64_t autos)
    fAutoSave = autos;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Set the pre-compression filter of the matching branches, see
+/// TBranch::SetBasketFilter. For example:
+/// ~~~ {.cpp}
+///     tree->SetBasketFilter("px*", TBranch::kShuffle);
+///     tree->SetBasketFilter("evtnum", TBranch::kDelta | TBranch::kShuffle);
+/// ~~~
+/// bname follows the same wildcarding rules as SetBasketSize. The branches
+/// for which the filter cannot be used are left unchanged.
+
+void TTree::SetBasketFilter(const char* bname, Int_t filter)
+{
+   Int_t nleaves = fLeaves.GetEntriesFast();
+   TRegexp re(bname, kTRUE);
+   Int_t nb = 0;
+   for (Int_t i = 0; i < nleaves; i++)  {
+      TLeaf* leaf = (TLeaf*) fLeaves.UncheckedAt(i);
+      TBranch* branch = (TBranch*) leaf->GetBranch();
+      TString s = branch->GetName();
+      if (strcmp(bname, branch->GetName()) && (s.Index(re) == kNPOS)) {
+         continue;
+      }
+      nb++;
+      branch->SetBasketFilter(filter);
+   }
+   if (!nb) {
+      Error("SetBasketFilter", "unknown branch -> '%s'", bname);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Set a branch's basket size.
 ///
@@ -7990,6 +8221,11 @@ Int_t TTree::SetCacheSizeAux(Bool_t autocache /* = kTRUE */, Long64_t cacheSize
 
    // Check for an existing cache
    TTreeCache* pf = GetReadCache(file);
+   if (!pf && autocache && file->IsMapped()) {
+      // The baskets of a memory mapped file are read in place (see the TFile
+      // option "mmap=1"), an automatic cache would only add a copy.
+      return 0;
+   }
    if (pf) {
       if (autocache) {
          // reset our cache status tracking in case existing cache was added
@@ -8159,6 +8395,37 @@ void TTree::SetCircular(Long64_t maxEntries)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Enable trained compression dictionaries for the matching branches.
+///
+/// The first nbaskets baskets of each branch are used as training samples;
+/// the resulting dictionary is written once to the file and all subsequent
+/// baskets of the branch are compressed against it. This only has an effect
+/// when the branch uses the ZSTD algorithm (ROOT::kZSTD) and is most useful
+/// for branches with many small baskets.
+///
+/// bname follows the same wildcarding rules as SetBasketSize.
+
+void TTree::SetCompressionDictionary(const char* bname, Int_t nbaskets)
+{
+   Int_t nleaves = fLeaves.GetEntriesFast();
+   TRegexp re(bname, kTRUE);
+   Int_t nb = 0;
+   for (Int_t i = 0; i < nleaves; i++)  {
+      TLeaf* leaf = (TLeaf*) fLeaves.UncheckedAt(i);
+      TBranch* branch = (TBranch*) leaf->GetBranch();
+      TString s = branch->GetName();
+      if (strcmp(bname, branch->GetName()) && (s.Index(re) == kNPOS)) {
+         continue;
+      }
+      nb++;
+      branch->SetCompressionDictionary(nbaskets);
+   }
+   if (!nb) {
+      Error("SetCompressionDictionary", "unknown branch -> '%s'", bname);
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Set the debug level and the debug range.
 ///
@@ -8377,6 +8644,23 @@ void TTree::SetFileNumber(Int_t number)
    fFileNumber = number;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Set the maximum total size, in bytes, of the buffers of dropped baskets
+/// kept for reuse by the next baskets (see AcquireBasketBuffer). 0 disables
+/// the pool. The buffers above the new limit are freed.
+
+void TTree::SetMaxBasketBufferPoolSize(Long64_t size)
+{
+   std::lock_guard<std::mutex> lock(fBasketBufferPoolMutex);
+   fMaxBasketBufferPoolSize = size > 0 ? size : 0;
+   while (!fBasketBufferPool.empty() && fBasketBufferPoolSize > fMaxBasketBufferPoolSize) {
+      TBuffer *buffer = fBasketBufferPool.back();
+      fBasketBufferPool.pop_back();
+      fBasketBufferPoolSize -= buffer->BufferSize();
+      delete buffer;
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Set all the branches in this TTree to be in decomposed object mode
 /// (also known as MakeClass mode).
@@ -8466,6 +8750,33 @@ void TTree::SetObject(const char* name, const char* title)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Enable or disable the parallel compression of the baskets.
+///
+/// When enabled, TTree::Fill and TTree::FlushBaskets no longer compress the
+/// full baskets one after the other on the calling thread: the baskets are
+/// collected, compressed concurrently by the implicit multi-threading pool,
+/// and written in the order in which they were collected. The layout of the
+/// file therefore does not depend on the scheduling of the threads.
+///
+/// nthreads is the maximum number of baskets compressed at the same time;
+/// 0 disables the parallel compression. The baskets are only compressed in
+/// parallel while the implicit multi-threading is enabled (see
+/// ROOT::EnableImplicitMT), otherwise they are compressed sequentially as
+/// usual. This requires ROOT to be built with -Dimt=ON.
+/// The parallel compression pays off mostly for slow algorithms such as
+/// LZMA and for trees with many branches flushed at the same time.
+
+void TTree::SetParallelCompression(Int_t nthreads)
+{
+   fParallelCompression = nthreads > 0 ? nthreads : 0;
+#ifndef R__USE_IMT
+   if (fParallelCompression) {
+      Warning("SetParallelCompression", "ROOT was built without implicit multi-threading support, the baskets are compressed sequentially");
+   }
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Enable or disable parallel unzipping of Tree buffers.
 
@@ -19,24 +19,38 @@ Core TTree-related code borrowed from the previous version
 
 ## Parallel Unzipping
 
-TTreeCache has been specialised in order to let additional threads
-free to unzip in advance its content. In this implementation we
-support up to 10 threads, but right now it makes more sense to
-limit their number to 1-2
+TTreeCache has been specialised in order to unzip its content in
+advance. As soon as the baskets of a cluster have been transferred into
+the cache, one task per basket is handed to the ROOT task scheduler
+(TBB), so that all the available cores can inflate the cluster while the
+application is still processing the previous entries.
 
 The application reading data is carefully synchronized, in order to:
  - if the block it wants is not unzipped, it self-unzips it without
    waiting
  - if the block is being unzipped in parallel, it waits only
    for that unzip to finish
- - if the block has already been unzipped, it takes it
-
-This is supposed to cancel a part of the unzipping latency, at the
-expenses of cpu time.
-
-The default parameters are the same of the prev version, i.e. 20%
-of the TTreeCache cache size. To change it use
-TTreeCache::SetUnzipBufferSize(Long64_t bufferSize)
+ - if the block has already been unzipped, it takes it without copy
+
+The tasks never block and are never waited for while the cache is
+locked: they unzip the blocks from a copy of the cluster owned by the
+unzipping state, so when the cache moves to the next cluster the blocks
+which were not picked up yet are simply cancelled and the cache buffer is
+reused right away. A task finding that the unzipped
+blocks not yet read exceed the unzip buffer size leaves its block; the
+skipped blocks are handed again to the scheduler as the reader consumes
+the unzipped ones.
+
+The parallel unzipping requires ROOT to be built with the support for
+implicit multi-threading (imt), and enabled with ROOT::EnableImplicitMT(),
+and is used only when the cache reads
+the cluster with a synchronous vectored read; in the other cases (
+asynchronous reading, prefetching, file being written) the baskets are
+unzipped serially, as with a TTreeCache.
+
+The default size of the memory used for the unzipped blocks waiting to
+be read is 50% of the TTreeCache cache size. To change it use
+TTreeCacheUnzip::SetUnzipBufferSize(Long64_t bufferSize)
 where bufferSize must be passed in bytes.
 */
 
@@ -47,16 +61,20 @@ where bufferSize must be passed in bytes.
 #include "TEventList.h"
 #include "TMutex.h"
 #include "TVirtualMutex.h"
-#include "TThread.h"
-#include "TCondition.h"
+#include "TSystem.h"
 #include "TMath.h"
+#include "TROOT.h"
 #include "Bytes.h"
+#include "RZip.h"
 
-#include "TEnv.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
 
-#define THREADCNT 2
-extern "C" void R__unzip(Int_t *nin, UChar_t *bufin, Int_t *lout, char *bufout, Int_t *nout);
-extern "C" int R__unzip_header(Int_t *nin, UChar_t *bufin, Int_t *lout);
+#ifdef R__USE_IMT
+#include "tbb/task_group.h"
+#endif
 
 TTreeCacheUnzip::EParUnzipMode TTreeCacheUnzip::fgParallel = TTreeCacheUnzip::kDisable;
 
@@ -65,22 +83,315 @@ TTreeCacheUnzip::EParUnzipMode TTreeCacheUnzip::fgParallel = TTreeCacheUnzip::kD
 // Hence there is no good reason to limit it too much
 Double_t TTreeCacheUnzip::fgRelBuffSize = .5;
 
+////////////////////////////////////////////////////////////////////////////////
+/// The unzip tasks of a cache. They are only waited for when the cache is
+/// deleted, without holding any lock of the cache.
+
+class TTreeCacheUnzipTasks {
+public:
+#ifdef R__USE_IMT
+   tbb::task_group           fGroup;           ///< The unzip tasks of all the clusters
+#endif
+
+   void Wait()
+   {
+#ifdef R__USE_IMT
+      fGroup.wait();
+#endif
+   }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Unzipping state of the blocks of one cluster.
+///
+/// The state holds a copy of the compressed blocks and is shared by the
+/// cache, the tasks unzipping the blocks and the readers waiting for one:
+/// when the cache moves to another cluster, Cancel() only prevents the tasks
+/// from picking up more blocks, the running ones finish on the copy and the
+/// state goes away with its last user.
+
+class TTreeCacheUnzipState : public std::enable_shared_from_this<TTreeCacheUnzipState> {
+public:
+   enum EStatus { kUntouched = 0, kProgress = 1, kFinished = 2, kSkipped = 3 };
+
+   Int_t                     fNblocks;         ///< Number of blocks of the cluster
+   std::vector<char>         fBuffer;          ///< Copy of the compressed blocks of the cluster
+   std::vector<Int_t>        fPos;             ///< Position of each block in fBuffer
+   std::atomic<Byte_t>      *fStatus;          ///< For each block, tells if it is untouched, being unzipped or finished
+   std::vector<char*>        fChunks;          ///< Unzipped blocks, owned until handed to a basket
+   std::vector<Int_t>        fLen;             ///< Length of the unzipped blocks
+   std::atomic<Long64_t>     fTotalUnzipBytes; ///< Sum of the size of the unzipped blocks not yet handed to a basket
+   Long64_t                  fMaxUnzipBytes;   ///< Above this the tasks leave the blocks to the reader
+   Bool_t                    fOldFile;         ///< The buffers might come from a file written before 3.04/01
+   std::atomic<Int_t>        fNUnzip;          ///< Number of blocks unzipped by the tasks
+   std::atomic<Int_t>        fNSkipped;        ///< Number of blocks left by the tasks because of fMaxUnzipBytes
+   std::mutex                fMutex;           ///< Protects the end of the unzipping of a block, see Wait()
+   std::condition_variable   fFinished;        ///< Notified when a block being unzipped is finished
+
+   TTreeCacheUnzipState(Int_t nblocks, const char *buffer, Int_t length, const Int_t *pos, Long64_t maxbytes, Bool_t oldfile) :
+      fNblocks(nblocks), fBuffer(buffer, buffer + length), fPos(pos, pos + nblocks), fStatus(new std::atomic<Byte_t>[nblocks]),
+      fChunks(nblocks, (char*)0), fLen(nblocks, 0), fTotalUnzipBytes(0), fMaxUnzipBytes(maxbytes),
+      fOldFile(oldfile), fNUnzip(0), fNSkipped(0)
+   {
+      for (Int_t i = 0; i < fNblocks; ++i) fStatus[i] = kUntouched;
+   }
+
+   ~TTreeCacheUnzipState()
+   {
+      for (Int_t i = 0; i < fNblocks; ++i) delete [] fChunks[i];
+      delete [] fStatus;
+   }
+
+   ////////////////////////////////////////////////////////////////////////////
+   /// Atomically move a block from kUntouched (or kSkipped) to the given
+   /// status. Returns false if somebody else got the block first.
+
+   Bool_t Claim(Int_t loc, EStatus status)
+   {
+      Byte_t expected = kUntouched;
+      if (fStatus[loc].compare_exchange_strong(expected, (Byte_t)status)) return kTRUE;
+      if (expected != kSkipped || !fStatus[loc].compare_exchange_strong(expected, (Byte_t)status)) return kFALSE;
+      --fNSkipped;
+      return kTRUE;
+   }
+
+   void Spawn(TTreeCacheUnzipTasks *tasks, Int_t loc);
+   void Respawn(TTreeCacheUnzipTasks *tasks, Int_t from);
+   void UnzipBlock(Int_t loc);
+   void Wait(Int_t loc);
+   void Cancel();
+};
+
+////////////////////////////////////////////////////////////////////////////////
+/// Read the header of a logical record, see TTreeCacheUnzip::GetRecordHeader.
+
+static void R__ReadRecordHeader(char *buf, Int_t maxbytes, Int_t &nbytes, Int_t &objlen, Int_t &keylen)
+{
+   Version_t versionkey;
+   Short_t klen;
+   UInt_t datime;
+   Int_t nb = 0,olen;
+   frombuf(buf,&nb);
+   nbytes = nb;
+   if (nb < 0) return;
+   //   const Int_t headerSize = Int_t(sizeof(nb) +sizeof(versionkey) +sizeof(olen) +sizeof(datime) +sizeof(klen));
+   const Int_t headerSize = 16;
+   if (maxbytes < headerSize) return;
+   frombuf(buf, &versionkey);
+   frombuf(buf, &olen);
+   frombuf(buf, &datime);
+   frombuf(buf, &klen);
+   if (!olen) olen = nbytes-klen;
+   objlen = olen;
+   keylen = klen;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Unzip the record (key + compressed object) starting at src, see
+/// TTreeCacheUnzip::UnzipBuffer.
+/// The buffers compressed against a branch dictionary are not handled here,
+/// -1 is returned and the basket unzips them itself.
+
+static Int_t R__UnzipRecord(char **dest, char *src, Bool_t oldFile)
+{
+   Int_t  uzlen = 0;
+   Bool_t alloc = kFALSE;
+
+   // Here we read the header of the buffer
+   const Int_t hlen=128;
+   Int_t nbytes=0, objlen=0, keylen=0;
+   R__ReadRecordHeader(src, hlen, nbytes, objlen, keylen);
+
+   UChar_t *bufcur = (UChar_t *) (src + keylen);
+
+   // Values filtered before compression, see TBranch::SetBasketFilter
+   Int_t filter = 0, elemsize = 0, filtersize = 0;
+   if (objlen > nbytes-keylen && R__filter_header(bufcur, &filter, &elemsize, &filtersize) == 0) {
+      bufcur += kFilterHeaderSize;
+   }
+
+   if (bufcur[0] == 'Z' && bufcur[1] == 'S' && bufcur[2] == 1) {
+      // zstd with a dictionary which is only known to the branch.
+      return -1;
+   }
+
+   if (!(*dest)) {
+      /* early consistency check */
+      Int_t nin, nbuf;
+      if(R__unzip_header(&nin, bufcur, &nbuf)!=0) {
+         ::Error("TTreeCacheUnzip::UnzipBuffer", "Inconsistency found in header (nin=%d, nbuf=%d)", nin, nbuf);
+         uzlen = -1;
+         return uzlen;
+      }
+      Int_t l = keylen+objlen;
+      *dest = new char[l];
+      alloc = kTRUE;
+   }
+
+   // This is similar to TBasket::ReadBasketBuffers
+   Bool_t oldCase = objlen==nbytes-keylen && oldFile;
+
+   if (objlen > nbytes-keylen || oldCase) {
+
+      // Copy the key
+      memcpy(*dest, src, keylen);
+      uzlen += keylen;
+
+      char *objbuf = *dest + keylen;
+      Int_t nin, nbuf;
+      Int_t nout = 0;
+      Int_t noutot = 0;
+
+      while (1) {
+         Int_t hc = R__unzip_header(&nin, bufcur, &nbuf);
+         if (hc!=0) break;
+         if (gDebug > 2)
+            ::Info("TTreeCacheUnzip::UnzipBuffer", " nin:%d, nbuf:%d, bufcur[3] :%d, bufcur[4] :%d, bufcur[5] :%d ",
+                   nin, nbuf, bufcur[3], bufcur[4], bufcur[5]);
+         if (oldCase && (nin > objlen || nbuf > objlen)) {
+            if (gDebug > 2)
+               ::Info("TTreeCacheUnzip::UnzipBuffer", "oldcase objlen :%d ", objlen);
+
+            //buffer was very likely not compressed in an old version
+            memcpy( *dest + keylen, src + keylen, objlen);
+            uzlen += objlen;
+            return uzlen;
+         }
+
+         R__unzip(&nin, bufcur, &nbuf, (UChar_t*)objbuf, &nout);
+
+         if (gDebug > 2)
+            ::Info("TTreeCacheUnzip::UnzipBuffer", "R__unzip nin:%d, bufcur:%p, nbuf:%d, objbuf:%p, nout:%d",
+                   nin, bufcur, nbuf, objbuf, nout);
+
+         if (!nout) break;
+         noutot += nout;
+         if (noutot >= objlen) break;
+         bufcur += nin;
+         objbuf += nout;
+      }
+
+      if (noutot != objlen) {
+         ::Error("TTreeCacheUnzip::UnzipBuffer", "nbytes = %d, keylen = %d, objlen = %d, noutot = %d, nout=%d, nin=%d, nbuf=%d",
+                 nbytes,keylen,objlen, noutot,nout,nin,nbuf);
+         uzlen = -1;
+         if(alloc) delete [] *dest;
+         *dest = 0;
+         return uzlen;
+      }
+      if (filter) {
+         std::vector<char> filtered(*dest + keylen, *dest + keylen + TMath::Min(filtersize, objlen));
+         if (filtersize > objlen || !R__unfilter(filter, elemsize, filtersize, filtered.data(), *dest + keylen)) {
+            ::Error("TTreeCacheUnzip::UnzipBuffer", "Unknown or inconsistent basket filter (filter=%d, elemsize=%d, size=%d, objlen=%d)",
+                    filter, elemsize, filtersize, objlen);
+            if(alloc) delete [] *dest;
+            *dest = 0;
+            return -1;
+         }
+      }
+      uzlen += objlen;
+   } else {
+      memcpy(*dest, src, keylen);
+      uzlen += keylen;
+      memcpy(*dest + keylen, src + keylen, objlen);
+      uzlen += objlen;
+   }
+   return uzlen;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Body of the unzip task of one block.
+
+void TTreeCacheUnzipState::UnzipBlock(Int_t loc)
+{
+   // Do not run too far ahead of the reader; the block is handed again to
+   // the scheduler by Respawn once the reader has consumed enough blocks.
+   if (fTotalUnzipBytes.load() >= fMaxUnzipBytes) {
+      Byte_t expected = kUntouched;
+      if (fStatus[loc].compare_exchange_strong(expected, (Byte_t)kSkipped)) ++fNSkipped;
+      return;
+   }
+
+   if (!Claim(loc, kProgress)) return;
+
+   char *ptr = 0;
+   Int_t len = R__UnzipRecord(&ptr, fBuffer.data() + fPos[loc], fOldFile);
+   if (len > 0) {
+      fChunks[loc] = ptr;
+      fLen[loc] = len;
+      fTotalUnzipBytes += len;
+      ++fNUnzip;
+   }
+   {
+      std::lock_guard<std::mutex> lock(fMutex);
+      fStatus[loc].store(kFinished);
+   }
+   fFinished.notify_all();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Block until the task unzipping the block loc, if any, is done with it.
+
+void TTreeCacheUnzipState::Wait(Int_t loc)
+{
+   std::unique_lock<std::mutex> lock(fMutex);
+   fFinished.wait(lock, [this, loc]() { return fStatus[loc].load() != kProgress; });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Hand the unzipping of the block loc to the task scheduler. The task keeps
+/// the state alive.
+
+void TTreeCacheUnzipState::Spawn(TTreeCacheUnzipTasks *tasks, Int_t loc)
+{
+#ifdef R__USE_IMT
+   std::shared_ptr<TTreeCacheUnzipState> self = shared_from_this();
+   tasks->fGroup.run([self, loc]() { self->UnzipBlock(loc); });
+#else
+   (void)tasks;
+   (void)loc;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Hand again to the scheduler the blocks after 'from' which were skipped
+/// by their task, as many as fit in the room left by the blocks consumed.
+
+void TTreeCacheUnzipState::Respawn(TTreeCacheUnzipTasks *tasks, Int_t from)
+{
+   Long64_t room = fMaxUnzipBytes - fTotalUnzipBytes.load();
+   for (Int_t i = from; i < fNblocks && room > 0 && fNSkipped.load() > 0; ++i) {
+      Byte_t expected = kSkipped;
+      if (!fStatus[i].compare_exchange_strong(expected, (Byte_t)kUntouched)) continue;
+      --fNSkipped;
+      Int_t nbytes = 0, objlen = 0, keylen = 0;
+      R__ReadRecordHeader(fBuffer.data() + fPos[i], 16, nbytes, objlen, keylen);
+      room -= keylen + objlen;
+      Spawn(tasks, i);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Prevent the tasks from picking up more blocks. The blocks being unzipped
+/// are finished on the copy held by the state, nothing is waited for.
+
+void TTreeCacheUnzipState::Cancel()
+{
+   for (Int_t i = 0; i < fNblocks; ++i) {
+      Claim(i, kFinished);
+   }
+}
+
 ClassImp(TTreeCacheUnzip)
 
 ////////////////////////////////////////////////////////////////////////////////
 
 TTreeCacheUnzip::TTreeCacheUnzip() : TTreeCache(),
-
-   fActiveThread(kFALSE),
-   fAsyncReading(kFALSE),
-   fCycle(0),
-   fLastReadPos(0),
-   fBlocksToGo(0),
-   fUnzipLen(0),
-   fUnzipChunks(0),
-   fUnzipStatus(0),
-   fTotalUnzipBytes(0),
-   fNseekMax(0),
+   fParallel(kFALSE),
+   fMutexList(0),
+   fIOMutex(0),
+   fUnzipTasks(0),
+   fTasksStarted(kFALSE),
    fUnzipBufferSize(0),
    fNUnzip(0),
    fNFound(0),
@@ -97,16 +408,11 @@ TTreeCacheUnzip::TTreeCacheUnzip() : TTreeCache(),
 /// Constructor.
 
 TTreeCacheUnzip::TTreeCacheUnzip(TTree *tree, Int_t buffersize) : TTreeCache(tree,buffersize),
-   fActiveThread(kFALSE),
-   fAsyncReading(kFALSE),
-   fCycle(0),
-   fLastReadPos(0),
-   fBlocksToGo(0),
-   fUnzipLen(0),
-   fUnzipChunks(0),
-   fUnzipStatus(0),
-   fTotalUnzipBytes(0),
-   fNseekMax(0),
+   fParallel(kFALSE),
+   fMutexList(0),
+   fIOMutex(0),
+   fUnzipTasks(0),
+   fTasksStarted(kFALSE),
    fUnzipBufferSize(0),
    fNUnzip(0),
    fNFound(0),
@@ -123,44 +429,29 @@ void TTreeCacheUnzip::Init()
 {
    fMutexList        = new TMutex(kTRUE);
    fIOMutex          = new TMutex(kTRUE);
+   fUnzipTasks       = new TTreeCacheUnzipTasks;
 
-   fUnzipStartCondition   = new TCondition(fMutexList);
-   fUnzipDoneCondition   = new TCondition(fMutexList);
-
-   fTotalUnzipBytes = 0;
-
-   fCompBuffer = new char[16384];
-   fCompBufferSize = 16384;
+   fUnzipBufferSize = Long64_t(fgRelBuffSize * GetBufferSize());
 
    if (fgParallel == kDisable) {
       fParallel = kFALSE;
    }
    else if(fgParallel == kEnable || fgParallel == kForce) {
+#ifdef R__USE_IMT
       SysInfo_t info;
       gSystem->GetSysInfo(&info);
 
-      fUnzipBufferSize = Long64_t(fgRelBuffSize * GetBufferSize());
+      fParallel = (fgParallel == kForce || info.fCpus != 1);
 
-      if(gDebug > 0)
+      if(gDebug > 0 && fParallel)
          Info("TTreeCacheUnzip", "Enabling Parallel Unzipping");
-
-      fParallel = kTRUE;
-
-      for (Int_t i = 0; i < 10; i++) fUnzipThread[i] = 0;
-
-      StartThreadUnzip(THREADCNT);
-
+#else
+      fParallel = kFALSE;
+#endif
    }
    else {
       Warning("TTreeCacheUnzip", "Parallel Option unknown");
    }
-
-   // Check if asynchronous reading is supported by this TFile specialization
-   if (gEnv->GetValue("TFile.AsyncReading", 1)) {
-      if (fFile && !(fFile->ReadBufferAsync(0, 0)))
-         fAsyncReading = kTRUE;
-   }
-
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -170,19 +461,12 @@ TTreeCacheUnzip::~TTreeCacheUnzip()
 {
    ResetCache();
 
-   if (IsActiveThread())
-      StopThreadUnzip();
-
-   delete [] fUnzipLen;
-
-   delete fUnzipStartCondition;
-   delete fUnzipDoneCondition;
-
+   // The tasks still running only use their unzipping state; wait for them
+   // before the task group goes away.
+   fUnzipTasks->Wait();
+   delete fUnzipTasks;
    delete fMutexList;
    delete fIOMutex;
-
-   delete [] fUnzipStatus;
-   delete [] fUnzipChunks;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -221,7 +505,6 @@ Bool_t TTreeCacheUnzip::FillBuffer()
    {
       // Fill the cache buffer with the branches in the cache.
       R__LOCKGUARD(fMutexList);
-      fIsTransferred = kFALSE;
 
       TTree *tree = ((TBranch*)fBranches->UncheckedAt(0))->GetTree();
       Long64_t entry = tree->GetReadEntry();
@@ -256,6 +539,10 @@ Bool_t TTreeCacheUnzip::FillBuffer()
          }
       }
 
+      // The tasks unzip a copy of the blocks, the cache buffer can be reused
+      StopUnzipTasks();
+      fIsTransferred = kFALSE;
+
       //clear cache buffer
       TFileCacheRead::Prefetch(0,0);
 
@@ -293,7 +580,7 @@ Bool_t TTreeCacheUnzip::FillBuffer()
          if (gDebug > 0) printf("Entry: %lld, registering baskets branch %s, fEntryNext=%lld, fNseek=%d, fNtot=%d\n",entry,((TBranch*)fBranches->UncheckedAt(i))->GetName(),fEntryNext,fNseek,fNtot);
       }
 
-      // Now fix the size of the status arrays
+      // Now forget the blocks of the previous cluster
       ResetCache();
 
       fIsLearning = kFALSE;
@@ -314,6 +601,7 @@ Int_t TTreeCacheUnzip::SetBufferSize(Int_t buffersize)
 {
    R__LOCKGUARD(fMutexList);
 
+   StopUnzipTasks();
    Int_t res = TTreeCache::SetBufferSize(buffersize);
    if (res < 0) {
       return res;
@@ -335,6 +623,18 @@ void TTreeCacheUnzip::SetEntryRange(Long64_t emin, Long64_t emax)
    TTreeCache::SetEntryRange(emin, emax);
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Change the file that is being cached. The unzip tasks of the current
+/// cluster are stopped first since the cache buffer is going to be reused.
+
+void TTreeCacheUnzip::SetFile(TFile *file, TFile::ECacheAction action)
+{
+   R__LOCKGUARD(fMutexList);
+
+   ResetCache();
+   TTreeCache::SetFile(file, action);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// It's the same as TTreeCache::StopLearningPhase but we guarantee that
 /// we start the unzipping just after getting the buffers
@@ -359,7 +659,7 @@ void TTreeCacheUnzip::UpdateBranches(TTree *tree)
 
 ////////////////////////////////////////////////////////////////////////////////
 //                                                                            //
-// From now on we have the methods concerning the threading part of the cache //
+// From now on we have the methods concerning the parallel part of the cache  //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -383,204 +683,64 @@ Bool_t TTreeCacheUnzip::IsParallelUnzip()
    return kFALSE;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-/// This indicates if the thread is active in this moment...
-/// this variable is very important because if we change it from true to
-/// false the thread will stop... ( see StopThreadTreeCacheUnzip() )
-
-Bool_t TTreeCacheUnzip::IsActiveThread()
-{
-   R__LOCKGUARD(fMutexList);
-
-   return fActiveThread;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// It says if the queue is empty... useful to see if we have to process it.
-
-Bool_t TTreeCacheUnzip::IsQueueEmpty()
-{
-   R__LOCKGUARD(fMutexList);
-
-   if ( fIsLearning )
-      return kTRUE;
-
-   return kFALSE;
-}
-
-void TTreeCacheUnzip::WaitUnzipStartSignal()
-{
-   // Here the threads sleep waiting for some blocks to unzip
-
-   fUnzipStartCondition->TimedWaitRelative(2000);
-
-}
-
-////////////////////////////////////////////////////////////////////////////////
-/// This will send the signal corresponfing to the queue... normally used
-/// when we want to start processing the list of buffers.
-
-void TTreeCacheUnzip::SendUnzipStartSignal(Bool_t broadcast)
-{
-   if (gDebug > 0) Info("SendSignal", " fUnzipCondition->Signal()");
-
-   if (broadcast)
-      fUnzipStartCondition->Broadcast();
-   else
-      fUnzipStartCondition->Signal();
-}
-
 ////////////////////////////////////////////////////////////////////////////////
 /// Static function that (de)activates multithreading unzipping
 ///
 /// The possible options are:
-///  - kEnable _Enable_ it, which causes an automatic detection and launches the
-///    additional thread if the number of cores in the machine is greater than
-///    one
-///  - kDisable _Disable_ will not activate the additional thread.
-///  - kForce _Force_ will start the additional thread even if there is only one
+///  - kEnable _Enable_ it, which causes an automatic detection and unzips
+///    the baskets in parallel if the number of cores in the machine is
+///    greater than one
+///  - kDisable _Disable_ will not unzip in parallel.
+///  - kForce _Force_ will unzip in parallel even if there is only one
 ///    core. the default will be taken as kEnable.
 ///
-/// Returns 0 if there was an error, 1 otherwise.
+/// The setting applies to the caches created afterwards.
+/// Returns 0 if there was an error (or if ROOT was built without the
+/// support for implicit multi-threading), 1 otherwise.
 
 Int_t TTreeCacheUnzip::SetParallelUnzip(TTreeCacheUnzip::EParUnzipMode option)
 {
-   if(fgParallel == kEnable || fgParallel == kForce || fgParallel == kDisable) {
+#ifndef R__USE_IMT
+   if (option != kDisable) {
+      ::Warning("TTreeCacheUnzip::SetParallelUnzip", "ROOT was built without imt support, the baskets are unzipped serially");
+      return 0;
+   }
+#endif
+   if(option == kEnable || option == kForce || option == kDisable) {
       fgParallel = option;
       return 1;
    }
    return 0;
 }
 
-class TTreeCacheUnzipData {
-public:
-   TTreeCacheUnzip *fInstance;
-   Int_t            fCount;
-};
-
-////////////////////////////////////////////////////////////////////////////////
-/// The Thread is only a part of the TTreeCache but it is the part that
-/// waits for info in the queue and process it... unfortunatly, a Thread is
-/// not an object an we have to deal with it in the old C-Style way
-/// Returns 0 if the thread was initialized or 1 if it was already running
-
-Int_t TTreeCacheUnzip::StartThreadUnzip(Int_t nthreads)
-{
-   Int_t nt = nthreads;
-   if (nt > 10) nt = 10;
-
-   if (gDebug > 0)
-      Info("StartThreadUnzip", "Going to start %d threads.", nt);
-
-   for (Int_t i = 0; i < nt; i++) {
-      if (!fUnzipThread[i]) {
-         TString nm("UnzipLoop");
-         nm += i;
-
-         if (gDebug > 0)
-            Info("StartThreadUnzip", "Going to start thread '%s'", nm.Data());
-
-         TTreeCacheUnzipData *d = new TTreeCacheUnzipData;
-         d->fInstance = this;
-         d->fCount = i;
-
-         fUnzipThread[i] = new TThread(nm.Data(), UnzipLoop, (void*)d);
-         if (!fUnzipThread[i])
-            Error("TTreeCacheUnzip::StartThreadUnzip", " Unable to create new thread.");
-
-         fUnzipThread[i]->Run();
-
-         // There is at least one active thread
-         fActiveThread=kTRUE;
-
-      }
-   }
-
-   return (fActiveThread == kTRUE);
-}
-
 ////////////////////////////////////////////////////////////////////////////////
-/// To stop the thread we only need to change the value of the variable
-/// fActiveThread to false and the loop will stop (of course, we will have)
-/// to do the cleaning after that.
-///
-/// Note: The syncronization part is important here or we will try to delete
-///       teh object while it's still processing the queue
+/// Hand the blocks of the current cluster to the task scheduler, one task
+/// per block. The tasks unzip the blocks from a copy of the cache buffer
+/// held by the unzipping state.
 
-Int_t TTreeCacheUnzip::StopThreadUnzip()
+void TTreeCacheUnzip::StartUnzipTasks()
 {
-   fActiveThread = kFALSE;
-
-   for (Int_t i = 0; i < 1; i++) {
-      if(fUnzipThread[i]){
+   fTasksStarted = kTRUE;
 
-         SendUnzipStartSignal(kTRUE);
-
-         if (fUnzipThread[i]->Exists()) {
-            fUnzipThread[i]->Join();
-            delete fUnzipThread[i];
-         }
-      }
+   Bool_t oldFile = ((TBranch*)fBranches->UncheckedAt(0))->GetCompressionLevel()!=0
+      && fFile->GetVersion()<=30401;
+   fUnzipState = std::make_shared<TTreeCacheUnzipState>(fNseek, fBuffer, fNtot, fSeekPos, fUnzipBufferSize, oldFile);
 
+   if (!ROOT::IsImplicitMTEnabled()) return;
+   for (Int_t loc = 0; loc < fNseek; ++loc) {
+      fUnzipState->Spawn(fUnzipTasks, loc);
    }
-
-   return 1;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// This is a static function.
-///
-/// This is the call that will be executed in the Thread generated by
-/// StartThreadTreeCacheUnzip... what we want to do is to inflate the next
-/// series of buffers leaving them in the second cache.
-///
-/// Returns 0 when it finishes
+/// Cancel the unzip tasks of the current cluster which did not start yet.
+/// The running ones are not waited for (this is called with fMutexList
+/// held), they finish on the copy of the blocks. The unzipped blocks stay
+/// available.
 
-void* TTreeCacheUnzip::UnzipLoop(void *arg)
+void TTreeCacheUnzip::StopUnzipTasks()
 {
-   TTreeCacheUnzipData *d = (TTreeCacheUnzipData *)arg;
-   TTreeCacheUnzip *unzipMng = d->fInstance;
-
-   TThread::SetCancelOn();
-   TThread::SetCancelDeferred();
-
-   Int_t thrnum = d->fCount;
-   Int_t startindex = thrnum;
-   Int_t locbuffsz = 16384;
-   char *locbuff = new char[16384];
-   Int_t res = 0;
-   Int_t myCycle = 0;
-
-   while( unzipMng->IsActiveThread() ) {
-      res = 1;
-
-      {
-         R__LOCKGUARD(unzipMng->fMutexList);
-         if (myCycle != unzipMng->fCycle) startindex = thrnum;
-         myCycle = unzipMng->fCycle;
-         if (unzipMng->fNseek) startindex = startindex % unzipMng->fNseek;
-         else startindex = -1;
-      }
-
-      if (startindex >= 0)
-         res = unzipMng->UnzipCache(startindex, locbuffsz, locbuff);
-
-      {
-         R__LOCKGUARD(unzipMng->fMutexList);
-
-         if(!unzipMng->IsActiveThread()) break;
-
-         if ((res == 1) || (!unzipMng->fIsTransferred)) {
-            unzipMng->WaitUnzipStartSignal();
-            startindex = unzipMng->fLastReadPos+3+thrnum;
-         }
-      }
-
-   }
-
-   delete d;
-   delete [] locbuff;
-   return (void *)0;
+   if (fUnzipState) fUnzipState->Cancel();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -609,25 +769,8 @@ void* TTreeCacheUnzip::UnzipLoop(void *arg)
 
 Int_t TTreeCacheUnzip::GetRecordHeader(char *buf, Int_t maxbytes, Int_t &nbytes, Int_t &objlen, Int_t &keylen)
 {
-   Version_t versionkey;
-   Short_t klen;
-   UInt_t datime;
-   Int_t nb = 0,olen;
-   Int_t nread = maxbytes;
-   frombuf(buf,&nb);
-   nbytes = nb;
-   if (nb < 0) return nread;
-   //   const Int_t headerSize = Int_t(sizeof(nb) +sizeof(versionkey) +sizeof(olen) +sizeof(datime) +sizeof(klen));
-   const Int_t headerSize = 16;
-   if (nread < headerSize) return nread;
-   frombuf(buf, &versionkey);
-   frombuf(buf, &olen);
-   frombuf(buf, &datime);
-   frombuf(buf, &klen);
-   if (!olen) olen = nbytes-klen;
-   objlen = olen;
-   keylen = klen;
-   return nread;
+   R__ReadRecordHeader(buf, maxbytes, nbytes, objlen, keylen);
+   return maxbytes;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -641,63 +784,26 @@ Int_t TTreeCacheUnzip::GetRecordHeader(char *buf, Int_t maxbytes, Int_t &nbytes,
 
 void TTreeCacheUnzip::ResetCache()
 {
-   {
    R__LOCKGUARD(fMutexList);
 
    if (gDebug > 0)
-      Info("ResetCache", "Thread: %ld -- Resetting the cache. fNseek:%d fNSeekMax:%d fTotalUnzipBytes:%lld", TThread::SelfId(), fNseek, fNseekMax, fTotalUnzipBytes);
-
-   // Reset all the lists and wipe all the chunks
-   fCycle++;
-   for (Int_t i = 0; i < fNseekMax; i++) {
-      if (fUnzipLen) fUnzipLen[i] = 0;
-      if (fUnzipChunks) {
-         if (fUnzipChunks[i]) delete [] fUnzipChunks[i];
-         fUnzipChunks[i] = 0;
-      }
-      if (fUnzipStatus) fUnzipStatus[i] = 0;
-
-   }
-
-   while (fActiveBlks.size()) fActiveBlks.pop();
-
-   if(fNseekMax < fNseek){
-      if (gDebug > 0)
-         Info("ResetCache", "Changing fNseekMax from:%d to:%d", fNseekMax, fNseek);
-
-      Byte_t *aUnzipStatus = new Byte_t[fNseek];
-      memset(aUnzipStatus, 0, fNseek*sizeof(Byte_t));
-
-      Int_t *aUnzipLen = new Int_t[fNseek];
-      memset(aUnzipLen, 0, fNseek*sizeof(Int_t));
-
-      char **aUnzipChunks = new char *[fNseek];
-      memset(aUnzipChunks, 0, fNseek*sizeof(char *));
-
-      if (fUnzipStatus) delete [] fUnzipStatus;
-      if (fUnzipLen) delete [] fUnzipLen;
-      if (fUnzipChunks) delete [] fUnzipChunks;
-
-      fUnzipStatus  = aUnzipStatus;
-      fUnzipLen  = aUnzipLen;
-      fUnzipChunks = aUnzipChunks;
-
-      fNseekMax  = fNseek;
+      Info("ResetCache", "Resetting the cache. fNseek:%d", fNseek);
+
+   StopUnzipTasks();
+   if (fUnzipState) {
+      fNUnzip += fUnzipState->fNUnzip;
+      // Unzipped blocks which were not read are released with the state,
+      // possibly by a reader still waiting for one of its blocks.
+      fUnzipState.reset();
    }
-
-   fLastReadPos = 0;
-   fTotalUnzipBytes = 0;
-   fBlocksToGo = fNseek;
-   }
-
-   SendUnzipStartSignal(kTRUE);
-
+   fTasksStarted = kFALSE;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 /// We try to read a buffer that has already been unzipped
-/// Returns -1 in case of read failure, 0 in case it's not in the
-/// cache and n>0 in case read from cache (number of bytes copied).
+/// Returns -1 if the block is not handled by the parallel unzipping (the
+/// caller then reads and unzips it as usual) and n>0 (number of bytes of
+/// the unzipped buffer) if the unzipped block is provided.
 /// pos and len are the original values as were passed to ReadBuffer
 /// but instead we will return the inflated buffer.
 /// Note!! : If *buf == 0 we will allocate the buffer and it will be the
@@ -706,213 +812,72 @@ void TTreeCacheUnzip::ResetCache()
 
 Int_t TTreeCacheUnzip::GetUnzipBuffer(char **buf, Long64_t pos, Int_t len, Bool_t *free)
 {
-   Int_t res = 0;
-   Int_t loc = -1;
+   if (!fParallel || !ROOT::IsImplicitMTEnabled()) return -1;
 
+   std::shared_ptr<TTreeCacheUnzipState> state;
+   Int_t loc = -1;
    {
       R__LOCKGUARD(fMutexList);
 
-      // We go straight to TTreeCache/TfileCacheRead, in order to get the info we need
-      //  pointer to the original zipped chunk
-      //  its index in the original unsorted offsets lists
-      //
-      // Actually there are situations in which copying the buffer is not
-      // useful. But the choice is among doing once more a small memcpy or a binary search in a large array. I prefer the former.
-      // Also, here we prefer not to trigger the (re)population of the chunks in the TFileCacheRead. That is
-      // better to be done in the main thread.
-
-      // And now loc is the position of the chunk in the array of the sorted chunks
-      Int_t myCycle = fCycle;
-
-      if (fParallel && !fIsLearning) {
-
-         if(fNseekMax < fNseek){
-            if (gDebug > 0)
-               Info("GetUnzipBuffer", "Changing fNseekMax from:%d to:%d", fNseekMax, fNseek);
-
-            Byte_t *aUnzipStatus = new Byte_t[fNseek];
-            memset(aUnzipStatus, 0, fNseek*sizeof(Byte_t));
-
-            Int_t *aUnzipLen = new Int_t[fNseek];
-            memset(aUnzipLen, 0, fNseek*sizeof(Int_t));
-
-            char **aUnzipChunks = new char *[fNseek];
-            memset(aUnzipChunks, 0, fNseek*sizeof(char *));
-
-            for (Int_t i = 0; i < fNseekMax; i++) {
-               aUnzipStatus[i] = fUnzipStatus[i];
-               aUnzipLen[i] = fUnzipLen[i];
-               aUnzipChunks[i] = fUnzipChunks[i];
-            }
-
-            if (fUnzipStatus) delete [] fUnzipStatus;
-            if (fUnzipLen) delete [] fUnzipLen;
-            if (fUnzipChunks) delete [] fUnzipChunks;
-
-            fUnzipStatus  = aUnzipStatus;
-            fUnzipLen  = aUnzipLen;
-            fUnzipChunks = aUnzipChunks;
-
-            fNseekMax  = fNseek;
-         }
-
-         loc = (Int_t)TMath::BinarySearch(fNseek,fSeekSort,pos);
-         if ( (fCycle == myCycle) && (loc >= 0) && (loc < fNseek) && (pos == fSeekSort[loc]) ) {
-
-            // The buffer is, at minimum, in the file cache. We must know its index in the requests list
-            // In order to get its info
-            Int_t seekidx = fSeekIndex[loc];
-
-            fLastReadPos = seekidx;
-
-            do {
-
-               // If the block is ready we get it immediately.
-               // And also we don't have to alloc the blks. This is supposed to be
-               // the main thread of the app.
-               if ((fUnzipStatus[seekidx] == 2) && (fUnzipChunks[seekidx]) && (fUnzipLen[seekidx] > 0)) {
-
-                  //if (gDebug > 0)
-                  //   Info("GetUnzipBuffer", "++++++++++++++++++++ CacheHIT Block wanted: %d  len:%d req_len:%d fNseek:%d", seekidx, fUnzipLen[seekidx], len,  fNseek);
-
-                  if(!(*buf)) {
-                     *buf = fUnzipChunks[seekidx];
-                     fUnzipChunks[seekidx] = 0;
-                     fTotalUnzipBytes -= fUnzipLen[seekidx];
-                     SendUnzipStartSignal(kFALSE);
-                     *free = kTRUE;
-                  }
-                  else {
-                     memcpy(*buf, fUnzipChunks[seekidx], fUnzipLen[seekidx]);
-                     delete fUnzipChunks[seekidx];
-                     fTotalUnzipBytes -= fUnzipLen[seekidx];
-                     fUnzipChunks[seekidx] = 0;
-                     SendUnzipStartSignal(kFALSE);
-                     *free = kFALSE;
-                  }
-
-                  fNFound++;
-
-                  return fUnzipLen[seekidx];
-               }
-
-               // If the status of the unzipped chunk is pending
-               // we wait on the condvar, hoping that the next signal is the good one
-               if ( fUnzipStatus[seekidx] == 1 ) {
-                  //fMutexList->UnLock();
-                  fUnzipDoneCondition->TimedWaitRelative(200);
-                  //fMutexList->Lock();
-
-                  if ( myCycle != fCycle ) {
-                     if (gDebug > 0)
-                        Info("GetUnzipBuffer", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                             IsActiveThread(), fNseek, fIsLearning);
-
-                     fLastReadPos = 0;
-
-                     seekidx = -1;
-                     break;
-                  }
-
-               }
-
-            } while ( fUnzipStatus[seekidx] == 1 );
-
-            //if (gDebug > 0)
-            //   Info("GetUnzipBuffer", "------- Block wanted: %d  status: %d len: %d chunk: %llx ", seekidx, fUnzipStatus[seekidx], fUnzipLen[seekidx], fUnzipChunks[seekidx]);
-
-            // Here the block is not pending. It could be done or aborted or not yet being processed.
-            if ( (seekidx >= 0) && (fUnzipStatus[seekidx] == 2) && (fUnzipChunks[seekidx]) && (fUnzipLen[seekidx] > 0) ) {
-
-               //if (gDebug > 0)
-               //   Info("GetUnzipBuffer", "++++++++++++++++++++ CacheLateHIT Block wanted: %d  len:%d fNseek:%d", seekidx, fUnzipLen[seekidx], fNseek);
-
-               if(!(*buf)) {
-                  *buf = fUnzipChunks[seekidx];
-                  fUnzipChunks[seekidx] = 0;
-                  fTotalUnzipBytes -= fUnzipLen[seekidx];
-                  SendUnzipStartSignal(kFALSE);
-                  *free = kTRUE;
-               }
-               else {
-                  memcpy(*buf, fUnzipChunks[seekidx], fUnzipLen[seekidx]);
-                  delete fUnzipChunks[seekidx];
-                  fTotalUnzipBytes -= fUnzipLen[seekidx];
-                  fUnzipChunks[seekidx] = 0;
-                  SendUnzipStartSignal(kFALSE);
-                  *free = kFALSE;
-               }
-
-               fNStalls++;
-
-               return fUnzipLen[seekidx];
-            }
-            else {
-               // This is a complete miss. We want to avoid the threads
-               // to try unzipping this block in the future.
-               fUnzipStatus[seekidx] = 2;
-               fUnzipChunks[seekidx] = 0;
-
-               if ((fTotalUnzipBytes < fUnzipBufferSize) && fBlocksToGo)
-                  SendUnzipStartSignal(kFALSE);
-
-               //if (gDebug > 0)
-               //   Info("GetUnzipBuffer", "++++++++++++++++++++ CacheMISS Block wanted: %d  len:%d fNseek:%d", seekidx, len, fNseek);
-            }
-
-         } else {
-            loc = -1;
-            //fLastReadPos = 0;
-            fIsTransferred = kFALSE;
-         }
-
-      } else {
-         // We need to reset it for new transferences...
-         //ResetCache();
-         //TFileCacheRead::Prefetch(0,0);
+      // The tasks unzip the blocks directly from the buffer filled with a
+      // vectored read. When this buffer is not used we leave the job to TBasket.
+      if (fIsLearning || !fEnabled || fAsyncReading || fEnablePrefetching) return -1;
+      if (!fFile || fFile->GetCacheWrite()) return -1;
+
+      // Make sure that the cluster is transferred and locate the block in it.
+      // Without a destination buffer nothing is copied.
+      Int_t res = ReadBufferExt(0, pos, len, loc);
+      if (res == 0 && FillBuffer()) {
+         loc = -1;
+         res = ReadBufferExt(0, pos, len, loc);
       }
-
-   } // scope of the lock!
-
-   if (len > fCompBufferSize) {
-      delete [] fCompBuffer;
-      fCompBuffer = new char[len];
-      fCompBufferSize = len;
-   } else {
-      if (fCompBufferSize > len*4) {
-      delete [] fCompBuffer;
-      fCompBuffer = new char[len*2];
-      fCompBufferSize = len*2;
+      if (res != 1 || !fBuffer || loc < 0 || loc >= fNseek) return -1;
+
+      if (!fTasksStarted) StartUnzipTasks();
+      state = fUnzipState;
+      if (!state || loc >= state->fNblocks) return -1;
+
+      if (state->Claim(loc, TTreeCacheUnzipState::kFinished)) {
+         // No task got to this block yet, unzip it here.
+         Bool_t alloc = (*buf == 0);
+         Int_t nout = R__UnzipRecord(buf, fBuffer + fSeekPos[loc], state->fOldFile);
+         if (nout < 0) return -1;
+         *free = alloc;
+         fNMissed++;
+         return nout;
       }
    }
 
-   {
-      R__LOCKGUARD(fIOMutex);
-      // Here we know that the async unzip of the wanted chunk
-      // was not done for some reason. We continue.
-
-      res = 0;
-      if (!ReadBufferExt(fCompBuffer, pos, len, loc)) {
-         //Info("GetUnzipBuffer", "++++++++++++++++++++ CacheMISS %d %d", loc, fNseek);
-         fFile->Seek(pos);
-         res = fFile->ReadBuffer(fCompBuffer, len);
-      }
-
-      if (res) res = -1;
+   // Wait for the task unzipping the block without holding the lock, so
+   // that the other readers of the cache are not blocked meanwhile. The
+   // state stays alive even if the cache moves to another cluster.
+   Bool_t stalled = (state->fStatus[loc].load() == TTreeCacheUnzipState::kProgress);
+   if (stalled) state->Wait(loc);
 
-   } // scope of the lock!
+   R__LOCKGUARD(fMutexList);
 
-   if (!res) {
-      res = UnzipBuffer(buf, fCompBuffer);
-      *free = kTRUE;
+   char *chunk = state->fChunks[loc];
+   if (!chunk) {
+      // Already handed to a basket or the task failed to unzip it
+      return -1;
    }
-
-   if (!fIsLearning) {
-      fNMissed++;
+   Int_t nout = state->fLen[loc];
+   state->fChunks[loc] = 0;
+   state->fTotalUnzipBytes -= nout;
+   if (state == fUnzipState) state->Respawn(fUnzipTasks, loc + 1);
+   if (!(*buf)) {
+      *buf = chunk;
+      *free = kTRUE;
+   } else {
+      memcpy(*buf, chunk, nout);
+      delete [] chunk;
+      *free = kFALSE;
    }
 
-   return res;
+   if (stalled) fNStalls++;
+   else         fNFound++;
 
+   return nout;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -925,7 +890,8 @@ void TTreeCacheUnzip::SetUnzipRelBufferSize(Float_t relbufferSize)
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Sets the size for the unzipping cache... by default it should be
-/// two times the size of the prefetching cache
+/// half of the size of the prefetching cache.
+/// It applies from the next cluster on.
 
 void TTreeCacheUnzip::SetUnzipBufferSize(Long64_t bufferSize)
 {
@@ -945,308 +911,22 @@ void TTreeCacheUnzip::SetUnzipBufferSize(Long64_t bufferSize)
 
 Int_t TTreeCacheUnzip::UnzipBuffer(char **dest, char *src)
 {
-   Int_t  uzlen = 0;
-   Bool_t alloc = kFALSE;
-
-   // Here we read the header of the buffer
-   const Int_t hlen=128;
-   Int_t nbytes=0, objlen=0, keylen=0;
-   GetRecordHeader(src, hlen, nbytes, objlen, keylen);
-
-   if (!(*dest)) {
-      /* early consistency check */
-      UChar_t *bufcur = (UChar_t *) (src + keylen);
-      Int_t nin, nbuf;
-      if(R__unzip_header(&nin, bufcur, &nbuf)!=0) {
-         Error("UnzipBuffer", "Inconsistency found in header (nin=%d, nbuf=%d)", nin, nbuf);
-         uzlen = -1;
-         return uzlen;
-      }
-      Int_t l = keylen+objlen;
-      *dest = new char[l];
-      alloc = kTRUE;
-   }
-   // Must unzip the buffer
-   // fSeekPos[ind]; adress of zipped buffer
-   // fSeekLen[ind]; len of the zipped buffer
-   // &fBuffer[fSeekPos[ind]]; memory address
-
-   // This is similar to TBasket::ReadBasketBuffers
-   Bool_t oldCase = objlen==nbytes-keylen
-      && ((TBranch*)fBranches->UncheckedAt(0))->GetCompressionLevel()!=0
+   Bool_t oldFile = ((TBranch*)fBranches->UncheckedAt(0))->GetCompressionLevel()!=0
       && fFile->GetVersion()<=30401;
-
-   if (objlen > nbytes-keylen || oldCase) {
-
-      // Copy the key
-      memcpy(*dest, src, keylen);
-      uzlen += keylen;
-
-      char *objbuf = *dest + keylen;
-      UChar_t *bufcur = (UChar_t *) (src + keylen);
-      Int_t nin, nbuf;
-      Int_t nout = 0;
-      Int_t noutot = 0;
-
-      while (1) {
-         Int_t hc = R__unzip_header(&nin, bufcur, &nbuf);
-         if (hc!=0) break;
-         if (gDebug > 2)
-            Info("UnzipBuffer", " nin:%d, nbuf:%d, bufcur[3] :%d, bufcur[4] :%d, bufcur[5] :%d ",
-                 nin, nbuf, bufcur[3], bufcur[4], bufcur[5]);
-         if (oldCase && (nin > objlen || nbuf > objlen)) {
-            if (gDebug > 2)
-               Info("UnzipBuffer", "oldcase objlen :%d ", objlen);
-
-            //buffer was very likely not compressed in an old version
-            memcpy( *dest + keylen, src + keylen, objlen);
-            uzlen += objlen;
-            return uzlen;
-         }
-
-         R__unzip(&nin, bufcur, &nbuf, objbuf, &nout);
-
-         if (gDebug > 2)
-            Info("UnzipBuffer", "R__unzip nin:%d, bufcur:%p, nbuf:%d, objbuf:%p, nout:%d",
-                 nin, bufcur, nbuf, objbuf, nout);
-
-         if (!nout) break;
-         noutot += nout;
-         if (noutot >= objlen) break;
-         bufcur += nin;
-         objbuf += nout;
-      }
-
-      if (noutot != objlen) {
-         Error("UnzipBuffer", "nbytes = %d, keylen = %d, objlen = %d, noutot = %d, nout=%d, nin=%d, nbuf=%d",
-               nbytes,keylen,objlen, noutot,nout,nin,nbuf);
-         uzlen = -1;
-         if(alloc) delete [] *dest;
-         *dest = 0;
-         return uzlen;
-      }
-      uzlen += objlen;
-   } else {
-      memcpy(*dest, src, keylen);
-      uzlen += keylen;
-      memcpy(*dest + keylen, src + keylen, objlen);
-      uzlen += objlen;
-   }
-   return uzlen;
+   return R__UnzipRecord(dest, src, oldFile);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// This inflates all the buffers in the cache.. passing the data to a new
-/// buffer that will only wait there to be read...
-/// We can not inflate all the buffers in the cache so we will try to do
-/// it until the cache gets full... there is a member called fUnzipBufferSize which will
-/// tell us the max size we can allocate for this cache.
-///
-/// note that we will  unzip in the order they were put into the cache not
-/// the order of the transference so it has to be read in that order or the
-/// pre-unzipping will be useless.
-///
-/// startindex is used as start index to check for blks to be unzipped
-///
-/// returns 0 in normal conditions or -1 if error, 1 if it would like to sleep
-///
-/// This func is supposed to compete among an indefinite number of threads to get a chunk to inflate
-/// in order to accommodate multiple unzippers
-/// Since everything is so async, we cannot use a fixed buffer, we are forced to keep
-/// the individual chunks as separate blocks, whose summed size does not exceed the maximum
-/// allowed. The pointers are kept globally in the array fUnzipChunks
-
-Int_t TTreeCacheUnzip::UnzipCache(Int_t &startindex, Int_t &locbuffsz, char *&locbuff)
-{
-   Int_t myCycle;
-   const Int_t hlen=128;
-   Int_t objlen=0, keylen=0;
-   Int_t nbytes=0;
-   Int_t readbuf = 0;
-
-   Int_t idxtounzip = -1;
-   Long64_t rdoffs = 0;
-   Int_t rdlen = 0;
-   {
-      R__LOCKGUARD(fMutexList);
-
-      if (!IsActiveThread() || !fNseek || fIsLearning || !fIsTransferred) {
-         if (gDebug > 0)
-            Info("UnzipCache", "Sudden Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                 IsActiveThread(), fNseek, fIsLearning);
-         return 1;
-      }
-
-      // To synchronize with the 'paging'
-      myCycle = fCycle;
-
-      // Try to look for a blk to unzip
-      idxtounzip = -1;
-      rdoffs = 0;
-      rdlen = 0;
-      if (fTotalUnzipBytes < fUnzipBufferSize) {
-
-         if (fBlocksToGo > 0) {
-            for (Int_t ii=0; ii < fNseek; ii++) {
-               Int_t reqi = (startindex+ii) % fNseek;
-               if (!fUnzipStatus[reqi] && (fSeekLen[reqi] > 256)   ) {
-                  // We found a chunk which is not unzipped nor pending
-                  fUnzipStatus[reqi] = 1; // Set it as pending
-                  idxtounzip = reqi;
-
-                  rdoffs = fSeek[idxtounzip];
-                  rdlen = fSeekLen[idxtounzip];
-                  break;
-               }
-            }
-            if (idxtounzip < 0) fBlocksToGo = 0;
-         }
-      }
-
-   } // lock scope
-
-   if (idxtounzip < 0) {
-      if (gDebug > 0)
-         Info("UnzipCache", "Nothing to do... startindex:%d fTotalUnzipBytes:%lld fUnzipBufferSize:%lld fNseek:%d",
-              startindex, fTotalUnzipBytes, fUnzipBufferSize, fNseek );
-      return 1;
-   }
-
-   // And here we have a new blk to unzip
-   startindex = idxtounzip+THREADCNT;
-
-   if (!IsActiveThread() || !fNseek || fIsLearning ) {
-      if (gDebug > 0)
-         Info("UnzipCache", "Sudden Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-              IsActiveThread(), fNseek, fIsLearning);
-      return 1;
-   }
-
-   Int_t loc = -1;
-
-   // Prepare a static tmp buf of adequate size
-   if(locbuffsz < rdlen) {
-      if (locbuff) delete [] locbuff;
-      locbuffsz = rdlen;
-      locbuff = new char[locbuffsz];
-      //memset(locbuff, 0, locbuffsz);
-   } else
-      if(locbuffsz > rdlen*3) {
-         if (locbuff) delete [] locbuff;
-         locbuffsz = rdlen*2;
-         locbuff = new char[locbuffsz];
-         //memset(locbuff, 0, locbuffsz);
-      }
-
-      if (gDebug > 0)
-      Info("UnzipCache", "Going to unzip block %d", idxtounzip);
-
-      readbuf = ReadBufferExt(locbuff, rdoffs, rdlen, loc);
-
-   {
-      R__LOCKGUARD(fMutexList);
-
-      if ( (myCycle != fCycle) || !fIsTransferred )  {
-         if (gDebug > 0)
-            Info("UnzipCache", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                 IsActiveThread(), fNseek, fIsLearning);
-
-         fUnzipStatus[idxtounzip] = 2; // Set it as not done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-         fUnzipDoneCondition->Signal();
-
-         startindex = 0;
-         return 1;
-      }
-
-      if (readbuf <= 0) {
-         fUnzipStatus[idxtounzip] = 2; // Set it as not done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-         if (gDebug > 0)
-            Info("UnzipCache", "Block %d not done. rdoffs=%lld rdlen=%d readbuf=%d", idxtounzip, rdoffs, rdlen, readbuf);
-         return -1;
-      }
-
-      GetRecordHeader(locbuff, hlen, nbytes, objlen, keylen);
-
-      Int_t len = (objlen > nbytes-keylen)? keylen+objlen : nbytes;
-
-      // If the single unzipped chunk is really too big, reset it to not processable
-      // I.e. mark it as done but set the pointer to 0
-      // This block will be unzipped synchronously in the main thread
-      if (len > 4*fUnzipBufferSize) {
-
-         //if (gDebug > 0)
-            Info("UnzipCache", "Block %d is too big, skipping.", idxtounzip);
-
-         fUnzipStatus[idxtounzip] = 2; // Set it as done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-
-         fUnzipDoneCondition->Signal();
-         return 0;
-      }
-
-   } // Scope of the lock
-
-   // Unzip it into a new blk
-   char *ptr = 0;
-   Int_t loclen = 0;
-
-   loclen = UnzipBuffer(&ptr, locbuff);
-
-   if ((loclen > 0) && (loclen == objlen+keylen)) {
-      R__LOCKGUARD(fMutexList);
-
-      if ( (myCycle != fCycle)  || !fIsTransferred) {
-         if (gDebug > 0)
-            Info("UnzipCache", "Sudden paging Break!!! IsActiveThread(): %d, fNseek: %d, fIsLearning:%d",
-                 IsActiveThread(), fNseek, fIsLearning);
-         delete [] ptr;
-
-         fUnzipStatus[idxtounzip] = 2; // Set it as not done
-         fUnzipChunks[idxtounzip] = 0;
-         fUnzipLen[idxtounzip] = 0;
-
-         startindex = 0;
-         fUnzipDoneCondition->Signal();
-         return 1;
-      }
-
-      fUnzipStatus[idxtounzip] = 2; // Set it as done
-      fUnzipChunks[idxtounzip] = ptr;
-      fUnzipLen[idxtounzip] = loclen;
-      fTotalUnzipBytes += loclen;
-
-      fActiveBlks.push(idxtounzip);
-
-      if (gDebug > 0)
-         Info("UnzipCache", "reqi:%d, rdoffs:%lld, rdlen: %d, loclen:%d",
-              idxtounzip, rdoffs, rdlen, loclen);
-
-      fNUnzip++;
-   }
-   else {
-      R__LOCKGUARD(fMutexList);
-      Info("argh", "loclen:%d objlen:%d loc:%d readbuf:%d", loclen, objlen, loc, readbuf);
-      fUnzipStatus[idxtounzip] = 2; // Set it as done
-      fUnzipChunks[idxtounzip] = 0;
-      fUnzipLen[idxtounzip] = 0;
-   }
-
-   fUnzipDoneCondition->Signal();
-
-   delete [] ptr;
-   return 0;
-}
+/// Print cache statistics.
 
 void  TTreeCacheUnzip::Print(Option_t* option) const {
 
+   Int_t nunzip = fNUnzip;
+   if (fUnzipState) nunzip += fUnzipState->fNUnzip;
+
    printf("******TreeCacheUnzip statistics for file: %s ******\n",fFile->GetName());
    printf("Max allowed mem for pending buffers: %lld\n", fUnzipBufferSize);
-   printf("Number of blocks unzipped by threads: %d\n", fNUnzip);
+   printf("Number of blocks unzipped by tasks: %d\n", nunzip);
    printf("Number of hits: %d\n", fNFound);
    printf("Number of stalls: %d\n", fNStalls);
    printf("Number of misses: %d\n", fNMissed);
@@ -32,7 +32,15 @@ Class implementing or helping  the various TTree cloning method
 #include "TLeafO.h"
 #include "TLeafC.h"
 
+#include "TROOT.h"
+
 #include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef R__USE_IMT
+#include "tbb/task_group.h"
+#endif
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -96,6 +104,14 @@ Bool_t TTreeCloner::CompareEntry::operator()(UInt_t i1, UInt_t i2)
 /// This means that on the file the baskets will be in the order
 /// in which they will be needed when reading the whole tree
 /// sequentially.
+///
+/// If 'method' contains 'Recompress', the baskets of the branches whose
+/// compression settings (or compression dictionary) differ between the
+/// input and the output are not copied verbatim: they are decompressed and
+/// compressed again with the settings of the output branch, without
+/// unstreaming their content. When the implicit multi-threading is enabled
+/// the baskets are recompressed concurrently, in batches, and written in
+/// the same order as without recompression.
 
 TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t options) :
    fWarningMsg(),
@@ -105,6 +121,7 @@ TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t option
    fFromTree(from),
    fToTree(to),
    fMethod(method),
+   fRecompress(TString(method).Contains("recompress", TString::kIgnoreCase)),
    fFromBranches( from ? from->GetListOfLeaves()->GetEntries()+1 : 0),
    fToBranches( to ? to->GetListOfLeaves()->GetEntries()+1 : 0),
    fMaxBaskets(CollectBranches()),
@@ -169,6 +186,8 @@ TTreeCloner::TTreeCloner(TTree *from, TTree *to, Option_t *method, UInt_t option
 
 ////////////////////////////////////////////////////////////////////////////////
 /// Execute the cloning.
+/// Returns kFALSE if the cloning failed; the output tree is then incomplete
+/// and GetWarning() tells why.
 
 Bool_t TTreeCloner::Exec()
 {
@@ -178,10 +197,13 @@ Bool_t TTreeCloner::Exec()
    ImportClusterRanges();
    CopyStreamerInfos();
    CopyProcessIds();
+   CopyCompressionDicts();
    CloseOutWriteBaskets();
    CollectBaskets();
    SortBaskets();
-   WriteBaskets();
+   if (!WriteBaskets()) {
+      return kFALSE;
+   }
    CopyMemoryBaskets();
 
    return kTRUE;
@@ -330,6 +352,24 @@ UInt_t TTreeCloner::CollectBranches(TBranch *from, TBranch *to) {
 
    }
 
+   Int_t fromDictSize = 0;
+   const char *fromDict = from->GetCompressionDict(fromDictSize);
+   if (fromDict) {
+      Int_t toDictSize = 0;
+      const char *toDict = to->GetCompressionDict(toDictSize);
+      if (toDict && !fRecompress && (toDictSize != fromDictSize || memcmp(toDict, fromDict, toDictSize) != 0)) {
+         // The baskets can only be decompressed with the dictionary they were compressed with.
+         fWarningMsg.Form("The export branch and the import branch (%s) use different compression dictionaries",
+                          from->GetName());
+         if (!(fOptions & kNoWarnings)) {
+            Warning("TTreeCloner::CollectBranches", "%s", fWarningMsg.Data());
+         }
+         fIsValid = kFALSE;
+         fNeedConversion = kTRUE;
+         return 0;
+      }
+   }
+
    fFromBranches.AddLast(from);
    if (!from->TestBit(TBranch::kDoNotUseBufferMap)) {
       // Make sure that we reset the Buffer's map if needed.
@@ -493,6 +533,24 @@ void TTreeCloner::CopyStreamerInfos()
    delete l;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+/// Make the compression dictionaries used by the input baskets available
+/// to the output branches that do not have one yet.
+
+void TTreeCloner::CopyCompressionDicts()
+{
+   for(Int_t i=0; i<fToBranches.GetEntries(); ++i) {
+      TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+      TBranch *to = (TBranch*)fToBranches.UncheckedAt(i);
+      Int_t size = 0;
+      const char *dict = from->GetCompressionDict(size);
+      if (!dict || to->fCompressionDictSeek) continue;
+      to->fCompressionDict.assign(dict, dict + size);
+      to->fCompressionDictTrain = 0;
+      to->WriteCompressionDict();
+   }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Transfer the basket from the input file to the output file
 
@@ -615,10 +673,14 @@ void TTreeCloner::SortBaskets()
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-/// Transfer the basket from the input file to the output file
+/// Transfer the basket from the input file to the output file.
+/// Returns kFALSE if some baskets could not be transferred.
 
-void TTreeCloner::WriteBaskets()
+Bool_t TTreeCloner::WriteBaskets()
 {
+   if (fRecompress) {
+      return WriteBasketsRecompress();
+   }
    TBasket *basket = new TBasket();
    for(UInt_t j=0; j<fMaxBaskets; ++j) {
       TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[ fBasketIndex[j] ] );
@@ -651,4 +713,141 @@ void TTreeCloner::WriteBaskets()
       }
    }
    delete basket;
+   return kTRUE;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Transfer the basket from the input file to the output file, converting
+/// them to the compression settings of the output branches when needed.
+///
+/// The baskets are read in batches; the baskets of a batch which need to be
+/// converted are recompressed concurrently (if the implicit multi-threading
+/// is enabled) and the batch is then written in order.
+///
+/// If a basket cannot be read or converted, nothing more is written: a
+/// basket keeping the compression (or dictionary) of the input branch would
+/// not be readable in the output branch. The cloning is then marked as
+/// invalid and kFALSE is returned.
+
+Bool_t TTreeCloner::WriteBasketsRecompress()
+{
+   const UInt_t kBatchSize = 32;
+
+   TFile *fromfile = fFromTree->GetCurrentFile();
+   UInt_t nbranches = fFromBranches.GetEntries();
+   std::vector<Bool_t> convert(nbranches, kFALSE);
+   for(UInt_t i=0; i<nbranches; ++i) {
+      TBranch *from = (TBranch*)fFromBranches.UncheckedAt(i);
+      TBranch *to   = (TBranch*)fToBranches.UncheckedAt(i);
+      // Also loads the dictionaries, which must not be read from the tasks.
+      Int_t fromDictSize = 0, toDictSize = 0;
+      const char *fromDict = from->GetCompressionDict(fromDictSize);
+      const char *toDict = to->GetCompressionDict(toDictSize);
+      convert[i] = from->GetCompressionSettings() != to->GetCompressionSettings()
+                   || from->GetBasketFilter() != to->GetBasketFilter()
+                   || fromDictSize != toDictSize
+                   || (fromDictSize && memcmp(fromDict, toDict, fromDictSize) != 0);
+   }
+   if (fromfile && fromfile->GetVersion() <= 30401) {
+      // Very old files may have uncompressed baskets looking compressed.
+      std::fill(convert.begin(), convert.end(), kFALSE);
+   }
+
+   std::vector<TBasket*> baskets;
+   std::vector<UInt_t> batch;
+   std::vector<Int_t> failed;
+   UInt_t j = 0;
+   while (j < fMaxBaskets) {
+      // Read the next batch of on-file baskets.
+      // One flag per basket, set if it cannot be read, or later by the
+      // tasks if it cannot be converted.
+      batch.clear();
+      failed.clear();
+      while (j < fMaxBaskets && batch.size() < kBatchSize) {
+         UInt_t bi = fBasketIndex[j];
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[bi] );
+         Int_t index = fBasketNum[bi];
+         Long64_t pos = from->GetBasketSeek(index);
+         if (pos == 0) break;
+         TFile *bfile = from->GetFile(0);
+         if (from->GetBasketBytes()[index] == 0) {
+            TBasket tmp;
+            from->GetBasketBytes()[index] = tmp.ReadBasketBytes(pos, bfile);
+         }
+         if (baskets.size() <= batch.size()) baskets.push_back(new TBasket());
+         Int_t notloaded = baskets[batch.size()]->LoadBasketBuffers(pos, from->GetBasketBytes()[index], bfile, fFromTree);
+         failed.push_back(notloaded ? 2 : 0);
+         batch.push_back(bi);
+         ++j;
+      }
+
+      // Convert the baskets which need it.
+      UInt_t nbatch = batch.size();
+      auto recompress = [&](UInt_t k) {
+         UInt_t b = fBasketBranchNum[batch[k]];
+         if (convert[b] && !failed[k]) {
+            if (baskets[k]->RecompressBuffer((TBranch*)fFromBranches.UncheckedAt(b), (TBranch*)fToBranches.UncheckedAt(b)) < 0) {
+               failed[k] = 1;
+            }
+         }
+      };
+#ifdef R__USE_IMT
+      if (nbatch > 1 && ROOT::IsImplicitMTEnabled()) {
+         tbb::task_group g;
+         for (UInt_t k = 0; k < nbatch; ++k) {
+            g.run([&recompress, k]() { recompress(k); });
+         }
+         g.wait();
+      } else
+#endif
+      {
+         for (UInt_t k = 0; k < nbatch; ++k) recompress(k);
+      }
+
+      for (UInt_t k = 0; k < nbatch; ++k) {
+         if (!failed[k]) continue;
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[batch[k]] );
+         if (failed[k] == 2) {
+            fWarningMsg.Form("A basket of the branch %s could not be read from the input file.", from->GetName());
+         } else {
+            fWarningMsg.Form("A basket of the branch %s could not be converted to the compression settings of the output branch.",
+                             from->GetName());
+         }
+         if (!(fOptions & kNoWarnings)) {
+            Error("TTreeCloner::WriteBasketsRecompress", "%s", fWarningMsg.Data());
+         }
+         fIsValid = kFALSE;
+         for (auto basket : baskets) delete basket;
+         return kFALSE;
+      }
+
+      // Write them in order.
+      for (UInt_t k = 0; k < nbatch; ++k) {
+         UInt_t bi = batch[k];
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[bi] );
+         TBranch *to   = (TBranch*)fToBranches.UncheckedAt( fBasketBranchNum[bi] );
+         TBasket *basket = baskets[k];
+         basket->IncrementPidOffset(fPidOffset);
+         basket->CopyTo(to->GetFile(0));
+         to->AddBasket(*basket,kTRUE,fToStartEntries + from->GetBasketEntry()[ fBasketNum[bi] ]);
+      }
+
+      if (nbatch == 0) {
+         // A basket still in memory, it is compressed by the output branch.
+         UInt_t bi = fBasketIndex[j];
+         TBranch *from = (TBranch*)fFromBranches.UncheckedAt( fBasketBranchNum[bi] );
+         TBranch *to   = (TBranch*)fToBranches.UncheckedAt( fBasketBranchNum[bi] );
+         Int_t index = fBasketNum[bi];
+         TBasket *frombasket = from->GetBasket( index );
+         if (frombasket && frombasket->GetNevBuf()>0) {
+            TBasket *tobasket = (TBasket*)frombasket->Clone();
+            tobasket->SetBranch(to);
+            to->AddBasket(*tobasket, kFALSE, fToStartEntries+from->GetBasketEntry()[index]);
+            to->FlushOneBasket(to->GetWriteBasket());
+         }
+         ++j;
+      }
+   }
+   for (auto basket : baskets) delete basket;
+   return kTRUE;
 }
@@ -47,7 +47,7 @@ $(TREEPLAYERLIB): $(TREEPLAYERO) $(TREEPLAYERDO) $(ORDER_) $(MAINLIBS) \
 		@$(MAKELIB) $(PLATFORM) $(LD) "$(LDFLAGS)" \
 		   "$(SOFLAGS)" libTreePlayer.$(SOEXT) $@ \
 		   "$(TREEPLAYERO) $(TREEPLAYERDO)" \
-		   "$(TREEPLAYERLIBEXTRA)"
+		   "$(TREEPLAYERLIBEXTRA) $(TBBLIBDIR) $(TBBLIB)"
 
 $(call pcmrule,TREEPLAYER)
 	$(noop)
@@ -89,3 +89,7 @@ endif
 
 # Optimize dictionary with stl containers.
 $(TREEPLAYERDO): NOOPT = $(OPT)
+
+ifeq ($(BUILDTBB),yes)
+$(TREEPLAYERO): CXXFLAGS += $(TBBINCDIR:%=-I%)
+endif
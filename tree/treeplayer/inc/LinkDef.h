@@ -25,6 +25,7 @@
 #pragma link C++ class TTreeDrawArgsParser+;
 #pragma link C++ class TTreePerfStats+;
 #pragma link C++ class TTreeReader+;
+#pragma link C++ class TTreeProcessorMT+;
 #pragma link C++ class TTreeTableInterface;
 
 #pragma link C++ namespace ROOT;
@@ -0,0 +1,78 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+#ifndef ROOT_TTreeProcessorMT
+#define ROOT_TTreeProcessorMT
+
+#ifndef ROOT_TTreeReader
+#include "TTreeReader.h"
+#endif
+
+#include <functional>
+#include <string>
+#include <type_traits> //std::result_of
+#include <vector>
+
+class TObject;
+class TTree;
+
+class TTreeProcessorMT {
+public:
+   explicit TTreeProcessorMT(const std::vector<std::string> &fileNames, const std::string &treeName = "");
+   explicit TTreeProcessorMT(const std::string &fileName, const std::string &treeName = "");
+   explicit TTreeProcessorMT(TTree &tree);
+   ~TTreeProcessorMT() {}
+   TTreeProcessorMT(const TTreeProcessorMT &) = delete;
+   TTreeProcessorMT &operator=(const TTreeProcessorMT &) = delete;
+
+   // procFunc returns a ptr to TObject or inheriting classes and takes a TTreeReader& (both enforced at compile-time)
+   template<class F> auto Process(F procFunc, ULong64_t nToProcess = 0) -> typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type;
+
+   void     SetCacheSize(Long64_t cacheSize) { fCacheSize = cacheSize; }
+   Long64_t GetCacheSize() const { return fCacheSize; }
+
+private:
+   using ProcFunc_t = std::function<TObject*(TTreeReader&)>;
+
+   /// A range of entries of one of the files, starting at the beginning of a cluster.
+   struct TEntryRange {
+      unsigned fFileN;  ///< index of the file in fFileNames
+      Long64_t fStart;  ///< first entry of the range
+      Long64_t fEnd;    ///< entry following the last entry of the range
+   };
+
+   std::vector<TEntryRange> MakeRanges(ULong64_t nToProcess) const;
+   TObject *ProcessRanges(const ProcFunc_t &procFunc, ULong64_t nToProcess);
+
+   std::vector<std::string> fFileNames; ///< the files to be processed
+   std::string fTreeName;               ///< the name, or path in the files, of the tree to be processed
+   TTree      *fTree;                   ///< tree without file, processed in the calling thread
+   Long64_t    fCacheSize;              ///< size of the TTreeCache of each thread, -1 to keep the default of the tree
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// Execute procFunc on the entries of the tree, in parallel when the implicit
+/// multi-threading is enabled (see ROOT::EnableImplicitMT).
+/// The entries are split in ranges aligned on the clusters of the tree, which
+/// are handed to the threads as they become idle. procFunc is called once per
+/// range, possibly concurrently, with a TTreeReader limited to that range.
+/// The objects it returns are merged and the result is returned.
+/// At most nToProcess entries are processed, all of them if it is 0.
+template<class F>
+auto TTreeProcessorMT::Process(F procFunc, ULong64_t nToProcess) -> typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type
+{
+   using retType = typename std::result_of<F(std::reference_wrapper<TTreeReader>)>::type;
+   static_assert(std::is_constructible<TObject*, retType>::value, "procFunc must return a pointer to a class inheriting from TObject, and must take a reference to TTreeReader as the only argument");
+
+   ProcFunc_t func = [&procFunc](TTreeReader &reader) -> TObject* { return procFunc(reader); };
+   return static_cast<retType>(ProcessRanges(func, nToProcess));
+}
+
+#endif
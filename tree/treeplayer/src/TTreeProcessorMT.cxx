@@ -0,0 +1,308 @@
+// @(#)root/treeplayer:$Id$
+
+/*************************************************************************
+ * Copyright (C) 1995-2016, Rene Brun and Fons Rademakers.               *
+ * All rights reserved.                                                  *
+ *                                                                       *
+ * For the licensing terms see $ROOTSYS/LICENSE.                         *
+ * For the list of contributors see $ROOTSYS/README/CREDITS.             *
+ *************************************************************************/
+
+/**
+\class TTreeProcessorMT
+\ingroup treeplayer
+
+TTreeProcessorMT processes the entries of a TTree or a TChain with several
+threads of the same process, with the same interface as TProcPool::ProcTree.
+
+The entries of each file are split in ranges following the clusters of the
+tree (see TTree::GetClusterIterator), so that no basket is read by two
+threads. The ranges are handed out dynamically to the threads of the
+implicit multi-threading scheduler as they become idle. Each thread opens
+the files with its own TFile and TTreeCache, and runs the user function with
+a new TTreeReader for each range. The objects returned for the ranges are
+merged in each thread and then between threads.
+
+~~~{.cpp}
+ROOT::EnableImplicitMT();
+TTreeProcessorMT tp(fileNames, "events");
+auto h = tp.Process([](TTreeReader &reader) {
+   TTreeReaderValue<Float_t> px(reader, "px");
+   auto h = new TH1F("px", "px", 100, -4, 4);
+   while (reader.Next()) h->Fill(*px);
+   return h;
+});
+~~~
+
+The user function can be called concurrently from several threads and must
+not modify shared state. Without implicit multi-threading the ranges are
+processed one after the other in the calling thread.
+*/
+
+#include "TTreeProcessorMT.h"
+
+#include "TChain.h"
+#include "TClass.h"
+#include "TError.h"
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+#include <memory>
+
+#ifdef R__USE_IMT
+#include "tbb/blocked_range.h"
+#include "tbb/enumerable_thread_specific.h"
+#include "tbb/parallel_for.h"
+#include "tbb/partitioner.h"
+#endif
+
+namespace {
+
+////////////////////////////////////////////////////////////////////////////////
+/// Retrieve the tree 'treeName' from the file, or its first tree if the
+/// name is empty. The file owns the tree.
+
+TTree *RetrieveTree(TFile *file, const std::string &treeName)
+{
+   if (!treeName.empty())
+      return dynamic_cast<TTree*>(file->Get(treeName.c_str()));
+   if (file->GetListOfKeys()) {
+      for (auto k : *file->GetListOfKeys()) {
+         TKey *key = static_cast<TKey*>(k);
+         if (!strcmp(key->GetClassName(), "TTree") || !strcmp(key->GetClassName(), "TNtuple"))
+            return static_cast<TTree*>(file->Get(key->GetName()));
+      }
+   }
+   return nullptr;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Merge 'obj' into 'result' with the Merge method of its class and delete it.
+/// Return the merged object, 'obj' if 'result' is null.
+
+TObject *MergeInto(TObject *result, TObject *obj)
+{
+   if (!obj) return result;
+   if (!result) return obj;
+   ROOT::MergeFunc_t merge = result->IsA()->GetMerge();
+   if (!merge) {
+      ::Error("TTreeProcessorMT::Process", "could not find a merge method for %s, dropping a result",
+              result->IsA()->GetName());
+      delete obj;
+      return result;
+   }
+   TList mergelist;
+   mergelist.Add(obj);
+   merge(result, &mergelist, nullptr);
+   mergelist.Delete();
+   return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Detach the object (typically a histogram) from the file it was created
+/// in, which is closed before the end of the processing.
+
+void DetachResult(TObject *obj)
+{
+   if (!obj) return;
+   ROOT::DirAutoAdd_t func = obj->IsA()->GetDirectoryAutoAdd();
+   if (func) func(obj, nullptr);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// The state of one thread: the file and tree it currently reads, kept
+/// between consecutive ranges of the same file, and its merged result.
+
+struct TWorkerState {
+   std::unique_ptr<TFile> fFile;
+   TTree   *fTree = nullptr;
+   unsigned fFileN = 0;
+   TObject *fResult = nullptr;
+   bool     fBusy = false;
+};
+
+} // anonymous namespace
+
+////////////////////////////////////////////////////////////////////////////////
+/// Process the tree 'treeName' of the files 'fileNames'. If the name is
+/// empty the first tree of each file is processed.
+
+TTreeProcessorMT::TTreeProcessorMT(const std::vector<std::string> &fileNames, const std::string &treeName)
+   : fFileNames(fileNames), fTreeName(treeName), fTree(nullptr), fCacheSize(-1)
+{
+   ROOT::EnableThreadSafety();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Process the tree 'treeName' of the file 'fileName'.
+
+TTreeProcessorMT::TTreeProcessorMT(const std::string &fileName, const std::string &treeName)
+   : fFileNames(1, fileName), fTreeName(treeName), fTree(nullptr), fCacheSize(-1)
+{
+   ROOT::EnableThreadSafety();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Process a tree or a chain. The files are opened again by each thread; a
+/// tree which is not attached to a file, or not located in the directories
+/// of its file, is processed in the calling thread.
+
+TTreeProcessorMT::TTreeProcessorMT(TTree &tree)
+   : fTree(nullptr), fCacheSize(-1)
+{
+   ROOT::EnableThreadSafety();
+   if (tree.InheritsFrom(TChain::Class())) {
+      fTreeName = tree.GetName();
+      for (auto f : *static_cast<TChain&>(tree).GetListOfFiles())
+         fFileNames.emplace_back(f->GetTitle());
+      return;
+   }
+   TFile *file = tree.GetCurrentFile();
+   TDirectory *dir = tree.GetDirectory();
+   if (file && dir) {
+      // The path of the tree inside its file: the path of a directory starts
+      // with the path of its file, which may itself contain ":/" (root://...)
+      std::string filePath = file->GetPath();
+      std::string path = dir->GetPath();
+      if (path.compare(0, filePath.size(), filePath) == 0) {
+         path.erase(0, filePath.size());
+         if (!path.empty() && path[0] == '/') path.erase(0, 1);
+         fFileNames.emplace_back(file->GetName());
+         fTreeName = path.empty() ? tree.GetName() : path + "/" + tree.GetName();
+         return;
+      }
+   }
+   fTree = &tree;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Split the entries of all the files in ranges made of whole clusters,
+/// limited to the first nToProcess entries if it is not 0.
+
+std::vector<TTreeProcessorMT::TEntryRange> TTreeProcessorMT::MakeRanges(ULong64_t nToProcess) const
+{
+   // Opening and closing the files must not change the caller's gDirectory.
+   TDirectory::TContext ctxt;
+   std::vector<TEntryRange> ranges;
+   ULong64_t nEntries = 0;
+   for (unsigned fileN = 0; fileN < fFileNames.size(); ++fileN) {
+      std::unique_ptr<TFile> file(TFile::Open(fFileNames[fileN].c_str()));
+      if (!file || file->IsZombie()) {
+         ::Error("TTreeProcessorMT::Process", "could not open file %s, skipping it", fFileNames[fileN].c_str());
+         continue;
+      }
+      TTree *tree = RetrieveTree(file.get(), fTreeName);
+      if (!tree) {
+         ::Error("TTreeProcessorMT::Process", "cannot find tree with name %s in file %s, skipping it",
+                 fTreeName.c_str(), fFileNames[fileN].c_str());
+         continue;
+      }
+      Long64_t entries = tree->GetEntries();
+      TTree::TClusterIterator clusters = tree->GetClusterIterator(0);
+      Long64_t start;
+      while ((start = clusters()) < entries) {
+         Long64_t end = clusters.GetNextEntry();
+         if (end > entries) end = entries;
+         if (nToProcess && nEntries + (end - start) >= nToProcess) {
+            ranges.push_back({fileN, start, start + Long64_t(nToProcess - nEntries)});
+            return ranges;
+         }
+         ranges.push_back({fileN, start, end});
+         nEntries += end - start;
+      }
+   }
+   return ranges;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// Run procFunc on all the ranges and return the merged result.
+
+TObject *TTreeProcessorMT::ProcessRanges(const ProcFunc_t &procFunc, ULong64_t nToProcess)
+{
+   if (fTree) {
+      // Without a file there is nothing another thread could open.
+      TTreeReader reader(fTree);
+      Long64_t finish = fTree->GetEntries();
+      if (nToProcess && (ULong64_t)finish > nToProcess) finish = nToProcess;
+      if (reader.SetEntriesRange(-1, finish) != TTreeReader::kEntryValid) {
+         ::Error("TTreeProcessorMT::Process", "could not set TTreeReader to range 0 %lld", finish);
+         return nullptr;
+      }
+      TObject *res = procFunc(reader);
+      DetachResult(res);
+      return res;
+   }
+
+   const std::vector<TEntryRange> ranges = MakeRanges(nToProcess);
+   // The calling thread opens files too while processing its ranges.
+   TDirectory::TContext ctxt;
+
+   auto processRange = [&](TWorkerState &state, const TEntryRange &range) {
+      if (!state.fTree || state.fFileN != range.fFileN) {
+         state.fTree = nullptr;
+         state.fFile.reset(TFile::Open(fFileNames[range.fFileN].c_str()));
+         if (!state.fFile || state.fFile->IsZombie()) {
+            ::Error("TTreeProcessorMT::Process", "could not open file %s", fFileNames[range.fFileN].c_str());
+            return;
+         }
+         state.fFileN = range.fFileN;
+         state.fTree = RetrieveTree(state.fFile.get(), fTreeName);
+         if (!state.fTree) return;
+         // The ranges are already processed in parallel. Tasks reading the
+         // branches of one entry would let this thread, while waiting for
+         // them, be handed another range and reuse this state.
+         state.fTree->SetImplicitMT(kFALSE);
+         if (fCacheSize >= 0) state.fTree->SetCacheSize(fCacheSize);
+      }
+      // Keep the prefetching of the cache within the range.
+      state.fTree->SetCacheEntryRange(range.fStart, range.fEnd);
+
+      TTreeReader reader(state.fTree);
+      // Set first entry to start-1 so that the next call to TTreeReader::Next() sets the entry to the right value
+      if (reader.SetEntriesRange(range.fStart - 1, range.fEnd) != TTreeReader::kEntryValid) {
+         ::Error("TTreeProcessorMT::Process", "could not set TTreeReader to range %lld %lld", range.fStart, range.fEnd);
+         return;
+      }
+      TObject *res = procFunc(reader);
+      DetachResult(res);
+      state.fResult = MergeInto(state.fResult, res);
+   };
+
+#ifdef R__USE_IMT
+   if (ROOT::IsImplicitMTEnabled()) {
+      TObject *result = nullptr;
+      tbb::enumerable_thread_specific<TWorkerState> states;
+      // A grain of one range: tbb hands out the ranges to the idle threads.
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, ranges.size(), 1),
+                        [&](const tbb::blocked_range<size_t> &r) {
+                           // If the user function waits for tasks itself, this
+                           // thread can be handed another range while its state
+                           // is in use: that range gets a state of its own.
+                           TWorkerState &local = states.local();
+                           TWorkerState nested;
+                           TWorkerState &state = local.fBusy ? nested : local;
+                           state.fBusy = true;
+                           for (size_t i = r.begin(); i != r.end(); ++i)
+                              processRange(state, ranges[i]);
+                           if (&state == &nested)
+                              local.fResult = MergeInto(local.fResult, nested.fResult);
+                           else
+                              local.fBusy = false;
+                        },
+                        tbb::simple_partitioner());
+      for (auto &state : states) {
+         result = MergeInto(result, state.fResult);
+         state.fTree = nullptr;
+         state.fFile.reset();
+      }
+      return result;
+   }
+#endif
+   TWorkerState state;
+   for (const auto &range : ranges)
+      processRange(state, range);
+   return state.fResult;
+}